@@ -590,6 +590,11 @@ void setRemoteFileTimeouts(unsigned maxconnecttime,unsigned maxreadtime)
     clientSetRemoteFileTimeouts(maxconnecttime,maxreadtime);
 }
 
+void setRemoteFileReadAhead(unsigned window, size32_t blockSize, bool compress)
+{
+    clientSetRemoteFileReadAhead(window, blockSize, compress);
+}
+
 unsigned validateNodes(const SocketEndpointArray &epso,const char *dataDir, const char *mirrorDir, bool chkver, SocketEndpointArray &failures, UnsignedArray &failedcodes, StringArray &failedmessages, const char *filename)
 {
     // used for detecting duff nodes
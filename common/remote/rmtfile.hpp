@@ -88,6 +88,8 @@ extern REMOTE_API bool asyncCopyFileSection(const char *uuid,   // from genUUID
                         ); // returns true when done
 
 extern REMOTE_API void setRemoteFileTimeouts(unsigned maxconnecttime,unsigned maxreadtime);
+extern REMOTE_API void setRemoteFileReadAhead(unsigned window, size32_t blockSize=DEFAULT_READAHEAD_BLOCKSIZE, bool compress=false);
+// once a remote file is being read sequentially, have dafilesrv stream window blocks of blockSize ahead of the reads (optionally LZ4 compressed), 0 window = off
 
 #define DAFS_VALIDATE_CONNECT_FAIL  (0x01)
 #define DAFS_VALIDATE_BAD_VERSION   (0x02)
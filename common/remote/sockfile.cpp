@@ -37,6 +37,9 @@
 #include "jencrypt.hpp"
 #include "jset.hpp"
 #include "jhtree.hpp"
+#include "jlz4.hpp"
+#include "rtldynfield.hpp"
+#include "rtlrecord.hpp"
 
 #include "remoteerr.hpp"
 #include <atomic>
@@ -44,6 +47,12 @@
 #define SOCKET_CACHE_MAX 500
 
 #define MIN_KEYFILTSUPPORT_VERSION 20
+#define MIN_FLATFILTSUPPORT_VERSION 23
+
+#define STREAMREAD_LZ4 0x01                         // RFCstreamread flags
+#define MAX_STREAMREAD_BLOCKSIZE 0x1000000
+#define READAHEAD_MIN_SEQUENTIAL 2                  // sequential reads seen before a CRemoteFileIO starts streaming ahead
+#define MAX_READAHEAD_SIZE 0x10000000               // limit on window*blockSize, each file with read ahead buffers two windows
 
 #ifdef _DEBUG
 //#define SIMULATE_PACKETLOSS 1
@@ -162,7 +171,7 @@ struct dummyReadWrite
 // backward compatible modes
 typedef enum { compatIFSHnone, compatIFSHread, compatIFSHwrite, compatIFSHexec, compatIFSHall} compatIFSHmode;
 
-static const char *VERSTRING= "DS V2.1"       // dont forget FILESRV_VERSION in header
+static const char *VERSTRING= "DS V2.3"       // dont forget FILESRV_VERSION in header
 #ifdef _WIN32
 "Windows ";
 #else
@@ -227,6 +236,23 @@ void clientSetRemoteFileTimeouts(unsigned maxconnecttime,unsigned maxreadtime)
     maxReceiveTime = maxreadtime;
 }
 
+static unsigned readAheadWindow = 0;        // blocks streamed ahead of sequential reads, 0 = off
+static size32_t readAheadBlockSize = DEFAULT_READAHEAD_BLOCKSIZE;
+static bool readAheadCompress = false;
+static IThreadPool *readAheadPool = NULL;
+static CriticalSection readAheadPoolCrit;
+
+void clientSetRemoteFileReadAhead(unsigned window, size32_t blockSize, bool compress)
+{
+    if (blockSize > MAX_STREAMREAD_BLOCKSIZE)
+        blockSize = MAX_STREAMREAD_BLOCKSIZE;
+    if (blockSize && (window > MAX_READAHEAD_SIZE/blockSize))
+        window = MAX_READAHEAD_SIZE/blockSize; // so that window*blockSize fits in a size32_t
+    readAheadWindow = blockSize ? window : 0;
+    readAheadBlockSize = blockSize;
+    readAheadCompress = compress;
+}
+
 
 struct sRFTM        
 {
@@ -326,6 +352,10 @@ enum {
     RFCreadfilteredindex,
     RFCreadfilteredindexcount,
     RFCreadfilteredindexblob,
+// 2.2
+    RFCstreamread,
+// 2.3
+    RFCreadfilteredflat,
     RFCmax,
     RFCunknown = 255 // 0 would have been more sensible, but can't break backward compatibility
 };
@@ -377,6 +407,8 @@ const char *RFCStrings[] =
     RFCText(RFCreadfilteredindex),
     RFCText(RFCreadfilteredcount),
     RFCText(RFCreadfilteredblob),
+    RFCText(RFCstreamread),
+    RFCText(RFCreadfilteredflat),
     RFCText(RFCunknown),
 };
 static const char *getRFCText(RemoteFileCommandType cmd)
@@ -444,6 +476,8 @@ static const char *getRFSERRText(unsigned err)
             return "RFSERR_CopySectionFailed";
         case RFSERR_TreeCopyFailed:
             return "RFSERR_TreeCopyFailed";
+        case RFSERR_FilteredReadFailed:
+            return "RFSERR_FilteredReadFailed";
         case RAERR_InvalidUsernamePassword:
             return "RAERR_InvalidUsernamePassword";
         case RFSERR_MasterSeemsToHaveDied:
@@ -1240,8 +1274,37 @@ protected: friend class CRemoteFileIO;
             }
         }
 
-        if (!handleErrCode)
-            return;
+        if (handleErrCode)
+            checkReplyErrCode(reply);
+    }
+
+    void receiveRemoteReply(MemoryBuffer & reply)
+    {
+        // receives a further reply to the last command sent (e.g. the following blocks of a streamed read)
+        // caller must hold crit from before the command was sent until the last reply has been received
+        if (!socket)
+            throw createDafsException(DAFSERR_protocol_failure, "receiveRemoteReply: not connected");
+        try {
+            receiveBuffer(socket, reply, NORMAL_RETRIES);
+        }
+        catch (IJSOCK_Exception *) {
+            abortRemoteReply(); // rest of the reply stream is lost
+            throw;
+        }
+        checkReplyErrCode(reply);
+    }
+
+    void abortRemoteReply()
+    {
+        // the rest of a multi part reply may still be on its way, so the connection cannot be reused
+        // caller must hold crit
+        SocketEndpoint tep(ep);
+        setDafsEndpointPort(tep);
+        killSocket(tep);
+    }
+
+    void checkReplyErrCode(MemoryBuffer & reply)
+    {
         unsigned errCode;
         reply.read(errCode);
         if (errCode) {
@@ -1689,6 +1752,7 @@ MODULE_INIT(INIT_PRIORITY_STANDARD)
 MODULE_EXIT()
 {
     delete dirCSTable;
+    ::Release(readAheadPool);
 }
 
 void CEndpointCS::beforeDispose()
@@ -2248,6 +2312,13 @@ extern bool clientAsyncCopyFileSection(const char *uuid,
 
 //---------------------------------------------------------------------------
 
+class CRemoteReadAheadThreadFactory : public CInterface, implements IThreadFactory
+{
+public:
+    IMPLEMENT_IINTERFACE;
+    virtual IPooledThread *createNew() override;
+};
+
 class CRemoteFileIO : implements IFileIO, public CInterface
 {
 protected:
@@ -2264,6 +2335,208 @@ protected:
     compatIFSHmode compatmode;
     IFEflags extraFlags;
     bool disconnectonexit;
+
+    CriticalSection readAheadCrit;
+    MemoryBuffer readAheadBuffer;       // data streamed ahead of sequential reads
+    offset_t readAheadPos = 0;          // file offset of start of readAheadBuffer
+    bool readAheadEof = false;          // readAheadBuffer ends at end of file
+    // The window following readAheadBuffer is streamed into nextBuffer in the background whilst readAheadBuffer is read.
+    // Protected by readAheadCrit, except while nextPending when only the read ahead thread uses them.
+    MemoryBuffer nextBuffer;
+    offset_t nextPos = 0;
+    size32_t nextLen = 0;
+    bool nextEof = false;
+    bool nextReady = false;             // nextBuffer has been filled
+    bool nextPending = false;           // a read ahead thread is filling nextBuffer, nextDone is signalled when it finishes
+    Semaphore nextDone;
+    Owned<IException> nextException;
+    bool streamReadUnsupported = false; // server predates RFCstreamread
+    offset_t lastReadEnd = (offset_t)-1;
+    unsigned sequentialReads = 0;
+
+    void invalidateReadAhead()
+    {
+        CriticalBlock block(readAheadCrit);
+        waitNextReadAhead();
+        nextBuffer.clear();
+        nextReady = false;
+        readAheadBuffer.clear();
+        readAheadEof = false;
+        lastReadEnd = (offset_t)-1;
+        sequentialReads = 0;
+    }
+
+    void streamRead(offset_t pos, size32_t len, MemoryBuffer &target, bool &eof)
+    {
+        // dafilesrv replies with a block at a time, sending each as soon as it has been read without waiting to be asked,
+        // so the whole window costs a single round trip.
+        size32_t blockSize = readAheadBlockSize;
+        byte flags = readAheadCompress ? STREAMREAD_LZ4 : 0;
+        MemoryBuffer sendBuffer;
+        initSendBuffer(sendBuffer);
+        sendBuffer.append((RemoteFileCommandType)RFCstreamread).append(handle).append(pos).append(len).append(blockSize).append(flags);
+        target.clear();
+        MemoryBuffer replyBuffer;
+        CriticalBlock block(parent->crit); // nothing else may use the socket until the last block has been received
+        parent->sendRemoteCommand(sendBuffer, replyBuffer, false);
+        try {
+            for (;;) {
+                bool last;
+                size32_t sz;
+                replyBuffer.read(last).read(sz);
+                if (sz>replyBuffer.remaining())
+                    throw createDafsException(RFSERR_ReadFailed, "Stream read beyond buffer");
+                const void *data = replyBuffer.readDirect(sz);
+                if (flags & STREAMREAD_LZ4)
+                    LZ4DecompressToBuffer(target, data);
+                else
+                    target.append(sz, data);
+                if (last)
+                    break;
+                parent->receiveRemoteReply(replyBuffer.clear());
+            }
+        }
+        catch (...) {
+            target.clear();
+            parent->abortRemoteReply(); // whatever went wrong, the socket may still hold the rest of the stream
+            throw;
+        }
+        eof = target.length() < len;
+    }
+
+    inline bool isReadAheadBuffered(offset_t pos, size32_t len) const
+    {
+        offset_t bufferEnd = readAheadPos+readAheadBuffer.length();
+        return (pos>=readAheadPos) && ((pos+len<=bufferEnd) || (readAheadEof && (pos<=bufferEnd)));
+    }
+
+    void waitNextReadAhead()
+    {
+        // called in readAheadCrit
+        if (!nextPending)
+            return;
+        nextDone.wait();
+        nextPending = false;
+        if (nextException) {
+            Owned<IException> e = nextException.getClear();
+            IDAFS_Exception *dafsException = QUERYINTERFACE(e.get(), IDAFS_Exception);
+            if (dafsException && (dafsException->errorCode()==RFSERR_InvalidCommand))
+                streamReadUnsupported = true;
+            else
+                EXCLOG(e, "CRemoteFileIO read ahead"); // the data will be read again when it is needed
+        }
+    }
+
+    void startNextReadAhead(offset_t pos)
+    {
+        // called in readAheadCrit
+        nextPos = pos;
+        nextLen = readAheadWindow*readAheadBlockSize;
+        nextEof = false;
+        nextReady = false;
+        nextPending = true;
+        IThreadPool *pool;
+        {
+            CriticalBlock block(readAheadPoolCrit);
+            if (!readAheadPool) {
+                Owned<IThreadFactory> factory = new CRemoteReadAheadThreadFactory;
+                readAheadPool = createThreadPool("RemoteReadAheadPool", factory, NULL, 0, 0);
+            }
+            pool = readAheadPool;
+        }
+        try {
+            pool->start(LINK(this));
+        }
+        catch (...) {
+            Release();
+            nextPending = false;
+            throw;
+        }
+    }
+
+    bool readAheadRead(offset_t pos, size32_t len, void *data, size32_t &got)
+    {
+        // returns false if the read should be satisfied directly
+        CriticalBlock block(readAheadCrit);
+        if (pos == lastReadEnd)
+            sequentialReads++;
+        else
+            sequentialReads = 0;
+        lastReadEnd = pos+len;
+        if (!isReadAheadBuffered(pos, len)) {
+            waitNextReadAhead();
+            offset_t bufferEnd = readAheadPos+readAheadBuffer.length();
+            if (nextReady && (nextPos==bufferEnd) && (pos>=readAheadPos) && (pos<=bufferEnd)) {
+                // move on to the next window, keeping whatever the read still needs from this one
+                size32_t ofs = (size32_t)(pos-readAheadPos);
+                size32_t keep = readAheadBuffer.length()-ofs;
+                if (keep) {
+                    byte *base = (byte *)readAheadBuffer.bufferBase();
+                    memmove(base, base+ofs, keep);
+                    readAheadBuffer.setLength(keep);
+                    readAheadBuffer.append(nextBuffer);
+                    readAheadPos = pos;
+                }
+                else {
+                    readAheadBuffer.swapWith(nextBuffer);
+                    readAheadPos = nextPos;
+                }
+                readAheadEof = nextEof;
+            }
+            nextBuffer.clear();
+            nextReady = false;
+        }
+        if (!isReadAheadBuffered(pos, len)) {
+            unsigned window = readAheadWindow;
+            if (!window || streamReadUnsupported || (sequentialReads<READAHEAD_MIN_SEQUENTIAL))
+                return false;
+            size32_t streamLen = window*readAheadBlockSize; // clamped by clientSetRemoteFileReadAhead
+            if (len >= streamLen)
+                return false;
+            try {
+                readAheadPos = pos;
+                streamRead(pos, streamLen, readAheadBuffer, readAheadEof);
+            }
+            catch (IDAFS_Exception *e) {
+                readAheadBuffer.clear();
+                if (e->errorCode()!=RFSERR_InvalidCommand)
+                    throw;
+                e->Release();
+                streamReadUnsupported = true;
+                return false;
+            }
+            catch (IJSOCK_Exception *e) {
+                // fall back to a direct read, which will retry/reopen
+                EXCLOG(e,"CRemoteFileIO::streamRead");
+                e->Release();
+                readAheadBuffer.clear();
+                return false;
+            }
+        }
+        size32_t ofs = (size32_t)(pos-readAheadPos);
+        got = readAheadBuffer.length()-ofs;
+        if (got>len)
+            got = len;
+        memcpy(data, readAheadBuffer.toByteArray()+ofs, got);
+        // double buffer - stream the following window whilst this one is read
+        if (!readAheadEof && !nextPending && !nextReady && readAheadWindow && !streamReadUnsupported)
+            startNextReadAhead(readAheadPos+readAheadBuffer.length());
+        return true;
+    }
+public:
+    void streamNextReadAhead()
+    {
+        // called on a read ahead thread whilst nextPending
+        try {
+            streamRead(nextPos, nextLen, nextBuffer, nextEof);
+            nextReady = true;
+        }
+        catch (IException *e) {
+            nextException.setown(e);
+        }
+        nextDone.signal();
+    }
+
 public:
     IMPLEMENT_IINTERFACE
     CRemoteFileIO(CRemoteFile *_parent)
@@ -2293,6 +2566,7 @@ public:
     void close()
     {
         if (handle) {
+            invalidateReadAhead();
             try {
                 MemoryBuffer sendBuffer;
                 initSendBuffer(sendBuffer);
@@ -2413,10 +2687,11 @@ public:
         size32_t got;
         MemoryBuffer replyBuffer;
         CCycleTimer timer;
-        const void *b;
+        const void *b = data;
         try
         {
-            b = doRead(pos,len,replyBuffer,got,data);
+            if (!readAheadRead(pos,len,data,got))
+                b = doRead(pos,len,replyBuffer,got,data);
         }
         catch (...)
         {
@@ -2499,6 +2774,7 @@ public:
 
     size32_t write(offset_t pos, size32_t len, const void * data)
     {
+        invalidateReadAhead();
         unsigned tries=0;
         size32_t ret = 0;
         CCycleTimer timer;
@@ -2548,6 +2824,7 @@ public:
         initSendBuffer(sendBuffer);
         MemoryBuffer replyBuffer;
         const char * fname = file->queryFilename();
+        invalidateReadAhead();
         sendBuffer.append((RemoteFileCommandType)RFCappend).append(handle).append(fname).append(pos).append(len);
         parent->sendRemoteCommand(sendBuffer, replyBuffer, false, true); // retry not safe
         
@@ -2565,6 +2842,7 @@ public:
         MemoryBuffer sendBuffer;
         initSendBuffer(sendBuffer);
         MemoryBuffer replyBuffer;
+        invalidateReadAhead();
         sendBuffer.append((RemoteFileCommandType)RFCsetsize).append(handle).append(size);
         parent->sendRemoteCommand(sendBuffer, replyBuffer, false, true);
         // retry using reopen TBD
@@ -2580,6 +2858,36 @@ public:
     }
 };
 
+class CRemoteReadAheadThread : public CInterface, implements IPooledThread
+{
+    Owned<CRemoteFileIO> io;
+public:
+    IMPLEMENT_IINTERFACE;
+
+    virtual void init(void *param) override
+    {
+        io.setown((CRemoteFileIO *) param);
+    }
+    virtual void main() override
+    {
+        Owned<CRemoteFileIO> current = io.getClear();
+        current->streamNextReadAhead();
+    }
+    virtual bool stop() override
+    {
+        return true;
+    }
+    virtual bool canReuse() override
+    {
+        return true;
+    }
+};
+
+IPooledThread *CRemoteReadAheadThreadFactory::createNew()
+{
+    return new CRemoteReadAheadThread;
+}
+
 void clientDisconnectRemoteIoOnExit(IFileIO *fileio,bool set)
 {
     CRemoteFileIO *cfileio = QUERYINTERFACE(fileio,CRemoteFileIO);
@@ -3236,6 +3544,18 @@ public:
             return directKM->lookupSkip(seek, seekGEOffset, seeklen);
         UNIMPLEMENTED;
     }
+    virtual void queuePrefetch() override
+    {
+        if (!remoteSupport())
+            directKM->queuePrefetch();
+        // else leaves are read by dafilesrv, nothing to prefetch locally
+    }
+    virtual unsigned prefetchLeaves() override
+    {
+        if (!remoteSupport())
+            return directKM->prefetchLeaves();
+        return 0;
+    }
     virtual void append(IKeySegmentMonitor *segment) override
     {
         if (!remoteSupport())
@@ -3288,6 +3608,99 @@ IKeyManager *createKeyManager(const char *filename, unsigned keySize, unsigned c
 
 //////////////
 
+// Binary type info is not self delimiting, so is framed by its size within request messages
+static void serializeTypeInfo(MemoryBuffer &mb, const RtlTypeInfo *type)
+{
+    DelayedSizeMarker typeSize(mb);
+    dumpTypeInfo(mb, type);
+    typeSize.write();
+}
+
+static const RtlTypeInfo *deserializeTypeInfo(IRtlFieldTypeDeserializer &deserializer, MemoryBuffer &mb)
+{
+    size32_t typeSize;
+    mb.read(typeSize);
+    MemoryBuffer typeMb;
+    typeMb.setBuffer(typeSize, (void *)mb.readDirect(typeSize));
+    typeMb.setEndian(__BIG_ENDIAN);
+    return deserializer.deserialize(typeMb);
+}
+
+class CRemoteFilteredFileReader : public CSimpleInterfaceOf<IRemoteFilteredFileReader>
+{
+    Linked<IFileIO> iFileIO;
+    CRemoteFileIO *remoteIO;
+    MemoryBuffer requestMb;         // serialized layouts and filters, resent with each request
+    MemoryBuffer replyMb;
+    offset_t nextPos;
+    offset_t endPos;
+    offset_t rowOffset = 0;
+    unsigned rowsRemaining = 0;
+    bool more = true;
+
+    void fetch()
+    {
+        MemoryBuffer sendBuffer;
+        initSendBuffer(sendBuffer);
+        sendBuffer.append((RemoteFileCommandType)RFCreadfilteredflat).append(remoteIO->getHandle());
+        sendBuffer.append(requestMb.length(), requestMb.toByteArray());
+        sendBuffer.append(nextPos).append(endPos);
+        remoteIO->sendRemoteCommand(sendBuffer, replyMb.clear());
+        replyMb.read(rowsRemaining).read(more).read(nextPos);
+    }
+public:
+    CRemoteFilteredFileReader(IFileIO *_iFileIO, CRemoteFileIO *_remoteIO, const RtlTypeInfo *inputType, const RtlTypeInfo *outputType, IIndexReadContext *filters, offset_t startOffset, offset_t length)
+        : iFileIO(_iFileIO), remoteIO(_remoteIO), nextPos(startOffset)
+    {
+        endPos = ((offset_t)-1 == length) ? length : startOffset+length;
+        requestMb.setEndian(__BIG_ENDIAN);
+        serializeTypeInfo(requestMb, inputType);
+        requestMb.append(nullptr != outputType);
+        if (outputType)
+            serializeTypeInfo(requestMb, outputType);
+        unsigned numFilters = filters ? filters->ordinality() : 0;
+        requestMb.append(numFilters);
+        for (unsigned f=0; f<numFilters; f++)
+            filters->item(f)->serialize(requestMb);
+    }
+// IRemoteFilteredFileReader impl.
+    virtual const void *nextRow(size32_t &size) override
+    {
+        while (!rowsRemaining)
+        {
+            if (!more)
+                return nullptr;
+            fetch();
+        }
+        --rowsRemaining;
+        replyMb.read(rowOffset).read(size);
+        return replyMb.readDirect(size);
+    }
+    virtual offset_t queryRowOffset() const override
+    {
+        return rowOffset;
+    }
+};
+
+IRemoteFilteredFileReader *createRemoteFilteredFileReader(IFileIO *fileIO, const RtlTypeInfo *inputType, const RtlTypeInfo *outputType, IIndexReadContext *filters, offset_t startOffset, offset_t length)
+{
+    CRemoteFileIO *remoteIO = QUERYINTERFACE(fileIO, CRemoteFileIO);
+    if (!remoteIO)
+        return nullptr;
+    StringBuffer verString;
+    if (getRemoteVersion(*remoteIO, verString) < MIN_FLATFILTSUPPORT_VERSION)
+        return nullptr;
+    return new CRemoteFilteredFileReader(fileIO, remoteIO, inputType, outputType, filters, startOffset, length);
+}
+
+IRemoteFilteredFileReader *createRemoteFilteredFileReader(IFile *file, const RtlTypeInfo *inputType, const RtlTypeInfo *outputType, IIndexReadContext *filters, offset_t startOffset, offset_t length)
+{
+    Owned<IFileIO> iFileIO = file->open(IFOread);
+    if (!iFileIO)
+        throw MakeStringException(0, "createRemoteFilteredFileReader: Failed to open file: %s", file->queryFilename());
+    return createRemoteFilteredFileReader(iFileIO, inputType, outputType, filters, startOffset, length);
+}
+
 extern unsigned stopRemoteServer(ISocket * socket)
 {
     // used to have a global critical section here
@@ -3823,6 +4236,49 @@ struct OpenFileInfo
 };
 
 #define MAX_KEYDATA_SZ 0x10000
+#define MAX_FLATDATA_SZ 0x100000                    // filtered flat rows returned per RFCreadfilteredflat request
+#define MAX_FLATSCAN_SZ 0x4000000                   // file data scanned per RFCreadfilteredflat request
+#define FLATROW_PEEK_SZ 0x10000                     // initial window used to size variable length rows
+
+// Builds rows in place at the end of a MemoryBuffer, used to translate rows directly into a reply
+class CMemoryBufferRowBuilder : public ARowBuilder
+{
+    MemoryBuffer &buffer;
+    unsigned startOffset = 0;
+public:
+    CMemoryBufferRowBuilder(MemoryBuffer &_buffer) : buffer(_buffer)
+    {
+    }
+    inline void startRow()
+    {
+        startOffset = buffer.length();
+        self = nullptr;
+    }
+    inline void finishRow(size32_t size)
+    {
+        buffer.reserve(size); // NB: setLength would clear the row just built
+        self = nullptr;
+    }
+    virtual byte * ensureCapacity(size32_t required, const char * fieldName) override
+    {
+        buffer.ensureCapacity(required);
+        self = (byte *)buffer.bufferBase()+startOffset;
+        return self;
+    }
+    virtual IEngineRowAllocator *queryAllocator() const override
+    {
+        return nullptr;
+    }
+protected:
+    virtual byte * createSelf() override
+    {
+        return ensureCapacity(0, nullptr);
+    }
+    virtual void reportMissingRow() const override
+    {
+        throwUnexpected();
+    }
+};
 
 class CRemoteFileServer : implements IRemoteFileServer, public CInterface
 {
@@ -4926,6 +5382,71 @@ public:
         return true;
     }
 
+    bool cmdStreamRead(MemoryBuffer & msg, MemoryBuffer & reply, CRemoteClientHandler &client, CClientStats &stats)
+    {
+        // Replies with a block at a time, pushing each to the client as soon as it has been read rather than waiting
+        // for the next request. Each block is errcode, last flag, size, data (LZ4 compressed if requested).
+        // The final block (or an error) is left in reply for the caller to send.
+        int handle;
+        __int64 pos;
+        size32_t len;
+        size32_t blockSize;
+        byte flags;
+        msg.read(handle).read(pos).read(len).read(blockSize).read(flags);
+        IFileIO *fileio;
+        if (!checkFileIOHandle(reply, handle, fileio))
+            return false;
+        if ((0 == blockSize) || (blockSize > MAX_STREAMREAD_BLOCKSIZE))
+            blockSize = MAX_STREAMREAD_BLOCKSIZE;
+        if (TF_TRACE)
+            PROGLOG("stream read file,  handle = %d, pos = %" I64F "d, toread = %d, blocksize = %d, flags = %d",handle,pos,len,blockSize,(int)flags);
+        MemoryAttr blockBuffer;
+        MemoryBuffer compressed;
+        unsigned posOfErr = reply.length();
+        for (;;) {
+            size32_t toread = len>blockSize?blockSize:len;
+            reply.append((unsigned)RFEnoerror);
+            unsigned posOfLast = reply.length();
+            reply.append(false);
+            unsigned posOfLength = reply.length();
+            reply.reserve(sizeof(size32_t));
+            void *data = (flags & STREAMREAD_LZ4) ? blockBuffer.ensure(toread) : reply.reserve(toread);
+            size32_t numRead;
+            try {
+                numRead = fileio->read(pos,toread,data);
+            }
+            catch (IException *e)
+            {
+                reply.setLength(posOfErr);
+                StringBuffer s;
+                e->errorMessage(s);
+                appendErr3(reply, RFSERR_ReadFailed, e->errorCode(), s.str());
+                e->Release();
+                return false;
+            }
+            stats.addRead(numRead);
+            pos += numRead;
+            len -= numRead;
+            size32_t sz = numRead;
+            if (flags & STREAMREAD_LZ4) {
+                LZ4CompressToBuffer(compressed.clear(), numRead, data);
+                sz = compressed.length();
+                reply.setLength(posOfLength+sizeof(size32_t));
+                reply.append(sz, compressed.toByteArray());
+            }
+            else
+                reply.setLength(posOfLength+sizeof(size32_t)+numRead);
+            reply.writeEndianDirect(posOfLength,sizeof(sz),&sz);
+            bool last = (numRead<toread) || (0 == len);
+            if (last) {
+                reply.writeDirect(posOfLast,sizeof(last),&last);
+                return true;
+            }
+            sendBuffer(client.socket, reply);
+            reply.setLength(posOfErr);
+        }
+    }
+
     bool cmdReadFilteredIndex(MemoryBuffer & msg, MemoryBuffer & reply, CClientStats &stats)
     {
         Owned<IKeyManager> keyManager = prepKey(msg, true);
@@ -4981,6 +5502,138 @@ public:
         return true;
     }
 
+    bool cmdReadFilteredFlat(MemoryBuffer & msg, MemoryBuffer & reply, CClientStats &stats)
+    {
+        // Scans a flat file from pos, returning rows that match the segment monitors, optionally translated to an
+        // output layout. Returns when enough rows have been gathered or data scanned, along with the position to continue from.
+        int handle;
+        msg.read(handle);
+        IFileIO *fileio;
+        if (!checkFileIOHandle(reply, handle, fileio))
+            return false;
+        Owned<IRtlFieldTypeDeserializer> inDeserializer = createRtlFieldTypeDeserializer();
+        const RtlTypeInfo *inType = deserializeTypeInfo(*inDeserializer, msg);
+        bool project;
+        msg.read(project);
+        Owned<IRtlFieldTypeDeserializer> outDeserializer;
+        const RtlTypeInfo *outType = inType;
+        if (project)
+        {
+            outDeserializer.setown(createRtlFieldTypeDeserializer());
+            outType = deserializeTypeInfo(*outDeserializer, msg);
+        }
+        // matched individually, rather than merged into a SegMonitorList, as the fields need not be contiguous
+        IArrayOf<IKeySegmentMonitor> segMonitors;
+        unsigned numFilters;
+        msg.read(numFilters);
+        while (numFilters--)
+            segMonitors.append(*deserializeKeySegmentMonitor(msg));
+        offset_t pos, end;
+        msg.read(pos).read(end);
+
+        RtlRecord inRecord(inType->queryFields(), true);
+        RtlRecord outRecord(outType->queryFields(), true);
+        Owned<const IDynamicTransform> translator;
+        if (project)
+        {
+            translator.setown(createRecordTranslator(outRecord, inRecord));
+            if (!translator->canTranslate())
+                throw createDafsException(RFSERR_FilteredReadFailed, "Cannot translate to requested output layout");
+            if (!translator->needsTranslate())
+                translator.clear();
+        }
+        offset_t fileSize = fileio->size();
+        if (end > fileSize)
+            end = fileSize;
+        if (TF_TRACE)
+            PROGLOG("filtered flat read,  handle = %d, pos = %" I64F "d, end = %" I64F "d, filters = %u",handle,pos,end,segMonitors.ordinality());
+
+        reply.append((unsigned)RFEnoerror);
+        DelayedMarker<unsigned> numReturned(reply);
+        DelayedMarker<bool> more(reply);
+        DelayedMarker<offset_t> nextPos(reply);
+        unsigned numRecs = 0;
+        unsigned startReplyLen = reply.length();
+        if (pos < end)
+        {
+            Owned<ISerialStream> in = createFileSerialStream(fileio, pos, end-pos);
+            unsigned numOffsets = inRecord.getNumVarFields() + 1;
+            size_t * variableOffsets = (size_t *)alloca(numOffsets * sizeof(size_t));
+            RtlRow row(inRecord, nullptr, numOffsets, variableOffsets);
+            CMemoryBufferRowBuilder builder(reply);
+            size32_t fixedSize = inRecord.getFixedSize();
+            offset_t startPos = pos;
+            while (!in->eos())
+            {
+                offset_t rowPos = in->tell();
+                size32_t rowSize;
+                const byte *rowData;
+                if (fixedSize)
+                {
+                    size32_t got;
+                    rowData = (const byte *)in->peek(fixedSize, got);
+                    if (got < fixedSize)
+                        throw createDafsException(RFSERR_FilteredReadFailed, "Partial row at end of file");
+                    rowSize = fixedSize;
+                    row.setRow(rowData);
+                }
+                else
+                {
+                    // grow the window until it holds the whole row, or the remainder of the file
+                    size32_t window = FLATROW_PEEK_SZ;
+                    for (;;)
+                    {
+                        size32_t got;
+                        row.setRow(in->peek(window, got));
+                        rowSize = row.getRecordSize();
+                        if (rowSize <= got)
+                            break;
+                        if (got < window)
+                            throw createDafsException(RFSERR_FilteredReadFailed, "Partial row at end of file");
+                        window = rowSize;
+                    }
+                    // the row is matched in place, so peek exactly what it needs
+                    size32_t got;
+                    rowData = (const byte *)in->peek(rowSize, got);
+                    assertex(got >= rowSize);
+                    row.setRow(rowData);
+                }
+                bool matched = true;
+                ForEachItemIn(i, segMonitors)
+                {
+                    if (!segMonitors.item(i).matches(&row))
+                    {
+                        matched = false;
+                        break;
+                    }
+                }
+                if (matched)
+                {
+                    reply.append(rowPos);
+                    DelayedSizeMarker rowSz(reply);
+                    if (translator)
+                    {
+                        builder.startRow();
+                        builder.finishRow(translator->translate(builder, rowData));
+                    }
+                    else
+                        reply.append(rowSize, rowData);
+                    rowSz.write();
+                    ++numRecs;
+                }
+                in->skip(rowSize);
+                if ((reply.length()-startReplyLen >= MAX_FLATDATA_SZ) || (in->tell()-startPos >= MAX_FLATSCAN_SZ))
+                    break;
+            }
+            pos = in->tell();
+            stats.addRead(pos-startPos);
+        }
+        numReturned.write(numRecs);
+        more.write(pos < end);
+        nextPos.write(pos);
+        return true;
+    }
+
     bool cmdSize(MemoryBuffer & msg, MemoryBuffer & reply)
     {
         int handle;
@@ -5707,6 +6360,7 @@ public:
             case RFCcloseIO:
             case RFCopenIO:
             case RFCread:
+            case RFCstreamread:
             case RFCsize:
             case RFCwrite:
             case RFCexists:
@@ -5721,6 +6375,7 @@ public:
             case RFCreadfilteredindex:
             case RFCreadfilteredindexcount:
             case RFCreadfilteredindexblob:
+            case RFCreadfilteredflat:
             case RFCgettime:
             case RFCsettime:
             case RFCcreatedir:
@@ -5759,9 +6414,11 @@ public:
             {
                 MAPCOMMANDSTATS(RFCread, cmdRead, *stats);
                 MAPCOMMANDSTATS(RFCwrite, cmdWrite, *stats);
+                MAPCOMMANDCLIENTSTATS(RFCstreamread, cmdStreamRead, *client, *stats);
                 MAPCOMMANDSTATS(RFCreadfilteredindex, cmdReadFilteredIndex, *stats);
                 MAPCOMMANDSTATS(RFCreadfilteredindexcount, cmdReadFilteredIndexCount, *stats);
                 MAPCOMMANDSTATS(RFCreadfilteredindexblob, cmdReadFilteredIndexBlob, *stats);
+                MAPCOMMANDSTATS(RFCreadfilteredflat, cmdReadFilteredFlat, *stats);
                 MAPCOMMANDCLIENTSTATS(RFCappend, cmdAppend, *client, *stats);
                 MAPCOMMAND(RFCcloseIO, cmdCloseFileIO);
                 MAPCOMMANDCLIENT(RFCopenIO, cmdOpenFileIO, *client);
@@ -6338,6 +6995,8 @@ class RemoteFileTest : public CppUnit::TestFixture
         CPPUNIT_TEST(testStartServer);
         CPPUNIT_TEST(testBasicFunctionality);
         CPPUNIT_TEST(testCopy);
+        CPPUNIT_TEST(testStreamRead);
+        CPPUNIT_TEST(testFilteredFlatRead);
         CPPUNIT_TEST(testOther);
         CPPUNIT_TEST(testConfiguration);
         CPPUNIT_TEST(testDirectoryMonitoring);
@@ -6494,6 +7153,157 @@ protected:
         // validate new size
         CPPUNIT_ASSERT(iFile1Copy->size() == testLen);
     }
+    void testStreamRead()
+    {
+        VStringBuffer filePath("%s%s", basePath.str(), "file3");
+        Owned<IFile> iFile = createIFile(filePath);
+        Owned<IFileIO> iFileIO = iFile->open(IFOcreate);
+        CPPUNIT_ASSERT(iFileIO);
+
+        // write 64MB of semi-compressible data, with an odd length so the last stream ends mid block
+        const size32_t writeSize = 0x100000;
+        const unsigned numWrites = 64;
+        const size32_t tail = 12345;
+        MemoryBuffer mb;
+        byte *buf = (byte *)mb.reserveTruncate(writeSize);
+        CRC32 writeCrc;
+        offset_t fileSize = 0;
+        for (unsigned w=0; w<=numWrites; w++)
+        {
+            size32_t sz = (w==numWrites) ? tail : writeSize;
+            for (unsigned b=0; b<sz; b++)
+                buf[b] = (b%7) ? (byte)w : (byte)(getRandom()%256);
+            writeCrc.tally(sz, buf);
+            CPPUNIT_ASSERT(sz == iFileIO->write(fileSize, sz, buf));
+            fileSize += sz;
+        }
+        iFileIO.clear();
+
+        // read back sequentially with a typical reader buffer size, without and with read-ahead
+        struct { unsigned window; size32_t blockSize; bool compress; } configs[] = { { 0, 0, false }, { 8, 0x40000, false }, { 8, 0x40000, true }, { 4, 0x100000, true } };
+        const size32_t readSize = 0x10000;
+        for (unsigned c=0; c<_elements_in(configs); c++)
+        {
+            setRemoteFileReadAhead(configs[c].window, configs[c].blockSize, configs[c].compress);
+            iFileIO.setown(iFile->open(IFOread));
+            CPPUNIT_ASSERT(iFileIO);
+            CRC32 readCrc;
+            offset_t pos = 0;
+            CCycleTimer timer;
+            for (;;)
+            {
+                size32_t got = iFileIO->read(pos, readSize, buf);
+                readCrc.tally(got, buf);
+                pos += got;
+                if (got < readSize)
+                    break;
+            }
+            unsigned ms = timer.elapsedMs();
+            iFileIO.clear();
+            PROGLOG("testStreamRead window=%u blockSize=%u compress=%s: %" I64F "u bytes in %u ms (%.1f MB/s)", configs[c].window, configs[c].blockSize, boolToStr(configs[c].compress), pos, ms, ms ? ((double)pos*1000)/((double)ms*0x100000) : 0.0);
+            CPPUNIT_ASSERT(pos == fileSize);
+            CPPUNIT_ASSERT(writeCrc.get() == readCrc.get());
+        }
+        setRemoteFileReadAhead(0);
+
+        CPPUNIT_ASSERT(iFile->remove());
+    }
+    void testFilteredFlatRead()
+    {
+        VStringBuffer filePath("%s%s", basePath.str(), "file4");
+        Owned<IFile> iFile = createIFile(filePath);
+        Owned<IFileIO> iFileIO = iFile->open(IFOcreate);
+        CPPUNIT_ASSERT(iFileIO);
+
+        // { unsigned4 id; string name; unsigned4 value; }
+        RtlIntTypeInfo uint4Type(type_int|type_unsigned, sizeof(unsigned));
+        RtlStringTypeInfo varStrType(type_string|RFTMunknownsize, 0);
+        RtlFieldInfo idField("id", nullptr, &uint4Type);
+        RtlFieldInfo nameField("name", nullptr, &varStrType);
+        RtlFieldInfo valueField("value", nullptr, &uint4Type);
+        const RtlFieldInfo * const inFields[] = { &idField, &nameField, &valueField, nullptr };
+        RtlRecordTypeInfo inType(type_record|RFTMunknownsize, 0, inFields);
+        // { unsigned4 id; unsigned4 value; }
+        const RtlFieldInfo * const outFields[] = { &idField, &valueField, nullptr };
+        RtlRecordTypeInfo outType(type_record, 2*sizeof(unsigned), outFields);
+
+        // enough rows that an unfiltered read needs several requests
+        const unsigned numRows = 100000;
+        MemoryBuffer mb;
+        offset_t fileSize = 0;
+        for (unsigned r=0; r<numRows; r++)
+        {
+            VStringBuffer name("row%u", r);
+            unsigned value = r % 10;
+            mb.clear().append(r).append(name.length()).append(name.length(), name.str()).append(value);
+            CPPUNIT_ASSERT(mb.length() == iFileIO->write(fileSize, mb.length(), mb.toByteArray()));
+            fileSize += mb.length();
+        }
+        iFileIO.clear();
+
+        // no filter or projection
+        Owned<IRemoteFilteredFileReader> reader = createRemoteFilteredFileReader(iFile, &inType, nullptr, nullptr);
+        CPPUNIT_ASSERT(reader);
+        unsigned count = 0;
+        offset_t total = 0;
+        size32_t size;
+        while (reader->nextRow(size))
+        {
+            CPPUNIT_ASSERT(reader->queryRowOffset() == total);
+            ++count;
+            total += size;
+        }
+        CPPUNIT_ASSERT(count == numRows);
+        CPPUNIT_ASSERT(total == fileSize);
+
+        // filter on a fixed offset field
+        SegMonitorList filters;
+        unsigned searchId = 12345;
+        filters.append(createSingleKeySegmentMonitor(false, 0, sizeof(unsigned), &searchId));
+        reader.setown(createRemoteFilteredFileReader(iFile, &inType, nullptr, &filters));
+        const byte *row = (const byte *)reader->nextRow(size);
+        CPPUNIT_ASSERT(row);
+        CPPUNIT_ASSERT(size == 2*sizeof(unsigned)+sizeof(size32_t)+strlen("row12345"));
+        CPPUNIT_ASSERT(0 == memcmp(row+2*sizeof(unsigned), "row12345", strlen("row12345")));
+        CPPUNIT_ASSERT(!reader->nextRow(size));
+
+        // filter on a field following a variable length field, and project away the variable length field
+        filters.reset();
+        unsigned searchValue = 3;
+        filters.append(createNewVarOffsetKeySegmentMonitor(createSingleKeySegmentMonitor(false, 0, sizeof(unsigned), &searchValue), 2*sizeof(unsigned), 2));
+        reader.setown(createRemoteFilteredFileReader(iFile, &inType, &outType, &filters));
+        count = 0;
+        while (nullptr != (row = (const byte *)reader->nextRow(size)))
+        {
+            CPPUNIT_ASSERT(size == 2*sizeof(unsigned));
+            CPPUNIT_ASSERT((*(const unsigned *)row % 10) == searchValue);
+            CPPUNIT_ASSERT(*(const unsigned *)(row+sizeof(unsigned)) == searchValue);
+            ++count;
+        }
+        CPPUNIT_ASSERT(count == numRows/10);
+
+        // filters on fields that are not contiguous, as a disk read's may be, are all applied unmerged
+        struct CFilterList : public IIndexReadContext
+        {
+            IArrayOf<IKeySegmentMonitor> segMonitors;
+            virtual void append(IKeySegmentMonitor *segment) override { segMonitors.append(*segment); }
+            virtual unsigned ordinality() const override { return segMonitors.ordinality(); }
+            virtual IKeySegmentMonitor *item(unsigned idx) const override { return &segMonitors.item(idx); }
+            virtual void setMergeBarrier(unsigned offset) override { }
+        } unmerged;
+        unsigned searchId2 = 13;
+        unmerged.append(createNewVarOffsetKeySegmentMonitor(createSingleKeySegmentMonitor(false, 0, sizeof(unsigned), &searchValue), 2*sizeof(unsigned), 2));
+        unmerged.append(createSingleKeySegmentMonitor(false, 0, sizeof(unsigned), &searchId2));
+        reader.setown(createRemoteFilteredFileReader(iFile, &inType, &outType, &unmerged));
+        row = (const byte *)reader->nextRow(size);
+        CPPUNIT_ASSERT(row);
+        CPPUNIT_ASSERT(*(const unsigned *)row == searchId2);
+        CPPUNIT_ASSERT(!reader->nextRow(size));
+        reader.clear();
+
+        CPPUNIT_ASSERT(iFile->remove());
+    }
+
     void testOther()
     {
         VStringBuffer filePath("%s%s", basePath.str(), "file1");
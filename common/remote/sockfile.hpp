@@ -51,6 +51,8 @@ enum ThrottleClass
 #define DEFAULT_SLOWCMD_THROTTLECPULIMIT 75
 #define DEFAULT_SLOWCMD_THROTTLEQUEUELIMIT 1000
 
+#define DEFAULT_READAHEAD_BLOCKSIZE 0x40000
+
 interface IRemoteFileServer : extends IInterface
 {
     virtual void run(DAFSConnectCfg connectMethod, SocketEndpoint &listenep, unsigned sslPort=0) = 0;
@@ -60,13 +62,26 @@ interface IRemoteFileServer : extends IInterface
     virtual StringBuffer &getStats(StringBuffer &stats, bool reset) = 0;
 };
 
-#define FILESRV_VERSION 21 // don't forget VERSTRING in sockfile.cpp
+#define FILESRV_VERSION 23 // don't forget VERSTRING in sockfile.cpp
 
 interface IKeyManager;
 interface IDelayedFile;
 extern REMOTE_API IFile * createRemoteFile(SocketEndpoint &ep,const char * _filename);
 extern REMOTE_API IKeyManager *createKeyManager(const char *filename, unsigned keySize, unsigned crc, IDelayedFile *delayedFile, bool allowRemote, bool forceRemote);
 extern REMOTE_API IKeyManager * createRemoteKeyManager(const char *filename, unsigned keySize, unsigned crc, IDelayedFile *delayedFile);
+
+interface IRemoteFilteredFileReader : extends IInterface
+{
+    virtual const void *nextRow(size32_t &size) = 0; // returns NULL at end, row is valid until the next call
+    virtual offset_t queryRowOffset() const = 0; // file offset of the row last returned
+};
+interface IIndexReadContext;
+struct RtlTypeInfo;
+// Reads a flat file, applying filters and projecting to outputType (if not NULL) within the dafilesrv serving it.
+// Each of the filters' segment monitors is matched against every row, as a disk read would, so they are not merged.
+// Returns NULL if the file is not remote or its server predates filtered flat reads, in which case read it directly.
+extern REMOTE_API IRemoteFilteredFileReader *createRemoteFilteredFileReader(IFile *file, const RtlTypeInfo *inputType, const RtlTypeInfo *outputType, IIndexReadContext *filters, offset_t startOffset=0, offset_t length=(offset_t)-1);
+extern REMOTE_API IRemoteFilteredFileReader *createRemoteFilteredFileReader(IFileIO *fileIO, const RtlTypeInfo *inputType, const RtlTypeInfo *outputType, IIndexReadContext *filters, offset_t startOffset=0, offset_t length=(offset_t)-1);
 extern REMOTE_API unsigned getRemoteVersion(ISocket * _socket, StringBuffer &ver);
 extern REMOTE_API unsigned stopRemoteServer(ISocket * _socket);
 extern REMOTE_API const char *remoteServerVersionString();
@@ -99,6 +114,7 @@ extern bool clientAsyncCopyFileSection(const char *uuid,    // from genUUID - mu
                         ); // returns true when done
 
 extern void clientSetRemoteFileTimeouts(unsigned maxconnecttime,unsigned maxreadtime);
+extern void clientSetRemoteFileReadAhead(unsigned window, size32_t blockSize, bool compress);
 extern void clientAddSocketToCache(SocketEndpoint &ep,ISocket *socket);
 
 #endif
@@ -1351,6 +1351,353 @@ unsigned CRowStreamReader::rdnum;
 
 bool UseMemoryMappedRead = false;
 
+//=====================================================================================================
+
+/* Write behind and read ahead wrappers used for rw_async.
+ * The wrapped IFileIO (typically a compressed file) is written/read on a background thread, so that
+ * compression and disk i/o are overlapped with the serialization/deserialization of rows by the caller.
+ * Any time the caller spends blocked waiting for the background thread is reported as StCycleSpillStallCycles.
+ */
+
+#define ASYNC_WRITE_BUFFERSIZE (0x100000)
+#define ASYNC_READ_BUFFERSIZE (0x10000)
+
+class CWriteBehindFileIO : public CInterfaceOf<IFileIO>, implements IThreaded
+{
+    Linked<IFileIO> io;
+    CThreaded threaded;
+    MemoryAttr buffers[2];
+    byte *fillBuf;
+    offset_t fillPos = 0;
+    size32_t fillLen = 0;
+    byte *writeBuf;
+    offset_t writePos = 0;
+    size32_t writeLen = 0;
+    Semaphore writeSem, doneSem;
+    Owned<IException> exception;
+    cycle_t stallCycles = 0;
+    bool busy = false;
+    bool stopped = false;
+
+    void waitIdle()
+    {
+        if (busy)
+        {
+            CCycleTimer timer;
+            doneSem.wait();
+            stallCycles += timer.elapsedCycles();
+            busy = false;
+        }
+        if (exception)
+            throw LINK(exception.get());
+    }
+    void startWrite()
+    {
+        waitIdle();
+        if (0 == fillLen)
+            return;
+        std::swap(fillBuf, writeBuf);
+        writePos = fillPos;
+        writeLen = fillLen;
+        fillPos += fillLen;
+        fillLen = 0;
+        busy = true;
+        writeSem.signal();
+    }
+    void stopThread()
+    {
+        if (!stopped)
+        {
+            stopped = true;
+            writeSem.signal();
+            threaded.join();
+        }
+    }
+public:
+    CWriteBehindFileIO(IFileIO *_io) : io(_io), threaded("CWriteBehindFileIO")
+    {
+        fillBuf = (byte *)buffers[0].allocate(ASYNC_WRITE_BUFFERSIZE);
+        writeBuf = (byte *)buffers[1].allocate(ASYNC_WRITE_BUFFERSIZE);
+        threaded.init(this);
+    }
+    ~CWriteBehindFileIO()
+    {
+        if (!stopped)
+        {
+            try
+            {
+                flushPending();
+            }
+            catch (IException *e)
+            {
+                EXCLOG(e, "~CWriteBehindFileIO");
+                e->Release();
+            }
+            stopThread();
+        }
+    }
+    void flushPending()
+    {
+        startWrite();
+        waitIdle();
+    }
+// IThreaded
+    virtual void main() override
+    {
+        for (;;)
+        {
+            writeSem.wait();
+            if (stopped)
+                break;
+            try
+            {
+                io->write(writePos, writeLen, writeBuf);
+            }
+            catch (IException *e)
+            {
+                exception.setown(e);
+            }
+            doneSem.signal();
+        }
+    }
+// IFileIO
+    virtual size32_t read(offset_t pos, size32_t len, void * data) override
+    {
+        flushPending();
+        return io->read(pos, len, data);
+    }
+    virtual offset_t size() override
+    {
+        flushPending();
+        return io->size();
+    }
+    virtual size32_t write(offset_t pos, size32_t len, const void * data) override
+    {
+        if (fillLen && (pos != fillPos + fillLen))
+            startWrite();
+        if (0 == fillLen)
+            fillPos = pos;
+        size32_t remaining = len;
+        const byte *src = (const byte *)data;
+        while (remaining)
+        {
+            size32_t copyLen = ASYNC_WRITE_BUFFERSIZE - fillLen;
+            if (copyLen > remaining)
+                copyLen = remaining;
+            memcpy(fillBuf + fillLen, src, copyLen);
+            fillLen += copyLen;
+            src += copyLen;
+            remaining -= copyLen;
+            if (ASYNC_WRITE_BUFFERSIZE == fillLen)
+                startWrite();
+        }
+        return len;
+    }
+    virtual offset_t appendFile(IFile *file, offset_t pos, offset_t len) override
+    {
+        flushPending();
+        return io->appendFile(file, pos, len);
+    }
+    virtual void setSize(offset_t size) override
+    {
+        flushPending();
+        io->setSize(size);
+    }
+    virtual void flush() override
+    {
+        flushPending();
+        io->flush();
+    }
+    virtual void close() override
+    {
+        flushPending();
+        stopThread();
+        io->close();
+    }
+    virtual unsigned __int64 getStatistic(StatisticKind kind) override
+    {
+        switch (kind)
+        {
+        case StCycleSpillStallCycles:
+            return stallCycles;
+        case StTimeSpillStall:
+            return cycle_to_nanosec(stallCycles);
+        }
+        return io->getStatistic(kind);
+    }
+};
+
+class CReadAheadFileIO : public CInterfaceOf<IFileIO>, implements IThreaded
+{
+    Linked<IFileIO> io;
+    CThreaded threaded;
+    MemoryAttr buffers[2];
+    byte *curBuf;
+    offset_t curPos = 0;
+    size32_t curLen = 0;
+    byte *aheadBuf;
+    offset_t aheadPos = 0;
+    size32_t aheadLen = 0;
+    Semaphore readSem, doneSem;
+    Owned<IException> exception;
+    cycle_t stallCycles = 0;
+    bool busy = false;
+    bool aheadReady = false;
+    bool started = false;
+    bool stopped = false;
+
+    void startReadAhead(offset_t pos)
+    {
+        aheadPos = pos;
+        aheadReady = false;
+        busy = true;
+        if (!started)
+        {
+            started = true;
+            threaded.init(this);
+        }
+        readSem.signal();
+    }
+    void waitReadAhead()
+    {
+        if (busy)
+        {
+            CCycleTimer timer;
+            doneSem.wait();
+            stallCycles += timer.elapsedCycles();
+            busy = false;
+            aheadReady = true;
+        }
+        if (exception)
+        {
+            aheadReady = false;
+            throw exception.getClear();
+        }
+    }
+    bool fill(offset_t pos)
+    {
+        waitReadAhead();
+        if (aheadReady && (pos >= aheadPos) && (pos < aheadPos + aheadLen))
+        {
+            std::swap(curBuf, aheadBuf);
+            curPos = aheadPos;
+            curLen = aheadLen;
+            aheadReady = false;
+        }
+        else
+        {
+            //Not sequential, or the read ahead has not started yet
+            curPos = pos;
+            curLen = io->read(pos, ASYNC_READ_BUFFERSIZE, curBuf);
+        }
+        if (ASYNC_READ_BUFFERSIZE == curLen)
+            startReadAhead(curPos + curLen);
+        return 0 != curLen;
+    }
+    void stopThread()
+    {
+        if (started && !stopped)
+        {
+            if (busy)
+                doneSem.wait();
+            busy = false;
+            stopped = true;
+            readSem.signal();
+            threaded.join();
+        }
+    }
+public:
+    CReadAheadFileIO(IFileIO *_io) : io(_io), threaded("CReadAheadFileIO")
+    {
+        curBuf = (byte *)buffers[0].allocate(ASYNC_READ_BUFFERSIZE);
+        aheadBuf = (byte *)buffers[1].allocate(ASYNC_READ_BUFFERSIZE);
+    }
+    ~CReadAheadFileIO()
+    {
+        stopThread();
+    }
+// IThreaded
+    virtual void main() override
+    {
+        for (;;)
+        {
+            readSem.wait();
+            if (stopped)
+                break;
+            try
+            {
+                aheadLen = io->read(aheadPos, ASYNC_READ_BUFFERSIZE, aheadBuf);
+            }
+            catch (IException *e)
+            {
+                aheadLen = 0;
+                exception.setown(e);
+            }
+            doneSem.signal();
+        }
+    }
+// IFileIO
+    virtual size32_t read(offset_t pos, size32_t len, void * data) override
+    {
+        size32_t done = 0;
+        byte *tgt = (byte *)data;
+        while (len)
+        {
+            if ((pos < curPos) || (pos >= curPos + curLen))
+            {
+                if (!fill(pos))
+                    break;
+            }
+            size32_t offset = (size32_t)(pos - curPos);
+            size32_t copyLen = curLen - offset;
+            if (copyLen > len)
+                copyLen = len;
+            memcpy(tgt, curBuf + offset, copyLen);
+            tgt += copyLen;
+            pos += copyLen;
+            len -= copyLen;
+            done += copyLen;
+        }
+        return done;
+    }
+    virtual offset_t size() override
+    {
+        waitReadAhead();
+        return io->size();
+    }
+    virtual size32_t write(offset_t pos, size32_t len, const void * data) override
+    {
+        UNIMPLEMENTED;
+    }
+    virtual offset_t appendFile(IFile *file, offset_t pos, offset_t len) override
+    {
+        UNIMPLEMENTED;
+    }
+    virtual void setSize(offset_t size) override
+    {
+        UNIMPLEMENTED;
+    }
+    virtual void flush() override
+    {
+    }
+    virtual void close() override
+    {
+        stopThread();
+        io->close();
+    }
+    virtual unsigned __int64 getStatistic(StatisticKind kind) override
+    {
+        switch (kind)
+        {
+        case StCycleSpillStallCycles:
+            return stallCycles;
+        case StTimeSpillStall:
+            return cycle_to_nanosec(stallCycles);
+        }
+        return io->getStatistic(kind);
+    }
+};
+
 IExtRowStream *createRowStreamEx(IFile *file, IRowInterfaces *rowIf, offset_t offset, offset_t len, unsigned __int64 maxrows, unsigned rwFlags, IExpander *eexp)
 {
     bool compressed = TestRwFlag(rwFlags, rw_compress);
@@ -1379,6 +1726,8 @@ IExtRowStream *createRowStreamEx(IFile *file, IRowInterfaces *rowIf, offset_t of
             fileio.setown(file->open(IFOread));
         if (!fileio)
             return NULL;
+        if (TestRwFlag(rwFlags, rw_async))
+            fileio.setown(new CReadAheadFileIO(fileio));
         if (maxrows == (unsigned __int64)-1)
             return new CRowStreamReader(fileio, NULL, rowIf, offset, len, TestRwFlag(rwFlags, rw_crc), emptyRowSemantics);
         else
@@ -1403,6 +1752,7 @@ void useMemoryMappedRead(bool on)
 class CRowStreamWriter : private IRowSerializerTarget, implements IExtRowWriter, public CSimpleInterface
 {
     Linked<IFileIOStream> stream;
+    Linked<CWriteBehindFileIO> asyncIO; // optional, if the file is being written on a background thread
     Linked<IOutputRowSerializer> serializer;
     Linked<IEngineRowAllocator> allocator;
     CRC32 crc;
@@ -1456,6 +1806,8 @@ class CRowStreamWriter : private IRowSerializerTarget, implements IExtRowWriter,
         try
         {
             stream->flush();
+            if (asyncIO)
+                asyncIO->flushPending();
         }
         catch (IException *e)
         {
@@ -1467,8 +1819,8 @@ class CRowStreamWriter : private IRowSerializerTarget, implements IExtRowWriter,
 public:
     IMPLEMENT_IINTERFACE_USING(CSimpleInterface);
 
-    CRowStreamWriter(IFileIOStream *_stream, IOutputRowSerializer *_serializer, IEngineRowAllocator *_allocator, EmptyRowSemantics _emptyRowSemantics, bool _tallycrc, bool _autoflush)
-        : stream(_stream), serializer(_serializer), allocator(_allocator), emptyRowSemantics(_emptyRowSemantics)
+    CRowStreamWriter(IFileIOStream *_stream, CWriteBehindFileIO *_asyncIO, IOutputRowSerializer *_serializer, IEngineRowAllocator *_allocator, EmptyRowSemantics _emptyRowSemantics, bool _tallycrc, bool _autoflush)
+        : stream(_stream), asyncIO(_asyncIO), serializer(_serializer), allocator(_allocator), emptyRowSemantics(_emptyRowSemantics)
     {
 #ifdef TRACE_CREATE
         PROGLOG("createRowWriter %d = %p",++wrnum,this);
@@ -1556,6 +1908,13 @@ public:
         return stream->tell()+bufpos+extbuf.length();
     }
 
+    virtual unsigned __int64 getStatistic(StatisticKind kind)
+    {
+        if (asyncIO)
+            return asyncIO->getStatistic(kind);
+        return 0;
+    }
+
     void put(size32_t len, const void * ptr)
     {
         // first fill buf
@@ -1641,10 +2000,25 @@ IExtRowWriter *createRowWriter(IFile *iFile, IRowInterfaces *rowIf, unsigned fla
     return createRowWriter(iFileIO, rowIf, flags);
 }
 
+static IExtRowWriter *createRowStreamWriter(IFileIOStream *strm, CWriteBehindFileIO *asyncIO, IRowInterfaces *rowIf, unsigned flags)
+{
+    if (0 != (flags & (rw_extend|rw_buffered|rw_async|COMP_MASK)))
+        throw MakeStringException(0, "Unsupported createRowWriter flags");
+    EmptyRowSemantics emptyRowSemantics = extractESRFromRWFlags(flags);
+    Owned<CRowStreamWriter> writer = new CRowStreamWriter(strm, asyncIO, rowIf->queryRowSerializer(), rowIf->queryRowAllocator(), emptyRowSemantics, TestRwFlag(flags, rw_crc), TestRwFlag(flags, rw_autoflush));
+    return writer.getClear();
+}
+
 IExtRowWriter *createRowWriter(IFileIO *iFileIO, IRowInterfaces *rowIf, unsigned flags, size32_t compressorBlkSz)
 {
     if (TestRwFlag(flags, rw_compress))
         throw MakeStringException(0, "Unsupported createRowWriter flags");
+    Owned<CWriteBehindFileIO> asyncIO;
+    if (TestRwFlag(flags, rw_async))
+    {
+        asyncIO.setown(new CWriteBehindFileIO(iFileIO));
+        iFileIO = asyncIO;
+    }
     Owned<IFileIOStream> stream;
     if (TestRwFlag(flags, rw_buffered))
         stream.setown(createBufferedIOStream(iFileIO));
@@ -1652,17 +2026,13 @@ IExtRowWriter *createRowWriter(IFileIO *iFileIO, IRowInterfaces *rowIf, unsigned
         stream.setown(createIOStream(iFileIO));
     if (flags & rw_extend)
         stream->seek(0, IFSend);
-    flags &= ~((unsigned)(rw_extend|rw_buffered));
-    return createRowWriter(stream, rowIf, flags);
+    flags &= ~((unsigned)(rw_extend|rw_buffered|rw_async));
+    return createRowStreamWriter(stream, asyncIO, rowIf, flags);
 }
 
 IExtRowWriter *createRowWriter(IFileIOStream *strm, IRowInterfaces *rowIf, unsigned flags)
 {
-    if (0 != (flags & (rw_extend|rw_buffered|COMP_MASK)))
-        throw MakeStringException(0, "Unsupported createRowWriter flags");
-    EmptyRowSemantics emptyRowSemantics = extractESRFromRWFlags(flags);
-    Owned<CRowStreamWriter> writer = new CRowStreamWriter(strm, rowIf->queryRowSerializer(), rowIf->queryRowAllocator(), emptyRowSemantics, TestRwFlag(flags, rw_crc), TestRwFlag(flags, rw_autoflush));
-    return writer.getClear();
+    return createRowStreamWriter(strm, nullptr, rowIf, flags);
 }
 
 class CDiskMerger : implements IDiskMerger, public CInterface
@@ -1994,3 +2364,204 @@ void bindMemoryToLocalNodes()
     numa_bitmask_free(nodes);
 #endif
 }
+
+#ifdef _USE_CPPUNIT
+#include "unittests.hpp"
+
+class AsyncFileIOTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(AsyncFileIOTest);
+        CPPUNIT_TEST(testSequentialRead);
+        CPPUNIT_TEST(testRandomRead);
+        CPPUNIT_TEST(testWrite);
+        CPPUNIT_TEST(testWriteErrorOnFlush);
+        CPPUNIT_TEST(testWriteErrorOnClose);
+        CPPUNIT_TEST(testCloseDuringRead);
+    CPPUNIT_TEST_SUITE_END();
+
+    // An in memory file, whose writes can be made to fail, and whose reads beyond the first block can be held up
+    class CMemFileIO : public CInterfaceOf<IFileIO>
+    {
+    public:
+        MemoryBuffer data;
+        offset_t failWritesAt = (offset_t)-1;
+        Semaphore *readGate = nullptr;
+        bool closed = false;
+
+        virtual size32_t read(offset_t pos, size32_t len, void * tgt) override
+        {
+            if (readGate && pos)
+                readGate->wait();
+            if (pos >= data.length())
+                return 0;
+            if (len > data.length() - pos)
+                len = data.length() - pos;
+            memcpy(tgt, data.toByteArray() + pos, len);
+            return len;
+        }
+        virtual offset_t size() override { return data.length(); }
+        virtual size32_t write(offset_t pos, size32_t len, const void * src) override
+        {
+            if (pos + len > failWritesAt)
+                throw makeStringException(0, "CMemFileIO: write failed");
+            if (pos + len > data.length())
+                data.setLength(pos + len);
+            memcpy((byte *)data.bufferBase() + pos, src, len);
+            return len;
+        }
+        virtual offset_t appendFile(IFile *file, offset_t pos, offset_t len) override { UNIMPLEMENTED; }
+        virtual void setSize(offset_t size) override { data.setLength(size); }
+        virtual void flush() override {}
+        virtual void close() override { closed = true; }
+        virtual unsigned __int64 getStatistic(StatisticKind kind) override { return 0; }
+    };
+
+    class CSignalThread : public Thread
+    {
+        Semaphore &sem;
+    public:
+        CSignalThread(Semaphore &_sem) : Thread("CSignalThread"), sem(_sem) {}
+        virtual int run() override
+        {
+            MilliSleep(100);
+            sem.signal();
+            return 0;
+        }
+    };
+
+    static byte expectedByte(offset_t pos) { return (byte)(pos % 251); }
+
+    CMemFileIO *createFilledFile(size32_t len)
+    {
+        CMemFileIO *io = new CMemFileIO;
+        io->data.setLength(len);
+        byte *tgt = (byte *)io->data.bufferBase();
+        for (size32_t i=0; i < len; i++)
+            tgt[i] = expectedByte(i);
+        return io;
+    }
+
+    void checkRead(IFileIO *io, offset_t pos, size32_t len, size32_t fileLen)
+    {
+        MemoryAttr buf(len);
+        size32_t got = io->read(pos, len, buf.bufferBase());
+        size32_t expected = (pos >= fileLen) ? 0 : (size32_t)std::min((offset_t)len, fileLen - pos);
+        CPPUNIT_ASSERT_EQUAL(expected, got);
+        const byte *data = (const byte *)buf.get();
+        for (size32_t i=0; i < got; i++)
+            CPPUNIT_ASSERT_EQUAL(expectedByte(pos+i), data[i]);
+    }
+
+    void testSequentialRead()
+    {
+        const size32_t fileLen = ASYNC_READ_BUFFERSIZE * 3 + 1234;
+        Owned<CMemFileIO> mem = createFilledFile(fileLen);
+        Owned<IFileIO> io = new CReadAheadFileIO(mem);
+        offset_t pos = 0;
+        while (pos < fileLen)
+        {
+            checkRead(io, pos, 1000, fileLen);
+            pos += 1000;
+        }
+        checkRead(io, pos, 1000, fileLen);  // at eof
+        io->close();
+        CPPUNIT_ASSERT(mem->closed);
+    }
+
+    void testRandomRead()
+    {
+        const size32_t fileLen = ASYNC_READ_BUFFERSIZE * 4;
+        Owned<CMemFileIO> mem = createFilledFile(fileLen);
+        Owned<IFileIO> io = new CReadAheadFileIO(mem);
+        for (unsigned i=0; i < 200; i++)
+        {
+            offset_t pos = getRandom() % (fileLen + 100);
+            size32_t len = getRandom() % (ASYNC_READ_BUFFERSIZE * 2);
+            checkRead(io, pos, len, fileLen);
+        }
+        checkRead(io, 0, fileLen, fileLen);
+        io->close();
+    }
+
+    void testWrite()
+    {
+        const size32_t fileLen = ASYNC_WRITE_BUFFERSIZE * 2 + 5000;
+        Owned<CMemFileIO> src = createFilledFile(fileLen);
+        Owned<CMemFileIO> mem = new CMemFileIO;
+        Owned<IFileIO> io = new CWriteBehindFileIO(mem);
+        offset_t pos = 0;
+        while (pos < fileLen)
+        {
+            size32_t len = std::min((offset_t)3000, fileLen - pos);
+            io->write(pos, len, src->data.toByteArray() + pos);
+            pos += len;
+        }
+        io->close();
+        CPPUNIT_ASSERT(mem->closed);
+        CPPUNIT_ASSERT_EQUAL(fileLen, mem->data.length());
+        CPPUNIT_ASSERT(0 == memcmp(src->data.toByteArray(), mem->data.toByteArray(), fileLen));
+    }
+
+    void testWriteErrorOnFlush()
+    {
+        // Nothing has been written by the background thread yet, so the failure is only seen by the flush
+        Owned<CMemFileIO> mem = new CMemFileIO;
+        mem->failWritesAt = 100;
+        Owned<IFileIO> io = new CWriteBehindFileIO(mem);
+        byte buf[1000] = { 0 };
+        io->write(0, sizeof(buf), buf);
+        try
+        {
+            io->flush();
+            CPPUNIT_FAIL("flush did not report the write error");
+        }
+        catch (IException *e)
+        {
+            e->Release();
+        }
+    }
+
+    void testWriteErrorOnClose()
+    {
+        // A full buffer is written in the background, the failure is reported by the close
+        Owned<CMemFileIO> mem = new CMemFileIO;
+        mem->failWritesAt = ASYNC_WRITE_BUFFERSIZE / 2;
+        Owned<IFileIO> io = new CWriteBehindFileIO(mem);
+        MemoryAttr buf(ASYNC_WRITE_BUFFERSIZE);
+        memset(buf.bufferBase(), 0, ASYNC_WRITE_BUFFERSIZE);
+        io->write(0, ASYNC_WRITE_BUFFERSIZE, buf.get());
+        try
+        {
+            io->close();
+            CPPUNIT_FAIL("close did not report the write error");
+        }
+        catch (IException *e)
+        {
+            e->Release();
+        }
+        CPPUNIT_ASSERT(!mem->closed);
+        io.clear(); // the background thread must still be stopped
+    }
+
+    void testCloseDuringRead()
+    {
+        // The read ahead of the second block is held up, close must wait for it rather than free its buffers
+        const size32_t fileLen = ASYNC_READ_BUFFERSIZE * 3;
+        Owned<CMemFileIO> mem = createFilledFile(fileLen);
+        Semaphore gate;
+        mem->readGate = &gate;
+        Owned<IFileIO> io = new CReadAheadFileIO(mem);
+        checkRead(io, 0, 1000, fileLen);
+        Owned<CSignalThread> signaller = new CSignalThread(gate);
+        signaller->start();
+        io->close();
+        CPPUNIT_ASSERT(mem->closed);
+        signaller->join();
+        mem->readGate = nullptr;
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( AsyncFileIOTest );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( AsyncFileIOTest, "AsyncFileIOTest" );
+
+#endif
@@ -19,6 +19,7 @@
 #include "thorsort.hpp"
 #include "jset.hpp"
 #include "errorlist.h"
+#include "rtlrecord.hpp"
 #include <exception>
 
 #ifdef _USE_TBB
@@ -274,6 +275,264 @@ void msortvecstableinplace(void ** rows, size_t n, const ICompare & compare, voi
     mergeSort(rows, n, compare, temp, 0);
 }
 
+//=========================================================================
+// Normalized key sorting.  Each row is paired with a 64bit big-endian encoding of the leading sort fields, the pairs
+// are radix sorted on the key, and only rows with identical keys are passed to the comparison function.
+
+struct NormalizedKeyEntry
+{
+    unsigned __int64 key;
+    void * row;
+};
+
+static void radixSortNormalizedKeys(NormalizedKeyEntry * entries, NormalizedKeyEntry * temp, size_t n)
+{
+    size_t counts[sizeof(unsigned __int64)][256];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i=0; i < n; i++)
+    {
+        unsigned __int64 key = entries[i].key;
+        for (unsigned pass=0; pass < sizeof(unsigned __int64); pass++)
+            counts[pass][(byte)(key >> (pass * 8))]++;
+    }
+
+    NormalizedKeyEntry * src = entries;
+    NormalizedKeyEntry * dst = temp;
+    for (unsigned pass=0; pass < sizeof(unsigned __int64); pass++)
+    {
+        size_t * passCounts = counts[pass];
+        //If every key has the same value for this byte the pass would not change the order
+        if (passCounts[(byte)(src[0].key >> (pass * 8))] == n)
+            continue;
+
+        size_t offsets[256];
+        size_t total = 0;
+        for (unsigned i=0; i < 256; i++)
+        {
+            offsets[i] = total;
+            total += passCounts[i];
+        }
+
+        unsigned shift = pass * 8;
+        for (size_t i=0; i < n; i++)
+        {
+            const NormalizedKeyEntry & cur = src[i];
+            dst[offsets[(byte)(cur.key >> shift)]++] = cur;
+        }
+        std::swap(src, dst);
+    }
+    if (src != entries)
+        memcpy(entries, src, n * sizeof(NormalizedKeyEntry));
+}
+
+void normalizedsortvecstableinplace(void ** rows, size_t n, const ICompare & compare, const ISortKeyNormalizer & normalizer, void ** temp)
+{
+    if (n <= 1)
+        return;
+
+    MemoryAttr entryMem(n * 2 * sizeof(NormalizedKeyEntry));
+    NormalizedKeyEntry * entries = static_cast<NormalizedKeyEntry *>(entryMem.bufferBase());
+    for (size_t i=0; i < n; i++)
+    {
+        entries[i].key = normalizer.getNormalizedKey(rows[i]);
+        entries[i].row = rows[i];
+    }
+
+    radixSortNormalizedKeys(entries, entries + n, n);
+
+    for (size_t i=0; i < n; i++)
+        rows[i] = entries[i].row;
+
+    if (normalizer.isComplete())
+        return;
+
+    //Resolve any runs of equal keys using the full comparison
+    size_t start = 0;
+    while (start < n)
+    {
+        unsigned __int64 key = entries[start].key;
+        size_t end = start+1;
+        while ((end < n) && (entries[end].key == key))
+            end++;
+        if (end - start > 1)
+            msortvecstableinplace(rows + start, end - start, compare, temp + start);
+        start = end;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+class CSortKeyNormalizer : public CInterfaceOf<ISortKeyNormalizer>
+{
+    struct KeyField
+    {
+        unsigned field;
+        unsigned type;
+        size32_t keyBytes;
+        bool isSigned;
+        bool descending;
+    };
+
+public:
+    CSortKeyNormalizer(const RtlRecord & _record) : record(_record)
+    {
+    }
+
+    bool addField(unsigned field, bool descending)
+    {
+        if (!canExtend())
+            return false;
+
+        const RtlTypeInfo * type = record.queryType(field);
+        unsigned kind = type->getType();
+        bool isSigned = false;
+        bool fixedSize = type->isFixedSize();
+        switch (kind)
+        {
+        case type_boolean:
+            break;
+        case type_int:
+        case type_swapint:
+            isSigned = !type->isUnsigned();
+            break;
+        case type_string:
+            if (type->isEbcdic())
+                return false;
+            break;
+        case type_data:
+            break;
+        default:
+            return false;
+        }
+
+        //Variable length strings are padded so later fields cannot follow them in the key
+        size32_t available = sizeof(unsigned __int64) - keyBytes;
+        size32_t fieldBytes = fixedSize ? type->length : available;
+        if (fieldBytes == 0)
+            return false;
+
+        KeyField & next = fields[numFields++];
+        next.field = field;
+        next.type = kind;
+        next.keyBytes = (fieldBytes < available) ? fieldBytes : available;
+        next.isSigned = isSigned;
+        next.descending = descending;
+        keyBytes += next.keyBytes;
+        if (field > maxField)
+            maxField = field;
+        if (!fixedSize || (fieldBytes > available))
+            truncated = true;
+        return true;
+    }
+
+    void noteIncomplete()
+    {
+        truncated = true;
+    }
+
+    virtual unsigned __int64 getNormalizedKey(const void * row) const override
+    {
+        const byte * self = static_cast<const byte *>(row);
+        size_t * variableOffsets = (size_t *)alloca((record.getNumVarFields() + 1) * sizeof(size_t));
+        variableOffsets[0] = 0;
+        record.calcRowOffsets(variableOffsets, row, maxField+1);
+
+        unsigned __int64 key = 0;
+        for (unsigned i=0; i < numFields; i++)
+        {
+            const KeyField & cur = fields[i];
+            const byte * data = self + record.getOffset(variableOffsets, cur.field);
+            unsigned __int64 value = 0;
+            switch (cur.type)
+            {
+            case type_boolean:
+                value = *data ? 1 : 0;
+                break;
+            case type_int:
+            {
+                //Little endian - most significant byte last
+                size32_t size = record.queryType(cur.field)->length;
+                for (unsigned j=0; j < cur.keyBytes; j++)
+                    value = (value << 8) | data[size-1-j];
+                if (cur.isSigned)
+                    value ^= (unsigned __int64)0x80 << ((cur.keyBytes-1) * 8);
+                break;
+            }
+            case type_swapint:
+                for (unsigned j=0; j < cur.keyBytes; j++)
+                    value = (value << 8) | data[j];
+                if (cur.isSigned)
+                    value ^= (unsigned __int64)0x80 << ((cur.keyBytes-1) * 8);
+                break;
+            case type_string:
+            case type_data:
+            {
+                if (record.queryType(cur.field)->isFixedSize())
+                {
+                    for (unsigned j=0; j < cur.keyBytes; j++)
+                        value = (value << 8) | data[j];
+                }
+                else
+                {
+                    //Comparisons on strings ignore trailing spaces, data is compared as a raw prefix
+                    size32_t len = *(const size32_t *)data;
+                    const byte * text = data + sizeof(size32_t);
+                    byte pad = (cur.type == type_string) ? ' ' : 0;
+                    for (unsigned j=0; j < cur.keyBytes; j++)
+                        value = (value << 8) | (j < len ? text[j] : pad);
+                }
+                break;
+            }
+            }
+            if (cur.descending)
+                value = ~value;
+            if (cur.keyBytes < sizeof(unsigned __int64))
+                value &= (((unsigned __int64)1) << (cur.keyBytes * 8)) - 1;
+            key = (cur.keyBytes < sizeof(unsigned __int64)) ? (key << (cur.keyBytes * 8)) | value : value;
+        }
+        if (keyBytes < sizeof(unsigned __int64))
+            key <<= (sizeof(unsigned __int64) - keyBytes) * 8;
+        return key;
+    }
+
+    virtual bool isComplete() const override
+    {
+        return !truncated;
+    }
+
+    inline bool isValid() const { return numFields != 0; }
+
+protected:
+    bool canExtend() const
+    {
+        return !truncated && (keyBytes < sizeof(unsigned __int64));
+    }
+
+protected:
+    const RtlRecord & record;
+    KeyField fields[sizeof(unsigned __int64)];
+    unsigned numFields = 0;
+    unsigned maxField = 0;
+    size32_t keyBytes = 0;
+    bool truncated = false;
+};
+
+ISortKeyNormalizer * createSortKeyNormalizer(const RtlRecord & record, unsigned numSortFields, const unsigned * sortFields, const bool * descending)
+{
+    Owned<CSortKeyNormalizer> normalizer = new CSortKeyNormalizer(record);
+    for (unsigned i=0; i < numSortFields; i++)
+    {
+        if (!normalizer->addField(sortFields[i], descending ? descending[i] : false))
+        {
+            normalizer->noteIncomplete();
+            break;
+        }
+    }
+    if (!normalizer->isValid())
+        return nullptr;
+    return normalizer.getClear();
+}
+
 //=========================================================================
 
 #ifdef _USE_TBB
@@ -734,3 +993,408 @@ void parmsortvecstableinplace(void ** rows, size_t n, const ICompare & compare,
     parqsortvecstableinplace(rows, (size32_t)n, compare, temp, ncpus);
 }
 #endif
+
+#ifdef _USE_CPPUNIT
+#include "unittests.hpp"
+#include "rtlfield.hpp"
+
+namespace thorsorttests {
+
+static const size32_t numSortTestRows = 500000;
+
+class CompareUnsigned8 : public ICompare
+{
+public:
+    virtual int docompare(const void * left, const void * right) const override
+    {
+        unsigned __int64 l = *(const unsigned __int64 *)left;
+        unsigned __int64 r = *(const unsigned __int64 *)right;
+        return (l < r) ? -1 : (l > r) ? +1 : 0;
+    }
+};
+
+class CompareString20 : public ICompare
+{
+public:
+    virtual int docompare(const void * left, const void * right) const override
+    {
+        return memcmp(left, right, 20);
+    }
+};
+
+class CompareStringInt : public ICompare
+{
+public:
+    virtual int docompare(const void * left, const void * right) const override
+    {
+        int ret = memcmp(left, right, 6);
+        if (ret)
+            return ret;
+        int l = *(const int *)((const byte *)left + 6);
+        int r = *(const int *)((const byte *)right + 6);
+        return (l < r) ? -1 : (l > r) ? +1 : 0;
+    }
+};
+
+class ThorSortNormalizedTimingTests : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( ThorSortNormalizedTimingTests );
+        CPPUNIT_TEST(testUnsigned8);
+        CPPUNIT_TEST(testString20);
+        CPPUNIT_TEST(testStringInt);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void fillString(byte * target, size32_t len, unsigned range)
+    {
+        //Use a small alphabet so that there are plenty of shared prefixes
+        for (unsigned i=0; i < len; i++)
+            target[i] = 'A' + getRandom() % range;
+    }
+
+    void timeSort(const char * title, const RtlRecord & record, unsigned numSortFields, const unsigned * sortFields, const ICompare & compare, size32_t rowSize, MemoryAttr & rowData)
+    {
+        Owned<ISortKeyNormalizer> normalizer = createSortKeyNormalizer(record, numSortFields, sortFields, nullptr);
+        CPPUNIT_ASSERT(normalizer);
+
+        byte * base = static_cast<byte *>(rowData.bufferBase());
+        MemoryAttr rowMem1(numSortTestRows * sizeof(void *));
+        MemoryAttr rowMem2(numSortTestRows * sizeof(void *));
+        MemoryAttr tempMem(numSortTestRows * sizeof(void *));
+        void * * rows1 = static_cast<void * *>(rowMem1.bufferBase());
+        void * * rows2 = static_cast<void * *>(rowMem2.bufferBase());
+        void * * temp = static_cast<void * *>(tempMem.bufferBase());
+        for (unsigned i=0; i < numSortTestRows; i++)
+        {
+            rows1[i] = base + i * rowSize;
+            rows2[i] = base + i * rowSize;
+        }
+
+        CCycleTimer timer;
+        msortvecstableinplace(rows1, numSortTestRows, compare, temp);
+        unsigned __int64 mergeTime = timer.elapsedNs();
+
+        timer.reset();
+        normalizedsortvecstableinplace(rows2, numSortTestRows, compare, *normalizer, temp);
+        unsigned __int64 normalizedTime = timer.elapsedNs();
+
+        DBGLOG("%s: %u rows merge sort %.3fms normalized sort %.3fms (complete key %s)", title, numSortTestRows,
+                (double)mergeTime / 1000000, (double)normalizedTime / 1000000, boolToStr(normalizer->isComplete()));
+
+        //Both sorts are stable, so the results must be identical
+        for (unsigned i=0; i < numSortTestRows; i++)
+            CPPUNIT_ASSERT(rows1[i] == rows2[i]);
+    }
+
+    void testUnsigned8()
+    {
+        static const RtlIntTypeInfo idType(type_unsigned|type_int, 8);
+        static const RtlStringTypeInfo payloadType(type_string, 12);
+        static const RtlFieldStrInfo idField("id", nullptr, &idType);
+        static const RtlFieldStrInfo payloadField("payload", nullptr, &payloadType);
+        static const RtlFieldInfo * const fields[] = { &idField, &payloadField, nullptr };
+        RtlRecord record(fields, true);
+
+        const size32_t rowSize = 20;
+        MemoryAttr rowData(numSortTestRows * rowSize);
+        byte * row = static_cast<byte *>(rowData.bufferBase());
+        for (unsigned i=0; i < numSortTestRows; i++, row += rowSize)
+        {
+            unsigned __int64 id = ((unsigned __int64)getRandom() << 32) | getRandom();
+            memcpy(row, &id, sizeof(id));
+            fillString(row + 8, 12, 26);
+        }
+
+        const unsigned sortFields[] = { 0 };
+        CompareUnsigned8 compare;
+        timeSort("unsigned8", record, 1, sortFields, compare, rowSize, rowData);
+    }
+
+    void testString20()
+    {
+        static const RtlStringTypeInfo nameType(type_string, 20);
+        static const RtlIntTypeInfo seqType(type_unsigned|type_int, 4);
+        static const RtlFieldStrInfo nameField("name", nullptr, &nameType);
+        static const RtlFieldStrInfo seqField("seq", nullptr, &seqType);
+        static const RtlFieldInfo * const fields[] = { &nameField, &seqField, nullptr };
+        RtlRecord record(fields, true);
+
+        const size32_t rowSize = 24;
+        MemoryAttr rowData(numSortTestRows * rowSize);
+        byte * row = static_cast<byte *>(rowData.bufferBase());
+        for (unsigned i=0; i < numSortTestRows; i++, row += rowSize)
+        {
+            fillString(row, 20, 4);
+            memcpy(row + 20, &i, sizeof(i));
+        }
+
+        const unsigned sortFields[] = { 0 };
+        CompareString20 compare;
+        timeSort("string20", record, 1, sortFields, compare, rowSize, rowData);
+    }
+
+    void testStringInt()
+    {
+        static const RtlStringTypeInfo surnameType(type_string, 6);
+        static const RtlIntTypeInfo ageType(type_int, 4);
+        static const RtlIntTypeInfo seqType(type_unsigned|type_int, 4);
+        static const RtlFieldStrInfo surnameField("surname", nullptr, &surnameType);
+        static const RtlFieldStrInfo ageField("age", nullptr, &ageType);
+        static const RtlFieldStrInfo seqField("seq", nullptr, &seqType);
+        static const RtlFieldInfo * const fields[] = { &surnameField, &ageField, &seqField, nullptr };
+        RtlRecord record(fields, true);
+
+        const size32_t rowSize = 14;
+        MemoryAttr rowData(numSortTestRows * rowSize);
+        byte * row = static_cast<byte *>(rowData.bufferBase());
+        for (unsigned i=0; i < numSortTestRows; i++, row += rowSize)
+        {
+            fillString(row, 6, 3);
+            int age = (int)(getRandom() % 200000) - 100000;
+            memcpy(row + 6, &age, sizeof(age));
+            memcpy(row + 10, &i, sizeof(i));
+        }
+
+        const unsigned sortFields[] = { 0, 1 };
+        CompareStringInt compare;
+        timeSort("string6,integer4", record, 2, sortFields, compare, rowSize, rowData);
+    }
+};
+
+class CompareStringDescInt : public ICompare
+{
+public:
+    virtual int docompare(const void * left, const void * right) const override
+    {
+        int ret = memcmp(left, right, 5);
+        if (ret)
+            return ret;
+        int l = *(const int *)((const byte *)left + 5);
+        int r = *(const int *)((const byte *)right + 5);
+        return (l < r) ? +1 : (l > r) ? -1 : 0;
+    }
+};
+
+class CompareDescUnsigned4Int : public ICompare
+{
+public:
+    virtual int docompare(const void * left, const void * right) const override
+    {
+        unsigned l = *(const unsigned *)left;
+        unsigned r = *(const unsigned *)right;
+        if (l != r)
+            return (l < r) ? +1 : -1;
+        int l2 = *(const int *)((const byte *)left + 4);
+        int r2 = *(const int *)((const byte *)right + 4);
+        return (l2 < r2) ? -1 : (l2 > r2) ? +1 : 0;
+    }
+};
+
+class CompareVarString : public ICompare
+{
+public:
+    virtual int docompare(const void * left, const void * right) const override
+    {
+        size32_t l = *(const size32_t *)left;
+        size32_t r = *(const size32_t *)right;
+        return rtlCompareStrStr(l, (const char *)left + sizeof(size32_t), r, (const char *)right + sizeof(size32_t));
+    }
+};
+
+//Check the normalized sort produces exactly the same order as the stable merge sort it replaces
+class ThorSortNormalizedTests : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( ThorSortNormalizedTests );
+        CPPUNIT_TEST(testMixed);
+        CPPUNIT_TEST(testDescending);
+        CPPUNIT_TEST(testCompleteKey);
+        CPPUNIT_TEST(testVariableString);
+        CPPUNIT_TEST(testUnsupported);
+    CPPUNIT_TEST_SUITE_END();
+
+    static const unsigned numRows = 20000;
+
+protected:
+    void checkSort(const RtlRecord & record, unsigned numSortFields, const unsigned * sortFields, const bool * descending, const ICompare & compare, const void * * rowPtrs, bool expectComplete)
+    {
+        Owned<ISortKeyNormalizer> normalizer = createSortKeyNormalizer(record, numSortFields, sortFields, descending);
+        CPPUNIT_ASSERT(normalizer);
+        CPPUNIT_ASSERT_EQUAL(expectComplete, normalizer->isComplete());
+
+        void * * rows1 = new void * [numRows];
+        void * * rows2 = new void * [numRows];
+        void * * temp = new void * [numRows];
+        for (unsigned i=0; i < numRows; i++)
+        {
+            rows1[i] = const_cast<void *>(rowPtrs[i]);
+            rows2[i] = const_cast<void *>(rowPtrs[i]);
+        }
+
+        msortvecstableinplace(rows1, numRows, compare, temp);
+        normalizedsortvecstableinplace(rows2, numRows, compare, *normalizer, temp);
+
+        for (unsigned i=0; i < numRows; i++)
+        {
+            CPPUNIT_ASSERT(rows1[i] == rows2[i]);
+            if (i)
+                CPPUNIT_ASSERT(compare.docompare(rows2[i-1], rows2[i]) <= 0);
+        }
+        delete [] rows1;
+        delete [] rows2;
+        delete [] temp;
+    }
+
+    void fillRows(const void * * rowPtrs, const byte * base, size32_t rowSize)
+    {
+        for (unsigned i=0; i < numRows; i++)
+            rowPtrs[i] = base + i * rowSize;
+    }
+
+    void testMixed()
+    {
+        //string6 + signed integer4 does not fit in the key, so runs of equal prefixes are resolved by the compare
+        static const RtlStringTypeInfo surnameType(type_string, 6);
+        static const RtlIntTypeInfo ageType(type_int, 4);
+        static const RtlIntTypeInfo seqType(type_unsigned|type_int, 4);
+        static const RtlFieldStrInfo surnameField("surname", nullptr, &surnameType);
+        static const RtlFieldStrInfo ageField("age", nullptr, &ageType);
+        static const RtlFieldStrInfo seqField("seq", nullptr, &seqType);
+        static const RtlFieldInfo * const fields[] = { &surnameField, &ageField, &seqField, nullptr };
+        RtlRecord record(fields, true);
+
+        const size32_t rowSize = 14;
+        MemoryAttr rowData(numRows * rowSize);
+        byte * row = static_cast<byte *>(rowData.bufferBase());
+        for (unsigned i=0; i < numRows; i++, row += rowSize)
+        {
+            for (unsigned j=0; j < 6; j++)
+                row[j] = 'A' + getRandom() % 3;
+            int age = (int)(getRandom() % 2000) - 1000;
+            memcpy(row + 6, &age, sizeof(age));
+            memcpy(row + 10, &i, sizeof(i));
+        }
+
+        const void * * rowPtrs = new const void * [numRows];
+        fillRows(rowPtrs, static_cast<const byte *>(rowData.get()), rowSize);
+        const unsigned sortFields[] = { 0, 1 };
+        CompareStringInt compare;
+        checkSort(record, 2, sortFields, nullptr, compare, rowPtrs, false);
+        delete [] rowPtrs;
+    }
+
+    void testDescending()
+    {
+        //string5 ascending, then a signed integer descending.  The key is truncated within the integer.
+        static const RtlStringTypeInfo codeType(type_string, 5);
+        static const RtlIntTypeInfo valueType(type_int, 4);
+        static const RtlIntTypeInfo seqType(type_unsigned|type_int, 4);
+        static const RtlFieldStrInfo codeField("code", nullptr, &codeType);
+        static const RtlFieldStrInfo valueField("value", nullptr, &valueType);
+        static const RtlFieldStrInfo seqField("seq", nullptr, &seqType);
+        static const RtlFieldInfo * const fields[] = { &codeField, &valueField, &seqField, nullptr };
+        RtlRecord record(fields, true);
+
+        const size32_t rowSize = 13;
+        MemoryAttr rowData(numRows * rowSize);
+        byte * row = static_cast<byte *>(rowData.bufferBase());
+        for (unsigned i=0; i < numRows; i++, row += rowSize)
+        {
+            for (unsigned j=0; j < 5; j++)
+                row[j] = 'A' + getRandom() % 2;
+            //Mix of small and large magnitudes so both the truncated and the untruncated bytes matter
+            int value = (getRandom() & 1) ? (int)(getRandom() % 200) - 100 : (int)getRandom();
+            memcpy(row + 5, &value, sizeof(value));
+            memcpy(row + 9, &i, sizeof(i));
+        }
+
+        const void * * rowPtrs = new const void * [numRows];
+        fillRows(rowPtrs, static_cast<const byte *>(rowData.get()), rowSize);
+        const unsigned sortFields[] = { 0, 1 };
+        const bool descending[] = { false, true };
+        CompareStringDescInt compare;
+        checkSort(record, 2, sortFields, descending, compare, rowPtrs, false);
+        delete [] rowPtrs;
+    }
+
+    void testCompleteKey()
+    {
+        //unsigned4 descending, then a signed integer4 ascending fills the key exactly
+        static const RtlIntTypeInfo groupType(type_unsigned|type_int, 4);
+        static const RtlIntTypeInfo valueType(type_int, 4);
+        static const RtlFieldStrInfo groupField("grp", nullptr, &groupType);
+        static const RtlFieldStrInfo valueField("value", nullptr, &valueType);
+        static const RtlFieldInfo * const fields[] = { &groupField, &valueField, nullptr };
+        RtlRecord record(fields, true);
+
+        const size32_t rowSize = 8;
+        MemoryAttr rowData(numRows * rowSize);
+        byte * row = static_cast<byte *>(rowData.bufferBase());
+        for (unsigned i=0; i < numRows; i++, row += rowSize)
+        {
+            unsigned grp = (getRandom() & 1) ? getRandom() % 10 : getRandom();
+            int value = (int)(getRandom() % 100) - 50;
+            memcpy(row, &grp, sizeof(grp));
+            memcpy(row + 4, &value, sizeof(value));
+        }
+
+        const void * * rowPtrs = new const void * [numRows];
+        fillRows(rowPtrs, static_cast<const byte *>(rowData.get()), rowSize);
+        const unsigned sortFields[] = { 0, 1 };
+        const bool descending[] = { true, false };
+        CompareDescUnsigned4Int compare;
+        checkSort(record, 2, sortFields, descending, compare, rowPtrs, true);
+        delete [] rowPtrs;
+    }
+
+    void testVariableString()
+    {
+        //Variable length strings compare ignoring trailing spaces, and may be shorter or longer than the key
+        static const RtlStringTypeInfo nameType(type_string|RFTMunknownsize, 0);
+        static const RtlFieldStrInfo nameField("name", nullptr, &nameType);
+        static const RtlFieldInfo * const fields[] = { &nameField, nullptr };
+        RtlRecord record(fields, true);
+
+        MemoryBuffer rowData;
+        UnsignedArray offsets;
+        for (unsigned i=0; i < numRows; i++)
+        {
+            size32_t len = getRandom() % 12;
+            offsets.append(rowData.length());
+            rowData.append(len);
+            for (unsigned j=0; j < len; j++)
+                rowData.append((char)((getRandom() % 4 == 0) ? ' ' : 'A' + getRandom() % 2));
+        }
+
+        const void * * rowPtrs = new const void * [numRows];
+        for (unsigned i=0; i < numRows; i++)
+            rowPtrs[i] = rowData.toByteArray() + offsets.item(i);
+        const unsigned sortFields[] = { 0 };
+        CompareVarString compare;
+        checkSort(record, 1, sortFields, nullptr, compare, rowPtrs, false);
+        delete [] rowPtrs;
+    }
+
+    void testUnsupported()
+    {
+        //A leading field that cannot be normalized means there is no normalizer at all
+        static const RtlRealTypeInfo realType(type_real, 8);
+        static const RtlIntTypeInfo seqType(type_unsigned|type_int, 4);
+        static const RtlFieldStrInfo realField("r", nullptr, &realType);
+        static const RtlFieldStrInfo seqField("seq", nullptr, &seqType);
+        static const RtlFieldInfo * const fields[] = { &realField, &seqField, nullptr };
+        RtlRecord record(fields, true);
+
+        const unsigned sortFields[] = { 0, 1 };
+        Owned<ISortKeyNormalizer> normalizer = createSortKeyNormalizer(record, 2, sortFields, nullptr);
+        CPPUNIT_ASSERT(!normalizer);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ThorSortNormalizedTests );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( ThorSortNormalizedTests, "ThorSortNormalizedTests" );
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ThorSortNormalizedTimingTests );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( ThorSortNormalizedTimingTests, "ThorSortNormalizedTimingTests" );
+
+} // namespace thorsorttests
+#endif
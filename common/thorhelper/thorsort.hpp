@@ -38,4 +38,19 @@ inline void parsortvecstableinplace(void ** rows, size_t n, const ICompare & com
 extern THORHELPER_API void tbbqsortvec(void **a, size_t n, const ICompare & compare);
 extern THORHELPER_API void tbbqsortstable(void ** rows, size_t n, const ICompare & compare, void ** temp);
 
+//Produces a fixed width, byte comparable encoding of the leading sort fields of a row.  If a.key < b.key then
+//compare(a,b) must be < 0, equal keys say nothing unless the key isComplete() (i.e. encodes the entire comparison).
+interface ISortKeyNormalizer : extends IInterface
+{
+    virtual unsigned __int64 getNormalizedKey(const void * row) const = 0;
+    virtual bool isComplete() const = 0;
+};
+
+class RtlRecord;
+//Returns NULL if the first sort field cannot be normalized, descending may be NULL if all fields are ascending.
+extern THORHELPER_API ISortKeyNormalizer * createSortKeyNormalizer(const RtlRecord & record, unsigned numSortFields, const unsigned * sortFields, const bool * descending);
+
+//Stable sort that radix sorts on the normalized keys, and only calls compare to resolve rows with equal keys.
+extern THORHELPER_API void normalizedsortvecstableinplace(void ** rows, size_t n, const ICompare & compare, const ISortKeyNormalizer & normalizer, void ** temp);
+
 #endif
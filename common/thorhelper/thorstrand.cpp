@@ -29,6 +29,106 @@ const void * queryEndOfSectionMarker() { return &endOfSectionMarker; }
 
 //---------------------------------------------------------------------------------------------------------------------
 
+//Strand and read-ahead threads are taken from a shared pool rather than being created for each activity instance.
+//The number of them that can be processing rows at the same time can optionally be limited (e.g. to the number of cpus)
+//so that several concurrent queries with many strands do not swamp the machine.  A thread gives up its cpu slot whenever
+//it blocks waiting for another strand, and only waits a short time to regain one, so the limit cannot cause a deadlock.
+//Activities can also block elsewhere while holding a slot, so the limit is off unless configured.
+static unsigned strandThreadLimit = 0;              // 0 means unlimited
+static Semaphore strandCpuSlots;
+static __thread bool holdsStrandCpuSlot = false;
+static const unsigned maxStrandCpuSlotWait = 100;   // ms
+
+static void acquireStrandCpuSlot()
+{
+    if (strandThreadLimit)
+        holdsStrandCpuSlot = strandCpuSlots.wait(maxStrandCpuSlotWait);
+}
+
+static void releaseStrandCpuSlot()
+{
+    if (holdsStrandCpuSlot)
+    {
+        holdsStrandCpuSlot = false;
+        strandCpuSlots.signal();
+    }
+}
+
+void setStrandThreadLimit(unsigned limit)
+{
+    strandThreadLimit = limit;
+    strandCpuSlots.reinit(limit);
+}
+
+//Release the current thread's cpu slot (if it has one) for the duration of a potentially blocking call
+class StrandBlockingSection
+{
+public:
+    inline StrandBlockingSection() : released(holdsStrandCpuSlot)
+    {
+        if (released)
+            releaseStrandCpuSlot();
+    }
+    inline ~StrandBlockingSection()
+    {
+        if (released)
+            acquireStrandCpuSlot();
+    }
+
+private:
+    bool released;
+};
+
+class CStrandThread : public CInterfaceOf<IPooledThread>
+{
+public:
+    virtual void init(void * param)
+    {
+        threaded = static_cast<IThreaded *>(param);
+    }
+    virtual void main()
+    {
+        acquireStrandCpuSlot();
+        try
+        {
+            threaded->main();
+        }
+        catch (...)
+        {
+            releaseStrandCpuSlot();
+            throw;
+        }
+        releaseStrandCpuSlot();
+    }
+    virtual bool stop() { return true; }
+    virtual bool canReuse() { return true; }
+
+protected:
+    IThreaded * threaded = nullptr;
+};
+
+class CStrandThreadFactory : public CInterfaceOf<IThreadFactory>
+{
+public:
+    virtual IPooledThread * createNew() { return new CStrandThread; }
+};
+
+static IThreadPool * strandThreadPool;
+
+MODULE_INIT(INIT_PRIORITY_STANDARD)
+{
+    Owned<IThreadFactory> factory = new CStrandThreadFactory;
+    strandThreadPool = createThreadPool("StrandThreadPool", factory, NULL, 0, 0);
+    return true;
+}
+
+MODULE_EXIT()
+{
+    ::Release(strandThreadPool);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
 class CStrandBarrier : public CInterfaceOf<IStrandBarrier>
 {
 public:
@@ -39,16 +139,17 @@ public:
 
     virtual void startStrand(IStrandThreaded & strand)
     {
-        CThreaded * thread = new CThreaded("Strand", &strand);
-        threads.append(*thread);
-        thread->start();
+        threads.append(strandThreadPool->start(&strand, "Strand"));
     }
 
     virtual void waitForStrands()
     {
         producerStopSem.signal(threads.ordinality());
-        ForEachItemIn(i, threads)
-            threads.item(i).join();
+        {
+            StrandBlockingSection blocking;
+            ForEachItemIn(i, threads)
+                strandThreadPool->join(threads.item(i));
+        }
         threads.kill();
     }
 
@@ -62,12 +163,13 @@ public:
 protected:
     void waitForStop()
     {
+        StrandBlockingSection blocking;
         producerStopSem.wait();
     }
 
 protected:
     Semaphore producerStopSem;
-    CIArrayOf<CThreaded> threads;
+    UnsignedArray threads;
 };
 
 
@@ -107,9 +209,7 @@ public:
 
     void startProducerThread(IThreaded & main)
     {
-        CThreaded * thread = new CThreaded("ReadAheadThread", &main);
-        threads.append(*thread);
-        thread->start();
+        threads.append(strandThreadPool->start(&main, "ReadAheadThread"));
     }
 
     void processConsumerStop()
@@ -120,6 +220,7 @@ public:
             if (!stopping.exchange(true, std::memory_order_acq_rel))
             {
                 stopActiveProducers();
+                StrandBlockingSection blocking;
                 for (unsigned i=0; i < numProducers; i++)
                     producerStoppedSem.wait();
             }
@@ -141,6 +242,7 @@ public:
 protected:
     void waitForStop()
     {
+        StrandBlockingSection blocking;
         producerStopSem.wait();
     }
 
@@ -153,8 +255,11 @@ protected:
     void waitForProducers()
     {
         producerStopSem.signal(numProducers);
-        ForEachItemIn(i, threads)
-            threads.item(i).join();
+        {
+            StrandBlockingSection blocking;
+            ForEachItemIn(i, threads)
+                strandThreadPool->join(threads.item(i));
+        }
         threads.kill();
     }
 
@@ -174,7 +279,7 @@ private:
     const unsigned numProducers;
     Semaphore producerStopSem;
     Semaphore producerStoppedSem;
-    CIArrayOf<CThreaded> threads;
+    UnsignedArray threads;
     std::atomic<bool> stopping;
     bool started;
 };
@@ -292,6 +397,21 @@ RoxieRowBlock * RowBlockAllocator::newBlock()
 
 //---------------------------------------------------------------------------------------------------------------------
 
+//These give up the strand's cpu slot while waiting for space in, or items from, another strand.
+static inline bool enqueueBlock(IRowQueue & queue, RoxieRowBlock * block)
+{
+    StrandBlockingSection blocking;
+    return queue.enqueue(block);
+}
+
+static inline bool dequeueBlock(IRowQueue & queue, const void * & next)
+{
+    if (queue.tryDequeue(next))
+        return true;
+    StrandBlockingSection blocking;
+    return queue.dequeue(next);
+}
+
 static void resetBlockQueue(IRowQueue * queue)
 {
     queue->reset();
@@ -321,7 +441,7 @@ public:
         {
             RoxieRowBlock * block = allocator.newBlock();
             done = block->readFromStream(stream);
-            if (junction.isStopping() || block->empty() || !queue->enqueue(block))
+            if (junction.isStopping() || block->empty() || !enqueueBlock(*queue, block))
             {
                 block->releaseBlock();
                 break;
@@ -380,7 +500,7 @@ public:
                 curBlock = NULL;
             }
             const void * next;
-            if (!queue.dequeue(next))
+            if (!dequeueBlock(queue, next))
             {
                 //If inputs are unordered, process exceptions last of all
                 if (pendingException)
@@ -589,7 +709,7 @@ public:
     {
         if (abortSoon || finishedReading)
             return false;
-        space.wait();
+        waitFor(space);
         if (abortSoon || finishedReading)
             return false;
         value = next;
@@ -609,7 +729,7 @@ public:
     {
         if (abortSoon)
             return;
-        space.wait();
+        waitFor(space);
         finishedWriting = true;
         avail.signal();
     }
@@ -618,7 +738,7 @@ public:
     {
         if (abortSoon)
             return false;
-        avail.wait();
+        waitFor(avail);
         if (abortSoon)
             return false;
 
@@ -634,6 +754,15 @@ public:
         return true;
     }
 
+protected:
+    static void waitFor(Semaphore & sem)
+    {
+        if (sem.wait(0))
+            return;
+        StrandBlockingSection blocking;
+        sem.wait();
+    }
+
 protected:
     RoxieRowBlock * value = nullptr;
     bool abortSoon = false;
@@ -1556,7 +1685,7 @@ public:
             curBlock = allocator.newBlock();
         if (curBlock->addRowNowFull(row))
         {
-            if (!queue->enqueue(curBlock))
+            if (!enqueueBlock(*queue, curBlock))
                 curBlock->releaseBlock();
             curBlock = NULL;
         }
@@ -1566,7 +1695,7 @@ public:
     {
         if (curBlock)
         {
-            if (!queue->enqueue(curBlock))
+            if (!enqueueBlock(*queue, curBlock))
                 curBlock->releaseBlock();
             curBlock = NULL;
         }
@@ -1640,7 +1769,7 @@ public:
                 curBlock = NULL;
             }
             const void * next;
-            if (!queue->dequeue(next))
+            if (!dequeueBlock(*queue, next))
                 return NULL;
             curBlock = (RoxieRowBlock *)next;
         }
@@ -1667,3 +1796,103 @@ extern THORHELPER_API IManyToOneRowStream * createManyToOneRowStream(roxiemem::I
         return new UnorderedManyToOneRowStream(rowManager, numInputs, blockSize);
     return NULL;
 }
+
+#ifdef _USE_CPPUNIT
+#include "unittests.hpp"
+
+class StrandThreadLimitTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(StrandThreadLimitTest);
+        CPPUNIT_TEST(testUnlimited);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    class CCountingStrand : public CInterface, implements IStrandThreaded
+    {
+    public:
+        CCountingStrand(IStrandBarrier & _barrier, std::atomic<unsigned> & _active, std::atomic<unsigned> & _maxActive)
+        : barrier(_barrier), active(_active), maxActive(_maxActive)
+        {
+        }
+        virtual void main()
+        {
+            heldSlot = holdsStrandCpuSlot;
+            unsigned now = ++active;
+            unsigned prevMax = maxActive.load();
+            while ((now > prevMax) && !maxActive.compare_exchange_weak(prevMax, now))
+            {
+            }
+            MilliSleep(5);
+            --active;
+            barrier.noteStrandFinished(NULL);   // blocks until all the strands have finished
+        }
+        virtual void stopStream()
+        {
+        }
+
+        bool heldSlot = false;
+    protected:
+        IStrandBarrier & barrier;
+        std::atomic<unsigned> & active;
+        std::atomic<unsigned> & maxActive;
+    };
+
+    void runStrands(unsigned numStrands, unsigned & maxActive, unsigned & numHeldSlot)
+    {
+        Owned<IStrandBarrier> barrier = createStrandBarrier();
+        std::atomic<unsigned> active{0};
+        std::atomic<unsigned> maxActiveCount{0};
+        CIArrayOf<CCountingStrand> strands;
+        for (unsigned i = 0; i < numStrands; i++)
+        {
+            CCountingStrand * strand = new CCountingStrand(*barrier, active, maxActiveCount);
+            strands.append(*strand);
+            barrier->startStrand(*strand);
+        }
+        barrier->waitForStrands();
+        maxActive = maxActiveCount;
+        numHeldSlot = 0;
+        ForEachItemIn(i, strands)
+        {
+            if (strands.item(i).heldSlot)
+                numHeldSlot++;
+        }
+    }
+
+    void testUnlimited()
+    {
+        //Off by default - no strand waits for or holds a slot
+        setStrandThreadLimit(0);
+        unsigned maxActive, numHeldSlot;
+        runStrands(8, maxActive, numHeldSlot);
+        CPPUNIT_ASSERT_EQUAL(0U, numHeldSlot);
+    }
+
+};
+
+//Depends on each strand finishing well within the time the others wait for a cpu slot, so can fail on a heavily loaded machine
+class StrandThreadLimitTimingTest : public StrandThreadLimitTest
+{
+    CPPUNIT_TEST_SUITE(StrandThreadLimitTimingTest);
+        CPPUNIT_TEST(testLimit);
+    CPPUNIT_TEST_SUITE_END();
+
+    void testLimit()
+    {
+        //No more than the limit run at once, and every strand gets a slot because those waiting for the other strands
+        //to finish give theirs up (a strand that timed out waiting would run without one)
+        setStrandThreadLimit(2);
+        unsigned maxActive, numHeldSlot;
+        runStrands(8, maxActive, numHeldSlot);
+        setStrandThreadLimit(0);
+        CPPUNIT_ASSERT(maxActive <= 2);
+        CPPUNIT_ASSERT_EQUAL(8U, numHeldSlot);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( StrandThreadLimitTest );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( StrandThreadLimitTest, "StrandThreadLimitTest" );
+CPPUNIT_TEST_SUITE_REGISTRATION( StrandThreadLimitTimingTest );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( StrandThreadLimitTimingTest, "StrandThreadLimitTimingTest" );
+
+#endif
@@ -82,6 +82,8 @@ extern THORHELPER_API IStrandBarrier * createStrandBarrier();
 
 extern THORHELPER_API IManyToOneRowStream * createManyToOneRowStream(roxiemem::IRowManager & _rowManager, unsigned numInputs, unsigned blockSize, bool isOrdered);
 extern THORHELPER_API const void * queryEndOfSectionMarker();
+//Limit the number of strand threads actively processing rows (0 = unlimited).  Should be called before any strands are started.
+extern THORHELPER_API void setStrandThreadLimit(unsigned limit);
 
 //---------------------------------------------------------------------------------------------------------------------
 
@@ -4911,7 +4911,11 @@ public:
     IConstWorkUnitIterator* getScheduledWorkUnits(ISecManager *secmgr, ISecUser *secuser)
     {
         StringBuffer path("*");
-        path.append("[@state=\"").append(getEnumText(WUStateScheduled, states)).append("\"]");
+        const char *scheduled = getEnumText(WUStateScheduled, states);
+        Owned<IPropertyTreeIterator> iter = getIndexedWorkUnits("@state", scheduled);
+        if (iter)
+            return createSecureConstWUIterator(iter.getClear(), secmgr, secuser);
+        path.append("[@state=\"").append(scheduled).append("\"]");
         return _getWorkUnitsByXPath(path.str(), secmgr, secuser);
     }
     virtual void clientShutdown();
@@ -4938,6 +4942,27 @@ public:
         query.append('"').append(value).append("\"]");
     };
 
+    static bool isIndexableFilter(int flags)
+    {
+        switch (flags & 0xff)
+        {
+        case WUSFstate:
+        case WUSFcluster:
+        case WUSFuser:
+            return (flags & (WUSFnocase|WUSFwild)) == 0;
+        }
+        return false;
+    }
+    /**
+     * Find the workunits with an exact attribute value using the dali server's index on /WorkUnits, if it has one
+     * covering the attribute. Returns NULL if the workunits need to be found by scanning instead.
+     */
+    static IPropertyTreeIterator *getIndexedWorkUnits(const char *attr, const char *value)
+    {
+        // CLightweightWorkunitInfo also needs the Action and Application children
+        return querySDS().getIndexedElements("WorkUnits", attr, value, NULL, false, 0, 0, "Action,Application");
+    }
+
     IConstWorkUnitIterator* getWorkUnitsSorted( WUSortField sortorder, // field to sort by (and flags for desc sort etc)
                                                 WUSortField *filters,   // NULL or list of fields to filter on (terminated by WUSFterm)
                                                 const void *filterbuf,  // (appended) string values for filters
@@ -5019,12 +5044,38 @@ public:
             StringAttr nameFilterHi;
             StringArray unknownAttributes;
             Owned<CQueryOrFilter> orFilter;
+            StringAttr indexAttr;
+            StringAttr indexValue;
+            bool indexOrFilter;
 
+            IPropertyTreeIterator *getIndexedElements()
+            {
+                if (indexAttr)
+                    return getIndexedWorkUnits(indexAttr, indexValue);
+                if (!indexOrFilter)
+                    return NULL;
+                Owned <CMultiPTreeIterator> multi = new CMultiPTreeIterator;
+                const StringArray& values = orFilter->queryValues();
+                ForEachItemIn(i, values)
+                {
+                    const char* value = values.item(i);
+                    if (!isEmptyString(value))
+                    {
+                        IPropertyTreeIterator *itr = getIndexedWorkUnits(orFilter->queryName(), value);
+                        if (!itr)
+                            return NULL;
+                        multi->addSource(*itr);
+                    }
+                }
+                return multi.getClear();
+            }
         public:
             IMPLEMENT_IINTERFACE_USING(CSimpleInterface);
 
-            CWorkUnitsPager(const char* _xPath, CQueryOrFilter* _orFilter, const char *_sortOrder, const char* _nameFilterLo, const char* _nameFilterHi, StringArray& _unknownAttributes)
-                : xPath(_xPath), orFilter(_orFilter), sortOrder(_sortOrder), nameFilterLo(_nameFilterLo), nameFilterHi(_nameFilterHi)
+            CWorkUnitsPager(const char* _xPath, CQueryOrFilter* _orFilter, const char *_sortOrder, const char* _nameFilterLo, const char* _nameFilterHi, StringArray& _unknownAttributes,
+                            const char *_indexAttr, const char *_indexValue, bool _indexOrFilter)
+                : xPath(_xPath), orFilter(_orFilter), sortOrder(_sortOrder), nameFilterLo(_nameFilterLo), nameFilterHi(_nameFilterHi),
+                  indexAttr(_indexAttr), indexValue(_indexValue), indexOrFilter(_indexOrFilter && _orFilter)
             {
                 ForEachItemIn(x, _unknownAttributes)
                     unknownAttributes.append(_unknownAttributes.item(x));
@@ -5034,35 +5085,39 @@ public:
                 Owned<IRemoteConnection> conn = querySDS().connect("WorkUnits", myProcessSession(), 0, SDS_LOCK_TIMEOUT);
                 if (!conn)
                     return NULL;
-                Owned<IPropertyTreeIterator> iter;
-                if (!orFilter)
-                {
-                    iter.setown(conn->getElements(xPath.get()));
-                }
-                else
+                // An index lookup returns copies of the matching workunits, otherwise scan them on the server
+                Owned<IPropertyTreeIterator> iter = getIndexedElements();
+                if (!iter)
                 {
-                    Owned <CMultiPTreeIterator> multi = new CMultiPTreeIterator;
-                    bool added = false;
-                    const char* fieldName = orFilter->queryName();
-                    unsigned flags = orFilter->querySearchFlags();
-                    const StringArray& values = orFilter->queryValues();
-                    ForEachItemIn(i, values)
+                    if (!orFilter)
                     {
-                        StringBuffer path = xPath.get();
-                        const char* value = values.item(i);
-                        if (!isEmptyString(value))
+                        iter.setown(conn->getElements(xPath.get()));
+                    }
+                    else
+                    {
+                        Owned <CMultiPTreeIterator> multi = new CMultiPTreeIterator;
+                        bool added = false;
+                        const char* fieldName = orFilter->queryName();
+                        unsigned flags = orFilter->querySearchFlags();
+                        const StringArray& values = orFilter->queryValues();
+                        ForEachItemIn(i, values)
                         {
-                            appendFilterToQueryString(path, flags, fieldName, value);
-                            IPropertyTreeIterator *itr = conn->getElements(path.str());
-                            if (itr)
+                            StringBuffer path = xPath.get();
+                            const char* value = values.item(i);
+                            if (!isEmptyString(value))
                             {
-                                multi->addSource(*itr);
-                                added = true;
+                                appendFilterToQueryString(path, flags, fieldName, value);
+                                IPropertyTreeIterator *itr = conn->getElements(path.str());
+                                if (itr)
+                                {
+                                    multi->addSource(*itr);
+                                    added = true;
+                                }
                             }
                         }
+                        if (added)
+                            iter.setown(multi.getClear());
                     }
-                    if (added)
-                        iter.setown(multi.getClear());
                 }
                 if (!iter)
                     return NULL;
@@ -5114,6 +5169,10 @@ public:
         StringAttr namefilterlo;
         StringAttr namefilterhi;
         StringArray unknownAttributes;
+        // A lone exact state/cluster/user filter (or an OR of them) can be looked up in the dali server's index
+        StringAttr indexAttr;
+        StringAttr indexValue;
+        unsigned numQueryFilters = 0;
         if (filters)
         {
             const char *fv = (const char *) filterbuf;
@@ -5132,6 +5191,7 @@ public:
                 {
                     const char *app = fv;
                     fv = fv + strlen(fv)+1;
+                    numQueryFilters++;
                     query.append("[Application/").append(app);
                     if (*fv)
                         query.append("=?~\"").append(fv).append('\"');
@@ -5147,7 +5207,15 @@ public:
                 {
                     const char* fieldName = getEnumText(subfmt,workunitSortFields);
                     if (!strchr(fv, '|'))
+                    {
                         appendFilterToQueryString(query, fmt, fieldName, fv);
+                        numQueryFilters++;
+                        if (isIndexableFilter(fmt))
+                        {
+                            indexAttr.set(fieldName);
+                            indexValue.set(fv);
+                        }
+                    }
                     else if (orFilter)
                         throw MakeStringException(WUERR_InvalidUserInput, "Multiple OR filters not allowed");
                     else
@@ -5164,6 +5232,11 @@ public:
         }
         if ((sortorder&0xff)==WUSFtotalthortime)
             sortorder = (WUSortField) (sortorder & ~WUSFnumeric);
+        bool indexOrFilter = false;
+        if (!streq(namefilter, "*") || (numQueryFilters != (orFilter ? 0 : 1)))
+            indexAttr.clear();
+        else if (orFilter)
+            indexOrFilter = isIndexableFilter(orFilter->querySearchFlags());
         query.insert(0, namefilter.get());
         if (sortorder)
         {
@@ -5178,7 +5251,8 @@ public:
             so.append(getEnumText(sortorder&0xff,workunitSortFields));
         }
         IArrayOf<IPropertyTree> results;
-        Owned<IElementsPager> elementsPager = new CWorkUnitsPager(query.str(), orFilter.getClear(), so.length()?so.str():NULL, namefilterlo.get(), namefilterhi.get(), unknownAttributes);
+        Owned<IElementsPager> elementsPager = new CWorkUnitsPager(query.str(), orFilter.getClear(), so.length()?so.str():NULL, namefilterlo.get(), namefilterhi.get(), unknownAttributes,
+                                                                    indexAttr.get(), indexValue.get(), indexOrFilter);
         Owned<IRemoteConnection> conn=getElementsPaged(elementsPager,startoffset,maxnum,secmgr?sc:NULL,"",cachehint,results,total,NULL);
         return new CConstWUArrayIterator(results);
     }
@@ -37,7 +37,7 @@ extern void closedownDFS();
 // base is saved in store whenever block exhausted, so replacement coven servers can restart 
 
 // server side versioning.
-#define ServerVersion    "3.14"
+#define ServerVersion    "3.16"
 #define MinClientVersion "1.5"
 
 
@@ -308,7 +308,25 @@ public:
         assertex(comm);
         return comm->verifyAll(duplex,timeout);
     }
-    
+
+    virtual bool broadcast(CMessageBuffer &mbuf, rank_t root, mptag_t tag, size32_t chunkSize=0, unsigned timeout=MP_WAIT_FOREVER)
+    {
+        assertex(comm);
+        return comm->broadcast(mbuf,root,tag,chunkSize,timeout);
+    }
+
+    virtual bool allgather(CMessageBuffer &mbuf, mptag_t tag, unsigned timeout=MP_WAIT_FOREVER)
+    {
+        assertex(comm);
+        return comm->allgather(mbuf,tag,timeout);
+    }
+
+    virtual bool reduce(CMessageBuffer &mbuf, rank_t root, mptag_t tag, IMPReducer &reducer, unsigned timeout=MP_WAIT_FOREVER)
+    {
+        assertex(comm);
+        return comm->reduce(mbuf,root,tag,reducer,timeout);
+    }
+
     // receive, returns senders rank or false if no message available in time given or cancel called
 
     virtual IGroup &queryGroup()
@@ -2218,6 +2218,43 @@ bool CClientSDSManager::updateEnvironment(IPropertyTree *newEnv, bool forceGroup
     return result;
 }
 
+#define MIN_GETINDEXED_SVER "3.16" // with the children to return
+IPropertyTreeIterator *CClientSDSManager::getIndexedElements(const char *xpath, const char *filterAttr, const char *filterValue, const char *sortAttr, bool descending, unsigned from, unsigned limit, const char *children, unsigned *total)
+{
+    CDaliVersion serverVersionNeeded(MIN_GETINDEXED_SVER);
+    if (queryDaliServerVersion().compare(serverVersionNeeded) < 0)
+        return NULL; // no server side indexes, caller falls back to scanning
+
+    CMessageBuffer mb;
+    mb.append((int)DAMP_SDSCMD_GETINDEXED);
+    mb.append(xpath).append(filterAttr).append(filterValue).append(sortAttr).append(descending).append(from).append(limit).append(children);
+
+    if (!sendRequest(mb, true))
+        throw MakeSDSException(SDSExcpt_FailedToCommunicateWithServer, ", getIndexedElements(%s)", xpath);
+
+    SdsReply replyMsg;
+    mb.read((int &)replyMsg);
+    switch (replyMsg)
+    {
+        case DAMP_SDSREPLY_OK:
+        {
+            unsigned _total, count;
+            mb.read(_total).read(count);
+            if (total)
+                *total = _total;
+            Owned<DaliPTArrayIterator> resultIterator = new DaliPTArrayIterator;
+            for (unsigned c=0; c<count; c++)
+                resultIterator->array.append(*createPTree(mb));
+            return resultIterator.getClear();
+        }
+        case DAMP_SDSREPLY_EMPTY:
+            return NULL;
+        case DAMP_SDSREPLY_ERROR:
+            throwMbException("SDS Reply Error ", mb);
+    }
+    throwUnexpected();
+}
+
 //////////////
 
 ISDSManager &querySDS()
@@ -416,6 +416,7 @@ public:
     virtual void setConfigOpt(const char *opt, const char *value);
     virtual unsigned queryCount(const char *xpath);
     virtual bool updateEnvironment(IPropertyTree *newEnv, bool forceGroupUpdate, StringBuffer &response);
+    virtual IPropertyTreeIterator *getIndexedElements(const char *xpath, const char *filterAttr, const char *filterValue, const char *sortAttr, bool descending, unsigned from, unsigned limit, const char *children, unsigned *total);
 
 private:
     void noteDisconnected(CRemoteConnection &connection);
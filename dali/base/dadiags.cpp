@@ -199,6 +199,11 @@ public:
                     if (success)
                         mb.append(connectionInfo);
                 }
+                else if (0 == stricmp(id, "lockstats")) {
+                    bool reset;
+                    params.read(reset);
+                    mb.append(querySDSServer().getLockWaitStats(buf, reset).str());
+                }
                 else if (0 == stricmp(id, "save")) {
                     PROGLOG("Dalidiag requests SDS save");
                     querySDSServer().saveRequest();
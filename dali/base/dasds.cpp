@@ -26,6 +26,9 @@
 #include "javahash.tpp"
 #include "jmisc.hpp"
 #include "jlog.hpp"
+#include "jlz4.hpp"
+#include "jdebug.hpp"
+#include "jsort.hpp"
 #include "mplog.hpp"
 #include "jptree.ipp"
 #include "jqueue.tpp"
@@ -89,6 +92,8 @@ static unsigned msgCount=(unsigned)-1;
 #define CRC_VALIDATION
 
 #define SUBNTFY_POOL_SIZE 400
+#define SUBNTFY_COALESCE_WINDOW 20 // ms
+#define SUBNTFY_QUEUE_LIMIT 100000 // pending changes per subscriber
 #define SUBSCAN_POOL_SIZE 100
 #define RTM_INTERNAL        0x80000000 // marker for internal connection (performed within a transaction)
 #define DEFAULT_EXTERNAL_SIZE_THRESHOLD (10*1024)
@@ -187,6 +192,8 @@ StringBuffer &getSdsCmdText(SdsCommand cmd, StringBuffer &ret)
             return ret.append("DAMP_SDSCMD_GETELEMENTSRAW");
         case DAMP_SDSCMD_GETCOUNT:
             return ret.append("DAMP_SDSCMD_GETCOUNT");
+        case DAMP_SDSCMD_GETINDEXED:
+            return ret.append("DAMP_SDSCMD_GETINDEXED");
         default:
             return ret.append("UNKNOWN");
     };
@@ -823,9 +830,170 @@ private:
 };
 
 typedef OwningStringSuperHashTableOf<CSubscriberContainerList> CSubscriberXPathTable;
+
+// A node in a prefix trie of subscribed xpaths, one level per path segment.
+// Segments containing wildcards or qualifiers are kept apart, as they must be tried against every segment at that level.
+// A '//' step is kept as a segment of its own, everything beneath it may match a change at any depth.
+class CSubscriberPathNode : public CInterface
+{
+    typedef OwningStringSuperHashTableOf<CSubscriberPathNode> CSubscriberPathNodeTable;
+public:
+    CSubscriberPathNode(const char *_segment) : segment(_segment) { }
+    const char *queryFindString() const { return segment; }
+
+    void add(const char *xpath, CSubscriberContainerList &list)
+    {
+        StringBuffer head;
+        const char *next = queryNextSegment(xpath, head);
+        if (!next)
+        {
+            subscribers = &list;
+            return;
+        }
+        CSubscriberPathNode *child = queryChild(head.str());
+        if (!child)
+        {
+            child = new CSubscriberPathNode(head.str());
+            if (isWild(head.str()))
+                wildChildren.append(*child);
+            else
+                children.replace(*child);
+        }
+        child->add(next, list);
+    }
+    // returns true if this node is no longer needed
+    bool remove(const char *xpath)
+    {
+        StringBuffer head;
+        const char *next = queryNextSegment(xpath, head);
+        if (!next)
+            subscribers = nullptr;
+        else
+        {
+            CSubscriberPathNode *child = queryChild(head.str());
+            if (child && child->remove(next))
+            {
+                if (isWild(head.str()))
+                    wildChildren.zap(*child);
+                else
+                    children.removeExact(child);
+            }
+        }
+        return !subscribers && !children.count() && !wildChildren.ordinality();
+    }
+    // Collect the subscribers that may match a change at xpath: those on the path to it, and all those below it.
+    void collect(const char *xpath, CSubscriberArray &subs)
+    {
+        StringBuffer head;
+        const char *next = queryNextSegment(xpath, head);
+        if (!next)
+        {
+            collectAll(subs);
+            return;
+        }
+        appendSubscribers(subs);
+        CSubscriberPathNode *child = children.find(head.str());
+        if (child)
+            child->collect(next, subs);
+        ForEachItemIn(w, wildChildren)
+        {
+            CSubscriberPathNode &wildChild = wildChildren.item(w);
+            if (wildChild.isDescendant())
+                wildChild.collectAll(subs);
+            else
+                wildChild.collect(next, subs);
+        }
+    }
+
+private:
+    // skips a separator, returns NULL if there are no more segments. A '//' step is returned as a segment of its own.
+    static const char *queryNextSegment(const char *xpath, StringBuffer &head)
+    {
+        if ('/' == *xpath)
+        {
+            xpath++;
+            if ('/' == *xpath)
+            {
+                head.append("//");
+                return xpath;
+            }
+        }
+        if ('\0' == *xpath)
+            return NULL;
+        const char *end = xpath;
+        unsigned nesting = 0;
+        char quote = '\0';
+        for (; *end; end++)
+        {
+            if (quote)
+            {
+                if (quote == *end)
+                    quote = '\0';
+            }
+            else if ('"' == *end || '\'' == *end)
+                quote = *end;
+            else if ('[' == *end)
+                nesting++;
+            else if (']' == *end)
+            {
+                if (nesting)
+                    nesting--;
+            }
+            else if ('/' == *end && !nesting)
+                break;
+        }
+        head.append(end-xpath, xpath);
+        return end;
+    }
+    static bool isWild(const char *segment)
+    {
+        return strchr(segment, '*') || strchr(segment, '[') || streq(segment, "//");
+    }
+    bool isDescendant() const { return streq(segment, "//"); }
+    CSubscriberPathNode *queryChild(const char *head)
+    {
+        if (!isWild(head))
+            return children.find(head);
+        ForEachItemIn(w, wildChildren)
+        {
+            CSubscriberPathNode &child = wildChildren.item(w);
+            if (streq(head, child.segment))
+                return &child;
+        }
+        return NULL;
+    }
+    void appendSubscribers(CSubscriberArray &subs)
+    {
+        if (subscribers)
+        {
+            ForEachItemIn(s, *subscribers)
+            {
+                CSubscriberContainer &sub = subscribers->item(s);
+                sub.Link();
+                subs.append(sub);
+            }
+        }
+    }
+    void collectAll(CSubscriberArray &subs)
+    {
+        appendSubscribers(subs);
+        SuperHashIteratorOf<CSubscriberPathNode> iter(children);
+        ForEach(iter)
+            iter.query().collectAll(subs);
+        ForEachItemIn(w, wildChildren)
+            wildChildren.item(w).collectAll(subs);
+    }
+
+    StringAttr segment;
+    CSubscriberContainerList *subscribers = nullptr; // NB: owned by the CSubscriberTable's xpathTable
+    CSubscriberPathNodeTable children;
+    CIArrayOf<CSubscriberPathNode> wildChildren;
+};
+
 class CSubscriberTable : public ThreadSafeSimpleHashTableOf<CSubscriberContainer, SubscriptionId>
 {
 public:
+    CSubscriberTable() : pathRoot("") { }
     ~CSubscriberTable() { _releaseAll(); }
 
     virtual void onAdd(void *et)
@@ -836,6 +1004,7 @@ public:
         {
             list = new CSubscriberContainerList(subscriber->queryXPath());
             xpathTable.replace(*list);
+            pathRoot.add(list->queryXPath(), *list);
         }
         list->append(*subscriber); // give over ownership.
     }
@@ -847,7 +1016,10 @@ public:
         assertex(list);
         verifyex(list->zap(*subscriber));
         if (!list->ordinality())
+        {
+            pathRoot.remove(list->queryXPath());
             xpathTable.removeExact(list);
+        }
     }
     CSubscriberContainerList *getQualifiedList(const char *xpath, CPTStack &stack)
     {
@@ -879,8 +1051,15 @@ public:
             subs.append(sub);
         }
     }
+    // Only those subscribers whose xpath could match a change at or below xpath
+    void getSubscribers(const char *xpath, CSubscriberArray &subs)
+    {
+        CriticalBlock b(crit);
+        pathRoot.collect(xpath, subs);
+    }
 private:
     CSubscriberXPathTable xpathTable;
+    CSubscriberPathNode pathRoot;
 };
 
 #ifdef _DEBUG
@@ -937,7 +1116,7 @@ void serializeVisibleAttributes(IPropertyTree &tree, MemoryBuffer &mb)
     mb.append(""); // attribute terminator. i.e. blank attr name.
 }
 
-void writeDelta(StringBuffer &xml, IFile &iFile, const char *msg="", unsigned retrySecs=0, unsigned retryAttempts=10)
+bool writeDelta(StringBuffer &xml, IFile &iFile, const char *msg="", unsigned retrySecs=0, unsigned retryAttempts=10)
 {
     Owned<IException> exception;
     OwnedIFileIO iFileIO;
@@ -990,13 +1169,13 @@ void writeDelta(StringBuffer &xml, IFile &iFile, const char *msg="", unsigned re
             LOG(MCoperatorError, unknownJob, e, s.append("writeDelta, failed").str());
         }
         if (!exception.get())
-            break;
+            return true;
         if (0 == retrySecs)
-            return;
+            return false;
         if (0 == --_retryAttempts)
         {
             WARNLOG("writeDelta, too many retry attempts [%d]", retryAttempts);
-            return;
+            return false;
         }
         exception.clear();
         WARNLOG("writeDelta, retrying");
@@ -1776,31 +1955,67 @@ void buildNotifyData(MemoryBuffer &notifyData, PDState state, CPTStack *stack, M
 class CSubscriberNotifier;
 typedef SimpleHashTableOf<CSubscriberNotifier, SubscriptionId> CSubscriberNotifierTable;
 
+enum NotifyQueueResult { nqQueued, nqCoalesced, nqDropped };
+
 class CSubscriberNotifier : public CInterface
 {
     DECL_NAMEDCOUNT;
     class CChange : public CInterface
     {
     public:
-        CChange(MemoryBuffer &_notifyData) : notifyData(_notifyData.length(), _notifyData.toByteArray()) { }
+        CChange(MemoryBuffer &_notifyData, bool hasPath) : notifyData(_notifyData.length(), _notifyData.toByteArray())
+        {
+            // see buildNotifyData for layout, node subscription notifications have no path as they all refer to the subscribed node
+            if (hasPath)
+                notifyData.read(path);
+            notifyData.read(state);
+            notifyData.reset();
+        }
+        const char *queryFindString() const { return path.str(); }
         MemoryBuffer notifyData;
+        StringAttr path;
+        int state = 0;
     };
 public:
-    CSubscriberNotifier(CSubscriberNotifierTable &_table, CSubscriberContainerBase &_subscriber, MemoryBuffer &notifyData)
+    CSubscriberNotifier(CSubscriberNotifierTable &_table, CSubscriberContainerBase &_subscriber)
         : table(_table), subscriber(_subscriber) //NB: takes ownership of subscriber
     {
         INIT_NAMEDCOUNT;
-        change.setown(new CChange(notifyData));
+        created = msTick();
     }
     ~CSubscriberNotifier() { subscriber.Release(); }
 
-    void queueChange(MemoryBuffer &notifyData)
+    // NB: called with nfyTableCrit held
+    NotifyQueueResult queueChange(MemoryBuffer &notifyData, bool hasPath, unsigned queueLimit)
     {
-        changeQueue.append(*new CChange(notifyData));
+        Owned<CChange> newChange = new CChange(notifyData, hasPath);
+        CChange *pending = pendingChanges.find(newChange->path.str());
+        if (pending && (pending->state == newChange->state))
+        {
+            /* NB: keeps its place in the queue, but delivers the latest value if one is sent.
+             * Only the latest queued change to a path is coalesced with, so a change never moves ahead of a different
+             * (e.g. deleted) change to the same path that was queued after it.
+             */
+            pending->notifyData.swapWith(newChange->notifyData);
+            return nqCoalesced;
+        }
+        if (queueLimit && (changeQueue.ordinality() >= queueLimit))
+            return nqDropped;
+        pendingChanges.replace(*newChange); // supersedes any earlier change to the same path
+        changeQueue.append(*newChange.getClear());
+        return nqQueued;
     }
 
-    void notify()
+    void notify(unsigned window)
     {
+        // allow changes arriving within the window to coalesce before the first is delivered
+        unsigned elapsed = msTick()-created;
+        if (elapsed < window)
+            Sleep(window-elapsed);
+        {
+            CHECKEDCRITICALBLOCK(nfyTableCrit, fakeCritTimeout);
+            dequeueChange();
+        }
         for (;;)
         {
             if (!subscriber.notify(change->notifyData))
@@ -1813,10 +2028,7 @@ public:
 
             CHECKEDCRITICALBLOCK(nfyTableCrit, fakeCritTimeout);
             if (changeQueue.ordinality())
-            {
-                change.set(&changeQueue.item(0));
-                changeQueue.remove(0);
-            }
+                dequeueChange();
             else
             {
                 table.removeExact(this);
@@ -1838,11 +2050,19 @@ public:
     }
 
 private:
+    void dequeueChange()
+    {
+        change.set(&changeQueue.item(0));
+        changeQueue.remove(0);
+        pendingChanges.removeExact(change);
+    }
+
     Linked<CChange> change;
     CIArrayOf<CChange> changeQueue;
+    StringSuperHashTableOf<CChange> pendingChanges; // NB: not linked, the latest of those in changeQueue for each path
     CSubscriberContainerBase &subscriber;
-    MemoryAttr notifyData;
     CSubscriberNotifierTable &table;
+    unsigned created;
 };
 
 ////////////////
@@ -1873,6 +2093,86 @@ private:
 
 class CLock;
 typedef ThreadSafeOwningSimpleHashTableOf<CLock, __int64> CLockTable;
+class CSDSQueryIndex;
+
+#define SDS_LOCK_STRIPES 64 // must be a power of 2
+
+// Locks are spread over a number of independently protected tables, keyed by tree id,
+// so that lock traffic on unrelated branches does not serialize on a single critical section.
+struct CLockStripe
+{
+    CheckedCriticalSection crit;
+    CLockTable table;
+};
+
+#define LOCKWAIT_BUCKETS 16
+#define LOCKWAIT_MAX_XPATHS 1000            // beyond this, the least contended xpaths are merged into LOCKWAIT_OTHER_XPATHS
+#define LOCKWAIT_OTHER_XPATHS "(other xpaths)"
+
+class CLockWaitStats : public CInterface
+{
+public:
+    CLockWaitStats(const char *_xpath) : xpath(_xpath), waits(0), timeouts(0), maxMs(0), totalMs(0)
+    {
+        memset(buckets, 0, sizeof(buckets));
+    }
+    const char *queryXPath() const { return xpath; }
+    const char *queryFindString() const { return queryXPath(); }
+    unsigned __int64 queryTotalMs() const { return totalMs; }
+
+    void noteWait(unsigned ms, bool timedout)
+    {
+        waits++;
+        if (timedout)
+            timeouts++;
+        totalMs += ms;
+        if (ms > maxMs)
+            maxMs = ms;
+        unsigned b = 0; // bucket b holds waits of < 2^b ms, the last bucket is open ended
+        while (ms && b<LOCKWAIT_BUCKETS-1)
+        {
+            ms >>= 1;
+            b++;
+        }
+        buckets[b]++;
+    }
+    void merge(const CLockWaitStats &other)
+    {
+        waits += other.waits;
+        timeouts += other.timeouts;
+        totalMs += other.totalMs;
+        if (other.maxMs > maxMs)
+            maxMs = other.maxMs;
+        for (unsigned b=0; b<LOCKWAIT_BUCKETS; b++)
+            buckets[b] += other.buckets[b];
+    }
+    StringBuffer &toString(StringBuffer &out) const
+    {
+        out.append(xpath).append(": waits=").append(waits).append(", timeouts=").append(timeouts);
+        out.append(", total=").append(totalMs).append("ms, mean=").append(waits ? totalMs/waits : 0).append("ms, max=").append(maxMs).append("ms").newline();
+        out.append("  ");
+        for (unsigned b=0; b<LOCKWAIT_BUCKETS; b++)
+        {
+            if (buckets[b])
+            {
+                if (b<LOCKWAIT_BUCKETS-1)
+                    out.append(" <").append(1U<<b);
+                else
+                    out.append(" >=").append(1U<<(b-1));
+                out.append("ms:").append(buckets[b]);
+            }
+        }
+        return out.newline();
+    }
+
+private:
+    StringAttr xpath;
+    unsigned waits, timeouts, maxMs;
+    unsigned __int64 totalMs;
+    unsigned buckets[LOCKWAIT_BUCKETS];
+};
+
+typedef OwningStringSuperHashTableOf<CLockWaitStats> CLockWaitStatsTable;
 
 
 //////////
@@ -1940,15 +2240,22 @@ public:
     void changeLockMode(CServerConnection &connection, unsigned newMode, unsigned timeout);
     void clearSDSLocks();
     void lock(CServerRemoteTree &tree, const char *xpath, ConnectionId connectionId, SessionId sessionId, unsigned mode, unsigned timeout, IUnlockCallback &callback);
-    CLock *queryLock(__int64 id) { return lockTable.find(&id); }
+    CLockStripe &queryLockStripe(__int64 id) { return lockStripes[((unsigned)id) & (SDS_LOCK_STRIPES-1)]; }
+    CLock *queryLock(__int64 id) { return queryLockStripe(id).table.find(&id); }
+    void noteLockWait(const char *xpath, unsigned ms, bool timedout);
+    void noteTreeFreed(CServerRemoteTree &tree);
+    void noteQueryIndexChanges(CPTStack &stack, CBranchChange &changes);
     CSubscriberTable &querySubscriberTable() { return subscribers; }
     IExternalHandler *queryExternalHandler(const char *handler) { if (!handler) return NULL; CExternalHandlerMapping *mapping = externalHandlers.find(handler); return mapping ? &mapping->query() : NULL; }
-    void handleNotify(CSubscriberContainerBase *subscriber, MemoryBuffer &notifyData);
+    void handleNotify(CSubscriberContainerBase *subscriber, MemoryBuffer &notifyData, bool hasPath);
+    CSubscriberNotifier *getNextNotifier();
     void startNotification(IPropertyTree &changeTree, CPTStack &stack, CBranchChange &changes); // subscription notification
     MemoryBuffer &collectUsageStats(MemoryBuffer &out);
     MemoryBuffer &collectConnections(MemoryBuffer &out);
     MemoryBuffer &collectSubscribers(MemoryBuffer &out);
     void blockingSave(unsigned *writeTransactions=NULL);
+    void endSnapshotDeltas();
+    void flushSnapshotBackupDeltas();
     bool queryStopped() { return server.queryStopped(); }
 
     void handleNodeNotify(notifications n, CServerRemoteTree &tree); // server node notification
@@ -1990,6 +2297,8 @@ public:
     virtual IPropertyTreeIterator *getXPathsSortLimit(const char *baseXPath, const char *matchXPath, const char *sortby, bool caseinsensitive, bool ascending, unsigned from, unsigned limit);
     virtual void getExternalValueFromServerId(__int64 serverId, MemoryBuffer &mb);
     virtual bool unlock(__int64 connectionId, bool closeConn, StringBuffer &connectionInfo);
+    virtual StringBuffer &getLockWaitStats(StringBuffer &out, bool reset);
+    virtual IPropertyTreeIterator *getIndexedElements(const char *xpath, const char *filterAttr, const char *filterValue, const char *sortAttr, bool descending, unsigned from, unsigned limit, const char *children, unsigned *total);
 
 // ISDSManagerServer
     virtual IRemoteConnections *connect(IMultipleConnector *mConnect, SessionId id, unsigned timeout);
@@ -2044,7 +2353,6 @@ public: // data
     CheckedCriticalSection connDestructCrit;
     CheckedCriticalSection cTableCrit;
     CheckedCriticalSection sTableCrit;
-    CheckedCriticalSection lockCrit;
     CheckedCriticalSection treeRegCrit;
     Owned<Thread> unhandledThread;
     unsigned writeTransactions;
@@ -2068,11 +2376,18 @@ private:
     Owned<ICoalesce> coalesce;
     unsigned __int64 nextExternal;
     unsigned externalSizeThreshold;
-    CLockTable lockTable;
+    CLockStripe lockStripes[SDS_LOCK_STRIPES];
+    CheckedCriticalSection lockWaitStatsCrit;
+    CLockWaitStatsTable lockWaitStats;
+    CheckedCriticalSection queryIndexCrit;
+    CIArrayOf<CSDSQueryIndex> queryIndexes; // fixed at construction
     CNotifyHandlerTable nodeNotifyHandlers;
     Owned<IThreadPool> scanNotifyPool, notifyPool;
     CExternalHandlerTable externalHandlers;
     CSubscriberNotifierTable subscriberNotificationTable;
+    QueueOf<CSubscriberNotifier, false> readyNotifiers; // NB: linked, protected by nfyTableCrit as are the counters below
+    unsigned activeNotifyThreads, notifyThreadLimit, notifyCoalesceWindow, notifyQueueLimit;
+    unsigned __int64 notificationsQueued, notificationsCoalesced, notificationsDropped;
     Owned<CConnectionSubscriptionManager> connectionSubscriptionManager;
     Owned<INodeSubscriptionManager> nodeSubscriptionManager;
     bool restartOnError, externalEnvironment;
@@ -2081,6 +2396,9 @@ private:
     StringBuffer blockedDelta;
     CBackupHandler backupHandler;
     bool backupOutOfSync = false;
+    bool binaryStore = false;
+    unsigned snapshotEdition = 0;   // edition being written from a snapshot, deltas are also saved to it until committed
+    StringBuffer snapshotBackupDeltas;
 };
 
 ISDSManagerServer &querySDSServer()
@@ -2501,6 +2819,7 @@ public:
         // always called inside SDSManager->treeRegCrit
         if (serverId)
         {
+            SDSManager->noteTreeFreed(*this);
             SDSManager->queryAllNodes().freeElem(serverId);
             serverId = 0;
         }
@@ -2672,6 +2991,300 @@ private:
 friend class COrphanHandler;
 };
 
+//////////////
+
+// A secondary index over the direct children of a single branch (e.g. /WorkUnits), on a configured set of their attributes.
+// Each attribute keeps the children sorted by (value, name), so equality filters and sorted, paged listings
+// are answered in time proportional to the result, rather than by walking every child of the branch.
+// NB: all access is protected by CCovenSDSManager::queryIndexCrit
+class CSDSQueryIndex : public CInterface
+{
+    class CIndexedNode : public CInterface
+    {
+    public:
+        CIndexedNode(CServerRemoteTree &_tree, unsigned numAttrs) : tree(&_tree) { values = new StringAttr[numAttrs]; }
+        ~CIndexedNode() { delete [] values; }
+        const void *queryFindParam() const { return (const void *) &tree; }
+
+        CServerRemoteTree *tree; // NB: not linked, entries are removed as nodes are freed (see CCovenSDSManager::noteTreeFreed)
+        StringAttr name;
+        StringAttr *values;
+    };
+    typedef OwningSimpleHashTableOf<CIndexedNode, CServerRemoteTree *> CIndexedNodeTable;
+
+    StringAttr xpath;
+    StringArray attrs;
+    CServerRemoteTree *parent = nullptr; // NB: not linked, index is reset when freed
+    CIndexedNodeTable nodes;
+    PointerArrayOf<CIndexedNode> *sorted; // one per attribute
+
+    static int compareKey(const CIndexedNode &n, unsigned a, const char *value, const char *name, const CServerRemoteTree *tree)
+    {
+        int c = strcmp(n.values[a].str(), value);
+        if (c) return c;
+        c = strcmp(n.name.str(), name);
+        if (c) return c;
+        if (n.tree == tree) return 0;
+        return (n.tree < tree) ? -1 : 1;
+    }
+    class CIndexedNodeCompare : implements ICompare
+    {
+        unsigned attr;
+    public:
+        CIndexedNodeCompare(unsigned _attr) : attr(_attr) { }
+        virtual int docompare(const void *left, const void *right) const
+        {
+            const CIndexedNode *r = (const CIndexedNode *)right;
+            return compareKey(*(const CIndexedNode *)left, attr, r->values[attr].str(), r->name.str(), r->tree);
+        }
+    };
+    // first position in attribute a's order not less than (value, name, tree)
+    aindex_t lowerBound(unsigned a, const char *value, const char *name, const CServerRemoteTree *tree) const
+    {
+        PointerArrayOf<CIndexedNode> &list = sorted[a];
+        aindex_t lo = 0, hi = list.ordinality();
+        while (lo < hi)
+        {
+            aindex_t mid = lo + (hi-lo)/2;
+            if (compareKey(*list.item(mid), a, value, name, tree) < 0)
+                lo = mid+1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+    // first position in attribute a's order whose value is greater than value
+    aindex_t upperBound(unsigned a, const char *value) const
+    {
+        PointerArrayOf<CIndexedNode> &list = sorted[a];
+        aindex_t lo = 0, hi = list.ordinality();
+        while (lo < hi)
+        {
+            aindex_t mid = lo + (hi-lo)/2;
+            if (strcmp(list.item(mid)->values[a].str(), value) <= 0)
+                lo = mid+1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+    void addEntries(CIndexedNode &n)
+    {
+        ForEachItemIn(a, attrs)
+            sorted[a].add(&n, lowerBound(a, n.values[a].str(), n.name.str(), n.tree));
+    }
+    void removeEntries(CIndexedNode &n)
+    {
+        ForEachItemIn(a, attrs)
+        {
+            aindex_t pos = lowerBound(a, n.values[a].str(), n.name.str(), n.tree);
+            assertex(pos < sorted[a].ordinality() && sorted[a].item(pos) == &n);
+            sorted[a].remove(pos);
+        }
+    }
+    void update(CServerRemoteTree &tree)
+    {
+        if (tree.isOrphaned())
+        {
+            remove(tree);
+            return;
+        }
+        CServerRemoteTree *key = &tree;
+        CIndexedNode *n = nodes.find(key);
+        if (n)
+        {
+            bool changed = !strsame(n->name.str(), tree.queryName());
+            for (unsigned a=0; !changed && a<attrs.ordinality(); a++)
+            {
+                const char *value = tree.queryProp(attrs.item(a));
+                changed = !strsame(n->values[a].str(), value ? value : "");
+            }
+            if (!changed)
+                return;
+            removeEntries(*n);
+        }
+        else
+        {
+            n = new CIndexedNode(tree, attrs.ordinality());
+            nodes.replace(*n);
+        }
+        n->name.set(tree.queryName());
+        ForEachItemIn(a, attrs)
+            n->values[a].set(tree.queryProp(attrs.item(a)));
+        addEntries(*n);
+    }
+    void updateChildren(CBranchChange &changes)
+    {
+        ForEachItemIn(c, changes.children)
+            update((CServerRemoteTree &)*changes.children.item(c).tree);
+    }
+    bool findAndUpdateChildren(CBranchChange &changes)
+    {
+        ForEachItemIn(c, changes.children)
+        {
+            CBranchChange &child = changes.children.item(c);
+            if ((CRemoteTreeBase *)parent == child.tree)
+            {
+                updateChildren(child);
+                return true;
+            }
+            if (findAndUpdateChildren(child))
+                return true;
+        }
+        return false;
+    }
+    void appendMatch(IArrayOf<IPropertyTree> &results, CServerRemoteTree &tree, const StringArray &children) const
+    {
+        IPropertyTree *match = createPTree(tree.queryName());
+        Owned<IAttributeIterator> attrIter = tree.getAttributes();
+        ForEach(*attrIter)
+            match->setProp(attrIter->queryName(), attrIter->queryValue());
+        ForEachItemIn(c, children)
+        {
+            Owned<IPropertyTreeIterator> childIter = tree.getElements(children.item(c));
+            ForEach(*childIter)
+                match->addPropTree(children.item(c), createPTreeFromIPT(&childIter->query()));
+        }
+        results.append(*match);
+    }
+    // Orphaned entries (removed from the tree, but not yet from the index) are skipped, returns the number of live entries
+    unsigned appendPage(IArrayOf<IPropertyTree> &results, CIndexedNode * const *entries, unsigned count, bool descending, unsigned from, unsigned limit, const StringArray &children) const
+    {
+        unsigned live = 0;
+        for (unsigned i=0; i<count; i++)
+        {
+            CIndexedNode *n = entries[descending ? count-1-i : i];
+            if (n->tree->isOrphaned())
+                continue;
+            if ((live >= from) && (!limit || results.ordinality()<limit))
+                appendMatch(results, *n->tree, children);
+            live++;
+        }
+        return live;
+    }
+
+public:
+    CSDSQueryIndex(const char *_xpath, const char *attrList)
+    {
+        if ('/' == *_xpath)
+            _xpath++;
+        xpath.set(_xpath);
+        attrs.appendListUniq(attrList, ",");
+        ForEachItemIn(a, attrs)
+        {
+            if ('@' != *attrs.item(a))
+                throw MakeSDSException(SDSExcpt_InappropriateXpath, "SDS index on /%s, only attributes can be indexed (%s)", xpath.get(), attrs.item(a));
+        }
+        sorted = new PointerArrayOf<CIndexedNode>[attrs.ordinality()];
+    }
+    ~CSDSQueryIndex()
+    {
+        delete [] sorted;
+    }
+    const char *queryXPath() const { return xpath; }
+    bool isBuilt() const { return nullptr != parent; }
+    unsigned queryAttr(const char *attr) const
+    {
+        ForEachItemIn(a, attrs)
+        {
+            if (streq(attr, attrs.item(a)))
+                return a;
+        }
+        return NotFound;
+    }
+    StringBuffer &getDescription(StringBuffer &out) const
+    {
+        out.append('/').append(xpath).append(" [");
+        ForEachItemIn(a, attrs)
+        {
+            if (a) out.append(',');
+            out.append(attrs.item(a));
+        }
+        return out.append(']');
+    }
+    void reset()
+    {
+        parent = nullptr;
+        ForEachItemIn(a, attrs)
+            sorted[a].kill();
+        nodes.kill();
+    }
+    void build(CServerRemoteTree &root)
+    {
+        reset();
+        parent = (CServerRemoteTree *)root.queryPropTree(xpath);
+        if (!parent)
+            return;
+        Owned<IPropertyTreeIterator> iter = parent->getElements("*");
+        ForEach(*iter)
+            update((CServerRemoteTree &)iter->query());
+    }
+    void remove(CServerRemoteTree &tree)
+    {
+        if (&tree == parent)
+        {
+            reset(); // rebuilt on next use
+            return;
+        }
+        CServerRemoteTree *key = &tree;
+        CIndexedNode *n = nodes.find(key);
+        if (n)
+        {
+            removeEntries(*n);
+            nodes.removeExact(n);
+        }
+    }
+    // Brings the index up to date with a commit, stack being the path to the top of the changes
+    void noteChanges(CPTStack &stack, CBranchChange &changes)
+    {
+        if (!parent)
+            return;
+        if ((CRemoteTreeBase *)parent == changes.tree)
+        {
+            updateChildren(changes);
+            return;
+        }
+        ForEachItemIn(s, stack)
+        {
+            if ((PTree *)parent == &stack.item(s))
+            {
+                if (s+1 < stack.ordinality()) // change is within a child
+                    update((CServerRemoteTree &)stack.item(s+1));
+                else // change is a child (e.g. newly created)
+                    update((CServerRemoteTree &)*changes.tree);
+                return;
+            }
+        }
+        findAndUpdateChildren(changes); // indexed branch may be below the change
+    }
+    void getElements(IArrayOf<IPropertyTree> &results, unsigned filterAttr, const char *filterValue, unsigned sortAttr, bool descending, unsigned from, unsigned limit, const StringArray &children, unsigned &total) const
+    {
+        if (NotFound != filterAttr)
+        {
+            aindex_t lo = lowerBound(filterAttr, filterValue, "", nullptr);
+            aindex_t hi = upperBound(filterAttr, filterValue);
+            unsigned count = hi-lo;
+            CIndexedNode * const *matches = sorted[filterAttr].getArray(lo);
+            if (NotFound == sortAttr || sortAttr == filterAttr) // already in name order within the value
+                total = appendPage(results, matches, count, descending, from, limit, children);
+            else
+            {
+                PointerArrayOf<CIndexedNode> resorted;
+                for (unsigned m=0; m<count; m++)
+                    resorted.append(matches[m]);
+                CIndexedNodeCompare compare(sortAttr);
+                qsortvec((void **)resorted.getArray(), count, compare);
+                total = appendPage(results, resorted.getArray(), count, descending, from, limit, children);
+            }
+        }
+        else
+        {
+            assertex(NotFound != sortAttr);
+            total = appendPage(results, sorted[sortAttr].getArray(), sorted[sortAttr].ordinality(), descending, from, limit, children);
+        }
+    }
+};
+
 class CNodeSubscriberContainer : public CSubscriberContainerBase
 {
     StringAttr xpath;
@@ -2734,7 +3347,7 @@ public:
                     buildNotifyData(sendValueNotifyData.clear(), state, NULL, &mb);
                     lastSendValue = 1;
                 }
-                SDSManager->handleNotify(subscriber.getClear(), sendValueNotifyData);
+                SDSManager->handleNotify(subscriber.getClear(), sendValueNotifyData, false);
             }
             else
             {
@@ -2743,7 +3356,7 @@ public:
                     buildNotifyData(sendValueNotifyData.clear(), state, NULL, NULL);
                     lastSendValue = 0;
                 }
-                SDSManager->handleNotify(subscriber.getClear(), sendValueNotifyData);
+                SDSManager->handleNotify(subscriber.getClear(), sendValueNotifyData, false);
             }
         }
     }
@@ -3122,17 +3735,20 @@ PDState CServerRemoteTree::processData(CServerConnection &connection, IPropertyT
     PDState res = processData(changeTree, top, newIds);
     changeTree.removeProp("@name");
     if (res)
+    {
         SDSManager->writeTransactions++;
-    // return asap from here, don't even wait for pool threads to queue, can take time.
+        // return asap from here, don't even wait for pool threads to queue, can take time.
 
-    if (res && !RTM_MODE(connection.queryMode(), RTM_INTERNAL))
-    {
         CPTStack stack = connection.queryPTreePath();
         if (connection.queryRoot() == (IPropertyTree *)SDSManager->queryRoot())
             stack.pop();
+        SDSManager->noteQueryIndexChanges(stack, *top);
 
-        connection.notify();
-        SDSManager->startNotification(changeTree, stack, *top);
+        if (!RTM_MODE(connection.queryMode(), RTM_INTERNAL))
+        {
+            connection.notify();
+            SDSManager->startNotification(changeTree, stack, *top);
+        }
     }
 
     return res;
@@ -3293,6 +3909,16 @@ class CLock : implements IInterface, public CInterface
     }
 
     LockStatus doLock(unsigned mode, unsigned timeout, ConnectionId id, SessionId sessionId, IUnlockCallback &callback, bool change=false)
+    {
+        unsigned start = msTick();
+        bool waited = false;
+        LockStatus result = waitForLock(mode, timeout, id, sessionId, callback, change, waited);
+        if (waited)
+            SDSManager->noteLockWait(xpath, msTick()-start, LockTimedOut == result);
+        return result;
+    }
+
+    LockStatus waitForLock(unsigned mode, unsigned timeout, ConnectionId id, SessionId sessionId, IUnlockCallback &callback, bool change, bool &waited)
     {
         if (INFINITE == timeout)
         {
@@ -3307,6 +3933,7 @@ class CLock : implements IInterface, public CInterface
                 {
                     bool timedout = false;
                     waiting++;
+                    waited = true;
                     {
                         CHECKEDCRITICALUNBLOCK(crit, fakeCritTimeout);
                         callback.unblock();
@@ -3346,6 +3973,7 @@ class CLock : implements IInterface, public CInterface
                 {
                     bool timedout = false;
                     waiting++;
+                    waited = true;
                     {
                         CHECKEDCRITICALUNBLOCK(crit, fakeCritTimeout);
                         callback.unblock();
@@ -3766,6 +4394,7 @@ int CSDSTransactionServer::run()
                         case DAMP_SDSCMD_GETEXTVALUE:
                         case DAMP_SDSCMD_GETELEMENTSRAW:
                         case DAMP_SDSCMD_GETCOUNT:
+                        case DAMP_SDSCMD_GETINDEXED:
                         {
                             mb.reset();
                             handler.handleMessage(mb);
@@ -4553,9 +5182,38 @@ void CSDSTransactionServer::processMessage(CMessageBuffer &mb)
                 mb.transferFrom(replyMb);
                 break;
             }
-            case DAMP_SDSCMD_GETCOUNT:
+            case DAMP_SDSCMD_GETINDEXED:
             {
-                mb.read(xpath);
+                StringAttr filterAttr, filterValue, sortAttr, children;
+                bool descending;
+                unsigned from, limit;
+                mb.read(xpath).read(filterAttr).read(filterValue).read(sortAttr).read(descending).read(from).read(limit).read(children);
+                if (queryTransactionLogging())
+                    transactionLog.log("xpath='%s', filter='%s=%s', sort='%s'", xpath.get(), filterAttr.str(), filterValue.str(), sortAttr.str());
+                unsigned total;
+                Owned<IPropertyTreeIterator> iter = manager.getIndexedElements(xpath, filterAttr, filterValue, sortAttr, descending, from, limit, children, &total);
+                mb.clear();
+                if (iter)
+                {
+                    mb.append((int)DAMP_SDSREPLY_OK);
+                    mb.append(total);
+                    unsigned pos = mb.length();
+                    unsigned count = 0;
+                    mb.append(count);
+                    ForEach(*iter)
+                    {
+                        iter->query().serialize(mb);
+                        ++count;
+                    }
+                    mb.writeDirect(pos, sizeof(count), &count);
+                }
+                else
+                    mb.append((int)DAMP_SDSREPLY_EMPTY);
+                break;
+            }
+            case DAMP_SDSCMD_GETCOUNT:
+            {
+                mb.read(xpath);
                 if (queryTransactionLogging())
                     transactionLog.log("xpath='%s'", xpath.get());
                 CHECKEDDALIREADLOCKBLOCK(manager.dataRWLock, readWriteTimeout);
@@ -4796,6 +5454,274 @@ void initializeInternals(IPropertyTree *root)
     root->addPropTree("Status/Servers",createPTree());
 }
 
+////////////////
+
+// Binary store format
+// The store is written as a sequence of lz4 compressed sections, each containing subtrees serialized in the
+// IPropertyTree binary format.  The root and each top level branch are written as separate sections, followed by the
+// branch's children in sections of up to BINARY_STORE_SECTION_SIZE bytes, so sections can be expanded in parallel.
+static const char binaryStoreMagic[] = "DALISDSB";
+#define BINARY_STORE_MAGIC_LEN 8
+#define BINARY_STORE_VERSION 1
+#define BINARY_STORE_SECTION_SIZE 0x1000000
+enum BinaryStoreSectionType : byte { BSS_End, BSS_Root, BSS_Branch, BSS_Children };
+
+class CStoreSection : public CInterface
+{
+public:
+    CStoreSection(byte _type) : type(_type) { }
+
+    byte type;
+    MemoryBuffer data;              // compressed
+    IArrayOf<IPropertyTree> trees;  // when loading
+};
+
+class CStoreSectionList : public CInterface
+{
+public:
+    CIArrayOf<CStoreSection> sections;
+};
+
+static void addStoreSection(CIArrayOf<CStoreSection> &sections, byte type, MemoryBuffer &mb)
+{
+    CStoreSection *section = new CStoreSection(type);
+    sections.append(*section);
+    LZ4CompressToBuffer(section->data, mb.length(), mb.toByteArray());
+    mb.clear();
+}
+
+// Only the flags describing the stored content are persisted, the rest (e.g. the dali subscribed/orphaned bits and
+// the memory/ordering hints) are runtime state and are left to the tree maker, as they are when loading an xml store.
+#define STORE_PERSISTENT_FLAGS ipt_binary
+
+static size32_t getStoreFlagsPos(MemoryBuffer &mb, size32_t nodePos)
+{
+    // serialized node is <name>\0<flags>...
+    return nodePos + (size32_t)strlen((const char *)mb.toByteArray() + nodePos) + 1;
+}
+
+static void serializeStoreNode(IPropertyTree &node, MemoryBuffer &tgt)
+{
+    size32_t nodePos = tgt.length();
+    ((PTree &)node).serializeSelf(tgt);
+    byte *flags = (byte *)tgt.bufferBase() + getStoreFlagsPos(tgt, nodePos);
+    *flags &= STORE_PERSISTENT_FLAGS;
+}
+
+static void serializeStoreTree(IPropertyTree &tree, MemoryBuffer &tgt)
+{
+    serializeStoreNode(tree, tgt);
+    Owned<IPropertyTreeIterator> iter = tree.getElements("*");
+    ForEach(*iter)
+        serializeStoreTree(iter->query(), tgt);
+    tgt.append(""); // element terminator
+}
+
+static void deserializeStoreNode(IPropertyTree &node, MemoryBuffer &src)
+{
+    // keep the runtime flags the maker created the node with (also masks any stray bits in stores written before they were masked on save)
+    byte *flags = (byte *)src.bufferBase() + getStoreFlagsPos(src, src.getPos());
+    *flags = (*flags & STORE_PERSISTENT_FLAGS) | (((PTree &)node).queryFlags() & ~STORE_PERSISTENT_FLAGS);
+    ((PTree &)node).deserializeSelf(src);
+}
+
+static void serializeStoreBranch(IPropertyTree &branch, CIArrayOf<CStoreSection> &sections)
+{
+    MemoryBuffer mb;
+    serializeStoreNode(branch, mb);
+    addStoreSection(sections, BSS_Branch, mb);
+    Owned<IPropertyTreeIterator> iter = branch.getElements("*");
+    ForEach(*iter)
+    {
+        serializeStoreTree(iter->query(), mb);
+        if (mb.length() >= BINARY_STORE_SECTION_SIZE)
+            addStoreSection(sections, BSS_Children, mb);
+    }
+    if (mb.length())
+        addStoreSection(sections, BSS_Children, mb);
+}
+
+static IPropertyTree *deserializeStoreTree(MemoryBuffer &src, IPTreeMaker *iMaker)
+{
+    IPropertyTree *tree = iMaker ? iMaker->create(NULL) : createPTree();
+    deserializeStoreNode(*tree, src);
+    for (;;)
+    {
+        if ('\0' == *(const char *)src.readDirect(0))
+        {
+            src.skip(1); // element terminator
+            break;
+        }
+        IPropertyTree *child = deserializeStoreTree(src, iMaker);
+        tree->addPropTree(child->queryName(), child);
+    }
+    return tree;
+}
+
+class CStoreSnapshot : public CInterfaceOf<IStoreSnapshot>
+{
+    CIArrayOf<CStoreSection> sections;
+    offset_t size = 0;
+public:
+    CStoreSnapshot(IPropertyTree &root)
+    {
+        MemoryBuffer mb;
+        serializeStoreNode(root, mb);
+        addStoreSection(sections, BSS_Root, mb);
+
+        ICopyArrayOf<IPropertyTree> branches;
+        Owned<IPropertyTreeIterator> iter = root.getElements("*");
+        ForEach(*iter)
+            branches.append(iter->query());
+        unsigned numBranches = branches.ordinality();
+        CIArrayOf<CStoreSectionList> branchSections;
+        for (unsigned b=0; b<numBranches; b++)
+            branchSections.append(*new CStoreSectionList);
+
+        class casyncfor: public CAsyncFor
+        {
+            ICopyArrayOf<IPropertyTree> &branches;
+            CIArrayOf<CStoreSectionList> &branchSections;
+        public:
+            casyncfor(ICopyArrayOf<IPropertyTree> &_branches, CIArrayOf<CStoreSectionList> &_branchSections)
+                : branches(_branches), branchSections(_branchSections) { }
+            void Do(unsigned i)
+            {
+                serializeStoreBranch(branches.item(i), branchSections.item(i).sections);
+            }
+        } afor(branches, branchSections);
+        afor.For(numBranches, getAffinityCpus(), true);
+
+        for (unsigned b=0; b<numBranches; b++)
+        {
+            CIArrayOf<CStoreSection> &cur = branchSections.item(b).sections;
+            ForEachItemIn(c, cur)
+                sections.append(OLINK(cur.item(c)));
+        }
+        ForEachItemIn(s, sections)
+            size += sections.item(s).data.length();
+    }
+
+// IStoreSnapshot
+    virtual void write(IIOStream &out) override
+    {
+        MemoryBuffer header;
+        header.append(BINARY_STORE_MAGIC_LEN, binaryStoreMagic).append((byte)BINARY_STORE_VERSION);
+        out.write(header.length(), header.toByteArray());
+        ForEachItemIn(s, sections)
+        {
+            CStoreSection &section = sections.item(s);
+            header.clear().append(section.type).append((size32_t)section.data.length());
+            out.write(header.length(), header.toByteArray());
+            out.write(section.data.length(), section.data.toByteArray());
+        }
+        byte end = BSS_End;
+        out.write(sizeof(end), &end);
+    }
+    virtual offset_t querySize() const override { return size; }
+};
+
+IStoreSnapshot *createStoreSnapshot(IPropertyTree &root)
+{
+    return new CStoreSnapshot(root);
+}
+
+static bool isBinaryStore(IFileIO &iFileIO)
+{
+    char magic[BINARY_STORE_MAGIC_LEN];
+    return (BINARY_STORE_MAGIC_LEN == iFileIO.read(0, BINARY_STORE_MAGIC_LEN, magic)) && (0 == memcmp(magic, binaryStoreMagic, BINARY_STORE_MAGIC_LEN));
+}
+
+static bool isBinaryStoreFile(const char *filename)
+{
+    OwnedIFile iFile = createIFile(filename);
+    OwnedIFileIO iFileIO = iFile->open(IFOread);
+    return iFileIO && isBinaryStore(*iFileIO);
+}
+
+static void readStoreBytes(IIOStream &in, size32_t len, void *dst)
+{
+    if (len != in.read(len, dst))
+        throw MakeSDSException(SDSExcpt_LoadInconsistency, "Binary store truncated");
+}
+
+static IPropertyTree *loadBinaryStore(IIOStream &in, IPTreeMaker *iMaker)
+{
+    char magic[BINARY_STORE_MAGIC_LEN];
+    readStoreBytes(in, BINARY_STORE_MAGIC_LEN, magic);
+    byte version;
+    readStoreBytes(in, sizeof(version), &version);
+    if (version > BINARY_STORE_VERSION)
+        throw MakeSDSException(SDSExcpt_LoadInconsistency, "Unsupported binary store version %u", (unsigned)version);
+
+    CIArrayOf<CStoreSection> sections;
+    for (;;)
+    {
+        byte type;
+        readStoreBytes(in, sizeof(type), &type);
+        if (BSS_End == type)
+            break;
+        MemoryBuffer lenMb;
+        size32_t len;
+        readStoreBytes(in, sizeof(len), lenMb.reserveTruncate(sizeof(len)));
+        lenMb.read(len);
+        CStoreSection *section = new CStoreSection(type);
+        sections.append(*section);
+        readStoreBytes(in, len, section->data.reserveTruncate(len));
+    }
+    if (!sections.ordinality() || (BSS_Root != sections.item(0).type))
+        throw MakeSDSException(SDSExcpt_LoadInconsistency, "Binary store has no root");
+
+    class casyncfor: public CAsyncFor
+    {
+        CIArrayOf<CStoreSection> &sections;
+        IPTreeMaker *iMaker;
+    public:
+        casyncfor(CIArrayOf<CStoreSection> &_sections, IPTreeMaker *_iMaker) : sections(_sections), iMaker(_iMaker) { }
+        void Do(unsigned i)
+        {
+            CStoreSection &section = sections.item(i);
+            MemoryBuffer mb;
+            LZ4DecompressToBuffer(mb, section.data);
+            section.data.clear();
+            if (BSS_Children == section.type)
+            {
+                while (mb.remaining())
+                    section.trees.append(*deserializeStoreTree(mb, iMaker));
+            }
+            else
+            {
+                IPropertyTree *tree = iMaker ? iMaker->create(NULL) : createPTree();
+                deserializeStoreNode(*tree, mb);
+                section.trees.append(*tree);
+            }
+        }
+    } afor(sections, iMaker);
+    afor.For(sections.ordinality(), getAffinityCpus(), true);
+
+    Owned<IPropertyTree> root = &sections.item(0).trees.popGet();
+    IPropertyTree *branch = root;
+    for (unsigned s=1; s<sections.ordinality(); s++)
+    {
+        CStoreSection &section = sections.item(s);
+        if (BSS_Branch == section.type)
+        {
+            IPropertyTree *tree = &section.trees.popGet();
+            branch = root->addPropTree(tree->queryName(), tree);
+        }
+        else
+        {
+            ForEachItemIn(t, section.trees)
+            {
+                IPropertyTree &tree = section.trees.item(t);
+                branch->addPropTree(tree.queryName(), &tree);
+            }
+            section.trees.kill(true); // now owned by the branch
+        }
+    }
+    return root.getClear();
+}
+
 IPropertyTree *loadStore(const char *storeFilename, IPTreeMaker *iMaker, unsigned crcValidation, bool logErrorsOnly=false, const bool *abort=NULL)
 {
     CHECKEDCRITICALBLOCK(loadStoreCrit, fakeCritTimeout);
@@ -4808,12 +5734,18 @@ IPropertyTree *loadStore(const char *storeFilename, IPTreeMaker *iMaker, unsigne
         if (!iFileIOStore)
             throw MakeSDSException(SDSExcpt_OpenStoreFailed, "%s", storeFilename);
 
+        bool binary = isBinaryStore(*iFileIOStore);
+        unsigned start = msTick();
         Owned<IFileIOStream> fstream = createIOStream(iFileIOStore);
         Owned<ICrcIOStream> crcPipeStream = createCrcPipeStream(fstream);
         Owned<IIOStream> ios = createBufferedIOStream(crcPipeStream);
-        root.setown((CServerRemoteTree *) createPTree(*ios, ipt_none, ptr_ignoreWhiteSpace, iMaker));
+        if (binary)
+            root.setown(loadBinaryStore(*ios, iMaker));
+        else
+            root.setown((CServerRemoteTree *) createPTree(*ios, ipt_none, ptr_ignoreWhiteSpace, iMaker));
         ios.clear();
         unsigned crc = crcPipeStream->queryCrc();
+        PROGLOG("Loaded %s store %s (size=%" I64F "d) in %u ms", binary ? "binary" : "xml", storeFilename, iFileIOStore->size(), msTick()-start);
 
         if (crcValidation && crc != crcValidation)
             LOG(MCoperatorWarning, unknownJob, "Error processing store %s - CRC ERROR (file size=%" I64F "d, validation crc=%x, calculated crc=%x)", storeFilename, iFileIOStore->size(), crcValidation, crc); // not fatal yet (maybe later)
@@ -4842,6 +5774,11 @@ IPropertyTree *loadStore(const char *storeFilename, IPTreeMaker *iMaker, unsigne
     return LINK(root);
 }
 
+IPropertyTree *loadStoreFile(const char *filename)
+{
+    return loadStore(filename, NULL, 0);
+}
+
 
 // Not really coalescing, blocking transations and saving store (which will delete pending transactions).
 class CLightCoalesceThread : implements ICoalesce, public CInterface
@@ -5016,9 +5953,10 @@ class CUnlockCallback : implements IUnlockCallback
     StringAttr xpath;
     ConnectionId connectionId;
     CServerRemoteTree &tree;
+    CheckedCriticalSection &lockCrit;
     bool lockedForWrite, unlocked;
 public:
-    CUnlockCallback(const char *_xpath, ConnectionId _connectionId, CServerRemoteTree &_tree) : xpath(_xpath), connectionId(_connectionId), tree(_tree), lockedForWrite(false), unlocked(false) { }
+    CUnlockCallback(const char *_xpath, ConnectionId _connectionId, CServerRemoteTree &_tree) : xpath(_xpath), connectionId(_connectionId), tree(_tree), lockCrit(SDSManager->queryLockStripe(_tree.queryServerId()).crit), lockedForWrite(false), unlocked(false) { }
     void block()
     {
         assertex(unlocked);
@@ -5027,7 +5965,7 @@ public:
             CHECKEDWRITELOCKENTER(SDSManager->dataRWLock, readWriteTimeout);
         else
             CHECKEDREADLOCKENTER(SDSManager->dataRWLock, readWriteTimeout);
-        CHECKEDCRITENTER(SDSManager->lockCrit, fakeCritTimeout);
+        CHECKEDCRITENTER(lockCrit, fakeCritTimeout);
         unlocked = false;
         unsigned e=msTick()-got;
         if (e>readWriteSlowTracing)
@@ -5045,7 +5983,7 @@ public:
     {
         unlocked = true;
         lockedForWrite = SDSManager->dataRWLock.queryWriteLocked();
-        CHECKEDCRITLEAVE(SDSManager->lockCrit);
+        CHECKEDCRITLEAVE(lockCrit);
         if (lockedForWrite)
             SDSManager->dataRWLock.unlockWrite();
         else
@@ -5057,6 +5995,9 @@ class CStoreHelper : implements IStoreHelper, public CInterface
 {
     StringAttr storeName, location, remoteBackupLocation;
     CStoreInfo storeInfo, deltaInfo;
+    CriticalSection infoCrit; // deltas refresh storeInfo/deltaInfo whilst a snapshot may be being committed
+    unsigned snapshotEdition = 0; // edition a snapshot is being saved as, deltas are also written to it until it is committed
+    StringBuffer snapshotPendingDelta; // deltas that failed to be written to the snapshot edition, retried with the next
     unsigned configFlags;
     const bool *abort;
     unsigned delay, keepStores;
@@ -5195,8 +6136,8 @@ class CStoreHelper : implements IStoreHelper, public CInterface
             info.crc = 0;
     }
 
-    void refreshStoreInfo() { refreshInfo(storeInfo, "store"); }
-    void refreshDeltaInfo() { refreshInfo(deltaInfo, "store"); }
+    void refreshStoreInfo() { CriticalBlock b(infoCrit); refreshInfo(storeInfo, "store"); }
+    void refreshDeltaInfo() { CriticalBlock b(infoCrit); refreshInfo(deltaInfo, "store"); }
 
     void checkInfo(const char *base, CStoreInfo &info)
     {
@@ -5334,6 +6275,7 @@ public:
     }
     virtual StringBuffer &getDetachedDeltaName(StringBuffer &detachName)
     {
+        CriticalBlock b(infoCrit);
         refreshDeltaInfo();
         constructStoreName(DELTADETACHED, deltaInfo.edition, detachName);
         return detachName;
@@ -5493,12 +6435,23 @@ public:
         return res;
     }
     virtual void saveStore(IPropertyTree *root, unsigned *_newEdition, bool currentEdition=false)
+    {
+        doSaveStore(root, nullptr, _newEdition, currentEdition);
+    }
+    virtual void saveStoreSnapshot(IStoreSnapshot &snapshot, unsigned *_newEdition)
+    {
+        doSaveStore(nullptr, &snapshot, _newEdition, false);
+    }
+    void doSaveStore(IPropertyTree *root, IStoreSnapshot *snapshot, unsigned *_newEdition, bool currentEdition)
     {
         LOG(MCdebugInfo(100), unknownJob, "Saving store");
 
-        refreshStoreInfo();
-
-        unsigned edition = storeInfo.edition;
+        unsigned edition;
+        {
+            CriticalBlock b(infoCrit);
+            refreshStoreInfo();
+            edition = storeInfo.edition;
+        }
         unsigned newEdition = currentEdition?edition:nextEditionN(edition);
         bool done = false;
         try
@@ -5513,15 +6466,28 @@ public:
                 Owned<ICrcIOStream> crcPipeStream = createCrcPipeStream(fstream);
                 Owned<IIOStream> ios = createBufferedIOStream(crcPipeStream);
 
+                unsigned start = msTick();
+                bool binary = snapshot || (SH_BinaryStore & configFlags);
+                if (snapshot)
+                    snapshot->write(*ios);
+                else if (binary)
+                {
+                    Owned<IStoreSnapshot> rootSnapshot = createStoreSnapshot(*root);
+                    rootSnapshot->write(*ios);
+                }
+                else
+                {
 #ifdef _DEBUG
-                toXML(root, *ios);          // formatted (default)
+                    toXML(root, *ios);          // formatted (default)
 #else
-                toXML(root, *ios, 0, 0);
+                    toXML(root, *ios, 0, 0);
 #endif
+                }
                 ios.clear();
                 fstream.clear();
                 crc = crcPipeStream->queryCrc();
                 crcPipeStream.clear();
+                PROGLOG("Store written (%s, size=%" I64F "d) in %u ms", binary ? "binary" : "xml", iFileIOTmpStore->size(), msTick()-start);
                 iFileIOTmpStore.clear();
             }
             catch (IException *e)
@@ -5536,12 +6502,15 @@ public:
             constructStoreName(storeName, newEdition, newStoreName);
             StringBuffer newStoreNamePath(location);
             newStoreNamePath.append(newStoreName);
-            refreshStoreInfo();
-            if (storeInfo.edition != edition)
             {
-                WARNLOG("Another process has updated the edition whilst saving the store: %s", newStoreNamePath.str());
-                iFileTmpStore->remove();
-                return;
+                CriticalBlock b(infoCrit);
+                refreshStoreInfo();
+                if (storeInfo.edition != edition)
+                {
+                    WARNLOG("Another process has updated the edition whilst saving the store: %s", newStoreNamePath.str());
+                    iFileTmpStore->remove();
+                    return;
+                }
             }
             try
             {
@@ -5560,7 +6529,7 @@ public:
 
             if (0 != (SH_CheckNewDelta & configFlags))
             {
-                CheckDeltaBlock cD(*this);
+                CheckDeltaBlock cD(*this); // NB: must not hold infoCrit, a delta in progress may be waiting on it
                 try { renameDelta(edition, newEdition, location); }
                 catch (IException *e)
                 {
@@ -5578,11 +6547,13 @@ public:
                         e->Release();
                     }
                 }
+                CriticalBlock b(infoCrit);
                 clearStoreInfo("store", location, 0, NULL);
                 writeStoreInfo("store", location, newEdition, &crc, &storeInfo);
             }
             else
             {
+                CriticalBlock b(infoCrit);
                 clearStoreInfo("store", location, 0, NULL);
                 writeStoreInfo("store", location, newEdition, &crc, &storeInfo);
             }
@@ -5596,6 +6567,7 @@ public:
                     constructStoreName(storeName, newEdition, rL);
                     copyFile(rL.str(), newStoreNamePath.str());
 
+                    CriticalBlock b(infoCrit);
                     clearStoreInfo("store", remoteBackupLocation, 0, NULL);
                     writeStoreInfo("store", remoteBackupLocation, newEdition, &crc, &storeInfo);
                     PROGLOG("Copy done");
@@ -5643,11 +6615,13 @@ public:
     }
     virtual unsigned queryCurrentEdition()
     {
+        CriticalBlock b(infoCrit);
         refreshStoreInfo();
         return storeInfo.edition;
     }
     virtual StringBuffer &getCurrentStoreFilename(StringBuffer &res, unsigned *crc=NULL)
     {
+        CriticalBlock b(infoCrit);
         refreshStoreInfo();
         constructStoreName(storeName, storeInfo.edition, res);
         if (crc)
@@ -5656,6 +6630,7 @@ public:
     }
     virtual StringBuffer &getCurrentDeltaFilename(StringBuffer &res, unsigned *crc=NULL)
     {
+        CriticalBlock b(infoCrit);
         refreshDeltaInfo();
         constructStoreName(DELTANAME, deltaInfo.edition, res);
         if (crc)
@@ -5664,10 +6639,95 @@ public:
     }
     virtual StringBuffer &getCurrentStoreInfoFilename(StringBuffer &res)
     {
+        CriticalBlock b(infoCrit);
         refreshStoreInfo();
         res.append(storeInfo.cache);
         return res;
     }
+    virtual unsigned beginSnapshotDeltas()
+    {
+        CriticalBlock b(infoCrit);
+        refreshStoreInfo();
+        snapshotEdition = nextEditionN(storeInfo.edition);
+        snapshotPendingDelta.clear();
+        return snapshotEdition;
+    }
+    virtual unsigned writeDelta(StringBuffer &delta, bool &first, StringBuffer *snapshotDelta)
+    {
+        // NB: held whilst writing, so that a snapshot cannot be committed between choosing the edition(s) and writing to them
+        CriticalBlock b(infoCrit);
+        unsigned edition;
+        if (snapshotEdition)
+        {
+            refreshStoreInfo();
+            edition = storeInfo.edition;
+            if ((edition == snapshotEdition) && snapshotPendingDelta.length()) // committed, catch up with the deltas it missed
+            {
+                snapshotPendingDelta.append(delta);
+                delta.swapWith(snapshotPendingDelta);
+                snapshotPendingDelta.clear();
+            }
+        }
+        else
+        {
+            refreshDeltaInfo();
+            edition = deltaInfo.edition;
+        }
+        StringBuffer deltaFilename(location);
+        constructStoreName(DELTANAME, edition, deltaFilename);
+        OwnedIFile iFile = createIFile(deltaFilename.str());
+        first = !iFile->exists() || 0 == iFile->size();
+        ::writeDelta(delta, *iFile);
+        if (snapshotEdition && (edition != snapshotEdition))
+        {
+            // NB: the delta is in the current edition now, so must not be rewritten there if this fails, it is kept for the next instead
+            snapshotPendingDelta.append(delta);
+            try
+            {
+                deltaFilename.clear().append(location);
+                constructStoreName(DELTANAME, snapshotEdition, deltaFilename);
+                OwnedIFile snapshotIFile = createIFile(deltaFilename.str());
+                if (::writeDelta(snapshotPendingDelta, *snapshotIFile))
+                {
+                    if (snapshotDelta)
+                        snapshotDelta->append(snapshotPendingDelta);
+                    snapshotPendingDelta.clear();
+                }
+            }
+            catch (IException *e)
+            {
+                LOG(MCoperatorError, unknownJob, e, "writeDelta: failed to save delta to snapshot edition");
+                e->Release();
+            }
+        }
+        return edition;
+    }
+    virtual bool endSnapshotDeltas(StringBuffer *snapshotDelta)
+    {
+        CriticalBlock b(infoCrit);
+        if (!snapshotEdition)
+            return false;
+        refreshStoreInfo();
+        bool committed = (storeInfo.edition == snapshotEdition);
+        StringBuffer deltaFilename(location);
+        constructStoreName(DELTANAME, snapshotEdition, deltaFilename);
+        OwnedIFile iFile = createIFile(deltaFilename.str());
+        if (!committed)
+            iFile->remove();
+        else if (snapshotPendingDelta.length())
+        {
+            if (::writeDelta(snapshotPendingDelta, *iFile))
+            {
+                if (snapshotDelta)
+                    snapshotDelta->append(snapshotPendingDelta);
+            }
+            else
+                LOG(MCoperatorError, unknownJob, "endSnapshotDeltas: failed to save deltas to store edition %u, size=%u", snapshotEdition, snapshotPendingDelta.length());
+        }
+        snapshotPendingDelta.clear();
+        snapshotEdition = 0;
+        return committed;
+    }
     virtual void backup(const char *filename)
     {
         try
@@ -5741,7 +6801,38 @@ CCovenSDSManager::CCovenSDSManager(ICoven &_coven, IPropertyTree &_config, const
     unsigned initNodeTableSize = queryCoven().getInitSDSNodes();
     allNodes.ensure(initNodeTableSize?initNodeTableSize:INIT_NODETABLE_SIZE);
     externalSizeThreshold = config.getPropInt("@externalSizeThreshold", DEFAULT_EXTERNAL_SIZE_THRESHOLD);
+    activeNotifyThreads = 0;
+    notifyThreadLimit = config.getPropInt("@notifyPoolSize", SUBNTFY_POOL_SIZE);
+    if (!notifyThreadLimit)
+        notifyThreadLimit = 1;
+    notifyCoalesceWindow = config.getPropInt("@notifyCoalesceWindow", SUBNTFY_COALESCE_WINDOW);
+    notifyQueueLimit = config.getPropInt("@notifyQueueLimit", SUBNTFY_QUEUE_LIMIT);
+    notificationsQueued = notificationsCoalesced = notificationsDropped = 0;
     remoteBackupLocation.set(config.queryProp("@remoteBackupLocation"));
+    Owned<IPropertyTreeIterator> indexIter = config.getElements("Index"); // e.g. <Index path="/WorkUnits" attributes="@state,@submitID,@clusterName"/>
+    ForEach(*indexIter)
+    {
+        IPropertyTree &indexConfig = indexIter->query();
+        const char *path = indexConfig.queryProp("@path");
+        const char *attributes = indexConfig.queryProp("@attributes");
+        if (isEmptyString(path) || isEmptyString(attributes))
+        {
+            WARNLOG("Ignoring SDS Index definition without both a path and attributes");
+            continue;
+        }
+        try
+        {
+            Owned<CSDSQueryIndex> index = new CSDSQueryIndex(path, attributes);
+            StringBuffer s;
+            PROGLOG("SDS index: %s", index->getDescription(s).str());
+            queryIndexes.append(*index.getClear());
+        }
+        catch (IException *e)
+        {
+            EXCLOG(e, "Ignoring SDS Index definition");
+            e->Release();
+        }
+    }
     nextExternal = 1;
     if (0 == coven.getServerRank())
     {
@@ -5843,6 +6934,10 @@ CCovenSDSManager::CCovenSDSManager(ICoven &_coven, IPropertyTree &_config, const
 
     unsigned configFlags = config.getPropBool("@recoverFromIncErrors", true) ? SH_RecoverFromIncErrors : 0;
     configFlags |= config.getPropBool("@backupErrorFiles", true) ? SH_BackupErrorFiles : 0;
+    const char *storeFormat = config.queryProp("@storeFormat");
+    binaryStore = storeFormat && strieq("binary", storeFormat);
+    if (binaryStore)
+        configFlags |= SH_BinaryStore;
     iStoreHelper = createStoreHelper(storeName, dataPath, remoteBackupLocation, configFlags, keepLastN, 100, &server.queryStopped());
     doTimeComparison = false;
     if (config.getPropBool("@lightweightCoalesce", true))
@@ -5860,6 +6955,13 @@ CCovenSDSManager::~CCovenSDSManager()
     if (coalesce) coalesce->stop();
     scanNotifyPool.clear();
     notifyPool.clear();
+    for (;;)
+    {
+        CSubscriberNotifier *notifier = readyNotifiers.dequeue();
+        if (!notifier)
+            break;
+        notifier->Release();
+    }
     connections.kill();
     ::Release(iStoreHelper);
     if (!config.getPropBool("@leakStore", true)) // intentional default leak of time consuming deconstruction of tree
@@ -5983,6 +7085,15 @@ void CCovenSDSManager::checkEnvironment(IPropertyTree *oldEnv, IPropertyTree *ne
     }
 }
 
+static void collectExternalCandidates(CServerRemoteTree &tree, ICopyArrayOf<CServerRemoteTree> &candidates)
+{
+    if (tree.testExternalCandidate())
+        candidates.append(tree);
+    Owned<IPropertyTreeIterator> iter = tree.getElements("*");
+    ForEach(*iter)
+        collectExternalCandidates((CServerRemoteTree &)iter->query(), candidates);
+}
+
 void CCovenSDSManager::loadStore(const char *storeName, const bool *abort)
 {
     if (root) root->Release();
@@ -6020,6 +7131,8 @@ void CCovenSDSManager::loadStore(const char *storeName, const bool *abort)
 
         LOG(MCdebugInfo(100), unknownJob, "loading store %d, storedCrc=%x", iStoreHelper->queryCurrentEdition(), crc);
         root = (CServerRemoteTree *)::loadStore(storeFilename.str(), &treeMaker, crc, false, abort);
+        if (root && isBinaryStoreFile(storeFilename))
+            collectExternalCandidates(*root, treeMaker.convertQueue); // nodes are not created via the tree maker's endNode
         if (!root)
         {
             StringBuffer s(storeName);
@@ -6545,14 +7658,12 @@ void CCovenSDSManager::saveDelta(const char *path, IPropertyTree &changeTree)
         catch (IException *e) { EXCLOG(e, NULL); e->Release(); }
     }
     bool first = false;
+    unsigned deltaEdition = 0;
     try
     {
-        StringBuffer deltaFilename(dataPath);
-        iStoreHelper->getCurrentDeltaFilename(deltaFilename);
         toXML(header, blockedDelta);
-        OwnedIFile iFile = createIFile(deltaFilename.str());
-        first = !iFile->exists() || 0 == iFile->size();
-        writeDelta(blockedDelta, *iFile);
+        // NB: whilst a snapshot is being saved, this also writes the delta to the snapshot's edition
+        deltaEdition = iStoreHelper->writeDelta(blockedDelta, first, remoteBackupLocation.length() ? &snapshotBackupDeltas : nullptr);
     }
     catch (IException *e)
     {
@@ -6575,7 +7686,11 @@ void CCovenSDSManager::saveDelta(const char *path, IPropertyTree &changeTree)
                 LOG(MCoperatorError, unknownJob, "Backup delta resynchronized");
             }
             else
-                backupHandler.addDelta(blockedDelta, iStoreHelper->queryCurrentEdition(), first);
+            {
+                if (snapshotEdition && (deltaEdition == snapshotEdition)) // the snapshot has been committed
+                    flushSnapshotBackupDeltas();
+                backupHandler.addDelta(blockedDelta, deltaEdition, first);
+            }
         }
         catch (IException *e)
         {
@@ -7305,7 +8420,7 @@ CServerConnection *CCovenSDSManager::createConnectionInstance(CRemoteTreeBase *r
     CServerConnection *connection = new CServerConnection(*this, connectionId, _xpath, sessionId, mode, timeout, parent, connInfoFlags);
     Owned<LinkingCriticalBlock> b;
     if (!RTM_MODE(mode, RTM_INTERNAL))
-        b.setown(new LinkingCriticalBlock(lockCrit, __FILE__, __LINE__));
+        b.setown(new LinkingCriticalBlock(queryLockStripe(tree->queryServerId()).crit, __FILE__, __LINE__));
     connection->initPTreePath(*root, *tree);
 
     if (newNode)
@@ -7391,13 +8506,17 @@ CServerConnection *CCovenSDSManager::createConnectionInstance(CRemoteTreeBase *r
 
 void CCovenSDSManager::clearSDSLocks()
 {
-    CHECKEDCRITICALBLOCK(lockCrit, fakeCritTimeout);
-    SuperHashIteratorOf<CLock> iter(lockTable.queryBaseTable());
-    ICopyArrayOf<CLock> locks;
-    ForEach(iter)
-        locks.append(iter.query());
-    ForEachItemIn(l, locks)
-        locks.item(l).unlockAll();
+    for (unsigned s=0; s<SDS_LOCK_STRIPES; s++)
+    {
+        CLockStripe &stripe = lockStripes[s];
+        CHECKEDCRITICALBLOCK(stripe.crit, fakeCritTimeout);
+        SuperHashIteratorOf<CLock> iter(stripe.table.queryBaseTable());
+        ICopyArrayOf<CLock> locks;
+        ForEach(iter)
+            locks.append(iter.query());
+        ForEachItemIn(l, locks)
+            locks.item(l).unlockAll();
+    }
 }
 
 void CCovenSDSManager::changeLockMode(CServerConnection &connection, unsigned newMode, unsigned timeout)
@@ -7409,7 +8528,7 @@ void CCovenSDSManager::changeLockMode(CServerConnection &connection, unsigned ne
     newMode |= connection.queryMode() & ~(RTM_LOCKBASIC_MASK|RTM_LOCK_SUB);
     CUnlockCallback callback(connection.queryXPath(), connectionId, *tree);
     {
-        CHECKEDCRITICALBLOCK(lockCrit, fakeCritTimeout);
+        CHECKEDCRITICALBLOCK(queryLockStripe(treeId).crit, fakeCritTimeout);
         CLock *lock = queryLock(treeId);
         if (lock)
         {
@@ -7441,7 +8560,7 @@ bool CCovenSDSManager::unlock(__int64 connectionId, bool close, StringBuffer &co
     {
         PROGLOG("forcing unlock for connection : %s", connectionInfo.str());
         __int64 nodeId = ((CRemoteTreeBase *)connection->queryRoot())->queryServerId();
-        CHECKEDCRITICALBLOCK(lockCrit, fakeCritTimeout);
+        CHECKEDCRITICALBLOCK(queryLockStripe(nodeId).crit, fakeCritTimeout);
         CLock *lock = queryLock(nodeId);
         if (lock)
             lock->unlock(connectionId);
@@ -7449,9 +8568,153 @@ bool CCovenSDSManager::unlock(__int64 connectionId, bool close, StringBuffer &co
     return true;
 }
 
+static StringBuffer &normalizeLockWaitXPath(StringBuffer &out, const char *xpath)
+{
+    // qualifiers (e.g. [@name="..."]) are dropped, so that locks on siblings of the same kind are counted together
+    unsigned depth = 0;
+    for (; *xpath; xpath++)
+    {
+        if ('[' == *xpath)
+            depth++;
+        else if (']' == *xpath)
+        {
+            if (depth)
+                depth--;
+        }
+        else if (!depth)
+            out.append(*xpath);
+    }
+    return out;
+}
+
+void CCovenSDSManager::noteLockWait(const char *xpath, unsigned ms, bool timedout)
+{
+    StringBuffer normalized;
+    normalizeLockWaitXPath(normalized, xpath);
+    CHECKEDCRITICALBLOCK(lockWaitStatsCrit, fakeCritTimeout);
+    CLockWaitStats *stats = lockWaitStats.find(normalized.str());
+    if (!stats)
+    {
+        if (lockWaitStats.count() >= LOCKWAIT_MAX_XPATHS)
+        {
+            // Bound the table, e.g. where each lock is on a uniquely named branch, by merging the least contended xpath into the overflow entry
+            CLockWaitStats *other = lockWaitStats.find(LOCKWAIT_OTHER_XPATHS);
+            if (!other)
+            {
+                other = new CLockWaitStats(LOCKWAIT_OTHER_XPATHS);
+                lockWaitStats.replace(*other);
+            }
+            CLockWaitStats *least = NULL;
+            SuperHashIteratorOf<CLockWaitStats> iter(lockWaitStats);
+            ForEach(iter)
+            {
+                CLockWaitStats &cur = iter.query();
+                if ((&cur != other) && (!least || (cur.queryTotalMs() < least->queryTotalMs())))
+                    least = &cur;
+            }
+            if (least)
+            {
+                other->merge(*least);
+                lockWaitStats.removeExact(least);
+            }
+        }
+        stats = new CLockWaitStats(normalized.str());
+        lockWaitStats.replace(*stats);
+    }
+    stats->noteWait(ms, timedout);
+}
+
+static int compareLockWaitStats(CInterface * const *_s1, CInterface * const *_s2)
+{
+    CLockWaitStats *s1 = (CLockWaitStats *)*_s1;
+    CLockWaitStats *s2 = (CLockWaitStats *)*_s2;
+    if (s1->queryTotalMs() == s2->queryTotalMs()) return strcmp(s1->queryXPath(), s2->queryXPath());
+    return (s1->queryTotalMs() > s2->queryTotalMs()) ? -1 : 1;
+}
+
+StringBuffer &CCovenSDSManager::getLockWaitStats(StringBuffer &out, bool reset)
+{
+    CIArrayOf<CLockWaitStats> stats;
+    {
+        CHECKEDCRITICALBLOCK(lockWaitStatsCrit, fakeCritTimeout);
+        SuperHashIteratorOf<CLockWaitStats> iter(lockWaitStats);
+        ForEach(iter)
+            stats.append(*LINK(&iter.query()));
+        if (reset)
+            lockWaitStats.kill();
+    }
+    if (0 == stats.ordinality())
+        return out.append("No lock waits recorded").newline();
+    stats.sort(compareLockWaitStats); // worst contended first
+    ForEachItemIn(s, stats)
+        stats.item(s).toString(out);
+    return out;
+}
+
+void CCovenSDSManager::noteTreeFreed(CServerRemoteTree &tree)
+{
+    if (!queryIndexes.ordinality())
+        return;
+    CHECKEDCRITICALBLOCK(queryIndexCrit, fakeCritTimeout);
+    ForEachItemIn(i, queryIndexes)
+        queryIndexes.item(i).remove(tree);
+}
+
+void CCovenSDSManager::noteQueryIndexChanges(CPTStack &stack, CBranchChange &changes)
+{
+    if (!queryIndexes.ordinality())
+        return;
+    CHECKEDCRITICALBLOCK(queryIndexCrit, fakeCritTimeout);
+    ForEachItemIn(i, queryIndexes)
+        queryIndexes.item(i).noteChanges(stack, changes);
+}
+
+IPropertyTreeIterator *CCovenSDSManager::getIndexedElements(const char *xpath, const char *filterAttr, const char *filterValue, const char *sortAttr, bool descending, unsigned from, unsigned limit, const char *children, unsigned *total)
+{
+    if (!queryIndexes.ordinality() || isEmptyString(xpath))
+        return NULL;
+    if ('/' == *xpath)
+        ++xpath;
+    CHECKEDDALIREADLOCKBLOCK(dataRWLock, readWriteTimeout);
+    CHECKEDCRITICALBLOCK(queryIndexCrit, fakeCritTimeout);
+    ForEachItemIn(i, queryIndexes)
+    {
+        CSDSQueryIndex &index = queryIndexes.item(i);
+        if (!streq(xpath, index.queryXPath()))
+            continue;
+        unsigned filter = isEmptyString(filterAttr) ? NotFound : index.queryAttr(filterAttr);
+        unsigned sort = isEmptyString(sortAttr) ? NotFound : index.queryAttr(sortAttr);
+        if ((NotFound == filter && !isEmptyString(filterAttr)) || (NotFound == sort && !isEmptyString(sortAttr)))
+            return NULL; // not indexed
+        if (NotFound == filter && NotFound == sort)
+            return NULL;
+        if (!index.isBuilt())
+        {
+            CTimeMon elapsed;
+            index.build(*root);
+            if (index.isBuilt())
+            {
+                StringBuffer s;
+                PROGLOG("SDS index %s built in %u ms", index.getDescription(s).str(), elapsed.elapsed());
+            }
+        }
+        StringArray childList;
+        if (!isEmptyString(children))
+            childList.appendListUniq(children, ",");
+        Owned<DaliPTArrayIterator> results = new DaliPTArrayIterator;
+        unsigned count = 0;
+        if (index.isBuilt()) // branch may not exist (yet)
+            index.getElements(results->array, filter, filterValue ? filterValue : "", sort, descending, from, limit, childList, count);
+        if (total)
+            *total = count;
+        return results.getClear();
+    }
+    return NULL;
+}
+
 bool CCovenSDSManager::unlock(__int64 treeId, ConnectionId connectionId, bool delayDelete)
 {
-    CHECKEDCRITICALBLOCK(lockCrit, fakeCritTimeout);
+    CHECKEDCRITICALBLOCK(queryLockStripe(treeId).crit, fakeCritTimeout);
     CLock *lock = queryLock(treeId);
     if (lock)
         return lock->unlock(connectionId, delayDelete);
@@ -7460,7 +8723,7 @@ bool CCovenSDSManager::unlock(__int64 treeId, ConnectionId connectionId, bool de
 
 void CCovenSDSManager::unlockAll(__int64 treeId)
 {
-    CHECKEDCRITICALBLOCK(lockCrit, fakeCritTimeout);
+    CHECKEDCRITICALBLOCK(queryLockStripe(treeId).crit, fakeCritTimeout);
     CLock *lock = queryLock(treeId);
     if (lock)
         lock->unlockAll();
@@ -7498,14 +8761,15 @@ void CCovenSDSManager::lock(CServerRemoteTree &tree, const char *xpath, Connecti
     }
 
     __int64 treeId = tree.queryServerId();
-    CHECKEDCRITICALBLOCK(lockCrit, fakeCritTimeout);
-    lock = lockTable.find(&treeId);
+    CLockStripe &stripe = queryLockStripe(treeId);
+    CHECKEDCRITICALBLOCK(stripe.crit, fakeCritTimeout);
+    lock = stripe.table.find(&treeId);
     
     if (!lock)
     {
         IdPath idPath;
-        lock = new CLock(lockTable, treeId, idPath, xpath, mode, connectionId, sessionId);
-        lockTable.replace(*lock);
+        lock = new CLock(stripe.table, treeId, idPath, xpath, mode, connectionId, sessionId);
+        stripe.table.replace(*lock);
     }
     else
     {
@@ -7648,7 +8912,7 @@ void CCovenSDSManager::createConnection(SessionId sessionId, unsigned mode, unsi
                                             {
                                                 CServerRemoteTree &e = freeExistingLocks.existingLockTrees.item(f);
                                                 {
-                                                    CHECKEDCRITICALBLOCK(lockCrit, fakeCritTimeout);
+                                                    CHECKEDCRITICALBLOCK(queryLockStripe(e.queryServerId()).crit, fakeCritTimeout);
                                                     CLock *_lock = queryLock(e.queryServerId());
                                                     if (_lock)
                                                     {
@@ -7736,6 +9000,7 @@ void CCovenSDSManager::createConnection(SessionId sessionId, unsigned mode, unsi
             if (connection->queryRoot() == SDSManager->queryRoot())
                 stack.pop();
             stack.popn(additions);
+            noteQueryIndexChanges(stack, *branchChange);
             connection->notify();
             SDSManager->startNotification(*deltaChange, stack, *branchChange);
             
@@ -7842,7 +9107,7 @@ void CCovenSDSManager::disconnect(ConnectionId id, bool deleteRoot, Owned<CLCLoc
     {
         if (deleteRoot || RTM_MODE(connection->queryMode(), RTM_DELETE_ON_DISCONNECT))
         {
-            CHECKEDCRITICALBLOCK(lockCrit, fakeCritTimeout);
+            CHECKEDCRITICALBLOCK(queryLockStripe(tree->queryServerId()).crit, fakeCritTimeout);
             CLock *lock = queryLock(tree->queryServerId());
             if (lock)
             {
@@ -7923,6 +9188,16 @@ StringBuffer &formatUsageStats(MemoryBuffer &src, StringBuffer &out)
     out.append("Subscribers              : ").append(c).newline();
     src.read(c);
     out.append("Connection subscriptions : ").append(c).newline();
+    if (src.remaining()) // older servers do not send notification counts
+    {
+        unsigned __int64 n;
+        src.read(n);
+        out.append("Notifications queued     : ").append(n).newline();
+        src.read(n);
+        out.append("Notifications coalesced  : ").append(n).newline();
+        src.read(n);
+        out.append("Notifications dropped    : ").append(n).newline();
+    }
     return out;
 }
 
@@ -8014,11 +9289,15 @@ unsigned CCovenSDSManager::countConnections()
 unsigned CCovenSDSManager::countActiveLocks()
 {
     unsigned activeLocks = 0;
-    CHECKEDCRITICALBLOCK(lockCrit, fakeCritTimeout);
-    SuperHashIteratorOf<CLock> iter(lockTable.queryBaseTable());
-    ForEach(iter) {
-        CLock &lock = iter.query();
-        if (lock.lockCount()) activeLocks++;
+    for (unsigned s=0; s<SDS_LOCK_STRIPES; s++)
+    {
+        CLockStripe &stripe = lockStripes[s];
+        CHECKEDCRITICALBLOCK(stripe.crit, fakeCritTimeout);
+        SuperHashIteratorOf<CLock> iter(stripe.table.queryBaseTable());
+        ForEach(iter) {
+            CLock &lock = iter.query();
+            if (lock.lockCount()) activeLocks++;
+        }
     }
     return activeLocks;
 }
@@ -8030,9 +9309,11 @@ ILockInfoCollection *CCovenSDSManager::getLocks(const char *ipPattern, const cha
     bool filteredConnections = !isEmptyString(ipPattern);
     bool filteredXPaths = !isEmptyString(xpathPattern);
     CLockInfoArray locks;
+    for (unsigned s=0; s<SDS_LOCK_STRIPES; s++)
     {
-        CHECKEDCRITICALBLOCK(lockCrit, fakeCritTimeout);
-        SuperHashIteratorOf<CLock> iter(lockTable.queryBaseTable());
+        CLockStripe &stripe = lockStripes[s];
+        CHECKEDCRITICALBLOCK(stripe.crit, fakeCritTimeout);
+        SuperHashIteratorOf<CLock> iter(stripe.table.queryBaseTable());
         ForEach(iter)
         {
             CLock &lock = iter.query();
@@ -8061,18 +9342,12 @@ MemoryBuffer &CCovenSDSManager::collectUsageStats(MemoryBuffer &out)
     { CHECKEDCRITICALBLOCK(cTableCrit, fakeCritTimeout);
         out.append(connections.count());
     }
-    unsigned activeLocks = 0;
-    { CHECKEDCRITICALBLOCK(lockCrit, fakeCritTimeout);
-        SuperHashIteratorOf<CLock> iter(lockTable.queryBaseTable());
-        ForEach(iter)
-        {
-            CLock &lock = iter.query();
-            if (lock.lockCount()) activeLocks++;
-        }
-    }
-    out.append(activeLocks);
+    out.append(countActiveLocks());
     out.append(subscribers.count());
     out.append(connectionSubscriptionManager->querySubscribers());
+    { CHECKEDCRITICALBLOCK(nfyTableCrit, fakeCritTimeout);
+        out.append(notificationsQueued).append(notificationsCoalesced).append(notificationsDropped);
+    }
     return out;
 }
 
@@ -8099,12 +9374,67 @@ MemoryBuffer &CCovenSDSManager::collectSubscribers(MemoryBuffer &out)
 
 void CCovenSDSManager::blockingSave(unsigned *writeTransactions)
 {
-    CHECKEDDALIREADLOCKBLOCK(SDSManager->dataRWLock, readWriteTimeout); // block all write actions whilst saving
-    CHECKEDCRITICALBLOCK(blockedSaveCrit, fakeCritTimeout);
-    if (writeTransactions)
-        *writeTransactions = SDSManager->writeTransactions;
-    // JCS - could in theory, not block, but abort save.
-    SDSManager->saveStore();
+    if (!binaryStore)
+    {
+        CHECKEDDALIREADLOCKBLOCK(SDSManager->dataRWLock, readWriteTimeout); // block all write actions whilst saving
+        CHECKEDCRITICALBLOCK(blockedSaveCrit, fakeCritTimeout);
+        if (writeTransactions)
+            *writeTransactions = SDSManager->writeTransactions;
+        // JCS - could in theory, not block, but abort save.
+        SDSManager->saveStore();
+        return;
+    }
+
+    // Only block writes whilst the tree is serialized, the snapshot is written after they resume.
+    // Deltas committed in the meantime are also saved to the new edition's delta, so nothing is lost whichever edition is loaded.
+    Owned<IStoreSnapshot> snapshot;
+    {
+        CHECKEDDALIREADLOCKBLOCK(dataRWLock, readWriteTimeout);
+        CHECKEDCRITICALBLOCK(blockedSaveCrit, fakeCritTimeout);
+        if (writeTransactions)
+            *writeTransactions = SDSManager->writeTransactions;
+        unsigned start = msTick();
+        {
+            ignoreExternals = true;
+            try { snapshot.setown(createStoreSnapshot(*root)); }
+            catch (...) { ignoreExternals = false; throw; }
+            ignoreExternals = false;
+        }
+        CHECKEDCRITICALBLOCK(saveIncCrit, fakeCritTimeout);
+        snapshotEdition = iStoreHelper->beginSnapshotDeltas();
+        PROGLOG("Store snapshot taken (size=%" I64F "d) in %u ms", snapshot->querySize(), msTick()-start);
+    }
+    try
+    {
+        iStoreHelper->saveStoreSnapshot(*snapshot);
+    }
+    catch (...)
+    {
+        endSnapshotDeltas();
+        throw;
+    }
+    endSnapshotDeltas();
+    unsigned initNodeTableSize = allNodes.maxElements()+OVERFLOWSIZE;
+    queryCoven().setInitSDSNodes(initNodeTableSize>INIT_NODETABLE_SIZE?initNodeTableSize:INIT_NODETABLE_SIZE);
+}
+
+void CCovenSDSManager::endSnapshotDeltas()
+{
+    CHECKEDCRITICALBLOCK(saveIncCrit, fakeCritTimeout);
+    // if not committed, the snapshot edition's delta is removed
+    if (iStoreHelper->endSnapshotDeltas(remoteBackupLocation.length() ? &snapshotBackupDeltas : nullptr))
+        flushSnapshotBackupDeltas();
+    snapshotBackupDeltas.clear();
+    snapshotEdition = 0;
+}
+
+void CCovenSDSManager::flushSnapshotBackupDeltas()
+{
+    if (snapshotBackupDeltas.length())
+    {
+        backupHandler.addDelta(snapshotBackupDeltas, snapshotEdition, true);
+        snapshotBackupDeltas.clear();
+    }
 }
 
 bool CCovenSDSManager::updateEnvironment(IPropertyTree *newEnv, bool forceGroupUpdate, StringBuffer &response)
@@ -8186,7 +9516,7 @@ void CCovenSDSManager::handleNodeNotify(notifications n, CServerRemoteTree &tree
     }
 }
 
-void CCovenSDSManager::handleNotify(CSubscriberContainerBase *_subscriber, MemoryBuffer &notifyData)
+void CCovenSDSManager::handleNotify(CSubscriberContainerBase *_subscriber, MemoryBuffer &notifyData, bool hasPath)
 {
     Owned<CSubscriberContainerBase> subscriber = _subscriber;
     class CNotifyPoolFactory : public IThreadFactory, public CInterface
@@ -8196,23 +9526,28 @@ void CCovenSDSManager::handleNotify(CSubscriberContainerBase *_subscriber, Memor
             DECL_NAMEDCOUNT;
         public:
             IMPLEMENT_IINTERFACE;
-            CNotifyHandler() { INIT_NAMEDCOUNT; }
+            CNotifyHandler(unsigned _window) : window(_window) { INIT_NAMEDCOUNT; }
             void init(void *startInfo) 
             {
-                n.setown((CSubscriberNotifier *)startInfo);
             }
             void main()
             {
-                try
-                {
-                    n->notify();
-                }
-                catch (IException *e)
+                // deliver to ready subscribers until there are none left, so that the number of threads stays bounded
+                for (;;)
                 {
-                    EXCLOG(e, "CNotifyHandler");
-                    e->Release();
+                    Owned<CSubscriberNotifier> n = SDSManager->getNextNotifier();
+                    if (!n)
+                        break;
+                    try
+                    {
+                        n->notify(window);
+                    }
+                    catch (IException *e)
+                    {
+                        EXCLOG(e, "CNotifyHandler");
+                        e->Release();
+                    }
                 }
-                n.clear();
             }
             bool canReuse()
             {
@@ -8223,42 +9558,81 @@ void CCovenSDSManager::handleNotify(CSubscriberContainerBase *_subscriber, Memor
                 return true;
             }
         private:
-            Linked<CSubscriberNotifier> n;
+            unsigned window;
         };
     public:
         IMPLEMENT_IINTERFACE;
+        CNotifyPoolFactory(unsigned _window) : window(_window) { }
         IPooledThread *createNew()
         {
-            return new CNotifyHandler();
+            return new CNotifyHandler(window);
         }
+    private:
+        unsigned window;
     };
     if (!notifyPool)
     {
-        CNotifyPoolFactory *factory = new CNotifyPoolFactory;
-        notifyPool.setown(createThreadPool("SDS Notification Pool", factory, this, SUBNTFY_POOL_SIZE));
+        CNotifyPoolFactory *factory = new CNotifyPoolFactory(notifyCoalesceWindow);
+        notifyPool.setown(createThreadPool("SDS Notification Pool", factory, this, notifyThreadLimit));
         factory->Release();
     }
 
-    CHECKEDCRITICALBLOCK(nfyTableCrit, fakeCritTimeout);
-    SubscriptionId id = subscriber->queryId();
-    CSubscriberNotifier *notifier = subscriberNotificationTable.find(id);
-
-    /* Must clear 'subscriber' before leaving ntyTableCrit block, so that the notifier thread owns and destroys it
-     * It cannot be destroyed here, because this method may have been called inside the SDS lock during a node
-     * delete and do not want to call into subscriber manager as that can deadlock if processing a request
-     * already that requires SDS lock.
-     */
-    if (notifier)
+    bool startThread = false;
     {
-        subscriber.clear();
-        notifier->queueChange(notifyData);
-    }
-    else
-    {
-        Owned<CSubscriberNotifier> _notifier = new CSubscriberNotifier(subscriberNotificationTable, *subscriber.getClear(), notifyData);
-        subscriberNotificationTable.replace(*_notifier);
-        notifyPool->start(_notifier.getClear()); // NB: takes ownership (during init())
+        CHECKEDCRITICALBLOCK(nfyTableCrit, fakeCritTimeout);
+        SubscriptionId id = subscriber->queryId();
+        CSubscriberNotifier *notifier = subscriberNotificationTable.find(id);
+
+        /* Must clear 'subscriber' before leaving ntyTableCrit block, so that the notifier thread owns and destroys it
+         * It cannot be destroyed here, because this method may have been called inside the SDS lock during a node
+         * delete and do not want to call into subscriber manager as that can deadlock if processing a request
+         * already that requires SDS lock.
+         */
+        if (notifier)
+        {
+            subscriber.clear();
+            switch (notifier->queueChange(notifyData, hasPath, notifyQueueLimit))
+            {
+                case nqQueued:
+                    ++notificationsQueued;
+                    break;
+                case nqCoalesced:
+                    ++notificationsCoalesced;
+                    break;
+                case nqDropped:
+                    if (0 == (notificationsDropped % 1000))
+                        WARNLOG("SDS: subscriber notification queue limit (%u) exceeded, dropping notifications (%" I64F "u dropped so far)", notifyQueueLimit, notificationsDropped+1);
+                    ++notificationsDropped;
+                    break;
+                default:
+                    throwUnexpected();
+            }
+        }
+        else
+        {
+            Owned<CSubscriberNotifier> _notifier = new CSubscriberNotifier(subscriberNotificationTable, *subscriber.getClear());
+            _notifier->queueChange(notifyData, hasPath, 0);
+            ++notificationsQueued;
+            subscriberNotificationTable.replace(*_notifier);
+            readyNotifiers.enqueue(_notifier.getClear());
+            if (activeNotifyThreads < notifyThreadLimit)
+            {
+                ++activeNotifyThreads;
+                startThread = true;
+            }
+        }
     }
+    if (startThread)
+        notifyPool->start(NULL); // NB: outside of nfyTableCrit, may briefly wait for an exiting thread to be returned to the pool
+}
+
+CSubscriberNotifier *CCovenSDSManager::getNextNotifier()
+{
+    CHECKEDCRITICALBLOCK(nfyTableCrit, fakeCritTimeout);
+    CSubscriberNotifier *notifier = readyNotifiers.dequeue();
+    if (!notifier)
+        --activeNotifyThreads;
+    return notifier;
 }
 
 /////////////////
@@ -8280,15 +9654,23 @@ public:
     CSubscriberNotifyScanner(IPropertyTree &_changeTree, CPTStack &_stack, CBranchChange &_rootChanges) : changeTree(&_changeTree), rootChanges(&_rootChanges), stack(_stack)
     {
         INIT_NAMEDCOUNT;
-        SDSManager->querySubscriberTable().getSubscribers(subs);
+        stack.toString(xpath);
+        SDSManager->querySubscriberTable().getSubscribers(xpath.str(), subs);
     }
+    bool hasSubscribers() const { return subs.ordinality() > 0; }
     enum SubCommitType { subCommitNone, subCommitExact, subCommitBelow, subCommitAbove };
-    SubCommitType match(const char *head, const char *path)
+    SubCommitType match(const char *head, const char *path, bool sub)
     {
         bool wild = false;
         for (;;)
         {
-            if (wild)
+            if (!wild && '/' == *path && '/' == *(path+1))
+            {
+                if ('/' != *head)
+                    return subCommitNone;
+                return matchDescendant(head, path+1, sub);
+            }
+            else if (wild)
             {
                 if (*head == *path)
                 {
@@ -8325,6 +9707,20 @@ public:
         }
     }
 
+    // path follows a '//' step, try it against this and every deeper segment of head
+    SubCommitType matchDescendant(const char *head, const char *path, bool sub)
+    {
+        for (;;)
+        {
+            SubCommitType subCommit = match(head, path, sub);
+            if ((subCommitExact == subCommit) || (sub && (subCommitBelow == subCommit)))
+                return subCommit;
+            head = strchr(head+1, '/');
+            if (!head)
+                return subCommitAbove; // a deeper change may yet match
+        }
+    }
+
     void scan() 
     {
         xpath.clear();
@@ -8343,7 +9739,7 @@ public:
             if (subscriber.isUnsubscribed())
                 subCommit = subCommitNone;
             else
-                subCommit = match(xpath, subscriber.queryXPath());
+                subCommit = match(xpath, subscriber.queryXPath(), subscriber.querySub());
             switch (subCommit)
             {
                 case subCommitNone:
@@ -8395,7 +9791,7 @@ public:
                         {
                             if (0 == notifyData.length())
                                 buildNotifyData(notifyData, state, &stack, NULL);
-                            SDSManager->handleNotify(LINK(&subscriber), notifyData);
+                            SDSManager->handleNotify(LINK(&subscriber), notifyData, true);
                         }
                         else
                             pruned.append(*LINK(&subscriber));
@@ -8416,7 +9812,7 @@ public:
                             {
                                 if (0 == notifyData.length())
                                     buildNotifyData(notifyData, state, &stack, NULL);
-                                SDSManager->handleNotify(LINK(&subscriber), notifyData);
+                                SDSManager->handleNotify(LINK(&subscriber), notifyData, true);
                             }
                             else
                                 pruned.append(*LINK(&subscriber));
@@ -8489,7 +9885,7 @@ public:
                                     lastSendValue = 0;
                                 }
                             }
-                            SDSManager->handleNotify(LINK(&subscriber), notifyData);
+                            SDSManager->handleNotify(LINK(&subscriber), notifyData, true);
                         }
                         else
                             pruned.append(*LINK(&subscriber));
@@ -8564,7 +9960,8 @@ void CCovenSDSManager::startNotification(IPropertyTree &changeTree, CPTStack &st
     }
 
     Owned<CSubscriberNotifyScanner> scan = new CSubscriberNotifyScanner(changeTree, stack, changes);
-    scanNotifyPool->start(scan.get());
+    if (scan->hasSubscribers())
+        scanNotifyPool->start(scan.get());
 }
 
 void CCovenSDSManager::deleteExternal(__int64 index)
@@ -118,6 +118,11 @@ interface ISDSManager
     virtual void setConfigOpt(const char *opt, const char *value) = 0;
     virtual unsigned queryCount(const char *xpath) = 0;
     virtual bool updateEnvironment(IPropertyTree *newEnv, bool forceGroupUpdate, StringBuffer &response) = 0;
+    // Lists the children of xpath using an index maintained by the server (see SDS Index configuration),
+    // filtered on filterAttr==filterValue and/or sorted (by string value) on sortAttr, from and limit (0 for all) selecting a page.
+    // Each result holds the child's attributes, plus copies of any child elements named in the comma separated children list.
+    // Returns NULL if the server has no index on xpath covering the attributes, in which case the caller should scan instead.
+    virtual IPropertyTreeIterator *getIndexedElements(const char *xpath, const char *filterAttr, const char *filterValue, const char *sortAttr, bool descending, unsigned from, unsigned limit, const char *children=NULL, unsigned *total=NULL) = 0;
 };
 
 extern da_decl const char *queryNotifyHandlerName(IPropertyTree *tree);
@@ -173,6 +178,7 @@ interface ISDSManagerServer : extends ISDSManager
     virtual unsigned queryCommitMeanSize() const = 0;
     virtual void saveRequest() = 0;
     virtual bool unlock(__int64 connectionId, bool closeConn, StringBuffer &connectionInfo) = 0;
+    virtual StringBuffer &getLockWaitStats(StringBuffer &out, bool reset=false) = 0; // per xpath (without qualifiers) summary of time spent blocked on SDS locks, for a bounded number of xpaths
 };
 
 
@@ -247,6 +253,13 @@ extern da_decl unsigned querySDSLockTimeoutCount();
 
 // utility
 
+// A serialized copy of the store, taken while writes are blocked, that can be written out after they resume.
+interface IStoreSnapshot : extends IInterface
+{
+    virtual void write(IIOStream &out) = 0;
+    virtual offset_t querySize() const = 0;     // compressed size in bytes
+};
+
 interface IStoreHelper : extends IInterface
 {
     virtual StringBuffer &getDetachedDeltaName(StringBuffer &detachName) = 0;
@@ -254,6 +267,7 @@ interface IStoreHelper : extends IInterface
     virtual bool loadDeltas(IPropertyTree *root, bool *errors=NULL) = 0;
     virtual bool detachCurrentDelta() = 0;
     virtual void saveStore(IPropertyTree *root, unsigned *newEdition=NULL, bool currentEdition=false) = 0;
+    virtual void saveStoreSnapshot(IStoreSnapshot &snapshot, unsigned *newEdition=NULL) = 0;
     virtual unsigned queryCurrentEdition() = 0;
     virtual StringBuffer &getCurrentStoreFilename(StringBuffer &res, unsigned *crc=NULL) = 0;
     virtual StringBuffer &getCurrentDeltaFilename(StringBuffer &res, unsigned *crc=NULL) = 0;
@@ -261,6 +275,10 @@ interface IStoreHelper : extends IInterface
     virtual void backup(const char *filename) = 0;
     virtual StringBuffer &getPrimaryLocation(StringBuffer &location) = 0;
     virtual StringBuffer &getBackupLocation(StringBuffer &backupLocation) = 0;
+    // Until ended, deltas are also written to the edition a snapshot is being saved as (returned), so none are lost whichever edition is loaded
+    virtual unsigned beginSnapshotDeltas() = 0;
+    virtual unsigned writeDelta(StringBuffer &delta, bool &first, StringBuffer *snapshotDelta=NULL) = 0; // returns the current edition written to
+    virtual bool endSnapshotDeltas(StringBuffer *snapshotDelta=NULL) = 0; // returns true if the snapshot was committed
 };
 
 enum
@@ -269,8 +287,11 @@ enum
     SH_RecoverFromIncErrors = 0x0002,
     SH_BackupErrorFiles     = 0x0004,
     SH_CheckNewDelta        = 0x0008,
+    SH_BinaryStore          = 0x0010,
 };
 extern da_decl IStoreHelper *createStoreHelper(const char *storeName, const char *location, const char *remoteBackupLocation, unsigned configFlags, unsigned keepStores=0, unsigned delay=5000, const bool *abort=NULL);
+extern da_decl IStoreSnapshot *createStoreSnapshot(IPropertyTree &root);
+extern da_decl IPropertyTree *loadStoreFile(const char *filename); // loads an xml or binary store file
 extern da_decl bool applyXmlDeltas(IPropertyTree &root, IIOStream &stream, bool stopOnError=false);
 extern da_decl bool traceAllTransactions(); // server only
 extern da_decl bool traceSlowTransactions(unsigned thresholdMs); // server only
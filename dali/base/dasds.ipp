@@ -67,6 +67,7 @@ enum SdsCommand { DAMP_SDSCMD_CONNECT, DAMP_SDSCMD_GET, DAMP_SDSCMD_GETCHILDREN,
                   DAMP_SDSCMD_GETXPATHS, DAMP_SDSCMD_GETEXTVALUE, DAMP_SDSCMD_GETXPATHSPLUSIDS, DAMP_SDSCMD_GETXPATHSCRITERIA, DAMP_SDSCMD_GETELEMENTSRAW,
                   DAMP_SDSCMD_GETCOUNT,
                   DAMP_SDSCMD_UPDTENV,
+                  DAMP_SDSCMD_GETINDEXED,
                   DAMP_SDSCMD_MAX,
                   DAMP_SDSCMD_LAZYEXT=0x80000000
                 };
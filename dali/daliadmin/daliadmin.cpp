@@ -2109,7 +2109,9 @@ static void coalesce()
     StringBuffer storeFilename(daliDataPath);
     iStoreHelper->getCurrentStoreFilename(storeFilename);
     OUTLOG("Loading store: %s", storeFilename.str());
-    Owned<IPropertyTree> root = createPTreeFromXMLFile(storeFilename.str());
+    Owned<IPropertyTree> root = loadStoreFile(storeFilename.str());
+    if (!root)
+        throw MakeStringException(0, "Failed to load store: %s", storeFilename.str());
     OUTLOG("Loaded: %s", storeFilename.str());
 
     if (baseEdition != iStoreHelper->queryCurrentEdition())
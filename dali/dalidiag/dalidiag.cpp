@@ -63,6 +63,8 @@ void usage(const char *exe)
     printf("-permissions <logicalname> <user> <password> -- get file permissions\n");
     printf("-unlock <connection_id> [close] -- forcibly disconnect an sds lock\n"); 
     printf("                                   (use id's given by '-locks'\n");
+    printf("-lockstats [reset]  -- SDS lock contention, per xpath histogram of lock wait times\n");
+    printf("                       (optionally resetting the collected stats)\n");
     printf("-settracetransactions    -- trace dali transactions\n");
     printf("-settraceslowtransactions <millisecond-threshold> -- trace slow dali transactions\n");
     printf("-cleartracetransactions  -- stop tracing dali transactions\n");
@@ -666,6 +668,16 @@ int main(int _argc, char* argv[])
                     printf("%s", s.str());
                     break;
                 }
+                if (0 == stricmp(arg, "lockstats")) {
+                    MemoryBuffer mb;
+                    bool reset = (i+1<argc && 0==stricmp("reset", argv[i+1]));
+                    mb.append("lockstats").append(reset);
+                    getDaliDiagnosticValue(mb);
+                    StringAttr stats;
+                    mb.read(stats);
+                    printf("\n%s:\n%s",arg,stats.get());
+                    break;
+                }
                 if (0 == stricmp(arg,"save")) {
                     PROGLOG("Requesting SDS save");
                     MemoryBuffer mb;
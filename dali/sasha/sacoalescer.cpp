@@ -92,7 +92,7 @@ void coalesceDatastore(bool force)
             if (storeIFile->exists())
             {
                 PROGLOG("Loading store: %s, size=%" I64F "d", storeFilename.str(), storeIFile->size());
-                _root.setown(createPTreeFromXMLFile(storeFilename.str()));
+                _root.setown(loadStoreFile(storeFilename.str()));
                 PROGLOG("Loaded: %s", storeFilename.str());
             }
             else
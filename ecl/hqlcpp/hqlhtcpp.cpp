@@ -16466,6 +16466,71 @@ void HqlCppTranslator::buildSkewThresholdMembers(BuildCtx & ctx, IHqlExpression
     }
 }
 
+//Return the position of a field within the top level fields of the row, or NotFound if the record contains
+//anything (e.g., ifblocks or unnamed nested records) that would make the engine's field numbering differ.
+static unsigned getTopLevelFieldIndex(IHqlExpression * record, IHqlExpression * field)
+{
+    unsigned index = 0;
+    ForEachChild(i, record)
+    {
+        IHqlExpression * cur = record->queryChild(i);
+        switch (cur->getOperator())
+        {
+        case no_field:
+            if (cur->queryId() == field->queryId())
+                return index;
+            index++;
+            break;
+        case no_attr:
+        case no_attr_expr:
+        case no_attr_link:
+            break;
+        default:
+            return NotFound;
+        }
+    }
+    return NotFound;
+}
+
+//The engines can sort on a normalized prefix of the key if they know which fields of the row are being sorted on
+static void buildSortKeyFields(BuildCtx & ctx, IHqlExpression * record, const HqlExprArray & sorts, IHqlExpression * selector)
+{
+    const unsigned maxSortKeyFields = 8;            // the normalized key contains at most 8 bytes
+    StringBuffer fields, descending;
+    unsigned numFields = 0;
+    ForEachItemIn(i, sorts)
+    {
+        if (numFields == maxSortKeyFields)
+            break;
+        IHqlExpression * cur = &sorts.item(i);
+        bool isDescending = false;
+        if (cur->getOperator() == no_negate)
+        {
+            cur = cur->queryChild(0);
+            isDescending = true;
+        }
+        if ((cur->getOperator() != no_select) || (cur->queryChild(0) != selector) || isNewSelector(cur))
+            break;
+        unsigned index = getTopLevelFieldIndex(record, cur->queryChild(1));
+        if (index == NotFound)
+            break;
+        if (numFields)
+        {
+            fields.append(",");
+            descending.append(",");
+        }
+        fields.append(index);
+        descending.append(isDescending ? "true" : "false");
+        numFields++;
+    }
+
+    if (numFields)
+    {
+        ctx.addQuotedF("virtual unsigned getSortKeyFields(const unsigned * & fields, const bool * & descending) override { static const unsigned _fields[] = { %s }; static const bool _descending[] = { %s }; fields = _fields; descending = _descending; return %u; }",
+                       fields.str(), descending.str(), numFields);
+    }
+}
+
 
 ABoundActivity * HqlCppTranslator::doBuildActivitySort(BuildCtx & ctx, IHqlExpression * expr)
 {
@@ -16545,6 +16610,7 @@ ABoundActivity * HqlCppTranslator::doBuildActivitySort(BuildCtx & ctx, IHqlExpre
     sortlist->unwindList(sorts, no_sortlist);
     bool tryToSerializeKey = (actKind == TAKsort) && !isGroupedActivity(expr) && !isLocalActivity(expr) && !instance->isChildActivity();
     generateSerializeKey(instance->nestedctx, no_none, DatasetReference(dataset), sorts, tryToSerializeKey, false);
+    buildSortKeyFields(instance->classctx, record, sorts, dataset->queryNormalizedSelector());
 
     buildSkewThresholdMembers(instance->classctx, expr);
 
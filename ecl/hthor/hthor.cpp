@@ -1082,6 +1082,8 @@ void CHThorIndexWriteActivity::execute()
         buildUserMetadata(metadata);
         buildLayoutMetadata(metadata);
         unsigned nodeSize = metadata ? metadata->getPropInt("_nodeSize", NODESIZE) : NODESIZE;
+        if (metadata && metadata->getPropBool("_frontCodedLeaves"))
+            flags |= HTREE_FRONTCODED_LEAF;
         size32_t keyMaxSize = helper.queryDiskRecordSize()->getRecordSize(NULL);
         Owned<IKeyBuilder> builder = createKeyBuilder(out, flags, keyMaxSize, nodeSize, helper.getKeyedSize(), 0);
         class BcWrapper : implements IBlobCreator
@@ -3882,7 +3884,13 @@ void CHThorGroupSortActivity::createSorter()
         if((flags & TAFparallel) != 0)
             sorter.setown(new CParallelStableMergeSorter(helper.queryCompare(), queryRowManager(), InitialSortElements, CommitStep, this));
         else
-            sorter.setown(new CStableMergeSorter(helper.queryCompare(), queryRowManager(), InitialSortElements, CommitStep, this));
+        {
+            ISortKeyNormalizer * normalizer = createNormalizer();
+            if (normalizer)
+                sorter.setown(new CNormalizedMergeSorter(helper.queryCompare(), normalizer, queryRowManager(), InitialSortElements, CommitStep, this));
+            else
+                sorter.setown(new CStableMergeSorter(helper.queryCompare(), queryRowManager(), InitialSortElements, CommitStep, this));
+        }
     }
     else if(stricmp(algoname, "parmergesort") == 0)
         sorter.setown(new CParallelStableMergeSorter(helper.queryCompare(), queryRowManager(), InitialSortElements, CommitStep, this));
@@ -3908,6 +3916,18 @@ void CHThorGroupSortActivity::createSorter()
     sorter->setActivityId(activityId);
 }
 
+ISortKeyNormalizer * CHThorGroupSortActivity::createNormalizer()
+{
+    if (agent.queryWorkUnit()->getCodeVersion() < 201) // older helpers do not implement getSortKeyFields()
+        return nullptr;
+    const unsigned * fields = nullptr;
+    const bool * descending = nullptr;
+    unsigned numFields = helper.getSortKeyFields(fields, descending);
+    if (!numFields)
+        return nullptr;
+    return createSortKeyNormalizer(outputMeta.queryOriginal()->queryRecordAccessor(false), numFields, fields, descending);
+}
+
 void CHThorGroupSortActivity::getSorted()
 {
     diskMerger.clear();
@@ -4123,6 +4143,17 @@ void CStableMergeSorter::performSort()
     }
 }
 
+void CNormalizedMergeSorter::performSort()
+{
+    size32_t numRows = rowsToSort.numCommitted();
+    if (numRows)
+    {
+        const void * * rows = rowsToSort.getBlock(numRows);
+        normalizedsortvecstableinplace((void * *)rows, numRows, *compare, *normalizer, (void * *)index);
+        finger = 0;
+    }
+}
+
 void CParallelStableMergeSorter::performSort()
 {
     size32_t numRows = rowsToSort.numCommitted();
@@ -8426,6 +8457,13 @@ bool CHThorBinaryDiskReadBase::openNext()
             //in.setown(createRowCompReadSeq(*inputfileiostream, 0, fixedDiskRecordSize));
         }
 
+        if (filterRemotely && !compressed && !grouped)
+        {
+            // Only the matching rows of a remote part need cross the network, falls back to reading it all if dafilesrv is too old
+            remoteFilteredReader.setown(createRemoteFilteredFileReader(inputfileio, diskMeta->queryTypeInfo(), nullptr, this));
+            if (remoteFilteredReader)
+                return true;
+        }
         //Only one of these will actually be used.
         prefetchBuffer.setStream(inputstream);
         deserializeSource.setStream(inputstream);
@@ -8436,6 +8474,7 @@ bool CHThorBinaryDiskReadBase::openNext()
 
 void CHThorBinaryDiskReadBase::closepart()
 {
+    remoteFilteredReader.clear();
     prefetchBuffer.clearStream();
     deserializeSource.clearStream();
     CHThorDiskReadBaseActivity::closepart();
@@ -8474,6 +8513,8 @@ void CHThorDiskReadActivity::ready()
     eogPending = false;
     lastGroupProcessed = processed;
     needTransform = helper.needTransform() || segMonitors.length();
+    // Remote parts can be filtered within dafilesrv, which returns the file position of each row
+    filterRemotely = segMonitors.length() && diskMeta->queryTypeInfo() && agent.queryWorkUnit()->getDebugValueBool("remoteFilter", true);
     limit = helper.getRowLimit();
     if (helper.getFlags() & TDRlimitskips)
         limit = (unsigned __int64) -1;
@@ -8487,6 +8528,14 @@ void CHThorDiskReadActivity::stop()
     PARENT::stop(); 
 }
 
+void CHThorDiskReadActivity::onLimitExceeded()
+{
+    outBuilder.clear();
+    if ( agent.queryCodeContext()->queryDebugContext())
+        agent.queryCodeContext()->queryDebugContext()->checkBreakpoint(DebugStateLimit, NULL, static_cast<IActivityBase *>(this));
+    helper.onLimitExceeded();
+}
+
 
 const void *CHThorDiskReadActivity::nextRow()
 {
@@ -8505,7 +8554,30 @@ const void *CHThorDiskReadActivity::nextRow()
             while (!eofseen && ((stopAfter == 0) || ((processed - initialProcessed) < stopAfter)))
             {
                 queryUpdateProgress();
-                while (!prefetchBuffer.eos())
+                if (remoteFilteredReader)
+                {
+                    // rows have already been matched against the segment monitors by dafilesrv
+                    size32_t sizeRead;
+                    const void * next;
+                    while (nullptr != (next = remoteFilteredReader->nextRow(sizeRead)))
+                    {
+                        queryUpdateProgress();
+                        localOffset = remoteFilteredReader->queryRowOffset();
+                        size32_t thisSize = helper.transform(outBuilder.ensureRow(), next);
+                        if (thisSize)
+                        {
+                            if ((processed - initialProcessed) >=limit)
+                            {
+                                onLimitExceeded();
+                                return NULL;
+                            }
+                            processed++;
+                            return outBuilder.finalizeRowClear(thisSize);
+                        }
+                    }
+                    localOffset = inputfileio->size(); // so the next part's file positions follow on from this one
+                }
+                while (!remoteFilteredReader && !prefetchBuffer.eos())
                 {
                     queryUpdateProgress();
 
@@ -8530,10 +8602,7 @@ const void *CHThorDiskReadActivity::nextRow()
                             eogPending = eog;
                         if ((processed - initialProcessed) >=limit)
                         {
-                            outBuilder.clear();
-                            if ( agent.queryCodeContext()->queryDebugContext())
-                                agent.queryCodeContext()->queryDebugContext()->checkBreakpoint(DebugStateLimit, NULL, static_cast<IActivityBase *>(this));
-                            helper.onLimitExceeded();
+                            onLimitExceeded();
                             return NULL;
                         }
                         processed++;
@@ -8562,10 +8631,7 @@ const void *CHThorDiskReadActivity::nextRow()
                     localOffset += sizeRead;
                     if ((processed - initialProcessed)>=limit)
                     {
-                        outBuilder.clear();
-                        if ( agent.queryCodeContext()->queryDebugContext())
-                            agent.queryCodeContext()->queryDebugContext()->checkBreakpoint(DebugStateLimit, NULL, static_cast<IActivityBase *>(this));
-                        helper.onLimitExceeded();
+                        onLimitExceeded();
                         return NULL;
                     }
                     processed++;
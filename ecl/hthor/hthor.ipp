@@ -43,6 +43,8 @@
 #include "rtlrecord.hpp"
 #include "roxiemem.hpp"
 #include "roxierowbuff.hpp"
+#include "thorsort.hpp"
+#include "sockfile.hpp"
 
 roxiemem::IRowManager * queryRowManager();
 using roxiemem::OwnedConstRoxieRow;
@@ -1089,6 +1091,7 @@ public:
 private:
     bool sortAndSpillRows();
     void createSorter();
+    ISortKeyNormalizer * createNormalizer();
     void getSorted();
 
 protected:
@@ -1189,6 +1192,17 @@ public:
     virtual void performSort();
 };
 
+class CNormalizedMergeSorter : public CStableSorter
+{
+public:
+    CNormalizedMergeSorter(ICompare * _compare, ISortKeyNormalizer * _normalizer, roxiemem::IRowManager * _rowManager, size32_t _initialSize, size32_t _commitDelta, roxiemem::IBufferedRowCallback * _rowCB) : CStableSorter(_compare, _rowManager, _initialSize, _commitDelta, _rowCB), normalizer(_normalizer) {}
+
+    virtual void performSort();
+
+protected:
+    Owned<ISortKeyNormalizer> normalizer;
+};
+
 class CParallelStableMergeSorter : public CStableSorter
 {
 public:
@@ -2297,6 +2311,8 @@ protected:
     const RtlRecord &recInfo;
     RtlDynRow rowInfo;
     unsigned numFieldsRequired = 0;
+    bool filterRemotely = false;
+    Owned<IRemoteFilteredFileReader> remoteFilteredReader;  // rows of a remote part that matched the segment monitors within dafilesrv
 public:
     CHThorBinaryDiskReadBase(IAgentContext &agent, unsigned _activityId, unsigned _subgraphId, IHThorDiskReadBaseArg &_arg, IHThorCompoundBaseArg & _segHelper, ThorActivityKind _kind);
 
@@ -2349,6 +2365,7 @@ protected:
     unsigned __int64 limit;
     unsigned __int64 stopAfter;
 
+    void onLimitExceeded();
 public:
     CHThorDiskReadActivity(IAgentContext &agent, unsigned _activityId, unsigned _subgraphId, IHThorDiskReadArg &_arg, ThorActivityKind _kind);
 
@@ -103,7 +103,7 @@
       <xsl:element name="SDS">
         <xsl:attribute name="store">dalisds.xml</xsl:attribute>
         <xsl:attribute name="caseInsensitive">0</xsl:attribute>
-        <xsl:copy-of select="@recoverFromIncErrors |@snmpSendWarnings | @enableSNMP | @enableSysLog | @snmpErrorMsgLevel | @msgLevel | @lightweightCoalesce | @keepStores | @backupLargeWarningThreshold | @backupSoftQueueLimit | @backupSoftQueueLimitDelay"/>
+        <xsl:copy-of select="@recoverFromIncErrors |@snmpSendWarnings | @enableSNMP | @enableSysLog | @snmpErrorMsgLevel | @msgLevel | @lightweightCoalesce | @keepStores | @storeFormat | @notifyPoolSize | @notifyCoalesceWindow | @notifyQueueLimit | @backupLargeWarningThreshold | @backupSoftQueueLimit | @backupSoftQueueLimitDelay"/>
         <xsl:if test="string(@IdlePeriod) != ''">
             <xsl:attribute name="lCIdlePeriod">
                 <xsl:value-of select="@IdlePeriod"/>
@@ -152,6 +152,7 @@
           </xsl:attribute>
         </xsl:if>
         <xsl:copy-of select="@asyncBackup | @useNFSBackupMount"/>
+        <xsl:copy-of select="Index"/>
       </xsl:element>
       <DFS>
       <xsl:copy-of select="@forceGroupUpdate | @numThreads"/>
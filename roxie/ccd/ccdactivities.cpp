@@ -4675,6 +4675,43 @@ class CRoxieKeyedJoinIndexActivity : public CRoxieKeyedActivity
     unsigned candidateCount;
     unsigned keepCount;
     unsigned inputDone;
+    unsigned prefetchedTo;
+
+    void prefetchRows(const CachedOutputMetaData &inputFields)
+    {
+        // Queue the lookups for all the following rows on the same part, so that the index nodes they need are
+        // read together (in file order, overlapped) rather than one at a time as each row is processed
+        createSegmentMonitors();
+        unsigned done = inputDone;
+        const char *data = inputData;
+        while (done < inputLength)
+        {
+            const PartNoType &partNo = *(const PartNoType *) data;
+            if (partNo.partNo != lastPartNo.partNo || partNo.fileNo != lastPartNo.fileNo)
+                break;
+            const char *inputRow = data + sizeof(PartNoType) + sizeof(const void *);
+            unsigned inputSize = inputFields.getFixedSize();
+            done += sizeof(PartNoType) + sizeof(const void *);
+            if (inputFields.isVariableSize())
+            {
+                inputSize = *(const unsigned *) inputRow;
+                inputRow += sizeof(unsigned);
+                done += sizeof(unsigned);
+            }
+            helper->createSegmentMonitors(tlk, inputRow);
+            if (rootIndex)
+                rootIndex->mergeSegmentMonitors(tlk);
+            tlk->finishSegmentMonitors();
+            tlk->queuePrefetch();
+            tlk->releaseSegmentMonitors();
+            data = inputRow + inputSize;
+            done += inputSize;
+        }
+        prefetchedTo = done;
+        unsigned nodesRead = tlk->prefetchLeaves();
+        if (logctx.queryTraceLevel() > 10)
+            logctx.CTXLOG("Prefetched %u index nodes", nodesRead);
+    }
 
 public:
     CRoxieKeyedJoinIndexActivity(SlaveContextLogger &_logctx, IRoxieQueryPacket *_packet, HelperFactory *_hFactory, const CRoxieKeyedJoinIndexActivityFactory *_aFactory)
@@ -4683,6 +4720,7 @@ public:
         helper = (IHThorKeyedJoinArg *) basehelper;
         variableFileName = allFilesDynamic || basefactory->queryQueryFactory().isDynamic() || ((helper->getJoinFlags() & (JFvarindexfilename|JFdynamicindexfilename|JFindexfromactivity)) != 0);
         inputDone = 0;
+        prefetchedTo = 0;
         processed = 0;
         candidateCount = 0;
         keepCount = 0;
@@ -4818,6 +4856,8 @@ IMessagePacker *CRoxieKeyedJoinIndexActivity::process()
         }
         if (tlk)
         {
+            if (keyPrefetchReaders && !resent && inputDone >= prefetchedTo)
+                prefetchRows(inputFields);
             createSegmentMonitors();
 
             helper->createSegmentMonitors(tlk, inputRow);
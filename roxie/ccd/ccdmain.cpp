@@ -39,6 +39,7 @@
 #include "ccdlistener.hpp"
 #include "ccdsnmp.hpp"
 #include "thorplugin.hpp"
+#include "thorstrand.hpp"
 
 #if defined (__linux__)
 #include <sys/syscall.h>
@@ -745,12 +746,15 @@ int STARTQUERY_API start_query(int argc, const char *argv[])
         linuxYield = topology->getPropBool("@linuxYield", false);
         traceSmartStepping = topology->getPropBool("@traceSmartStepping", false);
         useMemoryMappedIndexes = topology->getPropBool("@useMemoryMappedIndexes", false);
+        useNodeSearchPrefixes = topology->getPropBool("@useNodeSearchPrefixes", false);
+        keyPrefetchReaders = topology->getPropInt("@keyPrefetchReaders", 0);
         flushJHtreeCacheOnOOM = topology->getPropBool("@flushJHtreeCacheOnOOM", true);
         fastLaneQueue = topology->getPropBool("@fastLaneQueue", true);
         udpOutQsPriority = topology->getPropInt("@udpOutQsPriority", 0);
         udpSnifferEnabled = topology->getPropBool("@udpSnifferEnabled", true);
         udpInlineCollation = topology->getPropBool("@udpInlineCollation", false);
         udpInlineCollationPacketLimit = topology->getPropInt("@udpInlineCollationPacketLimit", 50);
+        udpReceiveBatchSize = topology->getPropInt("@udpReceiveBatchSize", 1);
         udpSendCompletedInData = topology->getPropBool("@udpSendCompletedInData", false);
         udpRetryBusySenders = topology->getPropInt("@udpRetryBusySenders", 0);
 
@@ -824,6 +828,7 @@ int STARTQUERY_API start_query(int argc, const char *argv[])
         defaultPrefetchProjectPreload = topology->getPropInt("@defaultPrefetchProjectPreload", 10);
         defaultStrandBlockSize = topology->getPropInt("@defaultStrandBlockSize", 512);
         defaultForceNumStrands = topology->getPropInt("@defaultForceNumStrands", 0);
+        setStrandThreadLimit(topology->getPropInt("@strandThreadLimit", 0));
         defaultCheckingHeap = topology->getPropBool("@checkingHeap", false);  // NOTE - not in configmgr - too dangerous!
 
         slaveQueryReleaseDelaySeconds = topology->getPropInt("@slaveQueryReleaseDelaySeconds", 60);
@@ -851,6 +856,7 @@ int STARTQUERY_API start_query(int argc, const char *argv[])
         bool retainMemory = topology->getPropBool("@heapRetainMemory", false);
         if (!totalMemoryLimit)
             totalMemoryLimit = 1024 * 0x100000;  // 1 Gb;
+        roxiemem::setHeapNumaNodes(topology->getPropInt("@heapNumaNodes", 1));
         roxiemem::setTotalMemoryLimit(allowHugePages, allowTransparentHugePages, retainMemory, totalMemoryLimit, 0, NULL, NULL);
 
         traceStartStop = topology->getPropBool("@traceStartStop", false);
@@ -902,6 +908,7 @@ int STARTQUERY_API start_query(int argc, const char *argv[])
         serverSideCacheSize = topology->getPropInt("@serverSideCacheSize", 0);
 
         setKeyIndexCacheSize((unsigned)-1); // unbound
+        setNodeCacheShards(topology->getPropInt("@nodeCacheShards", DEFAULT_NODE_CACHE_SHARDS)); // must precede any other node cache settings
         nodeCachePreload = topology->getPropBool("@nodeCachePreload", false);
         setNodeCachePreload(nodeCachePreload);
         nodeCacheMB = topology->getPropInt("@nodeCacheMem", 100); 
@@ -910,6 +917,9 @@ int STARTQUERY_API start_query(int argc, const char *argv[])
         setLeafCacheMem(leafCacheMB * 0x100000);
         blobCacheMB = topology->getPropInt("@blobCacheMem", 0);
         setBlobCacheMem(blobCacheMB * 0x100000);
+        setNodeCachePolicy(getNodeCachePolicy(topology->queryProp("@nodeCachePolicy")));
+        setLeafCachePolicy(getNodeCachePolicy(topology->queryProp("@leafCachePolicy")));
+        setBlobCachePolicy(getNodeCachePolicy(topology->queryProp("@blobCachePolicy")));
 
         unsigned __int64 affinity = topology->getPropInt64("@affinity", 0);
         updateAffinity(affinity);
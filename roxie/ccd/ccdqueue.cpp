@@ -48,6 +48,7 @@ static bool suspendedChannels[MAX_CLUSTER_SIZE];
 
 using roxiemem::OwnedRoxieRow;
 using roxiemem::OwnedConstRoxieRow;
+using roxiemem::ReleaseRoxieRowRange;
 using roxiemem::IRowManager;
 using roxiemem::DataBuffer;
 
@@ -2250,6 +2251,8 @@ public:
 interface ILocalMessageCollator : extends IMessageCollator
 {
     virtual void enqueueMessage(bool outOfBand, void *data, unsigned datalen, void *meta, unsigned metalen, void *header, unsigned headerlen) = 0;
+    virtual void enqueueRows(bool outOfBand, IRowManager *rowManager, ConstPointerArray &rows, UnsignedArray &rowLengths, unsigned datalen, void *meta, unsigned metalen, void *header, unsigned headerlen) = 0;
+    virtual IRowManager *queryRowManager() const = 0;
 };
 
 interface ILocalReceiveManager : extends IReceiveManager
@@ -2259,11 +2262,22 @@ interface ILocalReceiveManager : extends IReceiveManager
 
 
 
+// Rows are built directly in memory allocated from the collator's row manager, and passed to it as they are,
+// rather than being copied into a message buffer and copied out again by the unpack cursor.
+// The rows are still in their serialized form, so the reader sees exactly what a remote slave would have sent.
+// The row manager belongs to the server query, so the slave only allocates from it if that does not need any of the
+// server's activities to free memory (their callbacks must not run on a slave thread). Otherwise the reply falls back
+// to a message buffer, and the server allocates as it reads it, under its own memory limits.
 class LocalMessagePacker : public CDummyMessagePacker
 {
     MemoryBuffer meta;
     MemoryBuffer header;
     Linked<ILocalReceiveManager> rm;
+    Linked<IRowManager> rowManager;
+    ConstPointerArray rows;             // NULL entries are the length prefixes of variable size rows
+    UnsignedArray rowLengths;
+    void *pendingRow;
+    unsigned pendingCapacity;
     ruid_t id;
     bool outOfBand;
 
@@ -2273,6 +2287,62 @@ public:
     {
         id = _header.uid;
         header.append(sizeof(RoxiePacketHeader), &_header);
+        pendingRow = NULL;
+        pendingCapacity = 0;
+        Owned<ILocalMessageCollator> collator = rm->lookupCollator(id);
+        if (collator)
+            rowManager.set(collator->queryRowManager());
+    }
+
+    ~LocalMessagePacker()
+    {
+        ReleaseRoxieRow(pendingRow);
+        ReleaseRoxieRowRange(rows.getArray(), 0, rows.ordinality());
+    }
+
+    virtual void *getBuffer(unsigned len, bool variable)
+    {
+        if (rowManager)
+        {
+            // A buffer that was not put is discarded, so can be reused
+            if (pendingRow && (len <= pendingCapacity))
+                return pendingRow;
+            ReleaseRoxieRow(pendingRow);
+            pendingRow = NULL;
+            try
+            {
+                const unsigned maxSpillCost = 0; // never call back into the server's activities
+                pendingRow = rowManager->allocate(len ? len : 1, 0, maxSpillCost);
+                pendingCapacity = len;
+                return pendingRow;
+            }
+            catch (IException *E)
+            {
+                E->Release();
+                switchToBuffer();
+            }
+        }
+        return CDummyMessagePacker::getBuffer(len, variable);
+    }
+
+    virtual void putBuffer(const void *buf, unsigned len, bool variable)
+    {
+        if (!rowManager)
+        {
+            CDummyMessagePacker::putBuffer(buf, len, variable);
+            return;
+        }
+        assertex(buf == pendingRow && len <= pendingCapacity);
+        if (variable)
+        {
+            rows.append(NULL);
+            rowLengths.append(len);
+            lastput += sizeof(RecordLengthType);
+        }
+        rows.append(pendingRow);
+        rowLengths.append(len);
+        lastput += len;
+        pendingRow = NULL;
     }
 
     virtual void flush(bool last_message);
@@ -2282,6 +2352,25 @@ public:
         meta.append(len, buf);
     }
 
+protected:
+    void switchToBuffer()
+    {
+        // Copy the rows that have already been put, so the whole reply is sent in the buffer
+        ForEachItemIn(idx, rows)
+        {
+            const void *row = rows.item(idx);
+            RecordLengthType len = rowLengths.item(idx);
+            if (row)
+                data.append(len, row);
+            else
+                data.append(len);
+        }
+        assertex(data.length() == lastput);
+        ReleaseRoxieRowRange(rows.getArray(), 0, rows.ordinality());
+        rows.kill();
+        rowLengths.kill();
+        rowManager.clear();
+    }
 };
 
 class CLocalMessageUnpackCursor : implements IMessageUnpackCursor, public CInterface
@@ -2329,6 +2418,153 @@ public:
     }
 };
 
+class CLocalRowMessageUnpackCursor : implements IMessageUnpackCursor, public CInterface
+{
+    ConstPointerArray rows;
+    UnsignedArray rowLengths;
+    unsigned cur;
+    unsigned offset;  // within rows[cur], only if reads do not line up with the rows that were written
+    Linked<IRowManager> rowManager;
+    Linked<IRowManager> rowsManager; // that the rows were allocated from
+public:
+    IMPLEMENT_IINTERFACE;
+    CLocalRowMessageUnpackCursor(IRowManager *_rowManager, IRowManager *_rowsManager, ConstPointerArray &_rows, UnsignedArray &_rowLengths)
+        : rowManager(_rowManager), rowsManager(_rowsManager)
+    {
+        rows.swapWith(_rows);
+        rowLengths.swapWith(_rowLengths);
+        cur = 0;
+        offset = 0;
+    }
+
+    ~CLocalRowMessageUnpackCursor()
+    {
+        ReleaseRoxieRowRange(rows.getArray(), cur, rows.ordinality());
+    }
+
+    virtual bool atEOF() const
+    {
+        return cur==rows.ordinality();
+    }
+
+    virtual bool isSerialized() const
+    {
+        return true;
+    }
+
+    virtual const void * getNext(int length)
+    {
+        if (atEOF())
+            return NULL;
+        const void *row = rows.item(cur);
+        if (!offset)
+        {
+            if (row && ((unsigned) length == rowLengths.item(cur)))
+            {
+                cur++;
+                return row; // NB: ownership passes to the caller
+            }
+            if (!row && (length == sizeof(RecordLengthType)))
+            {
+                RecordLengthType *ret = (RecordLengthType *) rowManager->allocate(sizeof(RecordLengthType), 0);
+                *ret = rowLengths.item(cur++);
+                return ret;
+            }
+        }
+        byte *ret = (byte *) rowManager->allocate(length, 0);
+        unsigned copied = 0;
+        while (copied < (unsigned) length)
+        {
+            assertex(!atEOF());
+            RecordLengthType prefix;
+            const byte *src;
+            unsigned avail;
+            row = rows.item(cur);
+            if (row)
+            {
+                src = (const byte *) row;
+                avail = rowLengths.item(cur);
+            }
+            else
+            {
+                prefix = rowLengths.item(cur);
+                src = (const byte *) &prefix;
+                avail = sizeof(RecordLengthType);
+            }
+            unsigned size = avail - offset;
+            if (size > length - copied)
+                size = length - copied;
+            memcpy(ret + copied, src + offset, size);
+            copied += size;
+            offset += size;
+            if (offset == avail)
+            {
+                ReleaseRoxieRow(row);
+                cur++;
+                offset = 0;
+            }
+        }
+        //No need for finalize since only contains plain data.
+        return ret;
+    }
+};
+
+class CLocalRowMessageResult : implements IMessageResult, public CInterface
+{
+    Linked<IRowManager> rowManager; // that the rows were allocated from
+    mutable ConstPointerArray rows;
+    mutable UnsignedArray rowLengths;
+    mutable bool cursorCreated;
+    void *meta;
+    void *header;
+    unsigned metalen, headerlen;
+public:
+    IMPLEMENT_IINTERFACE;
+    CLocalRowMessageResult(IRowManager *_rowManager, ConstPointerArray &_rows, UnsignedArray &_rowLengths, void *_meta, unsigned _metalen, void *_header, unsigned _headerlen)
+        : rowManager(_rowManager)
+    {
+        rows.swapWith(_rows);
+        rowLengths.swapWith(_rowLengths);
+        cursorCreated = false;
+        metalen = _metalen;
+        headerlen = _headerlen;
+        meta = _meta;
+        header = _header;
+    }
+
+    ~CLocalRowMessageResult()
+    {
+        ReleaseRoxieRowRange(rows.getArray(), 0, rows.ordinality());
+        free(meta);
+        free(header);
+    }
+
+    virtual IMessageUnpackCursor *getCursor(IRowManager *rowMgr) const
+    {
+        // NB: the rows are handed over to the cursor rather than copied, so a result can only be read once
+        // (as is the case for all callers)
+        assertex(!cursorCreated);
+        cursorCreated = true;
+        return new CLocalRowMessageUnpackCursor(rowMgr, rowManager, rows, rowLengths);
+    }
+
+    virtual const void *getMessageHeader(unsigned &length) const
+    {
+        length = headerlen;
+        return header;
+    }
+
+    virtual const void *getMessageMetadata(unsigned &length) const
+    {
+        length = metalen;
+        return meta;
+    }
+
+    virtual void discard() const
+    {
+    }
+};
+
 class CLocalMessageResult : implements IMessageResult, public CInterface
 {
     void *data;
@@ -2388,6 +2624,7 @@ class CLocalMessageCollator : implements ILocalMessageCollator, public CInterfac
     Linked<ILocalReceiveManager> receiveManager;
     ruid_t id;
     unsigned totalBytesReceived;
+    unsigned totalBytesCopyAvoided;
 
 public:
     IMPLEMENT_IINTERFACE;
@@ -2430,10 +2667,32 @@ public:
         totalBytesReceived += datalen + metalen + headerlen;
     }
 
+    virtual void enqueueRows(bool outOfBand, IRowManager *rowsManager, ConstPointerArray &rows, UnsignedArray &rowLengths, unsigned datalen, void *meta, unsigned metalen, void *header, unsigned headerlen)
+    {
+        CriticalBlock c(crit);
+        if (outOfBand)
+            pending.enqueueHead(new CLocalRowMessageResult(rowsManager, rows, rowLengths, meta, metalen, header, headerlen));
+        else
+            pending.enqueue(new CLocalRowMessageResult(rowsManager, rows, rowLengths, meta, metalen, header, headerlen));
+        sem.signal();
+        totalBytesReceived += datalen + metalen + headerlen;
+        totalBytesCopyAvoided += datalen;
+    }
+
+    virtual IRowManager *queryRowManager() const
+    {
+        return rowManager;
+    }
+
     virtual unsigned queryBytesReceived() const
     {
         return totalBytesReceived;
     }
+
+    virtual unsigned queryBytesCopyAvoided() const
+    {
+        return totalBytesCopyAvoided;
+    }
 };
 
 class RoxieLocalReceiveManager : implements ILocalReceiveManager, public CInterface
@@ -2483,16 +2742,22 @@ public:
 
 void LocalMessagePacker::flush(bool last_message)
 {
-    data.setLength(lastput);
+    if (!rowManager)
+        data.setLength(lastput);
     if (last_message)
     {
         Owned<ILocalMessageCollator> collator = rm->lookupCollator(id);
         if (collator)
         {
-            unsigned datalen = data.length();
             unsigned metalen = meta.length();
             unsigned headerlen = header.length();
-            collator->enqueueMessage(outOfBand, data.detach(), datalen, meta.detach(), metalen, header.detach(), headerlen);
+            if (rowManager)
+                collator->enqueueRows(outOfBand, rowManager, rows, rowLengths, lastput, meta.detach(), metalen, header.detach(), headerlen);
+            else
+            {
+                unsigned datalen = data.length();
+                collator->enqueueMessage(outOfBand, data.detach(), datalen, meta.detach(), metalen, header.detach(), headerlen);
+            }
         }
         // otherwise Roxie server is no longer interested and we can simply discard
     }
@@ -2502,6 +2767,7 @@ CLocalMessageCollator::CLocalMessageCollator(IRowManager *_rowManager, ruid_t _r
     : rowManager(_rowManager), id(_ruid)
 {
     totalBytesReceived = 0;
+    totalBytesCopyAvoided = 0;
 }
 
 CLocalMessageCollator::~CLocalMessageCollator()
@@ -2889,3 +3155,171 @@ extern void stopPingTimer()
     }
 }
 
+
+//================================================================================================================
+
+#ifdef _USE_CPPUNIT
+#include "unittests.hpp"
+
+class LocalMessageTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(LocalMessageTest);
+        CPPUNIT_TEST(testSetup);
+        CPPUNIT_TEST(testAligned);
+        CPPUNIT_TEST(testCopied);
+        CPPUNIT_TEST(testBufferFallback);
+        CPPUNIT_TEST(testCleanup);
+    CPPUNIT_TEST_SUITE_END();
+protected:
+    class CountingCallback : public roxiemem::IBufferedRowCallback
+    {
+    public:
+        unsigned calls = 0;
+        virtual unsigned getSpillCost() const { return 10; }
+        virtual unsigned getActivityId() const { return 1; }
+        virtual bool freeBufferedRows(bool critical) { calls++; return false; }
+    };
+
+    void testSetup()
+    {
+        roxiemem::setTotalMemoryLimit(false, true, false, 20 * 1024 * 1024, 0, NULL, NULL);
+    }
+
+    void testCleanup()
+    {
+        roxiemem::releaseRoxieHeap();
+    }
+
+    // Three fixed size rows of two unsigneds, then three variable size rows of 'a'..'c', each preceded by a length.
+    // If bigSize is set, the buffer for the last row is requested with that size.
+    unsigned sendReply(RoxieLocalReceiveManager *rm, ruid_t ruid, unsigned bigSize = 0)
+    {
+        RemoteActivityId remoteId(1, 0);
+        RoxiePacketHeader header(remoteId, ruid, 0, 0);
+        Owned<IMessagePacker> packer = new LocalMessagePacker(header, false, rm);
+        for (unsigned i = 0; i < 3; i++)
+        {
+            unsigned *row = (unsigned *) packer->getBuffer(2*sizeof(unsigned), false);
+            row[0] = i;
+            row[1] = i*10;
+            packer->putBuffer(row, 2*sizeof(unsigned), false);
+        }
+        packer->getBuffer(100, false); // not put, so discarded
+        for (unsigned j = 0; j < 3; j++)
+        {
+            unsigned len = j+1;
+            char *row = (char *) packer->getBuffer((bigSize && (j == 2)) ? bigSize : len, true);
+            memset(row, 'a'+j, len);
+            packer->putBuffer(row, len, true);
+        }
+        packer->flush(true);
+        return packer->size();
+    }
+    void checkFixed(IMessageUnpackCursor *mu, unsigned i)
+    {
+        const unsigned *row = (const unsigned *) mu->getNext(2*sizeof(unsigned));
+        ASSERT(row);
+        ASSERT(row[0] == i && row[1] == i*10);
+        ReleaseRoxieRow(row);
+    }
+    void checkVariable(const char *row, unsigned j)
+    {
+        ASSERT(row);
+        for (unsigned k = 0; k <= j; k++)
+            ASSERT(row[k] == 'a'+(char)j);
+    }
+    void checkAligned(IMessageUnpackCursor *mu)
+    {
+        for (unsigned i = 0; i < 3; i++)
+            checkFixed(mu, i);
+        for (unsigned j = 0; j < 3; j++)
+        {
+            OwnedConstRoxieRow len = mu->getNext(sizeof(RecordLengthType));
+            ASSERT(len && *(const RecordLengthType *) len.get() == j+1);
+            OwnedConstRoxieRow row = mu->getNext(j+1);
+            checkVariable((const char *) row.get(), j);
+        }
+        ASSERT(mu->atEOF());
+        ASSERT(!mu->getNext(1));
+    }
+
+    void testAligned()
+    {
+        Owned<RoxieLocalReceiveManager> rm = new RoxieLocalReceiveManager;
+        Owned<IRowManager> rowManager = roxiemem::createRowManager(0, NULL, queryDummyContextLogger(), NULL);
+        Owned<IMessageCollator> collator = rm->createMessageCollator(rowManager, 1);
+        unsigned size = sendReply(rm, 1);
+        ASSERT(size == 3*2*sizeof(unsigned) + 3*sizeof(RecordLengthType) + 1+2+3);
+        ASSERT(collator->queryBytesCopyAvoided() == size);
+        bool anyActivity;
+        Owned<IMessageResult> mr = collator->getNextResult(0, anyActivity);
+        ASSERT(mr);
+        Owned<IMessageUnpackCursor> mu = mr->getCursor(rowManager);
+        ASSERT(mu->isSerialized());
+        checkAligned(mu);
+        rm->detachCollator(collator);
+    }
+
+    void testCopied()
+    {
+        Owned<RoxieLocalReceiveManager> rm = new RoxieLocalReceiveManager;
+        Owned<IRowManager> rowManager = roxiemem::createRowManager(0, NULL, queryDummyContextLogger(), NULL);
+        Owned<IMessageCollator> collator = rm->createMessageCollator(rowManager, 2);
+        sendReply(rm, 2);
+        bool anyActivity;
+        Owned<IMessageResult> mr = collator->getNextResult(0, anyActivity);
+        ASSERT(mr);
+        Owned<IMessageUnpackCursor> mu = mr->getCursor(rowManager);
+        // Reads that do not line up with the rows that were written are copied
+        for (unsigned i = 0; i < 3; i++)
+        {
+            OwnedConstRoxieRow first = mu->getNext(sizeof(unsigned));
+            OwnedConstRoxieRow second = mu->getNext(sizeof(unsigned));
+            ASSERT(*(const unsigned *) first.get() == i && *(const unsigned *) second.get() == i*10);
+        }
+        for (unsigned j = 0; j < 3; j++)
+        {
+            OwnedConstRoxieRow row = mu->getNext(sizeof(RecordLengthType) + j+1);
+            ASSERT(*(const RecordLengthType *) row.get() == j+1);
+            checkVariable((const char *) row.get() + sizeof(RecordLengthType), j);
+        }
+        ASSERT(mu->atEOF());
+        // The rows have been handed over to the cursor
+        try
+        {
+            Owned<IMessageUnpackCursor> again = mr->getCursor(rowManager);
+            CPPUNIT_FAIL("A local row result should only be read once");
+        }
+        catch (IException *E)
+        {
+            E->Release();
+        }
+        rm->detachCollator(collator);
+    }
+
+    void testBufferFallback()
+    {
+        Owned<RoxieLocalReceiveManager> rm = new RoxieLocalReceiveManager;
+        Owned<IRowManager> rowManager = roxiemem::createRowManager(1, NULL, queryDummyContextLogger(), NULL);
+        CountingCallback callback;
+        rowManager->addRowBuffer(&callback);
+        Owned<IMessageCollator> collator = rm->createMessageCollator(rowManager, 3);
+        // A row bigger than the server's memory limit switches the reply (including the rows already put) to a buffer,
+        // without calling back into the server
+        sendReply(rm, 3, 2*HEAP_ALIGNMENT_SIZE);
+        ASSERT(callback.calls == 0);
+        ASSERT(collator->queryBytesCopyAvoided() == 0);
+        bool anyActivity;
+        Owned<IMessageResult> mr = collator->getNextResult(0, anyActivity);
+        ASSERT(mr);
+        Owned<IMessageUnpackCursor> mu = mr->getCursor(rowManager);
+        checkAligned(mu);
+        rowManager->removeRowBuffer(&callback);
+        rm->detachCollator(collator);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LocalMessageTest );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( LocalMessageTest, "LocalMessageTest" );
+
+#endif
@@ -4400,7 +4400,12 @@ public:
         merger.reset();
         pending.kill();
         if (mc && ctx)
+        {
             ctx->addSlavesReplyLen(mc->queryBytesReceived());
+            unsigned copyAvoided = mc->queryBytesCopyAvoided();
+            if (copyAvoided)
+                ctx->noteStatistic(StSizeReplyCopyAvoided, copyAvoided);
+        }
         mc.clear(); // Or we won't free memory for graphs that get recreated
         mu.clear(); //ditto
         deferredStart = false;
@@ -12101,6 +12106,8 @@ public:
             buildUserMetadata(metadata);
             buildLayoutMetadata(metadata);
             unsigned nodeSize = metadata ? metadata->getPropInt("_nodeSize", NODESIZE) : NODESIZE;
+            if (metadata && metadata->getPropBool("_frontCodedLeaves"))
+                flags |= HTREE_FRONTCODED_LEAF;
             Owned<IKeyBuilder> builder = createKeyBuilder(out, flags, maxDiskRecordSize, nodeSize, helper.getKeyedSize(), 0);
             class BcWrapper : implements IBlobCreator
             {
@@ -32,6 +32,7 @@
 # if defined(__linux__)
    // MADV_HUGEPAGE on CentOS
 #  include <linux/mman.h>
+#  include <sys/syscall.h>
 # endif
 #endif
 
@@ -174,6 +175,10 @@ static unsigned __int64 statsCyclesInterval;
 static std::atomic<unsigned> activeRowManagers;
 
 static unsigned heapAllocated;
+static unsigned requestedNumaNodes = 1;
+static unsigned heapNumaNodes = 1;          // The heap is split into a contiguous range of bitmap entries for each NUMA node
+static unsigned heapNumaBlocksPerNode;
+static unsigned * heapNumaLWM;              // Low water mark within each NUMA node's range of the bitmap
 static std::atomic_uint dataBufferPages;
 static std::atomic_uint dataBuffersActive;
 
@@ -204,6 +209,26 @@ inline VALUE_TYPE align_pow2(VALUE_TYPE value, ALIGN_TYPE alignment)
 
 #define PAGES(x, alignment)    (((x) + ((alignment)-1)) / (alignment))           // hope the compiler converts to a shift
 
+const unsigned anyNumaNode = (unsigned)-1;
+const unsigned maxNumaNodes = 256;
+
+inline unsigned heapNumaNodeStart(unsigned node)
+{
+    return node * heapNumaBlocksPerNode;
+}
+
+inline unsigned heapNumaNodeEnd(unsigned node)
+{
+    return (node+1 == heapNumaNodes) ? heapBitmapSize : (node+1) * heapNumaBlocksPerNode;
+}
+
+//Which NUMA node does this entry in the heap bitmap belong to?
+inline unsigned getHeapNumaNode(unsigned wordOffset)
+{
+    unsigned node = wordOffset / heapNumaBlocksPerNode;
+    return (node < heapNumaNodes) ? node : heapNumaNodes-1;
+}
+
 inline void notifyMemoryUnused(void * address, memsize_t size)
 {
 #ifdef NOTIFY_UNUSED_PAGES_ON_FREE
@@ -222,6 +247,39 @@ typedef MapBetween<unsigned, unsigned, memsize_t, memsize_t> MapActivityToMemsiz
 
 static CriticalSection heapBitCrit;
 
+//Split the heap between the NUMA nodes, and ask the OS to place each section of the heap on the corresponding node.
+//Only a preferred policy is used so that a node's section can still be used if the node itself runs out of memory.
+static void initializeNumaNodes()
+{
+    unsigned numNodes = requestedNumaNodes ? requestedNumaNodes : getNumNumaNodes();
+    if (numNodes > maxNumaNodes)
+        numNodes = maxNumaNodes;
+    if (numNodes > heapBitmapSize)
+        numNodes = heapBitmapSize;
+
+    heapNumaNodes = (numNodes > 1) ? numNodes : 1;
+    heapNumaBlocksPerNode = heapBitmapSize / heapNumaNodes;
+    if (heapNumaNodes == 1)
+        return;
+
+    heapNumaLWM = new unsigned [heapNumaNodes];
+    for (unsigned node = 0; node < heapNumaNodes; node++)
+    {
+        heapNumaLWM[node] = heapNumaNodeStart(node);
+#if defined(__linux__) && defined(SYS_mbind)
+        const int mpolPreferred = 1; // MPOL_PREFERRED from numaif.h
+        const unsigned bitsPerMask = sizeof(unsigned long) * 8;
+        unsigned long nodeMask[maxNumaNodes / bitsPerMask] = { 0 };
+        nodeMask[node / bitsPerMask] = 1UL << (node % bitsPerMask);
+        char * start = heapBase + heapNumaNodeStart(node) * heapBlockSize;
+        memsize_t len = (heapNumaNodeEnd(node) - heapNumaNodeStart(node)) * heapBlockSize;
+        if (syscall(SYS_mbind, start, len, mpolPreferred, nodeMask, maxNumaNodes, 0) != 0)
+            DBGLOG("RoxieMemMgr: Failed to bind heap memory to NUMA node %u (error %d)", node, errno);
+#endif
+    }
+    DBGLOG("RoxieMemMgr: Heap split between %u NUMA nodes", heapNumaNodes);
+}
+
 static void initializeHeap(bool allowHugePages, bool allowTransparentHugePages, bool retainMemory, memsize_t pages, memsize_t largeBlockGranularity, ILargeMemCallback * largeBlockCallback)
 {
     if (heapBase) return;
@@ -379,6 +437,7 @@ static void initializeHeap(bool allowHugePages, bool allowTransparentHugePages,
     heapLargeBlocks = 1;
     heapLWM = 0;
     heapHWM = heapBitmapSize;
+    initializeNumaNodes();
 
     if (memTraceLevel)
         DBGLOG("RoxieMemMgr: %u Pages successfully allocated for the pool - memsize=%" I64F "u base=%p alignment=%" I64F "u bitmapSize=%u", 
@@ -421,6 +480,9 @@ extern void releaseRoxieHeap()
         heapEnd = NULL;
         heapBitmapSize = 0;
         heapTotalPages = 0;
+        delete [] heapNumaLWM;
+        heapNumaLWM = NULL;
+        heapNumaNodes = 1;
     }
 }
 
@@ -601,7 +663,20 @@ static void throwGlobalHeapExhausted(unsigned allocatorId, unsigned newPages, un
     throw MakeStringExceptionDirect(ROXIEMM_MEMORY_POOL_EXHAUSTED, msg.str());
 }
 
-static void *suballoc_aligned(size32_t pages, bool returnNullWhenExhausted)
+//Must be called inside heapBitCrit, and heapBitmap[i] must have at least one free page
+static inline char * allocateBitmapPage(unsigned i)
+{
+    heap_t hbi = heapBitmap[i];
+    const unsigned pos = countTrailingUnsetBits(hbi);
+    const heap_t mask = ((heap_t)1U) << pos;
+    const unsigned match = i*HEAP_BITS + pos;
+    heapBitmap[i] = hbi & ~mask;
+    heapAllocated++;
+    return heapBase + match*HEAP_ALIGNMENT_SIZE;
+}
+
+//If numaNode is specified single pages are allocated from that node's section of the heap when possible
+static void *suballoc_aligned(size32_t pages, bool returnNullWhenExhausted, unsigned numaNode = anyNumaNode)
 {
     //It would be tempting to make this lock free and use cas, but on reflection I suspect it will perform worse.
     //The problem is allocating multiple pages which fit into two unsigneds.  Because they can't be covered by a
@@ -653,23 +728,38 @@ static void *suballoc_aligned(size32_t pages, bool returnNullWhenExhausted)
 
     if (pages == 1)
     {
+        if (numaNode < heapNumaNodes && heapNumaLWM)
+        {
+            const unsigned end = heapNumaNodeEnd(numaNode);
+            unsigned i;
+            for (i = heapNumaLWM[numaNode]; i < end; i++)
+            {
+                if (heapBitmap[i])
+                {
+                    char *ret = allocateBitmapPage(i);
+                    //If no more free pages in this mask increment the low water mark
+                    if (heapBitmap[i] == 0)
+                        i++;
+                    heapNumaLWM[numaNode] = i;
+                    if (memTraceLevel >= 2)
+                        DBGLOG("RoxieMemMgr: suballoc_aligned() 1 page ok - addr=%p node=%u", ret, numaNode);
+                    return ret;
+                }
+            }
+            //No free pages on the preferred node - fall back to allocating from any node
+            heapNumaLWM[numaNode] = end;
+        }
+
         unsigned i;
         for (i = heapLWM; i < heapBitmapSize; i++)
         {
-            heap_t hbi = heapBitmap[i];
-            if (hbi)
+            if (heapBitmap[i])
             {
-                const unsigned pos = countTrailingUnsetBits(hbi);
-                const heap_t mask = ((heap_t)1U) << pos;
-                const unsigned match = i*HEAP_BITS + pos;
-                char *ret = heapBase + match*HEAP_ALIGNMENT_SIZE;
-                hbi &= ~mask;
-                heapBitmap[i] = hbi;
+                char *ret = allocateBitmapPage(i);
                 //If no more free pages in this mask increment the low water mark
-                if (hbi == 0)
+                if (heapBitmap[i] == 0)
                     i++;
                 heapLWM = i;
-                heapAllocated++;
                 if (memTraceLevel >= 2)
                     DBGLOG("RoxieMemMgr: suballoc_aligned() 1 page ok - addr=%p", ret);
                 return ret;
@@ -808,6 +898,20 @@ static void subfree_aligned(void *ptr, unsigned pages = 1)
         if (wordOffset < heapLWM)
             heapLWM = wordOffset;
 
+        if (heapNumaLWM)
+        {
+            //The freed pages may span the sections of more than one NUMA node
+            unsigned lastWordOffset = (unsigned) ((pageOffset + pages - 1) / HEAP_BITS);
+            unsigned lastNode = getHeapNumaNode(lastWordOffset);
+            for (unsigned node = getHeapNumaNode(wordOffset); node <= lastNode; node++)
+            {
+                unsigned nodeStart = heapNumaNodeStart(node);
+                unsigned nodeOffset = (wordOffset > nodeStart) ? wordOffset : nodeStart;
+                if (nodeOffset < heapNumaLWM[node])
+                    heapNumaLWM[node] = nodeOffset;
+            }
+        }
+
         for (;;)
         {
             heap_t prev = heapBitmap[wordOffset];
@@ -1389,6 +1493,7 @@ const static unsigned FREE_ROW_COUNT_MIN = DELAYFREE_ROW_COUNT;
 
 
 class CChunkedHeap;
+static inline bool cacheFreeChunk(CHeap * heap, char * chunk);
 class ChunkedHeaplet : public Heaplet
 {
 protected:
@@ -1534,6 +1639,8 @@ public:
     }
 
     inline char * allocateSingle(unsigned allocated, bool incCounter, unsigned & alreadyIncremented) __attribute__((always_inline));
+    //Return a chunk that was held in one of the heap's row caches to the heaplet
+    inline void uncacheChunk(char * ptr) { inlineReleasePointer(ptr); }
     char * allocateChunk();
     unsigned allocateMultiChunk(unsigned max, char * * rows);   // allocates at least 1 row
     virtual void verifySpaceList();
@@ -1646,6 +1753,13 @@ protected:
             noteEmptyPage(savedHeap);
         }
     }
+
+    inline void releaseChunk(char * ptr)
+    {
+        //A freed chunk may be kept in the calling thread's row cache for the heap instead of going back on the free list
+        if (!cacheFreeChunk(heap, ptr))
+            inlineReleasePointer(ptr);
+    }
 };
 
 //================================================================================
@@ -1716,7 +1830,7 @@ public:
 #ifdef _CLEAR_FREED_ROW
             memset((void *)_ptr, 0xdd, chunkCapacity);
 #endif
-            inlineReleasePointer(ptr);
+            releaseChunk(ptr);
         }
     }
 
@@ -1759,7 +1873,7 @@ public:
 #ifdef _CLEAR_FREED_ROW
             memset((void *)rowset, 0xdd, chunkCapacity);
 #endif
-            inlineReleasePointer(ptr);
+            releaseChunk(ptr);
         }
     }
 
@@ -2013,7 +2127,7 @@ public:
 #ifdef _CLEAR_FREED_ROW
             memset((void *)_ptr, 0xdd, chunkCapacity);
 #endif
-            inlineReleasePointer(ptr);
+            releaseChunk(ptr);
         }
     }
 
@@ -2038,7 +2152,7 @@ public:
 #ifdef _CLEAR_FREED_ROW
             memset((void *)rowset, 0xdd, chunkCapacity);
 #endif
-            inlineReleasePointer(ptr);
+            releaseChunk(ptr);
         }
     }
 
@@ -2379,6 +2493,9 @@ class CActivityMemoryUsageMap : implements IActivityMemoryUsageMap, public CInte
     memsize_t maxUsed;
     memsize_t totalUsed;
     unsigned allocatorIdMax;
+    unsigned numaNode = 0;
+    unsigned __int64 numaLocalPages = 0;
+    unsigned __int64 numaRemotePages = 0;
 
 public:
     IMPLEMENT_IINTERFACE;
@@ -2416,6 +2533,13 @@ public:
         heaps.append(*new HeapEntry(allocatorSize, heapFlags, numPages, memUsed));
     }
 
+    virtual void noteNumaUsage(unsigned node, unsigned __int64 localPages, unsigned __int64 remotePages)
+    {
+        numaNode = node;
+        numaLocalPages += localPages;
+        numaRemotePages += remotePages;
+    }
+
     static int sortUsage(const void *_l, const void *_r)
     {
         const ActivityEntry *l = *(const ActivityEntry **) _l;
@@ -2475,6 +2599,8 @@ public:
             unsigned percentUsed = totalHeapPages ? (unsigned)((totalHeapUsed * 100) / totalReserved) : 100;
             logctx.CTXLOG("Total: %" I64F "up %u%% (%" I64F "u/%" I64F "u) used",
                     (unsigned __int64) totalHeapPages, percentUsed, (unsigned __int64) totalHeapUsed, (unsigned __int64) totalReserved);
+            if (numaLocalPages || numaRemotePages)
+                logctx.CTXLOG("NUMA node %u: %" I64F "u local %" I64F "u remote page allocations", numaNode, numaLocalPages, numaRemotePages);
 
             logctx.CTXLOG("------------------ End of snapshot");
             delete [] results;
@@ -3046,6 +3172,9 @@ public:
         return false;
     }
 
+    //Return any freed rows held in per-thread caches to their heaplets
+    virtual void flushRowCaches() {}
+
     void noteEmptyPage() { possibleEmptyPages.store(true, std::memory_order_release); }
 
     inline void updateNumAllocs(unsigned __int64 allocs)
@@ -3241,6 +3370,20 @@ protected:
     }
 };
 
+//A small stack of chunks that have been freed, but not yet returned to their heaplets.  Each thread uses a different
+//cache, so the lock is almost never contended - other threads only access it when the cached chunks are flushed.
+//Chunks in the cache are still included in their heaplet's count, so the heaplet cannot be released while they are cached.
+struct CRowCache
+{
+    static constexpr unsigned maxChunks = 32;
+
+    NonReentrantSpinLock lock;
+    unsigned numChunks = 0;
+    __uint64 numAllocs = 0;     // allocations satisfied from this cache, so not included in the heap's stats
+    char * chunks[maxChunks];
+    char padding[CACHE_LINE_SIZE];  // avoid false sharing between the caches for different threads
+};
+
 class CChunkedHeap : public CHeap
 {
 public:
@@ -3249,6 +3392,16 @@ public:
     {
         chunksPerPage  = FixedSizeHeaplet::dataAreaSize() / chunkSize;
     }
+    ~CChunkedHeap()
+    {
+        //Return the cached rows first, so the heaplets' counts are correct when they are freed
+        flushRowCaches();
+        delete [] rowCaches;
+    }
+
+    void enableRowCaches(unsigned numCaches);
+    virtual void flushRowCaches() override;
+    inline bool cacheFreeChunk(char * chunk);
 
     void * doAllocate(unsigned allocatorId, unsigned maxSpillCost);
 
@@ -3267,6 +3420,7 @@ public:
     {
         dbgassertex(flags & RHFunique);
         flags |= RHForphaned;
+        flushRowCaches();
     }
     void checkScans(unsigned allocatorId);
     virtual void reportScanProblem(unsigned allocatorId, unsigned __int64 numScans, const HeapletStats & mergedStats) = 0;
@@ -3283,11 +3437,16 @@ protected:
 
     virtual ChunkedHeaplet * allocateHeaplet() = 0;
 
+    inline char * allocateCachedChunk();
+    __uint64 getCachedAllocs() const;
+
 protected:
     size32_t chunkSize;
     unsigned chunksPerPage;
     unsigned curCompactTarget = 0;
     unsigned __int64 totalAllocsLastScanCheck = 0;
+    CRowCache * rowCaches = nullptr;
+    unsigned numRowCaches = 0;
 };
 
 class CFixedChunkedHeap : public CChunkedHeap
@@ -3348,6 +3507,89 @@ protected:
 //================================================================================
 //
 
+//Each thread is assigned a slot the first time it uses a row cache.  0 indicates no slot has been assigned.
+static std::atomic_uint nextRowCacheSlot{0};
+static __thread unsigned threadRowCacheSlot = 0;
+
+static inline unsigned getRowCacheSlot()
+{
+    unsigned slot = threadRowCacheSlot;
+    if (unlikely(slot == 0))
+    {
+        slot = ++nextRowCacheSlot;
+        if (unlikely(slot == 0))
+            slot = ++nextRowCacheSlot;
+        threadRowCacheSlot = slot;
+    }
+    return slot;
+}
+
+void CChunkedHeap::enableRowCaches(unsigned numCaches)
+{
+    //Caches are not used by heaps that scan for free rows, or that release rows in batches
+    if (!numCaches || rowCaches || (flags & (RHFnofragment|RHFdelayrelease)))
+        return;
+    numRowCaches = numCaches;
+    rowCaches = new CRowCache[numCaches];
+}
+
+inline bool CChunkedHeap::cacheFreeChunk(char * chunk)
+{
+    if (!rowCaches)
+        return false;
+
+    CRowCache & cache = rowCaches[getRowCacheSlot() % numRowCaches];
+    NonReentrantSpinBlock block(cache.lock);
+    //Once a unique heap is orphaned the rows must go back to the heaplets so the pages can be freed.
+    //The flag is checked inside the lock so that it cannot race with the flush in noteOrphaned()
+    if ((cache.numChunks == CRowCache::maxChunks) || (flags & RHForphaned))
+        return false;
+    cache.chunks[cache.numChunks++] = chunk;
+    return true;
+}
+
+inline char * CChunkedHeap::allocateCachedChunk()
+{
+    CRowCache & cache = rowCaches[getRowCacheSlot() % numRowCaches];
+    NonReentrantSpinBlock block(cache.lock);
+    if (cache.numChunks == 0)
+        return nullptr;
+    cache.numAllocs++;
+    return cache.chunks[--cache.numChunks];
+}
+
+__uint64 CChunkedHeap::getCachedAllocs() const
+{
+    __uint64 total = 0;
+    for (unsigned i=0; i < numRowCaches; i++)
+    {
+        CRowCache & cache = rowCaches[i];
+        NonReentrantSpinBlock block(cache.lock);
+        total += cache.numAllocs;
+    }
+    return total;
+}
+
+void CChunkedHeap::flushRowCaches()
+{
+    for (unsigned i=0; i < numRowCaches; i++)
+    {
+        CRowCache & cache = rowCaches[i];
+        NonReentrantSpinBlock block(cache.lock);
+        while (cache.numChunks)
+        {
+            char * chunk = cache.chunks[--cache.numChunks];
+            static_cast<ChunkedHeaplet *>(findBase(chunk))->uncacheChunk(chunk);
+        }
+    }
+}
+
+bool cacheFreeChunk(CHeap * const heap, char * chunk)
+{
+    //Only chunked heaplets call this function, so the cast is safe
+    return static_cast<CChunkedHeap *>(heap)->cacheFreeChunk(chunk);
+}
+
 void noteEmptyPage(CHeap * const heap)
 {
     heap->noteEmptyPage();
@@ -4232,6 +4474,10 @@ private:
     bool trackMemoryByActivity;
     bool minimizeFootprint;
     bool minimizeFootprintCritical;
+    unsigned numRowCaches = 0;
+    unsigned numaNode = anyNumaNode;
+    std::atomic<unsigned __int64> numaLocalPages = {0};
+    std::atomic<unsigned __int64> numaRemotePages = {0};
 
 protected:
     const IContextLogger &logctx;
@@ -4279,6 +4525,9 @@ public:
         outputOOMReports = _outputOOMReports;
         minimizeFootprint = false;
         minimizeFootprintCritical = false;
+        //Default to the NUMA node of the thread that creates the row manager
+        if (heapNumaNodes > 1)
+            numaNode = getCurrentNumaNode() % heapNumaNodes;
 #ifdef _DEBUG
         trackMemoryByActivity = true; 
 #else
@@ -4350,6 +4599,7 @@ public:
 
     virtual void checkHeap()
     {
+        flushRowCaches();
         ForEachItemIn(iNormal, normalHeaps)
             normalHeaps.item(iNormal).checkHeap();
 
@@ -4368,6 +4618,7 @@ public:
 
     virtual unsigned allocated()
     {
+        flushRowCaches();
         unsigned total = 0;
         ForEachItemIn(iNormal, normalHeaps)
             total += normalHeaps.item(iNormal).allocated();
@@ -4408,6 +4659,10 @@ public:
     }
     virtual bool releaseEmptyPages(unsigned slaveId, bool forceFreeAll)
     {
+        //Rows held in the row caches prevent pages being freed, so return them if all possible pages are required
+        if (forceFreeAll)
+            flushRowCaches();
+
         unsigned total = 0;
         ForEachItemIn(iNormal, normalHeaps)
             total += normalHeaps.item(iNormal).releaseEmptyPages(forceFreeAll);
@@ -4436,6 +4691,7 @@ public:
 
     void getPeakActivityUsage()
     {
+        flushRowCaches();
         Owned<IActivityMemoryUsageMap> map = getActivityUsage();
 
         NonReentrantSpinBlock block(peakSpinLock);
@@ -4568,6 +4824,52 @@ public:
         minimizeFootprintCritical = critical;
     }
 
+    virtual void setNumaNode(unsigned node)
+    {
+        if (heapNumaNodes > 1)
+            numaNode = node % heapNumaNodes;
+    }
+
+    virtual unsigned getNumaNode() const
+    {
+        return numaNode;
+    }
+
+    //Allocate pages from the global heap, preferring the NUMA node this row manager is bound to
+    void * allocHeapPages(unsigned numPages)
+    {
+        void * memory = suballoc_aligned(numPages, true, numaNode);
+        if (memory && (numaNode != anyNumaNode))
+        {
+            unsigned wordOffset = (unsigned)(((char *)memory - heapBase) / heapBlockSize);
+            if (getHeapNumaNode(wordOffset) == numaNode)
+                numaLocalPages.fetch_add(numPages, std::memory_order_relaxed);
+            else
+                numaRemotePages.fetch_add(numPages, std::memory_order_relaxed);
+        }
+        return memory;
+    }
+
+    virtual void setThreadRowCaches(unsigned numCaches)
+    {
+        numRowCaches = numCaches;
+        ForEachItemIn(iNormal, normalHeaps)
+            normalHeaps.item(iNormal).enableRowCaches(numCaches);
+    }
+
+    void flushRowCaches()
+    {
+        if (!numRowCaches)
+            return;
+
+        ForEachItemIn(iNormal, normalHeaps)
+            normalHeaps.item(iNormal).flushRowCaches();
+
+        SpinBlock block(fixedSpinLock); //Spinblock needed if we can add/remove fixed heaps while allocations are occurring
+        ForEachItemIn(i, fixedHeaps)
+            fixedHeaps.item(i).flushRowCaches();
+    }
+
     virtual void resizeRow(memsize_t &capacity, void * & ptr, memsize_t copysize, memsize_t newsize, unsigned activityId)
     {
         void * const original = ptr;
@@ -4915,6 +5217,8 @@ protected:
     IActivityMemoryUsageMap * getActivityUsage() const
     {
         Owned<IActivityMemoryUsageMap> map = new CActivityMemoryUsageMap;
+        if (numaNode != anyNumaNode)
+            map->noteNumaUsage(numaNode, numaLocalPages.load(std::memory_order_relaxed), numaRemotePages.load(std::memory_order_relaxed));
         ForEachItemIn(iNormal, normalHeaps)
             normalHeaps.item(iNormal).getPeakActivityUsage(map);
         hugeHeap.getPeakActivityUsage(map);
@@ -4957,6 +5261,7 @@ protected:
         }
 
         CFixedChunkedHeap * heap = new CFixedChunkedHeap(this, logctx, allocatorCache, chunkSize, flags, maxSpillCost);
+        heap->enableRowCaches(numRowCaches);
         fixedHeaps.append(*LINK(heap));
         return heap;
     }
@@ -4978,6 +5283,7 @@ protected:
         }
 
         CPackedChunkingHeap * heap = new CPackedChunkingHeap(this, logctx, allocatorCache, chunkSize, flags, activityId, maxSpillCost);
+        heap->enableRowCaches(numRowCaches);
         fixedHeaps.append(*LINK(heap));
         return heap;
     }
@@ -5008,6 +5314,7 @@ protected:
 
     virtual memsize_t compactRows(memsize_t count, const void * * rows)
     {
+        flushRowCaches();
 #ifndef OLD_ROW_COMPACT
         NewHeapCompactState state;
         for (memsize_t i = 0; i < count; i++)
@@ -5145,6 +5452,7 @@ public:
     virtual void setCallbackOnThread(bool value) { throwUnexpected(); }
     virtual void setMinimizeFootprint(bool value, bool critical) { throwUnexpected(); }
     virtual void setReleaseWhenModifyCallback(bool value, bool critical) { throwUnexpected(); }
+    virtual void setThreadRowCaches(unsigned numCaches) { throwUnexpected(); }
     virtual unsigned querySlaveId() const { return slaveId; }
     virtual void reportMemoryUsage(bool peak) const;
     virtual void throwHeapExhausted(unsigned allocatorId, unsigned pages);
@@ -5361,7 +5669,11 @@ public:
         globalPageLimit = (unsigned) PAGES(_globalLimit, HEAP_ALIGNMENT_SIZE);
         slaveRowManagers = new CChunkingRowManager * [numSlaves];
         for (unsigned i=0; i < numSlaves; i++)
+        {
             slaveRowManagers[i] = new CSlaveRowManager(i+1, this, _memLimit, _tl, _logctx, slaveAllocatorCaches ? slaveAllocatorCaches[i] : _allocatorCache, _ignoreLeaks, _outputOOMReports);
+            //Spread the channels over the NUMA nodes - the channel's threads are bound to the same node
+            slaveRowManagers[i]->setNumaNode(i);
+        }
     }
     ~CGlobalRowManager()
     {
@@ -5385,6 +5697,13 @@ public:
         callbacks.removeRowBuffer(slaveId, callback);
     }
 
+    virtual void setThreadRowCaches(unsigned numCaches)
+    {
+        CCallbackRowManager::setThreadRowCaches(numCaches);
+        for (unsigned i=0; i < numSlaves; i++)
+            slaveRowManagers[i]->CChunkingRowManager::setThreadRowCaches(numCaches);
+    }
+
     virtual bool releaseEmptyPages(unsigned slaveId, bool forceFreeAll)
     {
         dbgassertex(slaveId <= numSlaves);
@@ -5558,7 +5877,7 @@ HugeHeaplet * CHugeHeap::allocateHeaplet(memsize_t _size, unsigned allocatorId,
         rowManager->checkLimit(numPages, maxSpillCost);
 
         //If the allocation fails, then try and free some memory by calling the callbacks
-        void * memory = suballoc_aligned(numPages, true);
+        void * memory = rowManager->allocHeapPages(numPages);
         if (memory)
             return new (memory) HugeHeaplet(this, allocatorCache, _size, allocatorId);
 
@@ -5624,7 +5943,7 @@ void CHugeHeap::expandHeap(void * original, memsize_t copysize, memsize_t oldcap
         void *realloced = subrealloc_aligned(oldbase, oldPages, newPages);
         if (!realloced)
         {
-            realloced = suballoc_aligned(newPages, true);
+            realloced = rowManager->allocHeapPages(newPages);
             release = true;
         }
         if (realloced)
@@ -5692,6 +6011,7 @@ void CChunkedHeap::gatherStats(CRuntimeStatisticCollection & result)
         CriticalBlock b(heapletLock);
         merged = stats;
     }
+    merged.totalAllocs += getCachedAllocs();
 
     if (merged.totalAllocs)
     {
@@ -5707,6 +6027,17 @@ void * CChunkedHeap::doAllocateRow(unsigned allocatorId, unsigned maxSpillCost)
     //The latter is done outside the lock, to reduce the window for contention.
     ChunkedHeaplet * donorHeaplet;
     char * chunk;
+    if (rowCaches)
+    {
+        chunk = allocateCachedChunk();
+        if (chunk)
+        {
+            //The heaplet still includes the cached chunk in its count, so it cannot have been released
+            donorHeaplet = static_cast<ChunkedHeaplet *>(findBase(chunk));
+            goto gotChunk;
+        }
+    }
+
     for (;;)
     {
         {
@@ -6002,7 +6333,7 @@ void CChunkedHeap::checkScans(unsigned allocatorId)
 
 ChunkedHeaplet * CFixedChunkedHeap::allocateHeaplet()
 {
-    void * memory = suballoc_aligned(1, true);
+    void * memory = rowManager->allocHeapPages(1);
     if (!memory)
         return NULL;
     return new (memory) FixedSizeHeaplet(this, allocatorCache, chunkSize, flags);
@@ -6031,7 +6362,7 @@ void CFixedChunkedHeap::reportScanProblem(unsigned allocatorId, unsigned __int64
 
 ChunkedHeaplet * CPackedChunkingHeap::allocateHeaplet()
 {
-    void * memory = suballoc_aligned(1, true);
+    void * memory = rowManager->allocHeapPages(1);
     if (!memory)
         return NULL;
     return new (memory) PackedFixedSizeHeaplet(this, allocatorCache, chunkSize, allocatorId, flags);
@@ -6413,6 +6744,16 @@ extern void setMemoryStatsInterval(unsigned secs)
     lastStatsCycles = get_cycles_now();
 }
 
+extern void setHeapNumaNodes(unsigned numNodes)
+{
+    requestedNumaNodes = numNodes;
+}
+
+extern unsigned getHeapNumaNodes()
+{
+    return heapNumaNodes;
+}
+
 extern void setTotalMemoryLimit(bool allowHugePages, bool allowTransparentHugePages, bool retainMemory, memsize_t max, memsize_t largeBlockSize, const unsigned * allocSizes, ILargeMemCallback * largeBlockCallback)
 {
     assertex(largeBlockSize == align_pow2(largeBlockSize, HEAP_ALIGNMENT_SIZE));
@@ -6691,6 +7032,8 @@ class RoxieMemTests : public CppUnit::TestFixture
         CPPUNIT_TEST(testRecursiveCallbacks);
         CPPUNIT_TEST(testResize);
         CPPUNIT_TEST(testResizeLock);
+        CPPUNIT_TEST(testRowCaches);
+        CPPUNIT_TEST(testNuma);
         //MORE: The following currently leak pages, so should go last
         CPPUNIT_TEST(testDatamanager);
         CPPUNIT_TEST(testCleanup);
@@ -8379,6 +8722,173 @@ protected:
         CPPUNIT_ASSERT(!callback.failed);
     }
 
+    void testRowCaches()
+    {
+        Owned<IRowManager> rowManager = createRowManager(0, NULL, logctx, NULL);
+        rowManager->setThreadRowCaches(4);
+        Owned<IFixedRowHeap> fixedHeap = rowManager->createFixedRowHeap(40, 0, RHFunique, 0);
+        Owned<IFixedRowHeap> packedHeap = rowManager->createFixedRowHeap(40, 0, RHFpacked, 0);
+        Owned<IFixedRowHeap> scanHeap = rowManager->createFixedRowHeap(40, 0, RHFnofragment, 0);
+
+        //A row released by a thread is reused by the next allocation on the same thread
+        void * row = rowManager->allocate(100, 0);
+        ReleaseRoxieRow(row);
+        ASSERT(rowManager->allocate(100, 0) == row);
+        ReleaseRoxieRow(row);
+        row = fixedHeap->allocate();
+        ReleaseRoxieRow(row);
+        ASSERT(fixedHeap->allocate() == row);
+        ReleaseRoxieRow(row);
+        row = packedHeap->allocate();
+        ReleaseRoxieRow(row);
+        ASSERT(packedHeap->allocate() == row);
+        ReleaseRoxieRow(row);
+
+        //Allocations from the cache are included in the heap's statistics
+        CRuntimeStatisticCollection before(heapStatistics);
+        packedHeap->gatherStats(before);
+        for (unsigned i=0; i < 10; i++)
+            ReleaseRoxieRow(packedHeap->allocate());
+        CRuntimeStatisticCollection after(heapStatistics);
+        packedHeap->gatherStats(after);
+        ASSERT(after.getStatisticValue(StNumAllocations) == before.getStatisticValue(StNumAllocations) + 10);
+
+        //Rows released on other threads are returned to their pages when the row manager is checked
+        const unsigned numRows = 3000;
+        const void * * rows = (const void * *)rowManager->allocate(numRows * sizeof(void *), 0);
+        for (unsigned i=0; i < numRows; i++)
+        {
+            switch (i % 4)
+            {
+            case 0: rows[i] = rowManager->allocate(i % 200 + 1, 0); break;
+            case 1: rows[i] = fixedHeap->allocate(); break;
+            case 2: rows[i] = packedHeap->allocate(); break;
+            case 3: rows[i] = scanHeap->allocate(); break;
+            }
+        }
+        ASSERT(rowManager->allocated() == numRows+1);
+
+        class casyncfor: public CAsyncFor
+        {
+        public:
+            casyncfor(const void * * _rows, unsigned _numRows) : rows(_rows), numRows(_numRows) {}
+
+            void Do(unsigned idx)
+            {
+                for (unsigned i=idx; i < numRows; i += 8)
+                    ReleaseRoxieRow(rows[i]);
+            }
+        private:
+            const void * * rows;
+            unsigned numRows;
+        } afor(rows, numRows);
+        afor.For(8, 8);
+
+        ASSERT(rowManager->allocated() == 1);
+        ReleaseRoxieRow(rows);
+        fixedHeap.clear();
+        packedHeap.clear();
+        scanHeap.clear();
+        ASSERT(rowManager->allocated() == 0);
+        ASSERT(rowManager->numPagesAfterCleanup(true) == 0);
+    }
+
+    void testNuma()
+    {
+        //Recreate the heap split between two nodes.  If the machine has a single node the binding fails harmlessly.
+        memsize_t memory = (useLargeMemory ? largeMemory : smallMemory) * (unsigned __int64)0x100000U;
+        releaseRoxieHeap();
+        setHeapNumaNodes(2);
+        initializeHeap(false, true, true, (unsigned)(memory / HEAP_ALIGNMENT_SIZE), 0, NULL);
+        ASSERT(getHeapNumaNodes() == 2);
+
+        //Single pages are allocated from the requested node until it is full, and then from any node
+        char * node1Base = heapBase + heapNumaNodeStart(1) * heapBlockSize;
+        unsigned node1Pages = (heapNumaNodeEnd(1) - heapNumaNodeStart(1)) * HEAP_BITS;
+        PointerArray pages;
+        for (unsigned i=0; i < node1Pages; i++)
+        {
+            void * page = suballoc_aligned(1, false, 1);
+            ASSERT((char *)page >= node1Base);
+            pages.append(page);
+        }
+        void * remote = suballoc_aligned(1, false, 1);
+        ASSERT(remote == heapBase);
+        ASSERT(suballoc_aligned(1, false, 0) == heapBase + HEAP_ALIGNMENT_SIZE);
+        subfree_aligned(heapBase + HEAP_ALIGNMENT_SIZE, 1);
+
+        //A page freed on the preferred node is reused before any other node
+        subfree_aligned(pages.item(5), 1);
+        ASSERT(suballoc_aligned(1, false, 1) == pages.item(5));
+
+        //Freeing a block that spans the boundary between the nodes makes the pages visible to both nodes
+        char * boundary = node1Base - 2 * HEAP_ALIGNMENT_SIZE;
+        clearBits((unsigned)((boundary - heapBase) / HEAP_ALIGNMENT_SIZE), 2);
+        subfree_aligned(boundary, 4);
+        ASSERT(suballoc_aligned(1, false, 1) == node1Base);
+        pages.remove(1);
+
+        ForEachItemIn(i, pages)
+            subfree_aligned(pages.item(i), 1);
+        subfree_aligned(remote, 1);
+        ASSERT(heapAllocated == 0);
+
+        {
+            Owned<IRowManager> rowManager = createRowManager(0, NULL, logctx, NULL);
+            rowManager->setNumaNode(1);
+            void * row = rowManager->allocate(1000, 0);
+            ASSERT((char *)row >= node1Base);
+            ReleaseRoxieRow(row);
+        }
+
+        {
+            //Channel row managers are spread over the nodes, independently of the global row manager
+            Owned<IRowManager> globalManager = createGlobalRowManager(memory, memory, 3, NULL, logctx, NULL, NULL, false, false);
+            for (unsigned channel=0; channel < 3; channel++)
+                ASSERT(globalManager->querySlaveRowManager(channel)->getNumaNode() == channel % 2);
+            globalManager->setNumaNode(1);
+            ASSERT(globalManager->getNumaNode() == 1);
+            ASSERT(globalManager->querySlaveRowManager(0)->getNumaNode() == 0);
+
+            void * row0 = globalManager->querySlaveRowManager(0)->allocate(1000, 0);
+            void * row1 = globalManager->querySlaveRowManager(1)->allocate(1000, 0);
+            void * row2 = globalManager->querySlaveRowManager(2)->allocate(1000, 0);
+            ASSERT((char *)row0 < node1Base);
+            ASSERT((char *)row1 >= node1Base);
+            ASSERT((char *)row2 < node1Base);
+            ReleaseRoxieRow(row0);
+            ReleaseRoxieRow(row1);
+            ReleaseRoxieRow(row2);
+        }
+
+        //A thread bound to a node's cpus runs on that node (only possible if the machine has the node)
+        class NumaBindThread : public Thread
+        {
+        public:
+            NumaBindThread(unsigned _node) : Thread("NumaBindThread"), node(_node) {}
+            virtual int run()
+            {
+                bound = bindCurrentThreadToNumaNode(node);
+                if (bound)
+                    ranOnNode = (getCurrentNumaNode() == node);
+                return 0;
+            }
+            unsigned node;
+            bool bound = false;
+            bool ranOnNode = false;
+        };
+        for (unsigned node=0; node < getNumNumaNodes(); node++)
+        {
+            Owned<NumaBindThread> thread = new NumaBindThread(node);
+            thread->start();
+            thread->join();
+            ASSERT(!thread->bound || thread->ranOnNode);
+        }
+
+        releaseRoxieHeap();
+        setHeapNumaNodes(1);
+        initializeHeap(false, true, true, (unsigned)(memory / HEAP_ALIGNMENT_SIZE), 0, NULL);
+    }
 };
 
 class CSimpleRowResizeCallback : public CVariableRowResizeCallback
@@ -8406,6 +8916,75 @@ class RoxieMemTimingTests : public RoxieMemTests
 };
 
 const memsize_t memorySize = 0x60000000;
+//Each thread repeatedly allocates a batch of rows from a shared heap.  Half of the rows are released by the same thread,
+//the other half are passed to whichever thread next swaps a batch, so rows are also freed by other threads.
+class CRowCacheThreadTester : public CAsyncFor
+{
+public:
+    CRowCacheThreadTester(IRowManager * _rowManager, IFixedRowHeap * _heap, unsigned _numIterations)
+        : rowManager(_rowManager), heap(_heap), numIterations(_numIterations)
+    {
+    }
+    ~CRowCacheThreadTester()
+    {
+        releaseBatch(exchange.exchange(nullptr));
+    }
+
+    virtual void Do(unsigned idx)
+    {
+        for (unsigned iter=0; iter < numIterations; iter++)
+        {
+            const void * local[batchSize];
+            const void * * batch = (const void * *)rowManager->allocate(batchSize * sizeof(void *), 0);
+            for (unsigned i=0; i < batchSize; i++)
+            {
+                local[i] = heap->allocate();
+                batch[i] = heap->allocate();
+            }
+            for (unsigned i=0; i < batchSize; i++)
+                ReleaseRoxieRow(local[i]);
+            releaseBatch(exchange.exchange(batch));
+        }
+    }
+
+protected:
+    void releaseBatch(const void * * batch)
+    {
+        if (batch)
+        {
+            for (unsigned i=0; i < batchSize; i++)
+                ReleaseRoxieRow(batch[i]);
+            ReleaseRoxieRow(batch);
+        }
+    }
+
+protected:
+    static constexpr unsigned batchSize = 16;
+    IRowManager * rowManager;
+    IFixedRowHeap * heap;
+    unsigned numIterations;
+    std::atomic<const void * *> exchange{nullptr};
+};
+
+//Returns the time in microseconds, and checks that all rows and pages are freed afterwards
+static unsigned testRowCacheThreads(const IContextLogger & logctx, unsigned numThreads, unsigned numCaches, unsigned heapFlags, unsigned numIterations)
+{
+    Owned<IRowManager> rowManager = createRowManager(0, NULL, logctx, NULL);
+    if (numCaches)
+        rowManager->setThreadRowCaches(numCaches);
+    Owned<IFixedRowHeap> heap = rowManager->createFixedRowHeap(40, 0, heapFlags, 0);
+    cycle_t start = get_cycles_now();
+    {
+        CRowCacheThreadTester tester(rowManager, heap, numIterations);
+        tester.For(numThreads, numThreads);
+    }
+    unsigned microsecs = cycle_to_microsec(get_cycles_now() - start);
+    CPPUNIT_ASSERT_EQUAL(0U, rowManager->allocated());
+    heap.clear();
+    CPPUNIT_ASSERT_EQUAL(0U, rowManager->numPagesAfterCleanup(true));
+    return microsecs;
+}
+
 class RoxieMemStressTests : public CppUnit::TestFixture
 {
     CPPUNIT_TEST_SUITE( RoxieMemStressTests );
@@ -8416,6 +8995,7 @@ class RoxieMemStressTests : public CppUnit::TestFixture
     CPPUNIT_TEST(testResizeFragmenting);
     CPPUNIT_TEST(testSequential);
     CPPUNIT_TEST(testDatamanagerThreading);
+    CPPUNIT_TEST(testRowCacheThreading);
     CPPUNIT_TEST(testCleanup);
     CPPUNIT_TEST_SUITE_END();
     const IContextLogger &logctx;
@@ -8632,6 +9212,19 @@ protected:
         dm.cleanUp();
     }
 
+    void testRowCacheThreading()
+    {
+        const unsigned heapFlags[] = { 0, RHFunique, RHFpacked, RHFpacked|RHFunique };
+        for (unsigned numThreads = 1; numThreads <= 64; numThreads *= 2)
+        {
+            for (unsigned flags : heapFlags)
+            {
+                unsigned uncachedTime = testRowCacheThreads(logctx, numThreads, 0, flags, 2000);
+                unsigned cachedTime = testRowCacheThreads(logctx, numThreads, numThreads, flags, 2000);
+                DBGLOG("Row caches %u threads flags(%x): uncached %u us cached %u us", numThreads, flags, uncachedTime, cachedTime);
+            }
+        }
+    }
 
 };
 
@@ -8725,6 +9318,7 @@ class RoxieMemTimingTests2 : public CppUnit::TestFixture
 #else
     CPPUNIT_TEST(testSyncOrderRelease);
     CPPUNIT_TEST(testSyncShuffleRelease);
+    CPPUNIT_TEST(testRowCacheScaling);
 #endif
     CPPUNIT_TEST(testCleanup);
     CPPUNIT_TEST_SUITE_END();
@@ -8771,6 +9365,23 @@ protected:
         testSyncRelease(numTuningRows / 16, true);
         testSyncRelease(numTuningRows, true);
     }
+    //The total number of rows is the same for each number of threads, so ideally the time is constant
+    void testRowCacheScaling()
+    {
+        const unsigned totalIterations = 0x10000;
+        for (unsigned numThreads = 1; numThreads <= 64; numThreads *= 2)
+        {
+            for (unsigned numCaches = 0; numCaches <= numThreads; numCaches += numThreads)
+            {
+                unsigned times[numTuningIters];
+                for (unsigned iter=0; iter < numTuningIters; iter++)
+                    times[iter] = testRowCacheThreads(logctx, numThreads, numCaches, RHFpacked, totalIterations / numThreads);
+                qsort(times, numTuningIters, sizeof(*times), compareTiming);
+                printf("RowCache %2u threads %s took %u us\n", numThreads, numCaches ? "cached  " : "uncached", times[numTuningIters/2]);
+            }
+        }
+    }
+
     void testSyncRelease(size_t numRows, bool shuffle)
     {
         size_t granularity = minGranularity;
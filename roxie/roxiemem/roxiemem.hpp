@@ -483,6 +483,13 @@ interface IRowManager : extends IInterface
     virtual void setMinimizeFootprint(bool value, bool critical) = 0;
     //If set, and changes to the callback list always triggers the callbacks to be called.
     virtual void setReleaseWhenModifyCallback(bool value, bool critical) = 0;
+    //Keep freed fixed size rows in caches local to the freeing thread so they can be reused without locking the heap.
+    //numCaches is the number of caches per heap (0 disables).  Must be called before any rows are allocated.
+    virtual void setThreadRowCaches(unsigned numCaches) = 0;
+    //Prefer pages from this NUMA node's section of the heap.  Defaults to the node of the thread that created the row manager,
+    //except for slave row managers, which are spread over the nodes by channel (channel % number of nodes).
+    virtual void setNumaNode(unsigned node) = 0;
+    virtual unsigned getNumaNode() const = 0;   // (unsigned)-1 if the heap is not split between NUMA nodes
     virtual IRowManager * querySlaveRowManager(unsigned slave) = 0;  // 0..numSlaves-1
 };
 
@@ -501,6 +508,7 @@ interface IActivityMemoryUsageMap : public IInterface
 {
     virtual void noteMemUsage(unsigned activityId, memsize_t memUsed, unsigned numAllocs) = 0;
     virtual void noteHeapUsage(memsize_t allocatorSize, RoxieHeapFlags heapFlags, memsize_t memReserved, memsize_t memUsed) = 0;
+    virtual void noteNumaUsage(unsigned node, unsigned __int64 localPages, unsigned __int64 remotePages) = 0;
     virtual void report(const IContextLogger &logctx, const IRowAllocatorCache *allocatorCache) = 0;
     virtual void reportStatistics(IStatisticTarget & target, unsigned detailtarget, const IRowAllocatorCache *allocatorCache) = 0;
 };
@@ -518,6 +526,9 @@ interface IDataBufferManager : extends IInterface
 
 extern roxiemem_decl IDataBufferManager *createDataBufferManager(size32_t size);
 extern roxiemem_decl void setMemoryStatsInterval(unsigned secs);
+//Split the heap between NUMA nodes - must be called before setTotalMemoryLimit().  1 (default) disables, 0 uses all nodes in the system
+extern roxiemem_decl void setHeapNumaNodes(unsigned numNodes);
+extern roxiemem_decl unsigned getHeapNumaNodes();
 extern roxiemem_decl void setTotalMemoryLimit(bool allowHugePages, bool allowTransparentHugePages, bool retainMemory, memsize_t max, memsize_t largeBlockSize, const unsigned * allocSizes, ILargeMemCallback * largeBlockCallback);
 extern roxiemem_decl memsize_t getTotalMemoryLimit();
 extern roxiemem_decl void releaseRoxieHeap();
@@ -70,7 +70,7 @@ interface IMessageUnpackCursor : extends IInterface
 
 interface IMessageResult : extends IInterface
 {
-    virtual IMessageUnpackCursor *getCursor(roxiemem::IRowManager *rowMgr) const = 0;
+    virtual IMessageUnpackCursor *getCursor(roxiemem::IRowManager *rowMgr) const = 0; // NB: call once per result - local results hand their rows over to the cursor
     virtual const void *getMessageHeader(unsigned &length) const = 0;
     virtual const void *getMessageMetadata(unsigned &length) const = 0;
     virtual void discard() const = 0;
@@ -82,6 +82,7 @@ interface IMessageCollator : extends IInterface
     virtual void interrupt(IException *E = NULL) = 0;
     virtual ruid_t queryRUID() const = 0;
     virtual unsigned queryBytesReceived() const = 0;
+    virtual unsigned queryBytesCopyAvoided() const = 0; // received as rows, rather than copied out of a message buffer
 
     virtual bool add_package(roxiemem::DataBuffer *dataBuff) = 0;
 };
@@ -132,6 +133,9 @@ extern UDPLIB_API unsigned udpInlineCollationPacketLimit;
 extern UDPLIB_API bool udpInlineCollation;
 extern UDPLIB_API bool udpSnifferEnabled;
 extern UDPLIB_API bool udpSendCompletedInData;
+extern UDPLIB_API unsigned udpReceiveBatchSize;
+extern UDPLIB_API RelaxedAtomic<unsigned __int64> udpPacketsReceived;
+extern UDPLIB_API RelaxedAtomic<unsigned __int64> udpReceiveCalls;
 extern UDPLIB_API unsigned udpSnifferReadThreadPriority;
 extern UDPLIB_API unsigned udpSnifferSendThreadPriority;
 
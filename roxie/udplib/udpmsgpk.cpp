@@ -494,6 +494,11 @@ public:
         return totalBytesReceived; // Arguably should lock, but can't be bothered. Never going to cause an issue in practice.
     }
 
+    virtual unsigned queryBytesCopyAvoided() const
+    {
+        return 0;
+    }
+
     virtual bool add_package(DataBuffer *dataBuff) 
     {
         UdpPacketHeader *pktHdr = (UdpPacketHeader*) dataBuff->data;
@@ -50,6 +50,9 @@ unsigned udpRetryBusySenders = 0; // seems faster with 0 than 1 in my testing on
 unsigned udpInlineCollationPacketLimit;
 bool udpInlineCollation = false;
 bool udpSendCompletedInData = false;
+unsigned udpReceiveBatchSize = 1;
+RelaxedAtomic<unsigned __int64> udpPacketsReceived(0);
+RelaxedAtomic<unsigned __int64> udpReceiveCalls(0);
 
 class CReceiveManager : implements IReceiveManager, public CInterface
 {
@@ -541,6 +544,119 @@ class CReceiveManager : implements IReceiveManager, public CInterface
             ::Release(receive_socket);
         }
 
+        void processPacket(DataBuffer *b, unsigned res)
+        {
+            UdpPacketHeader &hdr = *(UdpPacketHeader *) b->data;
+            unsigned flowBits = hdr.udpSequence;
+            if (flowBits & UDP_SEQUENCE_COMPLETE)
+            {
+                parent.manager->completed(hdr.nodeIndex);
+            }
+            if (udpTraceLevel > 5) // don't want to interrupt this thread if we can help it
+                DBGLOG("UdpReceiver: %u bytes received, node=%u", res, hdr.nodeIndex);
+
+            if (udpInlineCollation)
+                parent.collatePacket(b);
+            else
+                parent.input_queue->pushOwn(b);
+        }
+
+        void noteReadFailure(IException *e)
+        {
+            if (running && e->errorCode() != JSOCKERR_timeout_expired)
+            {
+                StringBuffer s;
+                DBGLOG("UdpReceiver: receive_data::run read failed port=%u - Exp: %s", parent.data_port,  e->errorMessage(s).str());
+                MilliSleep(1000); // Give a chance for mem free
+            }
+            e->Release();
+        }
+
+#ifdef __linux__
+        // Reads up to batchSize packets per system call, each directly into its own DataBuffer
+        void runBatched(unsigned batchSize)
+        {
+            int fd = receive_socket->OShandle();
+            OwnedMalloc<DataBuffer *> buffers;
+            OwnedMalloc<struct mmsghdr> msgs;
+            OwnedMalloc<struct iovec> iovs;
+            buffers.allocateN(batchSize, true);
+            msgs.allocateN(batchSize, true);
+            iovs.allocateN(batchSize, true);
+            for (unsigned i = 0; i < batchSize; i++)
+            {
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+                iovs[i].iov_len = DATA_PAYLOAD;
+            }
+            DataBuffer *b = NULL;
+            while (running)
+            {
+                try
+                {
+                    // Only the buffers filled by the previous call need replacing
+                    for (unsigned i = 0; i < batchSize; i++)
+                    {
+                        if (!buffers[i])
+                        {
+                            buffers[i] = bufferManager->allocate();
+                            iovs[i].iov_base = buffers[i]->data;
+                        }
+                    }
+                    if (receive_socket->wait_read(5000) <= 0)
+                        continue;
+                    int received = recvmmsg(fd, msgs, batchSize, MSG_DONTWAIT, NULL);
+                    if (received < 0)
+                    {
+                        int err = errno;
+                        if (err == EAGAIN || err == EWOULDBLOCK || err == EINTR)
+                            continue;
+                        throw makeErrnoException(err, "recvmmsg");
+                    }
+                    udpReceiveCalls++;
+                    udpPacketsReceived += received;
+                    // Hand off every packet in the batch even if one of them fails, then report the first failure
+                    Owned<IException> failure;
+                    for (int i = 0; i < received; i++)
+                    {
+                        b = buffers[i];
+                        buffers[i] = NULL;
+                        try
+                        {
+                            processPacket(b, msgs[i].msg_len);
+                        }
+                        catch (IException *e)
+                        {
+                            ::Release(b);
+                            if (failure)
+                                e->Release();
+                            else
+                                failure.setown(e);
+                        }
+                        b = NULL;
+                    }
+                    if (failure)
+                        throw failure.getClear();
+                }
+                catch (IException *e) 
+                {
+                    ::Release(b);
+                    b = NULL;
+                    noteReadFailure(e);
+                }
+                catch (...) 
+                {
+                    ::Release(b);
+                    b = NULL;
+                    DBGLOG("UdpReceiver: receive_data::run unknown exception port %u", parent.data_port);
+                    MilliSleep(1000);
+                }
+            }
+            for (unsigned i = 0; i < batchSize; i++)
+                ::Release(buffers[i]);
+        }
+#endif
+
         virtual int run() 
         {
             DBGLOG("UdpReceiver: receive_data started");
@@ -549,8 +665,16 @@ class CReceiveManager : implements IReceiveManager, public CInterface
         #else
             adjustPriority(2);
         #endif
-            DataBuffer *b = NULL;
             started.signal();
+        #ifdef __linux__
+            if (udpReceiveBatchSize > 1)
+            {
+                DBGLOG("UdpReceiver: receive_data reading up to %u packets per call", udpReceiveBatchSize);
+                runBatched(udpReceiveBatchSize);
+                return 0;
+            }
+        #endif
+            DataBuffer *b = NULL;
             while (running) 
             {
                 try 
@@ -558,32 +682,16 @@ class CReceiveManager : implements IReceiveManager, public CInterface
                     unsigned int res;
                     b = bufferManager->allocate();
                     receive_socket->read(b->data, 1, DATA_PAYLOAD, res, 5);
-                    UdpPacketHeader &hdr = *(UdpPacketHeader *) b->data;
-                    unsigned flowBits = hdr.udpSequence;
-                    if (flowBits & UDP_SEQUENCE_COMPLETE)
-                    {
-                        parent.manager->completed(hdr.nodeIndex);
-                    }
-                    if (udpTraceLevel > 5) // don't want to interrupt this thread if we can help it
-                        DBGLOG("UdpReceiver: %u bytes received, node=%u", res, hdr.nodeIndex);
-
-                    if (udpInlineCollation)
-                        parent.collatePacket(b);
-                    else
-                        parent.input_queue->pushOwn(b);
+                    udpReceiveCalls++;
+                    udpPacketsReceived++;
+                    processPacket(b, res);
                     b = NULL;
                 }
                 catch (IException *e) 
                 {
                     ::Release(b);
                     b = NULL;
-                    if (running && e->errorCode() != JSOCKERR_timeout_expired)
-                    {
-                        StringBuffer s;
-                        DBGLOG("UdpReceiver: receive_data::run read failed port=%u - Exp: %s", parent.data_port,  e->errorMessage(s).str());
-                        MilliSleep(1000); // Give a chance for mem free
-                    }
-                    e->Release();
+                    noteReadFailure(e);
                 }
                 catch (...) 
                 {
@@ -26,6 +26,9 @@
 #include "jsem.hpp"
 #include "jdebug.hpp"
 #include <time.h>
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
 
 #if defined(_DEBUG) && defined(_WIN32) && !defined(USING_MPATROL)
  #define new new(_NORMAL_BLOCK, __FILE__, __LINE__)
@@ -50,6 +53,7 @@ void usage()
         "--udpRetryBusySenders nn\n"
         "--maxPacketsPerSender nn\n"
         "--udpQueueSize nn\n"
+        "--udpReceiveBatchSize nn\n"
         "--udpRTSTimeout nn\n"
         "--udpSnifferEnabled 0|1\n"     
         "--udpTraceCategories nn\n"
@@ -144,6 +148,19 @@ SpinLock SendAsFastAsPossible::ratelock;
 unsigned SendAsFastAsPossible::lastReport = 0;
 unsigned SendAsFastAsPossible::totalSent = 0;
 
+static unsigned __int64 getProcessCpuMs()
+{
+#ifdef __linux__
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * (unsigned __int64) 1000 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+#else
+    UserSystemTime_t time;
+    getProcessTime(time); // NB: in ms on Windows
+    return time.user + time.system;
+#endif
+}
+
 class Receiver : public Thread
 {
     bool running;
@@ -188,6 +205,9 @@ public:
             received[i] = 0;
             lastSequence[i] = 0;
         }
+        unsigned __int64 cpuStart = getProcessCpuMs();
+        unsigned __int64 packetsStart = udpPacketsReceived;
+        unsigned __int64 callsStart = udpReceiveCalls;
         running = true;
         started.signal();
         unsigned start = msTick();
@@ -263,8 +283,15 @@ public:
         }
         {
             CriticalBlock block(arsect);
-            double totalRate = (((double)allReceived)/1048576.0)/((lastReceived-start)/1000.0);
+            double elapsedSecs = (lastReceived-start)/1000.0;
+            double totalMB = ((double)allReceived)/1048576.0;
+            double totalRate = totalMB/elapsedSecs;
             DBGLOG("Node %d All Received %" I64F "d bytes, rate = %.2f MB/s", myIndex, allReceived, totalRate);
+            unsigned __int64 packets = udpPacketsReceived - packetsStart;
+            unsigned __int64 calls = udpReceiveCalls - callsStart;
+            unsigned __int64 cpuMs = getProcessCpuMs() - cpuStart;
+            DBGLOG("Node %d Received %" I64F "u packets in %" I64F "u reads (batch size %u), %.0f packets/s, %.2f CPU ms/MB (process)",
+                   myIndex, packets, calls, udpReceiveBatchSize, packets/elapsedSecs, totalMB ? cpuMs/totalMB : 0.0);
         }
         rcvMgr->detachCollator(collator);
         delete [] received;
@@ -639,6 +666,13 @@ int main(int argc, char * argv[] )
                     usage();
                 udpRequestToSendTimeout = atoi(argv[c]);
             }
+            else if (strcmp(ip, "--udpReceiveBatchSize")==0)
+            {
+                c++;
+                if (c==argc || !isdigit(*argv[c]))
+                    usage();
+                udpReceiveBatchSize = atoi(argv[c]);
+            }
             else if (strcmp(ip, "--jumboFrames")==0)
             {
                 roxiemem::setDataAlignmentSize(0x2000);
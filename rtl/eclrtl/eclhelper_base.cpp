@@ -294,6 +294,7 @@ ICompare * CThorSortArg::queryCompareLeftRight() { return NULL; }
 ICompare * CThorSortArg::queryCompareSerializedRow() { return NULL; }
 unsigned CThorSortArg::getAlgorithmFlags() { return TAFconstant; }
 const char * CThorSortArg::getAlgorithm() { return NULL; }
+unsigned CThorSortArg::getSortKeyFields(const unsigned * & fields, const bool * & descending) { return 0; }
 
 //CThorTopNArg
 
@@ -308,6 +309,7 @@ ICompare * CThorTopNArg::queryCompareLeftRight() { return NULL; }
 ICompare * CThorTopNArg::queryCompareSerializedRow() { return NULL; }
 unsigned CThorTopNArg::getAlgorithmFlags() { return TAFconstant; }
 const char * CThorTopNArg::getAlgorithm() { return NULL; }
+unsigned CThorTopNArg::getSortKeyFields(const unsigned * & fields, const bool * & descending) { return 0; }
 
 bool CThorTopNArg::hasBest() { return false; }
 int CThorTopNArg::compareBest(const void * _left) { return +1; }
@@ -323,6 +325,7 @@ IOutputMetaData * CThorSubSortArg::querySortedRecordSize() { return NULL; }
 const char * CThorSubSortArg::getSortedFilename() { return NULL; }
 ICompare * CThorSubSortArg::queryCompareLeftRight() { return NULL; }
 ICompare * CThorSubSortArg::queryCompareSerializedRow() { return NULL; }
+unsigned CThorSubSortArg::getSortKeyFields(const unsigned * & fields, const bool * & descending) { return 0; }
 
 //CThorKeyedJoinArg
 
@@ -678,6 +678,11 @@ extern ECLRTL_API StringBuffer &dumpTypeInfo(StringBuffer &ret, const RtlTypeInf
     return CRtlFieldTypeSerializer::serialize(ret, t);
 }
 
+extern ECLRTL_API MemoryBuffer &dumpTypeInfo(MemoryBuffer &ret, const RtlTypeInfo *t)
+{
+    return CRtlFieldTypeBinSerializer::serialize(ret, t);
+}
+
 extern ECLRTL_API void dumpRecordType(size32_t & __lenResult,char * & __result,IOutputMetaData &metaVal)
 {
     StringBuffer ret;
@@ -1251,6 +1256,38 @@ private:
     }
 };
 
+class CDynamicTransform : public CInterfaceOf<IDynamicTransform>
+{
+public:
+    CDynamicTransform(const RtlRecord &_destRecInfo, const RtlRecord &_srcRecInfo)
+    : translator(_destRecInfo, _srcRecInfo)
+    {
+    }
+    virtual void describe() const override
+    {
+        translator.describe();
+    }
+    virtual size32_t translate(ARowBuilder &builder, const byte *sourceRec) const override
+    {
+        return translator.translate(builder, 0, sourceRec);
+    }
+    virtual bool canTranslate() const override
+    {
+        return translator.canTranslate();
+    }
+    virtual bool needsTranslate() const override
+    {
+        return translator.needsTranslate();
+    }
+private:
+    const GeneralRecordTranslator translator;
+};
+
+extern ECLRTL_API const IDynamicTransform *createRecordTranslator(const RtlRecord &_destRecInfo, const RtlRecord &_srcRecInfo)
+{
+    return new CDynamicTransform(_destRecInfo, _srcRecInfo);
+}
+
 class TranslatedRowStream : public CInterfaceOf<IRowStream>
 {
 public:
@@ -44,7 +44,7 @@ typedef unsigned short UChar;
 
 //Should be incremented whenever the virtuals in the context or a helper are changed, so
 //that a work unit can't be rerun.  Try as hard as possible to retain compatibility.
-#define ACTIVITY_INTERFACE_VERSION      200
+#define ACTIVITY_INTERFACE_VERSION      201
 #define MIN_ACTIVITY_INTERFACE_VERSION  200             //minimum value that is compatible with current interface
 
 typedef unsigned char byte;
@@ -1533,6 +1533,7 @@ struct IHThorSortArg : public IHThorArg
     virtual ICompare * queryCompareSerializedRow()=0;                           // null if row already serialized, or if compare not available
     virtual unsigned getAlgorithmFlags() = 0;
     virtual const char * getAlgorithm() = 0;
+    virtual unsigned getSortKeyFields(const unsigned * & fields, const bool * & descending) = 0; // leading sort components that are plain fields of the row (0=unknown), only present in helpers from interface version 201
 };
 
 typedef IHThorSortArg IHThorSortedArg;
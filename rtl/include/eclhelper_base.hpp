@@ -403,6 +403,7 @@ class ECLRTL_API CThorSortArg : public CThorArgOf<IHThorSortArg>
     virtual ICompare * queryCompareSerializedRow() override;
     virtual unsigned getAlgorithmFlags() override;
     virtual const char * getAlgorithm() override;
+    virtual unsigned getSortKeyFields(const unsigned * & fields, const bool * & descending) override;
 };
 
 class ECLRTL_API CThorTopNArg : public CThorArgOf<IHThorTopNArg>
@@ -418,6 +419,7 @@ class ECLRTL_API CThorTopNArg : public CThorArgOf<IHThorTopNArg>
     virtual ICompare * queryCompareSerializedRow() override;
     virtual unsigned getAlgorithmFlags() override;
     virtual const char * getAlgorithm() override;
+    virtual unsigned getSortKeyFields(const unsigned * & fields, const bool * & descending) override;
 
     virtual bool hasBest() override;
     virtual int compareBest(const void * _left) override;
@@ -434,6 +436,7 @@ class ECLRTL_API CThorSubSortArg : public CThorArgOf<IHThorSubSortArg>
     virtual const char * getSortedFilename() override;
     virtual ICompare * queryCompareLeftRight() override;
     virtual ICompare * queryCompareSerializedRow() override;
+    virtual unsigned getSortKeyFields(const unsigned * & fields, const bool * & descending) override;
 };
 
 class ECLRTL_API CThorKeyedJoinArg : public CThorArgOf<IHThorKeyedJoinArg>
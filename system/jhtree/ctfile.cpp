@@ -29,6 +29,18 @@
 #include "ctfile.hpp"
 #include "jstats.h"
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#define VECTORIZED_PREFIX_SEARCH
+#include <immintrin.h>
+#endif
+
+#define MIN_PREFIX_SEARCH_KEYS 16   // not worth building prefixes for nodes with fewer keys
+#define PREFIX_SEARCH_WINDOW 16     // binary chop until at most this many prefixes remain, then scan them
+
+#define FRONTCODED_RESTART_INTERVAL 16  // every 16th key in a front-coded leaf is stored in full
+#define FRONTCODED_LZW_SLACK 32         // allows for the lzw output that is only flushed when the block is closed
+#define FRONTCODED_HEADER_SIZE (sizeof(unsigned __int64) + 2 * sizeof(unsigned short) + sizeof(byte))
+
 inline void SwapBigEndian(KeyHdr &hdr)
 {
     _WINREV(hdr.phyrec);
@@ -227,7 +239,8 @@ void CWriteNodeBase::write(IFileIOStream *out, CRC32 *crc)
 {
     if (isLeaf() && (keyType & HTREE_COMPRESSED_KEY))
         lzwcomp.close();
-    assertex(hdr.keyBytes<=maxBytes);
+    if (hdr.keyBytes > maxBytes)
+        throw MakeStringException(0, "Htree: Corrupt key node detected (%u bytes exceeds node maximum %u)", (unsigned) hdr.keyBytes, (unsigned) maxBytes);
     writeHdr();
     assertex(fpos);
     out->seek(fpos, IFSbegin);
@@ -391,6 +404,134 @@ size32_t CWriteNode::compressValue(const char *keyData, size32_t size, char *res
 
 //=========================================================================================================
 
+// Front-coded leaf layout, following the node header (all integers big-endian):
+//     firstSequence        8 bytes
+//     restartInterval      2 bytes
+//     keyDataLength        2 bytes
+//     payloadCompressed    1 byte
+//     restartOffsets       2 bytes for each restart key - the offset of that key within keyData
+//     keyData              for each key, the length shared with the previous key (1 byte, or 0xff then 2 bytes)
+//                          followed by the rest of the keyed fields.  Restart keys share nothing.
+//     fpos                 8 bytes for each key
+//     payload              the non-keyed fields of each row, either raw or as a single lzw block
+
+CFrontCodedWriteNode::CFrontCodedWriteNode(offset_t _fpos, CKeyHdr *_keyHdr) : CWriteNode(_fpos, _keyHdr, true)
+{
+    assertex(!isVariable);
+    hdr.leafFlag = 4;
+    firstSequence = 0;
+    payloadLen = keyLen - keyCompareLen;
+    if (payloadLen)
+    {
+        payloadCompressor.setown(createLZWCompressor(true));
+        payloadCompressor->open(payloadEstimate, keyHdr->getNodeSize());
+    }
+}
+
+bool CFrontCodedWriteNode::add(offset_t pos, const void *indata, size32_t insize, unsigned __int64 sequence)
+{
+    if (0xffff == hdr.numKeys)
+        return false;
+    if (insize != keyLen)
+        throw MakeStringException(0, "key+payload (%u) does not match fixed key length (%u)", insize, keyLen);
+
+    const char *row = (const char *) indata;
+    size32_t prevKeyDataLen = keyData.length();
+    size32_t prevRestartLen = restartOffsets.length();
+    unsigned shared = 0;
+    if ((hdr.numKeys % FRONTCODED_RESTART_INTERVAL) == 0)
+    {
+        unsigned short offset = prevKeyDataLen;
+        _WINREV(offset);
+        restartOffsets.append(sizeof(offset), &offset);
+    }
+    else
+    {
+        while (shared < keyCompareLen && row[shared] == lastKeyValue[shared])
+            shared++;
+    }
+    if (shared < 0xff)
+        keyData.append((byte) shared);
+    else
+    {
+        unsigned short len = shared;
+        _WINREV(len);
+        keyData.append((byte) 0xff).append(sizeof(len), &len);
+    }
+    keyData.append(keyCompareLen - shared, row + shared);
+
+    size32_t payloadSize = 0;
+    if (payloadLen)
+    {
+        payloadCompressor->startblock();
+        payloadCompressor->write(row + keyCompareLen, payloadLen);
+        payloadCompressor->commitblock();
+        payloadSize = (hdr.numKeys + 1) * payloadLen;
+        if (payloadSize > payloadCompressor->buflen() + FRONTCODED_LZW_SLACK)
+            payloadSize = payloadCompressor->buflen() + FRONTCODED_LZW_SLACK;
+    }
+    size32_t required = FRONTCODED_HEADER_SIZE + restartOffsets.length() + keyData.length() + (hdr.numKeys + 1) * sizeof(offset_t) + payloadSize;
+    if (required > (size32_t) maxBytes)
+    {
+        keyData.setLength(prevKeyDataLen);
+        restartOffsets.setLength(prevRestartLen);
+        return false;
+    }
+
+    if (!hdr.numKeys)
+        firstSequence = sequence;
+    _WINREV(pos);
+    fposData.append(sizeof(pos), &pos);
+    payloadData.append(payloadLen, row + keyCompareLen);
+    memcpy(lastKeyValue, row, insize);
+    lastSequence = sequence;
+    hdr.numKeys++;
+    return true;
+}
+
+void CFrontCodedWriteNode::write(IFileIOStream *out, CRC32 *crc)
+{
+    // The payload of the rows that were accepted compresses to at most the size estimated in add()
+    MemoryBuffer compressed;
+    bool payloadCompressed = false;
+    if (payloadLen)
+    {
+        payloadCompressor->close();
+        Owned<ICompressor> compressor = createLZWCompressor(true);
+        compressor->open(compressed, payloadData.length());
+        compressor->write(payloadData.toByteArray(), payloadData.length());
+        compressor->close();
+        payloadCompressed = compressed.length() < payloadData.length();
+    }
+    const MemoryBuffer &payload = payloadCompressed ? compressed : payloadData;
+    hdr.keyBytes = FRONTCODED_HEADER_SIZE + restartOffsets.length() + keyData.length() + fposData.length() + payload.length();
+    if (hdr.keyBytes > maxBytes)
+        throw MakeStringException(0, "Htree: Corrupt key node detected (%u bytes exceeds node maximum %u)", (unsigned) hdr.keyBytes, (unsigned) maxBytes);
+
+    char *target = keyPtr;
+    unsigned __int64 rsequence = firstSequence;
+    _WINREV(rsequence);
+    memcpy(target, &rsequence, sizeof(rsequence));
+    target += sizeof(rsequence);
+    unsigned short interval = FRONTCODED_RESTART_INTERVAL;
+    _WINCPYREV2(target, &interval);
+    target += sizeof(interval);
+    unsigned short keyDataLen = keyData.length();
+    _WINCPYREV2(target, &keyDataLen);
+    target += sizeof(keyDataLen);
+    *target++ = payloadCompressed ? 1 : 0;
+    memcpy(target, restartOffsets.toByteArray(), restartOffsets.length());
+    target += restartOffsets.length();
+    memcpy(target, keyData.toByteArray(), keyData.length());
+    target += keyData.length();
+    memcpy(target, fposData.toByteArray(), fposData.length());
+    target += fposData.length();
+    memcpy(target, payload.toByteArray(), payload.length());
+    CWriteNode::write(out, crc);
+}
+
+//=========================================================================================================
+
 CBlobWriteNode::CBlobWriteNode(offset_t _fpos, CKeyHdr *_keyHdr) : CWriteNodeBase(_fpos, _keyHdr)
 {
     hdr.leafFlag = 2;
@@ -462,6 +603,7 @@ CJHTreeNode::CJHTreeNode()
     keyRecLen = 0;
     firstSequence = 0;
     expandedSize = 0;
+    keyPrefixes = NULL;
 }
 
 void CJHTreeNode::load(CKeyHdr *_keyHdr, const void *rawData, offset_t _fpos, bool needCopy)
@@ -473,6 +615,7 @@ void CJHTreeNode::load(CKeyHdr *_keyHdr, const void *rawData, offset_t _fpos, bo
 CJHTreeNode::~CJHTreeNode()
 {
     releaseMem(keyBuf, expandedSize);
+    delete [] keyPrefixes;
 }
 
 void CJHTreeNode::releaseMem(void *togo, size32_t len)
@@ -524,7 +667,7 @@ IRandRowExpander *CJHTreeNode::expandQuickKeys(void *src, bool needCopy)
 }
 
 
-void CJHTreeNode::unpack(const void *node, bool needCopy)
+const char *CJHTreeNode::unpackHeader(const void *node)
 {
     memcpy(&hdr, node, sizeof(hdr));
     SwapBigEndian(hdr);
@@ -540,16 +683,22 @@ void CJHTreeNode::unpack(const void *node, bool needCopy)
         PrintStackReport();
         throw MakeStringException(0, "Htree: Corrupt key node detected");
     }
-    if (!hdr.leafFlag)
-        keyLen = keyHdr->getNodeKeyLength();
-    keyRecLen = keyLen + sizeof(offset_t);
-    char *keys = ((char *) node) + sizeof(hdr);
+    const char *keys = ((const char *) node) + sizeof(hdr);
     if (hdr.crc32)
     {
         unsigned crc = crc32(keys, hdr.keyBytes, 0);
         if (hdr.crc32 != crc)
             throw MakeStringException(0, "CRC error on key node");
     }
+    return keys;
+}
+
+void CJHTreeNode::unpack(const void *node, bool needCopy)
+{
+    char *keys = (char *) unpackHeader(node);
+    if (!hdr.leafFlag)
+        keyLen = keyHdr->getNodeKeyLength();
+    keyRecLen = keyLen + sizeof(offset_t);
     if (hdr.leafFlag==1)
     {
         firstSequence = *(unsigned __int64 *) keys;
@@ -690,6 +839,175 @@ void CJHTreeNode::unpack(const void *node, bool needCopy)
             memcpy(keyBuf, keys, hdr.keyBytes + sizeof( __int64 ));
         }
     }
+    if (useNodeSearchPrefixes && keyBuf && hdr.leafFlag <= 1 && !(isVariable && isLeaf()) && hdr.numKeys >= MIN_PREFIX_SEARCH_KEYS)
+        buildKeyPrefixes();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
+// Fixed size keys can be searched using an array of the first 8 bytes of each key, held as big-endian integers
+// with the sign bit flipped so that a signed integer comparison gives the same ordering as memcmp.  The prefixes
+// are sorted, so most of a search is a binary chop over a dense array, finishing with a vectorized scan of a
+// small window.  Only keys that share the prefix of the search value need a full comparison.
+
+static inline __int64 makeKeyPrefix(const char *key, size32_t len)
+{
+    unsigned __int64 value = 0;
+    if (len >= sizeof(value))
+    {
+        memcpy(&value, key, sizeof(value));
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+        _rev(value);
+#endif
+    }
+    else
+    {
+        for (unsigned i = 0; i < len; i++)
+            value = (value << 8) | (byte)key[i];
+        value <<= 8 * (sizeof(value) - len);
+    }
+    return (__int64)(value ^ I64C(0x8000000000000000));
+}
+
+static unsigned countPrefixesBelowScalar(const __int64 *prefixes, unsigned num, __int64 value)
+{
+    unsigned count = 0;
+    while ((count < num) && (prefixes[count] < value))
+        count++;
+    return count;
+}
+
+#ifdef VECTORIZED_PREFIX_SEARCH
+__attribute__((target("sse4.2")))
+static unsigned countPrefixesBelowSSE42(const __int64 *prefixes, unsigned num, __int64 value)
+{
+    __m128i search = _mm_set1_epi64x(value);
+    unsigned count = 0;
+    unsigned i = 0;
+    for (; i + 2 <= num; i += 2)
+    {
+        __m128i cur = _mm_loadu_si128((const __m128i *)(prefixes + i));
+        unsigned mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(search, cur)));
+        count += __builtin_popcount(mask);
+    }
+    return count + countPrefixesBelowScalar(prefixes + i, num - i, value);
+}
+
+__attribute__((target("avx2")))
+static unsigned countPrefixesBelowAVX2(const __int64 *prefixes, unsigned num, __int64 value)
+{
+    __m256i search = _mm256_set1_epi64x(value);
+    unsigned count = 0;
+    unsigned i = 0;
+    for (; i + 4 <= num; i += 4)
+    {
+        __m256i cur = _mm256_loadu_si256((const __m256i *)(prefixes + i));
+        unsigned mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(search, cur)));
+        count += __builtin_popcount(mask);
+    }
+    return count + countPrefixesBelowScalar(prefixes + i, num - i, value);
+}
+#endif
+
+typedef unsigned (*CountPrefixesFunction)(const __int64 *prefixes, unsigned num, __int64 value);
+
+static CountPrefixesFunction selectCountPrefixesBelow()
+{
+#ifdef VECTORIZED_PREFIX_SEARCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return countPrefixesBelowAVX2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return countPrefixesBelowSSE42;
+#endif
+    return countPrefixesBelowScalar;
+}
+
+static const CountPrefixesFunction countPrefixesWindow = selectCountPrefixesBelow();
+
+// Returns the number of (sorted) prefixes that are less than value
+static unsigned countPrefixesBelow(const __int64 *prefixes, unsigned num, __int64 value)
+{
+    unsigned low = 0;
+    unsigned high = num;
+    while (high - low > PREFIX_SEARCH_WINDOW)
+    {
+        unsigned mid = low + (high - low) / 2;
+        if (prefixes[mid] < value)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low + countPrefixesWindow(prefixes + low, high - low, value);
+}
+
+void CJHTreeNode::buildKeyPrefixes()
+{
+    unsigned numKeys = hdr.numKeys;
+    keyPrefixes = new __int64[numKeys];
+    const char *key = keyBuf + sizeof(__int64);
+    for (unsigned i = 0; i < numKeys; i++, key += keyRecLen)
+        keyPrefixes[i] = makeKeyPrefix(key, keyCompareLen);
+}
+
+unsigned CJHTreeNode::searchKeyPrefixes(const char *src, unsigned minIndex, bool matchEqual) const
+{
+    unsigned numKeys = hdr.numKeys;
+    if (minIndex >= numKeys)
+        return numKeys;
+    __int64 srcPrefix = makeKeyPrefix(src, keyCompareLen);
+    unsigned first = minIndex + countPrefixesBelow(keyPrefixes + minIndex, numKeys - minIndex, srcPrefix);
+    unsigned last = numKeys;
+    if (srcPrefix != I64C(0x7fffffffffffffff))
+        last = first + countPrefixesBelow(keyPrefixes + first, numKeys - first, srcPrefix + 1);
+    if (keyCompareLen <= sizeof(__int64))
+        return matchEqual ? first : last;   // the prefix is the whole key
+
+    // Keys within [first, last) share the prefix of src - compare the rest of the key
+    while (first < last)
+    {
+        unsigned mid = first + (last - first) / 2;
+        int rc = memcmp(src, keyBuf + mid*keyRecLen + sizeof(__int64), keyCompareLen);
+        if (rc > 0 || (!matchEqual && rc == 0))
+            first = mid + 1;
+        else
+            last = mid;
+    }
+    return first;
+}
+
+unsigned CJHTreeNode::locateGE(const char *src, unsigned minIndex) const
+{
+    if (keyPrefixes)
+        return searchKeyPrefixes(src, minIndex, true);
+    unsigned a = minIndex;
+    unsigned b = getNumKeys();
+    while (a < b)
+    {
+        unsigned i = a+(b-a)/2;
+        if (compareValueAt(src, i) > 0)
+            a = i+1;
+        else
+            b = i;
+    }
+    return a;
+}
+
+unsigned CJHTreeNode::locateGT(const char *src, unsigned minIndex) const
+{
+    if (keyPrefixes)
+        return searchKeyPrefixes(src, minIndex, false);
+    unsigned a = minIndex;
+    unsigned b = getNumKeys();
+    while (a < b)
+    {
+        unsigned i = a+(b-a)/2;
+        if (compareValueAt(src, i) >= 0)
+            a = i+1;
+        else
+            b = i;
+    }
+    return a;
 }
 
 offset_t CJHTreeNode::prevNodeFpos() const
@@ -829,10 +1147,10 @@ extern jhtree_decl void validateKeyFile(const char *filename, offset_t nodePos)
             MTIME_SECTION(queryActiveTimer(), "JHTREE read index node");
             io->read(nodeOffset, hdr.nodeSize, buffer);
         }
-        CJHTreeNode theNode;
+        Owned<CJHTreeNode> theNode = (((NodeHdr *) buffer)->leafFlag == 4) ? new CJHFrontCodedNode : new CJHTreeNode;
         {
             MTIME_SECTION(queryActiveTimer(), "JHTREE load index node");
-            theNode.load(&keyHdr, buffer, nodeOffset, true);
+            theNode->load(&keyHdr, buffer, nodeOffset, true);
         }
         NodeHdr *nodeHdr = (NodeHdr *) buffer;
         SwapBigEndian(*nodeHdr);
@@ -938,6 +1256,235 @@ offset_t CJHVarTreeNode::getFPosAt(unsigned int num) const
 }
 
 
+//=========================================================================================================
+
+static inline unsigned readSharedLength(const byte * &cur)
+{
+    unsigned shared = *cur++;
+    if (shared == 0xff)
+    {
+        unsigned short len;
+        _WINCPYREV2(&len, cur);
+        cur += sizeof(len);
+        shared = len;
+    }
+    return shared;
+}
+
+CJHFrontCodedNode::CJHFrontCodedNode() : expandedPayload(nullptr)
+{
+    nodeData = NULL;
+    keyData = NULL;
+    fposData = NULL;
+    payloadData = NULL;
+    restartOffsets = NULL;
+    restartInterval = 0;
+    numRestarts = 0;
+    payloadLen = 0;
+    payloadCompressed = false;
+}
+
+CJHFrontCodedNode::~CJHFrontCodedNode()
+{
+    delete [] restartOffsets;
+    char *payload = expandedPayload.load();
+    if (payload)
+        releaseMem(payload, hdr.numKeys * payloadLen);
+}
+
+void CJHFrontCodedNode::load(CKeyHdr *_keyHdr, const void *rawData, offset_t _fpos, bool needCopy)
+{
+    CNodeBase::load(_keyHdr, _fpos);
+    const char *data = unpackHeader(rawData);
+    keyRecLen = keyLen + sizeof(offset_t);
+    if (needCopy)
+    {
+        expandedSize = hdr.keyBytes;
+        keyBuf = (char *) allocMem(expandedSize);
+        memcpy(keyBuf, data, expandedSize);
+        data = keyBuf;
+    }
+    nodeData = data;
+    const char *end = data + hdr.keyBytes;
+    if (isVariable || hdr.keyBytes < FRONTCODED_HEADER_SIZE)
+        throw MakeStringException(0, "Htree: Corrupt key node detected");
+
+    memcpy(&firstSequence, data, sizeof(firstSequence));
+    _WINREV(firstSequence);
+    data += sizeof(firstSequence);
+    unsigned short interval;
+    unsigned short keyDataLen;
+    _WINCPYREV2(&interval, data);
+    data += sizeof(interval);
+    _WINCPYREV2(&keyDataLen, data);
+    data += sizeof(keyDataLen);
+    payloadCompressed = (*data++ != 0);
+    restartInterval = interval;
+    numRestarts = restartInterval ? (hdr.numKeys + restartInterval - 1) / restartInterval : 0;
+    payloadLen = keyLen - keyCompareLen;
+    size32_t fixedSize = numRestarts * sizeof(unsigned short) + keyDataLen + hdr.numKeys * sizeof(offset_t);
+    if (!restartInterval || fixedSize > (size32_t) (end - data))
+        throw MakeStringException(0, "Htree: Corrupt key node detected");
+
+    restartOffsets = new unsigned short[numRestarts];
+    for (unsigned i = 0; i < numRestarts; i++)
+    {
+        _WINCPYREV2(&restartOffsets[i], data);
+        data += sizeof(unsigned short);
+        if (restartOffsets[i] >= keyDataLen)
+            throw MakeStringException(0, "Htree: Corrupt key node detected");
+    }
+    keyData = data;
+    data += keyDataLen;
+    fposData = data;
+    data += hdr.numKeys * sizeof(offset_t);
+    payloadData = data;
+    if (!payloadCompressed && (size32_t) (end - data) < hdr.numKeys * payloadLen)
+        throw MakeStringException(0, "Htree: Corrupt key node detected");
+}
+
+size32_t CJHFrontCodedNode::getMemSize()
+{
+    // The payload is counted as expanded, since any read of a cached node may expand it
+    size32_t size = expandedSize + numRestarts * sizeof(unsigned short);
+    if (payloadCompressed)
+        size += hdr.numKeys * payloadLen;
+    return size;
+}
+
+const char *CJHFrontCodedNode::queryPayload() const
+{
+    if (!payloadCompressed)
+        return payloadData;
+    return querySingleton(expandedPayload, payloadCrit, [this]
+    {
+        MTIME_SECTION(queryActiveTimer(), "Front-coded payload expand");
+        Owned<IExpander> exp = createLZWExpander(true);
+        size32_t len = exp->init(payloadData);
+        if (len != hdr.numKeys * payloadLen)
+            throw MakeStringException(0, "Htree: Corrupt key node detected");
+        char *payload = (char *) allocMem(len);
+        exp->expand(payload);
+        return payload;
+    });
+}
+
+void CJHFrontCodedNode::expandKey(unsigned index, char *dst) const
+{
+    unsigned restart = index / restartInterval;
+    const byte *cur = (const byte *) keyData + restartOffsets[restart];
+    for (unsigned i = restart * restartInterval; ; i++)
+    {
+        unsigned shared = readSharedLength(cur);
+        size32_t len = keyCompareLen - shared;
+        memcpy(dst + shared, cur, len);
+        cur += len;
+        if (i == index)
+            break;
+    }
+}
+
+// Returns the index of the first key >= src (matchEqual) or > src.  The restart keys are binary chopped in place,
+// then the keys that follow the chosen restart are scanned, comparing only the bytes that differ from the previous key.
+unsigned CJHFrontCodedNode::locate(const char *src, unsigned minIndex, bool matchEqual) const
+{
+    unsigned numKeys = hdr.numKeys;
+    if (minIndex >= numKeys)
+        return numKeys;
+    unsigned minRestart = minIndex / restartInterval;
+    unsigned low = minRestart;
+    unsigned high = numRestarts;
+    while (low < high)
+    {
+        unsigned mid = low + (high - low) / 2;
+        int rc = memcmp(src, queryRestartKey(mid), keyCompareLen);
+        if (rc > 0 || (!matchEqual && rc == 0))
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low == minRestart)
+        return minIndex;
+
+    // The restart key before 'low' precedes src, as may the keys that follow it
+    unsigned restart = low - 1;
+    unsigned index = restart * restartInterval;
+    unsigned limit = index + restartInterval;
+    if (limit > numKeys)
+        limit = numKeys;
+    const byte *key = (const byte *) queryRestartKey(restart);
+    const byte *cur = key + keyCompareLen;
+    unsigned matched = 0;
+    while (matched < keyCompareLen && (byte) src[matched] == key[matched])
+        matched++;
+    for (index++; index < limit; index++)
+    {
+        unsigned shared = readSharedLength(cur);
+        const byte *suffix = cur - shared;
+        cur += keyCompareLen - shared;
+        if (shared < matched)
+            break;      // differs from the previous key at a byte where that matched src, so is after src
+        if (shared == matched)
+        {
+            while (matched < keyCompareLen && (byte) src[matched] == suffix[matched])
+                matched++;
+            if (matched == keyCompareLen)
+            {
+                if (matchEqual)
+                    break;
+            }
+            else if (suffix[matched] > (byte) src[matched])
+                break;
+        }
+        // otherwise it matches src for longer than the previous key did, so also precedes src
+    }
+    return (index > minIndex) ? index : minIndex;
+}
+
+unsigned CJHFrontCodedNode::locateGE(const char *src, unsigned minIndex) const
+{
+    return locate(src, minIndex, true);
+}
+
+unsigned CJHFrontCodedNode::locateGT(const char *src, unsigned minIndex) const
+{
+    return locate(src, minIndex, false);
+}
+
+int CJHFrontCodedNode::compareValueAt(const char *src, unsigned int index) const
+{
+    char *key = (char *) alloca(keyCompareLen);
+    expandKey(index, key);
+    return memcmp(src, key, keyCompareLen);
+}
+
+bool CJHFrontCodedNode::getValueAt(unsigned int index, char *dst) const
+{
+    if (index >= hdr.numKeys) return false;
+    if (dst)
+    {
+        expandKey(index, dst);
+        if (payloadLen)
+            memcpy(dst + keyCompareLen, queryPayload() + index * payloadLen, payloadLen);
+    }
+    return true;
+}
+
+size32_t CJHFrontCodedNode::getSizeAt(unsigned int index) const
+{
+    return keyLen;
+}
+
+offset_t CJHFrontCodedNode::getFPosAt(unsigned int index) const
+{
+    if (index >= hdr.numKeys) return 0;
+
+    offset_t pos;
+    memcpy(&pos, fposData + index * sizeof(offset_t), sizeof(pos));
+    _WINREV(pos);
+    return pos;
+}
+
 //=========================================================================================================
 
 CJHTreeBlobNode::CJHTreeBlobNode()
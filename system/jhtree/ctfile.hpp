@@ -37,7 +37,9 @@
 #define INDAR_TRAILING_SEG  0x80 // Obsolete, not supported
 #define HTREE_COMPRESSED_KEY 0x40
 #define HTREE_QUICK_COMPRESSED_KEY 0x48
-#define KEYBUILD_VERSION 1 // unsigned short. NB: This should upped if a change would make existing keys incompatible with current build.
+#define HTREE_FRONTCODED_LEAF 0x100 // Builder option only (not stored in ktype) - write fixed size leaves front-coded with restart points
+#define KEYBUILD_VERSION 2 // unsigned short. NB: This should upped if a change would make existing keys incompatible with current build.
+#define KEYBUILD_COMPATIBLE_VERSION 1 // version written for keys that only use node formats understood by older builds
 #define KEYBUILD_MAXLENGTH 0x7FFF
 
 // structure to be read into - NO VIRTUALS.
@@ -187,6 +189,11 @@ protected:
     unsigned __int64 firstSequence;
     size32_t expandedSize;
     Owned<IRandRowExpander> rowexp;  // expander for rand rowdiff   
+    __int64 *keyPrefixes;            // optional, leading bytes of each key as sign-biased big-endian integers, for searching
+
+    const char *unpackHeader(const void *node);
+    void buildKeyPrefixes();
+    unsigned searchKeyPrefixes(const char *src, unsigned minIndex, bool matchEqual) const;
 
     static char *expandKeys(void *src,unsigned keylength,size32_t &retsize, bool rowcompression);
     static IRandRowExpander *expandQuickKeys(void *src, bool needCopy);
@@ -198,7 +205,7 @@ public:
     CJHTreeNode();
     virtual void load(CKeyHdr *keyHdr, const void *rawData, offset_t pos, bool needCopy);
     ~CJHTreeNode();
-    size32_t getMemSize() { return expandedSize; }
+    virtual size32_t getMemSize() { return expandedSize + (keyPrefixes ? hdr.numKeys * sizeof(__int64) : 0); }
 
 // reading methods
     offset_t prevNodeFpos() const;
@@ -207,6 +214,8 @@ public:
     virtual size32_t getSizeAt(unsigned int num) const;
     virtual offset_t getFPosAt(unsigned int num) const;
     virtual int compareValueAt(const char *src, unsigned int index) const;
+    virtual unsigned locateGE(const char *src, unsigned minIndex) const; // index of first key >= src, or numKeys if none
+    virtual unsigned locateGT(const char *src, unsigned minIndex) const; // index of first key > src, or numKeys if none
     bool contains(const char *src) const;
     inline offset_t getRightSib() const { return hdr.rightSib; }
     inline offset_t getLeftSib() const { return hdr.leftSib; }
@@ -230,6 +239,40 @@ public:
     virtual void dump();
 };
 
+// Fixed size leaf node (leafFlag 4) holding the keyed fields front-coded, with every restartInterval'th key stored in full.
+// Seeks run directly on the encoded keys, and the payload fields are only expanded when a row is first read.
+class CJHFrontCodedNode : public CJHTreeNode
+{
+    const char *nodeData;               // encoded node, either copied into keyBuf or referencing the caller's (mapped) data
+    const char *keyData;                // front-coded keyed fields
+    const char *fposData;               // big-endian file positions
+    const char *payloadData;            // payload fields, stored raw or as a single lzw block
+    unsigned short *restartOffsets;     // offset of each restart key within keyData
+    unsigned restartInterval;
+    unsigned numRestarts;
+    size32_t payloadLen;                // size of the payload of each row
+    bool payloadCompressed;
+    mutable std::atomic<char *> expandedPayload;
+    mutable CriticalSection payloadCrit;
+
+    inline const char *queryRestartKey(unsigned restart) const { return keyData + restartOffsets[restart] + 1; }
+    const char *queryPayload() const;
+    void expandKey(unsigned index, char *dst) const;
+    unsigned locate(const char *src, unsigned minIndex, bool matchEqual) const;
+
+public:
+    CJHFrontCodedNode();
+    ~CJHFrontCodedNode();
+    virtual void load(CKeyHdr *keyHdr, const void *rawData, offset_t pos, bool needCopy);
+    virtual size32_t getMemSize();
+    virtual bool getValueAt(unsigned int num, char *key) const;
+    virtual size32_t getSizeAt(unsigned int num) const;
+    virtual offset_t getFPosAt(unsigned int num) const;
+    virtual int compareValueAt(const char *src, unsigned int index) const;
+    virtual unsigned locateGE(const char *src, unsigned minIndex) const;
+    virtual unsigned locateGT(const char *src, unsigned minIndex) const;
+};
+
 class CJHTreeBlobNode : public CJHTreeNode
 {
 public:
@@ -280,7 +323,7 @@ public:
     CWriteNodeBase(offset_t fpos, CKeyHdr *keyHdr);
     ~CWriteNodeBase();
 
-    void write(IFileIOStream *, CRC32 *crc = NULL);
+    virtual void write(IFileIOStream *, CRC32 *crc = NULL);
     void setLeftSib(offset_t leftSib) { hdr.leftSib = leftSib; }
     void setRightSib(offset_t rightSib) { hdr.rightSib = rightSib; }
 };
@@ -288,7 +331,7 @@ public:
 
 class jhtree_decl CWriteNode : public CWriteNodeBase
 {
-private:
+protected:
     char *lastKeyValue;
     unsigned __int64 lastSequence;
 
@@ -297,11 +340,31 @@ public:
     ~CWriteNode();
 
     size32_t compressValue(const char *keyData, size32_t size, char *result);
-    bool add(offset_t pos, const void *data, size32_t size, unsigned __int64 sequence);
+    virtual bool add(offset_t pos, const void *data, size32_t size, unsigned __int64 sequence);
     const void *getLastKeyValue() const { return lastKeyValue; }
     unsigned __int64 getLastSequence() const { return lastSequence; }
 };
 
+// Writes the leaf format read by CJHFrontCodedNode.  Rows are buffered, and only encoded into the node when it is written.
+class jhtree_decl CFrontCodedWriteNode : public CWriteNode
+{
+private:
+    MemoryBuffer keyData;
+    MemoryBuffer restartOffsets;
+    MemoryBuffer fposData;
+    MemoryBuffer payloadData;
+    MemoryBuffer payloadEstimate;
+    Owned<ICompressor> payloadCompressor;   // only used to track how well the payload compresses
+    unsigned __int64 firstSequence;
+    size32_t payloadLen;
+
+public:
+    CFrontCodedWriteNode(offset_t fpos, CKeyHdr *keyHdr);
+
+    virtual bool add(offset_t pos, const void *data, size32_t size, unsigned __int64 sequence);
+    virtual void write(IFileIOStream *, CRC32 *crc = NULL);
+};
+
 class jhtree_decl CBlobWriteNode : public CWriteNodeBase
 {
     static unsigned __int64 makeBlobId(offset_t nodepos, unsigned offset);
@@ -43,6 +43,7 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <memory>
 #ifdef __linux__
 #include <alloca.h>
 #endif
@@ -62,13 +63,17 @@
 static std::atomic<CKeyStore *> keyStore(nullptr);
 static unsigned defaultKeyIndexLimit = 200;
 static CNodeCache *nodeCache = NULL;
+static unsigned nodeCacheShards = DEFAULT_NODE_CACHE_SHARDS;
 static CriticalSection *initCrit = NULL;
+static IThreadPool *prefetchPool = NULL;
 
 bool useMemoryMappedIndexes = false;
 bool logExcessiveSeeks = false;
 bool linuxYield = false;
 bool traceSmartStepping = false;
 bool flushJHtreeCacheOnOOM = true;
+bool useNodeSearchPrefixes = false;
+unsigned keyPrefetchReaders = 0;
 
 MODULE_INIT(INIT_PRIORITY_JHTREE_JHTREE)
 {
@@ -78,6 +83,7 @@ MODULE_INIT(INIT_PRIORITY_JHTREE_JHTREE)
 
 MODULE_EXIT()
 {
+    ::Release(prefetchPool);
     delete initCrit;
     delete keyStore.load(std::memory_order_relaxed);
     ::Release((CInterface*)nodeCache);
@@ -410,6 +416,9 @@ protected:
     CMemoryBlock layoutTransBuff;
     Owned<IRecordLayoutTranslator::SegmentMonitorContext> layoutTransSegCtx;
     Owned<IRecordLayoutTranslator::RowTransformContext> layoutTransRowCtx;
+    Linked<IKeyIndex> keyIndex;
+    MemoryBuffer prefetchKeys;  // start position of each queued lookup, keySize bytes apart
+    unsigned numPrefetchKeys = 0;
 
     inline void setLow(unsigned segNo) 
     {
@@ -610,11 +619,13 @@ public:
     {
         ::Release(keyCursor);
         keyCursor = NULL;
+        keyIndex.clear();
         if (_key)
         {
             assertex(_key->numParts()==1);
             IKeyIndex *ki = _key->queryPart(0);
             keyCursor = ki->getCursor(ctx);
+            keyIndex.set(ki);
             keyName.set(ki->queryFileName());
             if (!keyBuffer)
             {
@@ -993,6 +1004,34 @@ public:
         }
         segs.finish();
     }
+
+    virtual void queuePrefetch() override
+    {
+        if (!keySize)
+            return;
+        void *seek = prefetchKeys.reserve(keySize);
+        memset(seek, 0, keySize);
+        segs.setLow(0, seek);
+        numPrefetchKeys++;
+    }
+
+    virtual unsigned prefetchLeaves() override
+    {
+        unsigned nodesRead = 0;
+        if (numPrefetchKeys)
+        {
+            nodesRead = prefetchFromKeys(numPrefetchKeys, prefetchKeys.toByteArray());
+            prefetchKeys.clear();
+            numPrefetchKeys = 0;
+        }
+        return nodesRead;
+    }
+
+protected:
+    virtual unsigned prefetchFromKeys(unsigned numKeys, const void *keys)
+    {
+        return keyIndex ? keyIndex->prefetchLeaves(numKeys, keys, keySize, ctx) : 0;
+    }
 };
 
 
@@ -1019,34 +1058,254 @@ public:
     CNodeMapping(CKeyIdAndPos &fp, CJHTreeNode &et) : HTMapping<CJHTreeNode, CKeyIdAndPos>(et, fp) { }
     ~CNodeMapping() { this->et.Release(); }
     CJHTreeNode &query() { return queryElement(); }
+
+    bool inProbation = false; // only used by the 2Q policy
 };
 typedef OwningSimpleHashTableOf<CNodeMapping, CKeyIdAndPos> CNodeTable;
 #define FIXED_NODE_OVERHEAD (sizeof(CJHTreeNode))
+#define NODE_CACHE_PROBATION_FRACTION 4     // 2Q: proportion of the cache (1/n) given to nodes that have only been seen once
+#define FREQUENCY_SKETCH_DEPTH 4
+#define FREQUENCY_SKETCH_MAX_COUNT 15
+#define FREQUENCY_SKETCH_AGE_FACTOR 10      // counters are halved after width*n increments
+
+// Count-min sketch used to estimate how often a node has been requested recently (TinyLFU admission)
+class CFrequencySketch
+{
+    byte *counts = nullptr;
+    unsigned widthMask = 0;
+    unsigned additions = 0;
+    unsigned sampleSize = 0;
+
+    inline unsigned getIndex(unsigned hash, unsigned row) const
+    {
+        unsigned step = ((hash >> 17) | (hash << 15)) | 1;
+        return row * (widthMask + 1) + ((hash + row * step) & widthMask);
+    }
+    void age()
+    {
+        unsigned size = FREQUENCY_SKETCH_DEPTH * (widthMask + 1);
+        for (unsigned i = 0; i < size; i++)
+            counts[i] >>= 1;
+        additions /= 2;
+    }
+public:
+    ~CFrequencySketch()
+    {
+        delete [] counts;
+    }
+    void setCapacity(unsigned numEntries)
+    {
+        unsigned width = 256;
+        while (width < numEntries && width < 0x100000)
+            width <<= 1;
+        if (width == widthMask + 1)
+            return;
+        delete [] counts;
+        counts = new byte[FREQUENCY_SKETCH_DEPTH * width];
+        memset(counts, 0, FREQUENCY_SKETCH_DEPTH * width);
+        widthMask = width - 1;
+        additions = 0;
+        sampleSize = width * FREQUENCY_SKETCH_AGE_FACTOR;
+    }
+    void increment(unsigned hash)
+    {
+        for (unsigned row = 0; row < FREQUENCY_SKETCH_DEPTH; row++)
+        {
+            byte &count = counts[getIndex(hash, row)];
+            if (count < FREQUENCY_SKETCH_MAX_COUNT)
+                count++;
+        }
+        if (++additions >= sampleSize)
+            age();
+    }
+    unsigned estimate(unsigned hash) const
+    {
+        unsigned ret = FREQUENCY_SKETCH_MAX_COUNT;
+        for (unsigned row = 0; row < FREQUENCY_SKETCH_DEPTH; row++)
+        {
+            unsigned count = counts[getIndex(hash, row)];
+            if (count < ret)
+                ret = count;
+        }
+        return ret;
+    }
+};
+
 class CNodeMRUCache : public CMRUCacheOf<CKeyIdAndPos, CJHTreeNode, CNodeMapping, CNodeTable>
 {
+    typedef CMRUCacheOf<CKeyIdAndPos, CJHTreeNode, CNodeMapping, CNodeTable> PARENT;
     size32_t sizeInMem, memLimit;
+    NodeCachePolicy policy = NCPlru;
+    QueueOf<CNodeMapping, false> probationList;     // 2Q: FIFO of nodes only accessed once, the main mruList holds the rest
+    size32_t probationSizeInMem = 0;
+    CFrequencySketch frequencies;                   // TinyLFU: recent access frequencies, including nodes not in the cache
+    unsigned hits = 0;
+    unsigned misses = 0;
+    unsigned rejected = 0;
+
+    static inline unsigned getSketchHash(const CKeyIdAndPos &key)
+    {
+        return hashc((const byte *) &key, sizeof(key), 0);
+    }
+    static inline size32_t getMappingSize(CNodeMapping *mapping)
+    {
+        return FIXED_NODE_OVERHEAD+mapping->queryElement().getMemSize();
+    }
+    void evictProbation()
+    {
+        CNodeMapping *tail = probationList.dequeueTail();
+        if (tail)
+            table.removeExact(tail);
+    }
+    void resetSketch()
+    {
+        if (policy == NCPtinylfu)
+            frequencies.setCapacity(((size32_t)-1 == memLimit) ? 0 : memLimit / NODESIZE);
+    }
 public:
     CNodeMRUCache(size32_t _memLimit) : memLimit(0)
     {
         sizeInMem = 0;
         setMemLimit(_memLimit);
     }
+    size32_t queryMemSize() const
+    {
+        return sizeInMem;
+    }
+    NodeCachePolicy queryPolicy() const
+    {
+        return policy;
+    }
+    void getStats(unsigned &_hits, unsigned &_misses, unsigned &_rejected) const
+    {
+        _hits += hits;
+        _misses += misses;
+        _rejected += rejected;
+    }
+    void resetStats()
+    {
+        hits = misses = rejected = 0;
+    }
     size32_t setMemLimit(size32_t _memLimit)
     {
         size32_t oldMemLimit = memLimit;
         memLimit = _memLimit;
+        resetSketch();
         if (full())
             makeSpace();
         return oldMemLimit;
     }
+    NodeCachePolicy setPolicy(NodeCachePolicy _policy)
+    {
+        NodeCachePolicy oldPolicy = policy;
+        if (policy == NCP2q)
+        {
+            // Anything still on probation becomes the least recently used part of the main list
+            for (;;)
+            {
+                CNodeMapping *mapping = probationList.dequeue();
+                if (!mapping)
+                    break;
+                mapping->inProbation = false;
+                mruList.enqueue(mapping);
+            }
+            probationSizeInMem = 0;
+        }
+        policy = _policy;
+        resetSketch();
+        return oldPolicy;
+    }
+    CJHTreeNode *query(CKeyIdAndPos key)
+    {
+        CNodeMapping *mapping = table.find(key);
+        if (!mapping)
+            return NULL;
+        hits++;
+        if (policy == NCPtinylfu)
+            frequencies.increment(getSketchHash(key));
+        if (mapping->inProbation)
+        {
+            // 2Q: a second access moves the node out of probation into the main list
+            probationList.dequeue(mapping);
+            probationSizeInMem -= getMappingSize(mapping);
+            mapping->inProbation = false;
+            mruList.enqueueHead(mapping);
+        }
+        else
+            promote(mapping);
+        return &mapping->query();
+    }
+    bool contains(CKeyIdAndPos key)
+    {
+        // Unlike query(), does not count as an access
+        return table.find(key) != NULL;
+    }
+    void add(CKeyIdAndPos key, CJHTreeNode &node) // takes ownership of node
+    {
+        misses++;
+        switch (policy)
+        {
+        case NCPlru:
+            PARENT::add(key, node);
+            break;
+        case NCP2q:
+        {
+            if (table.find(key))
+            {
+                node.Release();
+                break;
+            }
+            if (full())
+                makeSpace();
+            CNodeMapping *mapping = new CNodeMapping(key, node);
+            mapping->inProbation = true;
+            table.replace(*mapping);
+            probationList.enqueueHead(mapping);
+            probationSizeInMem += getMappingSize(mapping);
+            break;
+        }
+        case NCPtinylfu:
+        {
+            unsigned hash = getSketchHash(key);
+            frequencies.increment(hash);
+            CNodeMapping *victim = mruList.tail();
+            if (full() && victim)
+            {
+                // Only displace the least recently used node if the new one is requested more often
+                if (frequencies.estimate(hash) <= frequencies.estimate(getSketchHash(*(const CKeyIdAndPos *) victim->queryFindParam())))
+                {
+                    rejected++;
+                    node.Release();
+                    break;
+                }
+            }
+            PARENT::add(key, node);
+            break;
+        }
+        }
+    }
+    void kill()
+    {
+        PARENT::kill();
+        for (;;)
+        {
+            CNodeMapping *mapping = probationList.dequeueTail();
+            if (!mapping)
+                break;
+            table.removeExact(mapping);
+        }
+    }
     virtual void makeSpace()
     {
-        // remove LRU until !full
+        // remove LRU (or, for 2Q, the oldest probationary node once probation exceeds its share) until !full
         do
         {
-            clear(1);
+            if (probationList.ordinality() && (!mruList.ordinality() || probationSizeInMem > memLimit / NODE_CACHE_PROBATION_FRACTION))
+                evictProbation();
+            else
+                clear(1);
         }
-        while (full());
+        while (full() && (mruList.ordinality() || probationList.ordinality()));
     }
     virtual bool full()
     {
@@ -1055,42 +1314,129 @@ public:
     }
     virtual void elementAdded(CNodeMapping *mapping)
     {
-        CJHTreeNode &node = mapping->queryElement();
-        sizeInMem += (FIXED_NODE_OVERHEAD+node.getMemSize());
+        sizeInMem += getMappingSize(mapping);
     }
     virtual void elementRemoved(CNodeMapping *mapping)
     {
-        CJHTreeNode &node = mapping->queryElement();
-        sizeInMem -= (FIXED_NODE_OVERHEAD+node.getMemSize());
+        size32_t size = getMappingSize(mapping);
+        sizeInMem -= size;
+        if (mapping->inProbation)
+            probationSizeInMem -= size;
     }
 };
 
-class CNodeCache : public CInterface
+// The node cache is split into a number of shards, each with its own lock and its own node/leaf/blob
+// caches, so that concurrent lookups of different nodes do not all serialize on a single critical section.
+// A node is always found in the shard selected by hashing its key id and position.
+class CNodeCacheShard
 {
-private:
+public:
+    CNodeCacheShard() : nodeCache(0), leafCache(0), blobCache(0), preloadCache((unsigned) -1)
+    {
+    }
+
     mutable CriticalSection lock;
     CNodeMRUCache nodeCache;
     CNodeMRUCache leafCache;
     CNodeMRUCache blobCache;
     CNodeMRUCache preloadCache;
+    RelaxedAtomic<unsigned> nodeCacheHits{0};
+    RelaxedAtomic<unsigned> leafCacheHits{0};
+    RelaxedAtomic<unsigned> blobCacheHits{0};
+    RelaxedAtomic<unsigned> preloadCacheHits{0};
+
+    void resetStats()
+    {
+        nodeCacheHits.store(0);
+        leafCacheHits.store(0);
+        blobCacheHits.store(0);
+        preloadCacheHits.store(0);
+        CriticalBlock block(lock);
+        nodeCache.resetStats();
+        leafCache.resetStats();
+        blobCache.resetStats();
+    }
+};
+
+#define NODE_CACHE_SHARD_HASH_SEED 0x9e3779b9 // must differ from the seed used by the per-shard hash tables
+
+class CNodeCache : public CInterface
+{
+private:
+    unsigned numShards;
+    CNodeCacheShard *shards;
+    size32_t nodeCacheMem;
+    size32_t leafCacheMem;
+    size32_t blobCacheMem;
     bool cacheNodes; 
     bool cacheLeaves;
     bool cacheBlobs;
     bool preloadNodes;
+
+    inline CNodeCacheShard &queryShard(const CKeyIdAndPos &key) const
+    {
+        return shards[hashc((const byte *) &key, sizeof(key), NODE_CACHE_SHARD_HASH_SEED) % numShards];
+    }
+    inline size32_t getShardLimit(size32_t totalSize) const
+    {
+        if (totalSize == (size32_t) -1)
+            return totalSize;
+        return totalSize / numShards;
+    }
+    // Lookups read the cache settings with only their own shard locked, so changing them locks every shard (always in the same order)
+    class CAllShardsBlock
+    {
+        CNodeCache &cache;
+    public:
+        CAllShardsBlock(CNodeCache &_cache) : cache(_cache)
+        {
+            for (unsigned i = 0; i < cache.numShards; i++)
+                cache.shards[i].lock.enter();
+        }
+        ~CAllShardsBlock()
+        {
+            for (unsigned i = cache.numShards; i--;)
+                cache.shards[i].lock.leave();
+        }
+    };
 public:
-    CNodeCache(size32_t maxNodeMem, size32_t maxLeaveMem, size32_t maxBlobMem)
-        : nodeCache(maxNodeMem), leafCache(maxLeaveMem), blobCache(maxBlobMem), preloadCache((unsigned) -1)
+    CNodeCache(size32_t maxNodeMem, size32_t maxLeaveMem, size32_t maxBlobMem, unsigned _numShards)
+        : numShards(_numShards ? _numShards : 1), nodeCacheMem(maxNodeMem), leafCacheMem(maxLeaveMem), blobCacheMem(maxBlobMem)
     {
+        shards = new CNodeCacheShard[numShards];
+        for (unsigned i = 0; i < numShards; i++)
+        {
+            shards[i].nodeCache.setMemLimit(getShardLimit(maxNodeMem));
+            shards[i].leafCache.setMemLimit(getShardLimit(maxLeaveMem));
+            shards[i].blobCache.setMemLimit(getShardLimit(maxBlobMem));
+        }
         cacheNodes = maxNodeMem != 0;
         cacheLeaves = maxLeaveMem != 0;;
         cacheBlobs = maxBlobMem != 0;
         preloadNodes = false;
         // note that each index caches the last blob it unpacked so that sequential blobfetches are still ok
     }
+    ~CNodeCache()
+    {
+        delete [] shards;
+    }
     CJHTreeNode *getNode(INodeLoader *key, int keyID, offset_t pos, IContextLogger *ctx, bool isTLK);
     void preload(CJHTreeNode *node, int keyID, offset_t pos, IContextLogger *ctx);
 
     bool isPreloaded(int keyID, offset_t pos);
+    bool isCached(int keyID, offset_t pos);
+
+    inline bool isCachingLeaves() const
+    {
+        return cacheLeaves;
+    }
+    inline unsigned getPrefetchLimit(size32_t nodeSize) const
+    {
+        // Leaves are held expanded, so allow for twice their size on disk
+        if (leafCacheMem == (size32_t) -1)
+            return (unsigned) -1;
+        return leafCacheMem / (2 * nodeSize);
+    }
 
     inline bool getNodeCachePreload() 
     {
@@ -1099,38 +1445,107 @@ public:
 
     inline bool setNodeCachePreload(bool _preload)
     {
+        CAllShardsBlock block(*this);
         bool oldPreloadNodes = preloadNodes;
         preloadNodes = _preload;
         return oldPreloadNodes;
     }
 
+    inline unsigned queryNumShards() const
+    {
+        return numShards;
+    }
+
     inline size32_t setNodeCacheMem(size32_t newSize)
     {
-        CriticalBlock block(lock);
-        unsigned oldV = nodeCache.setMemLimit(newSize);
+        CAllShardsBlock block(*this);
+        size32_t oldV = nodeCacheMem;
+        nodeCacheMem = newSize;
+        for (unsigned i = 0; i < numShards; i++)
+            shards[i].nodeCache.setMemLimit(getShardLimit(newSize));
         cacheNodes = (newSize != 0);
         return oldV;
     }
     inline size32_t setLeafCacheMem(size32_t newSize)
     {
-        CriticalBlock block(lock);
-        unsigned oldV = leafCache.setMemLimit(newSize);
+        CAllShardsBlock block(*this);
+        size32_t oldV = leafCacheMem;
+        leafCacheMem = newSize;
+        for (unsigned i = 0; i < numShards; i++)
+            shards[i].leafCache.setMemLimit(getShardLimit(newSize));
         cacheLeaves = (newSize != 0); 
         return oldV;
     }
     inline size32_t setBlobCacheMem(size32_t newSize)
     {
-        CriticalBlock block(lock);
-        unsigned oldV = blobCache.setMemLimit(newSize);
+        CAllShardsBlock block(*this);
+        size32_t oldV = blobCacheMem;
+        blobCacheMem = newSize;
+        for (unsigned i = 0; i < numShards; i++)
+            shards[i].blobCache.setMemLimit(getShardLimit(newSize));
         cacheBlobs = (newSize != 0); 
         return oldV;
     }
+    NodeCachePolicy setCachePolicy(CNodeMRUCache CNodeCacheShard::*cache, NodeCachePolicy policy)
+    {
+        NodeCachePolicy oldPolicy = NCPlru;
+        for (unsigned i = 0; i < numShards; i++)
+        {
+            CriticalBlock block(shards[i].lock);
+            oldPolicy = (shards[i].*cache).setPolicy(policy);
+        }
+        return oldPolicy;
+    }
+    StringBuffer &getCachePolicyMetrics(StringBuffer &xml, const char *name, CNodeMRUCache CNodeCacheShard::*cache) const
+    {
+        unsigned hits = 0, misses = 0, rejected = 0;
+        NodeCachePolicy policy = NCPlru;
+        for (unsigned i = 0; i < numShards; i++)
+        {
+            CriticalBlock block(shards[i].lock);
+            (shards[i].*cache).getStats(hits, misses, rejected);
+            policy = (shards[i].*cache).queryPolicy();
+        }
+        unsigned hitRate = (hits + misses) ? (unsigned)(((unsigned __int64) hits * 100) / (hits + misses)) : 0;
+        return xml.appendf(" <%s policy=\"%s\" hits=\"%u\" misses=\"%u\" rejected=\"%u\" hitRate=\"%u%%\"/>\n",
+                           name, getNodeCachePolicyName(policy), hits, misses, rejected, hitRate);
+    }
     void clear()
     {
-        CriticalBlock block(lock);
-        nodeCache.kill();
-        leafCache.kill();
-        blobCache.kill();
+        for (unsigned i = 0; i < numShards; i++)
+        {
+            CriticalBlock block(shards[i].lock);
+            shards[i].nodeCache.kill();
+            shards[i].leafCache.kill();
+            shards[i].blobCache.kill();
+        }
+    }
+    void resetStats()
+    {
+        for (unsigned i = 0; i < numShards; i++)
+            shards[i].resetStats();
+    }
+    StringBuffer &getMetrics(StringBuffer &xml) const
+    {
+        xml.appendf(" <NodeCacheMetrics shards=\"%u\">\n", numShards);
+        for (unsigned i = 0; i < numShards; i++)
+        {
+            const CNodeCacheShard &shard = shards[i];
+            size32_t nodeMem, leafMem, blobMem;
+            {
+                CriticalBlock block(shard.lock);
+                nodeMem = shard.nodeCache.queryMemSize();
+                leafMem = shard.leafCache.queryMemSize();
+                blobMem = shard.blobCache.queryMemSize();
+            }
+            xml.appendf(" <Shard id=\"%u\" nodeCacheHits=\"%u\" leafCacheHits=\"%u\" blobCacheHits=\"%u\" preloadCacheHits=\"%u\" nodeCacheMem=\"%u\" leafCacheMem=\"%u\" blobCacheMem=\"%u\"/>\n",
+                        i, shard.nodeCacheHits.load(), shard.leafCacheHits.load(), shard.blobCacheHits.load(), shard.preloadCacheHits.load(), nodeMem, leafMem, blobMem);
+        }
+        getCachePolicyMetrics(xml, "NodeCache", &CNodeCacheShard::nodeCache);
+        getCachePolicyMetrics(xml, "LeafCache", &CNodeCacheShard::leafCache);
+        getCachePolicyMetrics(xml, "BlobCache", &CNodeCacheShard::blobCache);
+        xml.append(" </NodeCacheMetrics>\n");
+        return xml;
     }
 };
 
@@ -1138,7 +1553,7 @@ static inline CNodeCache *queryNodeCache()
 {
     if (nodeCache) return nodeCache; // avoid crit
     CriticalBlock b(*initCrit);
-    if (!nodeCache) nodeCache = new CNodeCache(100*0x100000, 50*0x100000, 0);
+    if (!nodeCache) nodeCache = new CNodeCache(100*0x100000, 50*0x100000, 0, nodeCacheShards);
     return nodeCache;
 }
 
@@ -1521,6 +1936,9 @@ CJHTreeNode *CKeyIndex::loadNode(char *nodeData, offset_t pos, bool needsCopy)
         case 3:
             ret.setown(new CJHTreeMetadataNode());
             break;
+        case 4:
+            ret.setown(new CJHFrontCodedNode());
+            break;
         default:
             throwUnexpected();
         }
@@ -1565,6 +1983,237 @@ CJHTreeNode *CKeyIndex::getNode(offset_t offset, IContextLogger *ctx)
     return cache->getNode(this, iD, offset, ctx, isTopLevelKey()); 
 }
 
+static int compareNodePositions(const unsigned __int64 *left, const unsigned __int64 *right)
+{
+    return (*left < *right) ? -1 : (*left > *right) ? 1 : 0;
+}
+
+// The nodes missing from one level of a prefetch, read by the calling thread and any readers it can borrow from the pool
+class CPrefetchBatch
+{
+    CNodeCache *cache;
+    INodeLoader *loader;
+    int keyID;
+    bool isTLK;
+    IContextLogger *ctx;
+    const UInt64Array &positions;
+    const UnsignedArray &misses;
+    Owned<CJHTreeNode> *nodes;
+    std::atomic<unsigned> nextMiss{0};
+    CriticalSection crit;
+    Owned<IException> exception;
+public:
+    Semaphore done;
+
+    CPrefetchBatch(CNodeCache *_cache, INodeLoader *_loader, int _keyID, bool _isTLK, IContextLogger *_ctx, const UInt64Array &_positions, const UnsignedArray &_misses, Owned<CJHTreeNode> *_nodes)
+        : cache(_cache), loader(_loader), keyID(_keyID), isTLK(_isTLK), ctx(_ctx), positions(_positions), misses(_misses), nodes(_nodes)
+    {
+    }
+    void read()
+    {
+        try
+        {
+            for (;;)
+            {
+                unsigned next = nextMiss++;
+                if (next >= misses.ordinality())
+                    break;
+                unsigned which = misses.item(next);
+                nodes[which].setown(cache->getNode(loader, keyID, positions.item(which), ctx, isTLK));
+            }
+        }
+        catch (IException *e)
+        {
+            nextMiss = misses.ordinality();
+            CriticalBlock block(crit);
+            if (exception)
+                e->Release();
+            else
+                exception.setown(e);
+        }
+    }
+    void checkException()
+    {
+        if (exception)
+            throw exception.getClear();
+    }
+};
+
+class CPrefetchReader : public CInterface, implements IPooledThread
+{
+    CPrefetchBatch *batch = nullptr;
+public:
+    IMPLEMENT_IINTERFACE;
+
+    virtual void init(void *param) override
+    {
+        batch = (CPrefetchBatch *) param;
+    }
+    virtual void main() override
+    {
+        CPrefetchBatch *current = batch;
+        batch = nullptr;
+        current->read();
+        current->done.signal();     // current may be freed once signalled
+    }
+    virtual bool stop() override
+    {
+        return true;
+    }
+    virtual bool canReuse() override
+    {
+        return true;
+    }
+};
+
+class CPrefetchReaderFactory : public CInterface, implements IThreadFactory
+{
+public:
+    IMPLEMENT_IINTERFACE;
+
+    virtual IPooledThread *createNew() override
+    {
+        return new CPrefetchReader;
+    }
+};
+
+static IThreadPool *queryPrefetchPool()
+{
+    CriticalBlock b(*initCrit);
+    if (!prefetchPool)
+    {
+        // Shared by every prefetching lookup, so keyPrefetchReaders bounds the extra reads in flight across the process
+        Owned<IThreadFactory> factory = new CPrefetchReaderFactory;
+        prefetchPool = createThreadPool("KeyPrefetchReaders", factory, NULL, keyPrefetchReaders);
+    }
+    return prefetchPool;
+}
+
+unsigned CKeyIndex::prefetchLeaves(unsigned numKeys, const void *keys, size32_t keyLen, IContextLogger *ctx)
+{
+    // Walk the whole batch of searches down the tree together, one level at a time. At each level the distinct
+    // child positions are sorted into file order, and those not already cached are read by the calling thread
+    // together with any readers it can borrow from the shared pool, so the reads overlap instead of each lookup
+    // waiting for its own leaf in turn.
+    if (!numKeys || !keyPrefetchReaders || !rootNode || rootNode->isLeaf() || !cache->isCachingLeaves())
+        return 0;
+
+    // Each search needs at most one leaf, so only prefetch as many searches as the leaf cache can hold -
+    // any more would evict the first leaves read before they are used
+    unsigned maxLeaves = cache->getPrefetchLimit(keyHdr->getNodeSize());
+    if (!maxLeaves)
+        return 0;
+    if (numKeys > maxLeaves)
+        numKeys = maxLeaves;
+
+    const char *searchKeys = (const char *) keys;
+    CIArrayOf<CJHTreeNode> level;
+    level.append(*LINK(rootNode));
+    UnsignedArray keyNodes;     // index into level of the node each search has reached, or NotFound
+    keyNodes.ensure(numKeys);
+    for (unsigned i = 0; i < numKeys; i++)
+        keyNodes.append(0);
+    unsigned nodesRead = 0;
+    for (;;)
+    {
+        UInt64Array childPositions;
+        UInt64Array positions;
+        for (unsigned i = 0; i < numKeys; i++)
+        {
+            offset_t childPos = 0;
+            unsigned nodeIdx = keyNodes.item(i);
+            if (nodeIdx != NotFound)
+            {
+                CJHTreeNode &node = level.item(nodeIdx);
+                unsigned a = node.locateGE(searchKeys + (size_t) i * keyLen, 0);
+                if (a < node.getNumKeys())
+                    childPos = node.getFPosAt(a);
+            }
+            childPositions.append(childPos);
+            if (childPos)
+                positions.append(childPos);
+        }
+        if (!positions.ordinality())
+            break;
+
+        positions.sort(compareNodePositions);
+        unsigned numDistinct = 0;
+        ForEachItemIn(p, positions)
+        {
+            if (!numDistinct || positions.item(p) != positions.item(numDistinct-1))
+                positions.replace(positions.item(p), numDistinct++);
+        }
+        positions.trunc(numDistinct);
+
+        UnsignedArray misses;
+        for (unsigned p = 0; p < numDistinct; p++)
+        {
+            if (!cache->isCached(iD, positions.item(p)))
+                misses.append(p);
+        }
+        std::unique_ptr<Owned<CJHTreeNode>[]> nodes(new Owned<CJHTreeNode>[numDistinct]);
+        if (misses.ordinality())
+        {
+            unsigned numReaders = misses.ordinality() < keyPrefetchReaders ? misses.ordinality() : keyPrefetchReaders;
+            CPrefetchBatch batch(cache, this, iD, isTopLevelKey(), ctx, positions, misses, nodes.get());
+            unsigned started = 0;
+            if (numReaders > 1)
+            {
+                IThreadPool *pool = queryPrefetchPool();
+                for (; started < numReaders-1; started++)
+                {
+                    try
+                    {
+                        pool->startNoBlock(&batch);
+                    }
+                    catch (IException *e)
+                    {
+                        e->Release();   // all the pooled readers are busy, this thread reads the rest itself
+                        break;
+                    }
+                }
+            }
+            batch.read();
+            while (started--)
+                batch.done.wait();
+            batch.checkException();
+            nodesRead += misses.ordinality();
+        }
+
+        level.kill();
+        for (unsigned p = 0; p < numDistinct; p++)
+        {
+            if (!nodes[p])
+                nodes[p].setown(cache->getNode(this, iD, positions.item(p), ctx, isTopLevelKey()));
+            level.append(*nodes[p].getClear());
+        }
+        if (level.item(0).isLeaf())
+            break;
+
+        for (unsigned i = 0; i < numKeys; i++)
+        {
+            offset_t childPos = childPositions.item(i);
+            unsigned nodeIdx = NotFound;
+            if (childPos)
+            {
+                unsigned lo = 0;
+                unsigned hi = numDistinct;
+                while (lo < hi)
+                {
+                    unsigned mid = (lo + hi) / 2;
+                    if (positions.item(mid) < childPos)
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+                nodeIdx = lo;
+            }
+            keyNodes.replace(nodeIdx, i);
+        }
+    }
+    return nodesRead;
+}
+
 void dumpNode(FILE *out, CJHTreeNode *node, int length, unsigned rowCount, bool raw)
 {
     if (!raw)
@@ -1849,18 +2498,8 @@ bool CKeyCursor::gtEqual(const char *src, char *dst, bool seekForward)
         node.set(key.rootNode);
     for (;;)
     {
-        unsigned int a = lwm;
-        int b = node->getNumKeys();
-        // first search for first GTE entry (result in b(<),a(>=))
-        while ((int)a<b)
-        {
-            int i = a+(b-a)/2;
-            int rc = node->compareValueAt(src, i);
-            if (rc>0)
-                a = i+1;
-            else
-                b = i;
-        }
+        // first search for first GTE entry
+        unsigned int a = node->locateGE(src, lwm);
         if (node->isLeaf())
         {
             if (a<node->getNumKeys())
@@ -1922,18 +2561,8 @@ bool CKeyCursor::ltEqual(const char *src, char *dst, bool seekForward)
         node.set(key.rootNode);
     for (;;)
     {
-        unsigned int a = lwm;
-        int b = node->getNumKeys();
         // Locate first record greater than src
-        while ((int)a<b)
-        {
-            int i = a+(b+1-a)/2;
-            int rc = node->compareValueAt(src, i-1);
-            if (rc>=0)
-                a = i;
-            else
-                b = i-1;
-        }
+        unsigned int a = node->locateGT(src, lwm);
         if (node->isLeaf())
         {
             // record we want is the one before first record greater than src.
@@ -2075,6 +2704,7 @@ public:
     virtual IPropertyTree * getMetadata() { return checkOpen().getMetadata(); }
     virtual unsigned getNodeSize() { return checkOpen().getNodeSize(); }
     virtual const IFileIO *queryFileIO() const override { return iFileIO; } // NB: if not yet opened, will be null
+    virtual unsigned prefetchLeaves(unsigned numKeys, const void *keys, size32_t keyLen, IContextLogger *ctx) override { return checkOpen().prefetchLeaves(numKeys, keys, keyLen, ctx); }
 };
 
 extern jhtree_decl IKeyIndex *createKeyIndex(const char *keyfile, unsigned crc, IFileIO &iFileIO, bool isTLK, bool preloadAllowed)
@@ -2117,7 +2747,8 @@ extern jhtree_decl void clearKeyStoreCacheEntry(const IFileIO *io)
 
 extern jhtree_decl StringBuffer &getIndexMetrics(StringBuffer &ret)
 {
-    return queryKeyStore()->getMetrics(ret);
+    queryKeyStore()->getMetrics(ret);
+    return queryNodeCache()->getMetrics(ret);
 }
 
 extern jhtree_decl void resetIndexMetrics()
@@ -2158,6 +2789,52 @@ extern jhtree_decl bool setNodeCachePreload(bool preload)
     return queryNodeCache()->setNodeCachePreload(preload);
 }
 
+extern jhtree_decl unsigned setNodeCacheShards(unsigned numShards)
+{
+    CriticalBlock b(*initCrit);
+    unsigned oldShards = nodeCacheShards;
+    if (nodeCache)
+        WARNLOG("setNodeCacheShards(%u) ignored - node cache already created with %u shards", numShards, nodeCache->queryNumShards());
+    else
+        nodeCacheShards = numShards ? numShards : 1;
+    return oldShards;
+}
+
+extern jhtree_decl NodeCachePolicy setNodeCachePolicy(NodeCachePolicy policy)
+{
+    return queryNodeCache()->setCachePolicy(&CNodeCacheShard::nodeCache, policy);
+}
+
+extern jhtree_decl NodeCachePolicy setLeafCachePolicy(NodeCachePolicy policy)
+{
+    return queryNodeCache()->setCachePolicy(&CNodeCacheShard::leafCache, policy);
+}
+
+extern jhtree_decl NodeCachePolicy setBlobCachePolicy(NodeCachePolicy policy)
+{
+    return queryNodeCache()->setCachePolicy(&CNodeCacheShard::blobCache, policy);
+}
+
+static const char * const nodeCachePolicyNames[] = { "lru", "2q", "tinylfu" };
+
+extern jhtree_decl NodeCachePolicy getNodeCachePolicy(const char *name)
+{
+    if (name)
+    {
+        for (unsigned i = 0; i < _elements_in(nodeCachePolicyNames); i++)
+        {
+            if (strieq(name, nodeCachePolicyNames[i]))
+                return (NodeCachePolicy) i;
+        }
+    }
+    return NCPlru;
+}
+
+extern jhtree_decl const char *getNodeCachePolicyName(NodeCachePolicy policy)
+{
+    return nodeCachePolicyNames[policy];
+}
+
 extern jhtree_decl size32_t setNodeCacheMem(size32_t cacheSize)
 {
     return queryNodeCache()->setNodeCacheMem(cacheSize);
@@ -2186,55 +2863,60 @@ CJHTreeNode *CNodeCache::getNode(INodeLoader *keyIndex, int iD, offset_t pos, IC
         return NULL;
     { 
         // It's a shame that we don't know the type before we read it. But probably not that big a deal
-        CriticalBlock block(lock);
         CKeyIdAndPos key(iD, pos);
+        CNodeCacheShard &shard = queryShard(key);
+        CriticalBlock block(shard.lock);
         if (preloadNodes)
         {
-            CJHTreeNode *cacheNode = preloadCache.query(key);
+            CJHTreeNode *cacheNode = shard.preloadCache.query(key);
             if (cacheNode)
             {
                 cacheHits++;
                 if (ctx) ctx->noteStatistic(StNumPreloadCacheHits, 1);
                 preloadCacheHits++;
+                shard.preloadCacheHits++;
                 return LINK(cacheNode);
             }
         }
         if (cacheNodes)
         {
-            CJHTreeNode *cacheNode = nodeCache.query(key);
+            CJHTreeNode *cacheNode = shard.nodeCache.query(key);
             if (cacheNode)
             {
                 cacheHits++;
                 if (ctx) ctx->noteStatistic(StNumNodeCacheHits, 1);
                 nodeCacheHits++;
+                shard.nodeCacheHits++;
                 return LINK(cacheNode);
             }
         }
         if (cacheLeaves)
         {
-            CJHTreeNode *cacheNode = leafCache.query(key);
+            CJHTreeNode *cacheNode = shard.leafCache.query(key);
             if (cacheNode)
             {
                 cacheHits++;
                 if (ctx) ctx->noteStatistic(StNumLeafCacheHits, 1);
                 leafCacheHits++;
+                shard.leafCacheHits++;
                 return LINK(cacheNode);
             }
         }
         if (cacheBlobs)
         {
-            CJHTreeNode *cacheNode = blobCache.query(key);
+            CJHTreeNode *cacheNode = shard.blobCache.query(key);
             if (cacheNode)
             {
                 cacheHits++;
                 if (ctx) ctx->noteStatistic(StNumBlobCacheHits, 1);
                 blobCacheHits++;
+                shard.blobCacheHits++;
                 return LINK(cacheNode);
             }
         }
         CJHTreeNode *node;
         {
-            CriticalUnblock block(lock);
+            CriticalUnblock block(shard.lock);
             node = keyIndex->loadNode(pos);  // NOTE - don't want cache locked while we load!
         }
         cacheAdds++;
@@ -2242,54 +2924,57 @@ CJHTreeNode *CNodeCache::getNode(INodeLoader *keyIndex, int iD, offset_t pos, IC
         {
             if (cacheBlobs)
             {
-                CJHTreeNode *cacheNode = blobCache.query(key); // check if added to cache while we were reading
+                CJHTreeNode *cacheNode = shard.blobCache.query(key); // check if added to cache while we were reading
                 if (cacheNode)
                 {
                     ::Release(node);
                     cacheHits++;
                     if (ctx) ctx->noteStatistic(StNumBlobCacheHits, 1);
                     blobCacheHits++;
+                    shard.blobCacheHits++;
                     return LINK(cacheNode);
                 }
                 if (ctx) ctx->noteStatistic(StNumBlobCacheAdds, 1);
                 blobCacheAdds++;
-                blobCache.add(key, *LINK(node));
+                shard.blobCache.add(key, *LINK(node));
             }
         }
         else if (node->isLeaf() && !isTLK) // leaves in TLK are cached as if they were nodes
         {
             if (cacheLeaves)
             {
-                CJHTreeNode *cacheNode = leafCache.query(key); // check if added to cache while we were reading
+                CJHTreeNode *cacheNode = shard.leafCache.query(key); // check if added to cache while we were reading
                 if (cacheNode)
                 {
                     ::Release(node);
                     cacheHits++;
                     if (ctx) ctx->noteStatistic(StNumLeafCacheHits, 1);
                     leafCacheHits++;
+                    shard.leafCacheHits++;
                     return LINK(cacheNode);
                 }
                 if (ctx) ctx->noteStatistic(StNumLeafCacheAdds, 1);
                 leafCacheAdds++;
-                leafCache.add(key, *LINK(node));
+                shard.leafCache.add(key, *LINK(node));
             }
         }
         else
         {
             if (cacheNodes)
             {
-                CJHTreeNode *cacheNode = nodeCache.query(key); // check if added to cache while we were reading
+                CJHTreeNode *cacheNode = shard.nodeCache.query(key); // check if added to cache while we were reading
                 if (cacheNode)
                 {
                     ::Release(node);
                     cacheHits++;
                     if (ctx) ctx->noteStatistic(StNumNodeCacheHits, 1);
                     nodeCacheHits++;
+                    shard.nodeCacheHits++;
                     return LINK(cacheNode);
                 }
                 if (ctx) ctx->noteStatistic(StNumNodeCacheAdds, 1);
                 nodeCacheAdds++;
-                nodeCache.add(key, *LINK(node));
+                shard.nodeCache.add(key, *LINK(node));
             }
         }
         return node;
@@ -2300,23 +2985,35 @@ void CNodeCache::preload(CJHTreeNode *node, int iD, offset_t pos, IContextLogger
 {
     assertex(pos);
     assertex(preloadNodes);
-    CriticalBlock block(lock);
     CKeyIdAndPos key(iD, pos);
-    CJHTreeNode *cacheNode = preloadCache.query(key);
+    CNodeCacheShard &shard = queryShard(key);
+    CriticalBlock block(shard.lock);
+    CJHTreeNode *cacheNode = shard.preloadCache.query(key);
     if (!cacheNode)
     {
         cacheAdds++;
         if (ctx) ctx->noteStatistic(StNumPreloadCacheAdds, 1);
         preloadCacheAdds++;
-        preloadCache.add(key, *LINK(node));
+        shard.preloadCache.add(key, *LINK(node));
     }
 }
 
 bool CNodeCache::isPreloaded(int iD, offset_t pos)
 {
-    CriticalBlock block(lock);
     CKeyIdAndPos key(iD, pos);
-    return NULL != preloadCache.query(key);
+    CNodeCacheShard &shard = queryShard(key);
+    CriticalBlock block(shard.lock);
+    return NULL != shard.preloadCache.query(key);
+}
+
+bool CNodeCache::isCached(int iD, offset_t pos)
+{
+    CKeyIdAndPos key(iD, pos);
+    CNodeCacheShard &shard = queryShard(key);
+    CriticalBlock block(shard.lock);
+    if (preloadNodes && shard.preloadCache.contains(key))
+        return true;
+    return (cacheNodes && shard.nodeCache.contains(key)) || (cacheLeaves && shard.leafCache.contains(key));
 }
 
 RelaxedAtomic<unsigned> cacheAdds;
@@ -2344,6 +3041,8 @@ void clearNodeStats()
     nodeCacheAdds.store(0);
     preloadCacheHits.store(0);
     preloadCacheAdds.store(0);
+    if (nodeCache)
+        nodeCache->resetStats();
 }
 
 //------------------------------------------------------------------------------------------------
@@ -2943,6 +3642,15 @@ public:
         if (sortFieldOffset)
             replicateForTrailingSort();
     }
+
+protected:
+    virtual unsigned prefetchFromKeys(unsigned numKeys, const void *keys) override
+    {
+        unsigned nodesRead = 0;
+        for (unsigned i = 0; i < numkeys; i++)
+            nodesRead += keyset->queryPart(i)->prefetchLeaves(numKeys, keys, keySize, ctx);
+        return nodesRead;
+    }
 };
 
 extern jhtree_decl IKeyManager *createKeyMerger(IKeyIndexSet * _keys, unsigned _rawSize, unsigned _sortFieldOffset, IContextLogger *_ctx)
@@ -3020,8 +3728,15 @@ class IKeyManagerTest : public CppUnit::TestFixture
     CPPUNIT_TEST_SUITE( IKeyManagerTest  );
         CPPUNIT_TEST(testStepping);
         CPPUNIT_TEST(testKeys);
+        CPPUNIT_TEST(testCachePolicies);
+        CPPUNIT_TEST(testFrontCodedKeys);
+        CPPUNIT_TEST(testFrontCodedNodes);
+        CPPUNIT_TEST(testNodeSearchPrefixes);
+        CPPUNIT_TEST(testPrefetch);
     CPPUNIT_TEST_SUITE_END();
 
+    unsigned keyFormatFlags = 0;
+
     void testStepping()
     {
         buildTestKeys(false, false, false, false);
@@ -3138,7 +3853,7 @@ class IKeyManagerTest : public CppUnit::TestFixture
         Owned<IFileIOStream> out = createIOStream(io);
         unsigned maxRecSize = (variable && blobby) ? 18 : 10;
         unsigned keyedSize = (shortForm || (variable && blobby)) ? 10 : (unsigned) -1;
-        Owned<IKeyBuilder> builder = createKeyBuilder(out, COL_PREFIX | HTREE_FULLSORT_KEY | HTREE_COMPRESSED_KEY |  (variable ? HTREE_VARSIZE : 0), maxRecSize, NODESIZE, keyedSize, 0);
+        Owned<IKeyBuilder> builder = createKeyBuilder(out, COL_PREFIX | HTREE_FULLSORT_KEY | HTREE_COMPRESSED_KEY |  (variable ? HTREE_VARSIZE : 0) | keyFormatFlags, maxRecSize, NODESIZE, keyedSize, 0);
 
         char keybuf[18];
         memset(keybuf, '0', 18);
@@ -3393,15 +4108,521 @@ protected:
         removeTestKeys();
     }
 
+    // Returns whether a frequently used node survives a scan of many nodes that are only used once
+    bool hotNodeSurvivesScan(CKeyIndex *index, NodeCachePolicy policy)
+    {
+        unsigned nodeSize = index->getNodeSize();
+        Owned<CJHTreeNode> node = index->loadNode(nodeSize);
+        size32_t nodeMem = FIXED_NODE_OVERHEAD + node->getMemSize();
+        CNodeMRUCache cache(nodeMem * 16);
+        cache.setPolicy(policy);
+        CKeyIdAndPos hot(1, nodeSize);
+        for (unsigned i = 0; i < 10; i++)
+        {
+            if (!cache.query(hot))
+                cache.add(hot, *index->loadNode(nodeSize));
+        }
+        for (unsigned i = 2; i < 200; i++)
+        {
+            CKeyIdAndPos cold(1, (offset_t) i * nodeSize);
+            if (!cache.query(cold))
+                cache.add(cold, *index->loadNode(nodeSize));
+        }
+        return cache.query(hot) != NULL;
+    }
+
+    void testCachePolicies()
+    {
+        buildTestKeys(false, false, false, false);
+        {
+            OwnedIFile file = createIFile("keyfile1.$$$");
+            OwnedIFileIO io = file->open(IFOread);
+            Owned<CKeyIndex> index = new CDiskKeyIndex(1, io.getClear(), "keyfile1.$$$", false, false);
+            ASSERT(!hotNodeSurvivesScan(index, NCPlru));
+            ASSERT(hotNodeSurvivesScan(index, NCP2q));
+            ASSERT(hotNodeSurvivesScan(index, NCPtinylfu));
+            ASSERT(getNodeCachePolicy("2Q") == NCP2q);
+            ASSERT(getNodeCachePolicy("unknown") == NCPlru);
+        }
+        removeTestKeys();
+    }
+
     void testKeys()
     {
         ASSERT(sizeof(CKeyIdAndPos) == sizeof(unsigned __int64) + sizeof(offset_t));
         for (unsigned i = 0; i < 16; i++)
             testKeys((i & 0x8)!=0,(i & 0x4)!=0,(i & 0x2)!=0,(i & 0x1)!=0);
     }
+
+    void testFrontCodedKeys()
+    {
+        keyFormatFlags = HTREE_FRONTCODED_LEAF; // variable size keys fall back to the original leaf format
+        for (unsigned i = 0; i < 16; i++)
+            testKeys((i & 0x8)!=0,(i & 0x4)!=0,(i & 0x2)!=0,(i & 0x1)!=0);
+    }
+
+    void testFrontCodedNodes()
+    {
+        // 8 keyed bytes containing duplicates and gaps, followed by a 12 byte payload
+        const char *filename = "keyfile4.$$$";
+        const unsigned numRows = 20000;
+        {
+            OwnedIFile file = createIFile(filename);
+            OwnedIFileIO io = file->openShared(IFOcreate, IFSHfull);
+            Owned<IFileIOStream> out = createIOStream(io);
+            Owned<IKeyBuilder> builder = createKeyBuilder(out, COL_PREFIX | HTREE_FULLSORT_KEY | HTREE_COMPRESSED_KEY | HTREE_FRONTCODED_LEAF, 20, NODESIZE, 8, 0);
+            char row[21];
+            for (unsigned i = 0; i < numRows; i++)
+            {
+                sprintf(row, "%08u%012u", (i / 3) * 2, i);
+                builder->processKeyData(row, i*10, 20);
+            }
+            builder->finish();
+            out->flush();
+        }
+        validateKeyFile(filename);
+        {
+            OwnedIFile file = createIFile(filename);
+            OwnedIFileIO io = file->open(IFOread);
+            Owned<CKeyIndex> index = new CDiskKeyIndex(1, io.getClear(), filename, false, false);
+            unsigned nodeSize = index->getNodeSize();
+            unsigned row = 0;
+            for (offset_t pos = nodeSize; ; pos += nodeSize)
+            {
+                Owned<CJHTreeNode> node = index->loadNode(pos);
+                if (!node->isLeaf())
+                    break;
+                ASSERT(dynamic_cast<CJHFrontCodedNode *>(node.get()) != NULL);
+                unsigned numKeys = node->getNumKeys();
+                char expected[21];
+                char actual[20];
+                for (unsigned k = 0; k < numKeys; k++)
+                {
+                    sprintf(expected, "%08u%012u", ((row + k) / 3) * 2, row + k);
+                    ASSERT(node->getValueAt(k, actual));
+                    ASSERT(memcmp(actual, expected, 20) == 0);
+                    ASSERT(node->getFPosAt(k) == (row + k) * 10);
+                    ASSERT(node->getSequence(k) == row + k);
+                }
+                unsigned firstValue = (row / 3) * 2;
+                unsigned lastValue = ((row + numKeys - 1) / 3) * 2;
+                for (unsigned value = firstValue ? firstValue - 1 : 0; value <= lastValue + 1; value++)
+                {
+                    char search[9];
+                    sprintf(search, "%08u", value);
+                    unsigned ge = 0;
+                    while (ge < numKeys && node->compareValueAt(search, ge) > 0)
+                        ge++;
+                    unsigned gt = ge;
+                    while (gt < numKeys && node->compareValueAt(search, gt) == 0)
+                        gt++;
+                    ASSERT(node->locateGE(search, 0) == ge);
+                    ASSERT(node->locateGT(search, 0) == gt);
+                    unsigned minIndex = numKeys / 2;
+                    ASSERT(node->locateGE(search, minIndex) == (ge > minIndex ? ge : minIndex));
+                    ASSERT(node->locateGT(search, minIndex) == (gt > minIndex ? gt : minIndex));
+                }
+                row += numKeys;
+            }
+            ASSERT(row == numRows);
+        }
+        ASSERT(remove(filename)==0);
+    }
+
+    void makePrefixRow(char *row, unsigned i)
+    {
+        // Runs of 50 rows share their first 8 bytes, and every value in the last 8 keyed bytes appears 3 times
+        sprintf(row, "%08u%08u%04u", i / 50, (i / 3) * 2, i % 10000);
+    }
+
+    void testNodeSearchPrefixes()
+    {
+        const char *filename = "keyfile6.$$$";
+        const unsigned numRows = 20000;
+        {
+            OwnedIFile file = createIFile(filename);
+            OwnedIFileIO io = file->openShared(IFOcreate, IFSHfull);
+            Owned<IFileIOStream> out = createIOStream(io);
+            Owned<IKeyBuilder> builder = createKeyBuilder(out, COL_PREFIX | HTREE_FULLSORT_KEY | HTREE_COMPRESSED_KEY, 20, NODESIZE, 16, 0);
+            char row[21];
+            for (unsigned i = 0; i < numRows; i++)
+            {
+                makePrefixRow(row, i);
+                builder->processKeyData(row, i, 20);
+            }
+            builder->finish();
+            out->flush();
+        }
+        bool oldUseNodeSearchPrefixes = useNodeSearchPrefixes;
+        {
+            // Every search of a node with prefixes must give the same answer as the binary search of the same node without them
+            OwnedIFile file = createIFile(filename);
+            OwnedIFileIO io = file->open(IFOread);
+            Owned<CKeyIndex> index = new CDiskKeyIndex(1, io.getClear(), filename, false, false);
+            unsigned nodeSize = index->getNodeSize();
+            unsigned leavesChecked = 0;
+            for (offset_t pos = nodeSize; ; pos += nodeSize)
+            {
+                useNodeSearchPrefixes = false;
+                Owned<CJHTreeNode> plain = index->loadNode(pos);
+                useNodeSearchPrefixes = true;
+                Owned<CJHTreeNode> prefixed = index->loadNode(pos);
+                if (!plain->isLeaf())
+                    break;
+                unsigned numKeys = plain->getNumKeys();
+                ASSERT(prefixed->getNumKeys() == numKeys);
+                ASSERT(prefixed->getMemSize() > plain->getMemSize());
+                const unsigned minIndexes[] = { 0, 1, numKeys / 3, numKeys - 1, numKeys };
+                char key[20];
+                for (unsigned k = 0; k < numKeys; k++)
+                {
+                    ASSERT(plain->getValueAt(k, key));
+                    char searches[5][16];
+                    memcpy(searches[0], key, 16);               // an existing (duplicated) key
+                    memcpy(searches[1], key, 16);
+                    searches[1][15]--;                          // just before it, with the same prefix
+                    memcpy(searches[2], key, 16);
+                    searches[2][15]++;                          // just after it, with the same prefix
+                    memcpy(searches[3], key, 8);
+                    memset(searches[3] + 8, '0', 8);            // first key with its prefix
+                    memcpy(searches[4], key, 8);
+                    memset(searches[4] + 8, '9', 8);            // last key with its prefix
+                    for (unsigned i = 0; i < _elements_in(searches); i++)
+                    {
+                        for (unsigned m = 0; m < _elements_in(minIndexes); m++)
+                        {
+                            unsigned minIndex = minIndexes[m];
+                            ASSERT(prefixed->locateGE(searches[i], minIndex) == plain->locateGE(searches[i], minIndex));
+                            ASSERT(prefixed->locateGT(searches[i], minIndex) == plain->locateGT(searches[i], minIndex));
+                        }
+                    }
+                }
+                leavesChecked++;
+            }
+            ASSERT(leavesChecked > 1);
+        }
+        {
+            // Lookups through a key manager find every duplicate with prefix searching enabled
+            useNodeSearchPrefixes = true;
+            clearNodeCache();
+            Owned<IKeyIndex> index = createKeyIndex(filename, 0, false, false);
+            Owned<IKeyManager> tlk = createLocalKeyManager(index, 20, NULL);
+            for (unsigned i = 0; i < numRows; i += 97)
+            {
+                char row[21];
+                makePrefixRow(row, i);
+                Owned<IStringSet> sset = createStringSet(16);
+                sset->addRange(row, row);
+                tlk->append(createKeySegmentMonitor(false, sset.getClear(), 0, 16));
+                tlk->finishSegmentMonitors();
+                tlk->reset();
+                unsigned expected = 0;
+                for (unsigned j = (i >= 3 ? i - 3 : 0); j < numRows && j <= i + 3; j++)
+                {
+                    char other[21];
+                    makePrefixRow(other, j);
+                    if (memcmp(row, other, 16) == 0)
+                        expected++;
+                }
+                unsigned matches = 0;
+                while (tlk->lookup(true))
+                {
+                    offset_t fpos;
+                    ASSERT(memcmp(tlk->queryKeyBuffer(fpos), row, 16) == 0);
+                    matches++;
+                }
+                ASSERT(matches == expected);
+                tlk->releaseSegmentMonitors();
+            }
+            clearNodeCache();
+        }
+        useNodeSearchPrefixes = oldUseNodeSearchPrefixes;
+        clearKeyStoreCache(true);
+        ASSERT(remove(filename)==0);
+    }
+
+    void setProbe(IKeyManager *tlk, unsigned value)
+    {
+        char search[11];
+        sprintf(search, "%010u", value);
+        Owned<IStringSet> sset = createStringSet(10);
+        sset->addRange(search, search);
+        tlk->append(createKeySegmentMonitor(false, sset.getClear(), 0, 10));
+        tlk->finishSegmentMonitors();
+    }
+
+    void testPrefetch()
+    {
+        // Even values only, so that odd probes and probes past the end have no match
+        const char *filename = "keyfile5.$$$";
+        const unsigned numRows = 100000;
+        {
+            OwnedIFile file = createIFile(filename);
+            OwnedIFileIO io = file->openShared(IFOcreate, IFSHfull);
+            Owned<IFileIOStream> out = createIOStream(io);
+            Owned<IKeyBuilder> builder = createKeyBuilder(out, COL_PREFIX | HTREE_FULLSORT_KEY | HTREE_COMPRESSED_KEY, 10, NODESIZE, 10, 0);
+            char row[11];
+            for (unsigned i = 0; i < numRows; i++)
+            {
+                sprintf(row, "%010u", i * 2);
+                builder->processKeyData(row, i, 10);
+            }
+            builder->finish();
+            out->flush();
+        }
+        clearNodeCache();
+        unsigned oldPrefetchReaders = keyPrefetchReaders;
+        keyPrefetchReaders = 4;
+        {
+            Owned<IKeyIndex> index = createKeyIndex(filename, 0, false, false);
+            Owned<IKeyManager> tlk = createLocalKeyManager(index, 10, NULL);
+            const unsigned numProbes = 200;
+            unsigned probes[numProbes];
+            for (unsigned i = 0; i < numProbes; i++)
+                probes[i] = (i * 7919) % (numRows * 2 + 100);
+
+            for (unsigned i = 0; i < numProbes; i++)
+            {
+                setProbe(tlk, probes[i]);
+                tlk->queuePrefetch();
+                tlk->releaseSegmentMonitors();
+            }
+            unsigned loadedBefore = nodesLoaded;
+            unsigned nodesRead = tlk->prefetchLeaves();
+            ASSERT(nodesRead > 1);
+            ASSERT(nodesLoaded - loadedBefore == nodesRead);
+            ASSERT(tlk->prefetchLeaves() == 0);
+
+            // Every lookup in the batch now finds its nodes in the cache, and still returns its matches in probe order
+            loadedBefore = nodesLoaded;
+            for (unsigned i = 0; i < numProbes; i++)
+            {
+                setProbe(tlk, probes[i]);
+                tlk->reset();
+                bool expected = (probes[i] % 2 == 0) && (probes[i] < numRows * 2);
+                ASSERT(tlk->lookup(true) == expected);
+                if (expected)
+                {
+                    char row[11];
+                    sprintf(row, "%010u", probes[i]);
+                    offset_t fpos;
+                    ASSERT(memcmp(tlk->queryKeyBuffer(fpos), row, 10) == 0);
+                    ASSERT(fpos == probes[i] / 2);
+                    ASSERT(!tlk->lookup(true));
+                }
+                tlk->releaseSegmentMonitors();
+            }
+            ASSERT(nodesLoaded == loadedBefore);
+
+            for (unsigned i = 0; i < numProbes; i++)
+            {
+                setProbe(tlk, probes[i]);
+                tlk->queuePrefetch();
+                tlk->releaseSegmentMonitors();
+            }
+            ASSERT(tlk->prefetchLeaves() == 0);
+
+            // Only as many searches as the leaf cache can hold are prefetched, and none if leaves are not cached
+            clearNodeCache();
+            size32_t oldLeafCacheMem = setLeafCacheMem(NODESIZE * 2 * 10);
+            for (unsigned i = 0; i < numProbes; i++)
+            {
+                setProbe(tlk, probes[i]);
+                tlk->queuePrefetch();
+                tlk->releaseSegmentMonitors();
+            }
+            unsigned cappedRead = tlk->prefetchLeaves();
+            ASSERT(cappedRead > 1 && cappedRead < nodesRead);
+            clearNodeCache();
+            setLeafCacheMem(0);
+            for (unsigned i = 0; i < numProbes; i++)
+            {
+                setProbe(tlk, probes[i]);
+                tlk->queuePrefetch();
+                tlk->releaseSegmentMonitors();
+            }
+            ASSERT(tlk->prefetchLeaves() == 0);
+            setLeafCacheMem(oldLeafCacheMem);
+        }
+        keyPrefetchReaders = oldPrefetchReaders;
+        clearKeyStoreCache(true);
+        ASSERT(remove(filename)==0);
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION( IKeyManagerTest );
 CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( IKeyManagerTest, "IKeyManagerTest" );
 
+class JHTreeNodeCacheTimingTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( JHTreeNodeCacheTimingTest );
+        CPPUNIT_TEST(testLookupScaling);
+        CPPUNIT_TEST(testLeafFormats);
+    CPPUNIT_TEST_SUITE_END();
+
+    static const unsigned numCachedNodes = 0x1000;
+    static const unsigned lookupsPerThread = 0x100000;
+
+    // Every position maps to a distinct copy of the first leaf, so that cache hits do not all contend on the link count of one node
+    class CTestNodeLoader : implements INodeLoader
+    {
+        CKeyIndex &index;
+    public:
+        CTestNodeLoader(CKeyIndex &_index) : index(_index) {}
+        virtual CJHTreeNode *loadNode(offset_t pos) override
+        {
+            return index.loadNode(index.getNodeSize());
+        }
+    };
+
+    void buildTestKey(const char *filename)
+    {
+        OwnedIFile file = createIFile(filename);
+        OwnedIFileIO io = file->openShared(IFOcreate, IFSHfull);
+        Owned<IFileIOStream> out = createIOStream(io);
+        Owned<IKeyBuilder> builder = createKeyBuilder(out, COL_PREFIX | HTREE_FULLSORT_KEY | HTREE_COMPRESSED_KEY, 10, NODESIZE, 10, 0);
+        char keybuf[11];
+        for (unsigned count = 0; count < 10000; count++)
+        {
+            sprintf(keybuf, "%010u", count);
+            builder->processKeyData(keybuf, count*10, 10);
+        }
+        builder->finish();
+        out->flush();
+    }
+
+    unsigned timeLookups(CNodeCache *cache, INodeLoader *loader, unsigned nodeSize, unsigned numThreads)
+    {
+        class casyncfor: public CAsyncFor
+        {
+        public:
+            casyncfor(CNodeCache *_cache, INodeLoader *_loader, unsigned _nodeSize) : cache(_cache), loader(_loader), nodeSize(_nodeSize) {}
+
+            void Do(unsigned idx)
+            {
+                unsigned seed = idx * 0x9e3779b9;
+                for (unsigned i = 0; i < lookupsPerThread; i++)
+                {
+                    seed = seed * 1103515245 + 12345;
+                    offset_t pos = (offset_t)((seed >> 8) % numCachedNodes + 1) * nodeSize;
+                    Owned<CJHTreeNode> node = cache->getNode(loader, 1, pos, NULL, false);
+                }
+            }
+        private:
+            CNodeCache *cache;
+            INodeLoader *loader;
+            unsigned nodeSize;
+        } afor(cache, loader, nodeSize);
+
+        cycle_t start = get_cycles_now();
+        afor.For(numThreads, numThreads);
+        unsigned microsecs = cycle_to_microsec(get_cycles_now() - start);
+        return microsecs ? microsecs : 1;
+    }
+
+    void testLookupScaling()
+    {
+        const char *filename = "keyfile3.$$$";
+        buildTestKey(filename);
+        {
+            OwnedIFile file = createIFile(filename);
+            OwnedIFileIO io = file->open(IFOread);
+            Owned<CKeyIndex> index = new CDiskKeyIndex(1, io.getClear(), filename, false, false);
+            CTestNodeLoader loader(*index);
+            unsigned nodeSize = index->getNodeSize();
+            unsigned maxThreads = getAffinityCpus();
+            unsigned shardCounts[] = { 1, DEFAULT_NODE_CACHE_SHARDS };
+            for (unsigned numShards : shardCounts)
+            {
+                Owned<CNodeCache> cache = new CNodeCache(0, (size32_t) -1, 0, numShards);
+                for (unsigned i = 1; i <= numCachedNodes; i++)
+                    Owned<CJHTreeNode> node = cache->getNode(&loader, 1, (offset_t)i * nodeSize, NULL, false);
+                for (unsigned numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+                {
+                    unsigned microsecs = timeLookups(cache, &loader, nodeSize, numThreads);
+                    unsigned __int64 lookups = (unsigned __int64)lookupsPerThread * numThreads;
+                    printf("Node cache %u shards %u threads: %" I64F "u lookups/sec\n", numShards, numThreads, (lookups * 1000000) / microsecs);
+                }
+            }
+        }
+        clearKeyStoreCache(true);
+        ASSERT(remove(filename)==0);
+    }
+
+    // Compares the cache memory and search times of the same rows written in the original and front-coded leaf formats
+    void testLeafFormats()
+    {
+        const char *filename = "keyfile5.$$$";
+        const unsigned numRows = 200000;
+        const unsigned numSearches = 1000000;
+        unsigned formats[] = { 0, HTREE_FRONTCODED_LEAF };
+        for (unsigned format : formats)
+        {
+            {
+                OwnedIFile file = createIFile(filename);
+                OwnedIFileIO io = file->openShared(IFOcreate, IFSHfull);
+                Owned<IFileIOStream> out = createIOStream(io);
+                Owned<IKeyBuilder> builder = createKeyBuilder(out, COL_PREFIX | HTREE_FULLSORT_KEY | HTREE_COMPRESSED_KEY | format, 64, NODESIZE, 16, 0);
+                char row[65];
+                for (unsigned i = 0; i < numRows; i++)
+                {
+                    sprintf(row, "%016u%048u", i * 7, i % 1000);
+                    builder->processKeyData(row, i*10, 64);
+                }
+                builder->finish();
+                out->flush();
+            }
+            OwnedIFile file = createIFile(filename);
+            OwnedIFileIO io = file->open(IFOread);
+            Owned<CKeyIndex> index = new CDiskKeyIndex(1, io.getClear(), filename, false, false);
+            unsigned nodeSize = index->getNodeSize();
+            CIArrayOf<CJHTreeNode> leaves;
+            cycle_t start = get_cycles_now();
+            for (offset_t pos = nodeSize; ; pos += nodeSize)
+            {
+                Owned<CJHTreeNode> node = index->loadNode(pos);
+                if (!node->isLeaf())
+                    break;
+                leaves.append(*node.getClear());
+            }
+            unsigned loadTime = cycle_to_microsec(get_cycles_now() - start);
+            unsigned __int64 cacheMem = 0;
+            ForEachItemIn(i, leaves)
+                cacheMem += leaves.item(i).getMemSize();
+
+            char search[17];
+            char value[64];
+            unsigned seed = 1;
+            start = get_cycles_now();
+            for (unsigned i = 0; i < numSearches; i++)
+            {
+                seed = seed * 1103515245 + 12345;
+                CJHTreeNode &leaf = leaves.item((seed >> 8) % leaves.ordinality());
+                sprintf(search, "%016u", (unsigned) ((seed >> 4) % (numRows * 7)));
+                leaf.locateGE(search, 0);
+            }
+            unsigned searchTime = cycle_to_microsec(get_cycles_now() - start);
+            start = get_cycles_now();
+            for (unsigned i = 0; i < numSearches; i++)
+            {
+                seed = seed * 1103515245 + 12345;
+                CJHTreeNode &leaf = leaves.item((seed >> 8) % leaves.ordinality());
+                sprintf(search, "%016u", (unsigned) ((seed >> 4) % (numRows * 7)));
+                unsigned idx = leaf.locateGE(search, 0);
+                leaf.getValueAt(idx < leaf.getNumKeys() ? idx : 0, value);
+            }
+            unsigned readTime = cycle_to_microsec(get_cycles_now() - start);
+            printf("%s leaves: %u nodes, %" I64F "u bytes cached (%" I64F "u/node), load %u us, %u searches %u us, with reads %u us\n",
+                   format ? "Front-coded" : "Original", leaves.ordinality(), cacheMem, cacheMem / leaves.ordinality(),
+                   loadTime, numSearches, searchTime, readTime);
+            leaves.kill();
+            index.clear();
+            ASSERT(remove(filename)==0);
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( JHTreeNodeCacheTimingTest );
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( JHTreeNodeCacheTimingTest, "JHTreeNodeCacheTimingTest" );
+
 #endif
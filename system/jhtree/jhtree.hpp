@@ -81,6 +81,7 @@ interface jhtree_decl IKeyIndex : public IKeyIndexBase
     virtual IPropertyTree * getMetadata() = 0;
     virtual unsigned getNodeSize() = 0;
     virtual const IFileIO *queryFileIO() const = 0;
+    virtual unsigned prefetchLeaves(unsigned numKeys, const void *keys, size32_t keyLen, IContextLogger *ctx) = 0; // keys holds numKeys search values, keyLen bytes apart
 };
 
 interface IKeyArray : extends IInterface
@@ -108,11 +109,26 @@ extern jhtree_decl void clearKeyStoreCacheEntry(const IFileIO *io);
 extern jhtree_decl unsigned setKeyIndexCacheSize(unsigned limit);
 extern jhtree_decl void clearNodeCache();
 // these methods return previous values
+#define DEFAULT_NODE_CACHE_SHARDS 16
+extern jhtree_decl unsigned setNodeCacheShards(unsigned numShards); // only effective before the node cache is first used
 extern jhtree_decl bool setNodeCachePreload(bool preload);
 extern jhtree_decl size32_t setNodeCacheMem(size32_t cacheSize);
 extern jhtree_decl size32_t setLeafCacheMem(size32_t cacheSize);
 extern jhtree_decl size32_t setBlobCacheMem(size32_t cacheSize);
 
+// Eviction/admission policy used by each of the node caches
+enum NodeCachePolicy
+{
+    NCPlru,         // evict the least recently used node
+    NCP2q,          // simplified 2Q - nodes seen only once are evicted first, so a single scan cannot flush the hot set
+    NCPtinylfu      // LRU, but a new node only displaces the LRU node if it has been requested more often recently
+};
+extern jhtree_decl NodeCachePolicy setNodeCachePolicy(NodeCachePolicy policy);
+extern jhtree_decl NodeCachePolicy setLeafCachePolicy(NodeCachePolicy policy);
+extern jhtree_decl NodeCachePolicy setBlobCachePolicy(NodeCachePolicy policy);
+extern jhtree_decl NodeCachePolicy getNodeCachePolicy(const char *name);
+extern jhtree_decl const char *getNodeCachePolicyName(NodeCachePolicy policy);
+
 
 extern jhtree_decl IKeyIndex *createKeyIndex(const char *filename, unsigned crc, bool isTLK, bool preloadAllowed);
 extern jhtree_decl IKeyIndex *createKeyIndex(const char *filename, unsigned crc, IFileIO &ifile, bool isTLK, bool preloadAllowed);
@@ -142,6 +158,8 @@ extern jhtree_decl bool linuxYield;
 extern jhtree_decl bool traceSmartStepping;
 extern jhtree_decl bool flushJHtreeCacheOnOOM;
 extern jhtree_decl bool useMemoryMappedIndexes;
+extern jhtree_decl bool useNodeSearchPrefixes;
+extern jhtree_decl unsigned keyPrefetchReaders;
 extern jhtree_decl void clearNodeStats();
 
 
@@ -223,6 +241,11 @@ interface IKeyManager : public IInterface, extends IIndexReadContext
     virtual void finishSegmentMonitors() = 0;
 
     virtual bool lookupSkip(const void *seek, size32_t seekGEOffset, size32_t seeklen) = 0;
+
+    // Batched lookups: call queuePrefetch() once the segment monitors for each probe are finished, then
+    // prefetchLeaves() to read all the nodes those probes will need, before looking them up in probe order.
+    virtual void queuePrefetch() = 0;
+    virtual unsigned prefetchLeaves() = 0;
 };
 
 extern jhtree_decl IKeyManager *createLocalKeyManager(IKeyIndex * _key, unsigned rawSize, IContextLogger *ctx);
@@ -88,11 +88,13 @@ protected:
     CRC32StartHT crcStartPosTable;
     CRC32EndHT crcEndPosTable;
     bool doCrc;
+    bool frontCodedLeaves;
 
 public:
     CKeyBuilderBase(IFileIOStream *_out, unsigned flags, unsigned rawSize, unsigned nodeSize, unsigned _keyedSize, unsigned __int64 _startSequence) : out(_out)
     {
         doCrc = false;
+        frontCodedLeaves = (flags & HTREE_FRONTCODED_LEAF) && !(flags & HTREE_VARSIZE);
         sequence = _startSequence;
         keyHdr.setown(new CKeyHdr());
         keyValueSize = rawSize;
@@ -126,7 +128,7 @@ public:
         hdr->fposOffset = 0;
         hdr->fileSize = 0;
         hdr->nodeKeyLength = _keyedSize;
-        hdr->version = KEYBUILD_VERSION;
+        hdr->version = frontCodedLeaves ? KEYBUILD_VERSION : KEYBUILD_COMPATIBLE_VERSION;
         hdr->blobHead = 0;
         hdr->metadataHead = 0;
 
@@ -135,6 +137,7 @@ public:
 
     CKeyBuilderBase(CKeyHdr * chdr)
     {
+        frontCodedLeaves = false;
         levels = 0;
         records = 0;
         prevLeafNode = NULL;
@@ -399,22 +402,29 @@ public:
         leafInfo.append(* info);
     }
 
+    CWriteNode *createLeafNode()
+    {
+        CWriteNode *node;
+        if (frontCodedLeaves)
+            node = new CFrontCodedWriteNode(nextPos, keyHdr);
+        else
+            node = new CWriteNode(nextPos, keyHdr, true);
+        nextPos += keyHdr->getNodeSize();
+        return node;
+    }
+
     void processKeyData(const char *keyData, offset_t pos, size32_t recsize)
     {
         records++;
         if (NULL == activeNode)
-        {
-            activeNode = new CWriteNode(nextPos, keyHdr, true);
-            nextPos += keyHdr->getNodeSize();
-        }
+            activeNode = createLeafNode();
         if (!activeNode->add(pos, keyData, recsize, sequence))
         {
             assertex(NULL != activeNode->getLastKeyValue()); // empty and doesn't fit!
 
             flushNode(activeNode, leafInfo);
             activeNode->Release();
-            activeNode = new CWriteNode(nextPos, keyHdr, true);
-            nextPos += keyHdr->getNodeSize();
+            activeNode = createLeafNode();
             if (!activeNode->add(pos, keyData, recsize, sequence))
                 throw MakeStringException(0, "Key row too large to fit within a key node (uncompressed size=%d, variable=%s, pos=%" I64F "d)", recsize, keyHdr->isVariable()?"true":"false", pos);
         }
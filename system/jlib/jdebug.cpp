@@ -46,6 +46,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/klog.h>
+#include <sys/syscall.h>
 #include <dirent.h>
 #endif
 #ifdef __APPLE__
@@ -3169,6 +3170,114 @@ memsize_t getHugePageSize()
     return 0x200000; // Default for an x86 system
 }
 
+unsigned getNumNumaNodes()
+{
+#ifdef __linux__
+    StringBuffer contents;
+    try
+    {
+        //The possible nodes are listed as a range e.g. "0" or "0-3".  The highest node number is the last number.
+        contents.loadFile("/sys/devices/system/node/possible");
+        const char * cur = contents.str();
+        const char * last = NULL;
+        for (; *cur; cur++)
+        {
+            if (isdigit(*cur) && ((cur == contents.str()) || !isdigit(cur[-1])))
+                last = cur;
+        }
+        if (last)
+            return (unsigned)strtoul(last, NULL, 10) + 1;
+    }
+    catch (IException * e)
+    {
+        e->Release();
+    }
+#endif
+    return 1;
+}
+
+unsigned getCurrentNumaNode()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+        return node;
+#endif
+    return 0;
+}
+
+static std::atomic<bool> threadsNumaBound{false};
+
+bool bindCurrentThreadToNumaNode(unsigned node)
+{
+#ifdef __linux__
+    StringBuffer cpuList;
+    try
+    {
+        //The cpus are listed as a comma separated list of ranges e.g. "0-3,8-11"
+        VStringBuffer filename("/sys/devices/system/node/node%u/cpulist", node);
+        cpuList.loadFile(filename);
+    }
+    catch (IException * e)
+    {
+        e->Release();
+        return false;
+    }
+
+    //Ensure the cached number of cpus reflects the process, not this thread
+    getAffinityCpus();
+
+    cpu_set_t allowed;
+    if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &allowed) != 0)
+        return false;
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    bool any = false;
+    const char * cur = cpuList.str();
+    while (isdigit(*cur))
+    {
+        char * end;
+        unsigned first = (unsigned)strtoul(cur, &end, 10);
+        unsigned last = first;
+        if (*end == '-')
+            last = (unsigned)strtoul(end+1, &end, 10);
+        for (unsigned cpu = first; (cpu <= last) && (cpu < CPU_SETSIZE); cpu++)
+        {
+            //Never extend the cpus the process has been restricted to
+            if (CPU_ISSET(cpu, &allowed))
+            {
+                CPU_SET(cpu, &cpuset);
+                any = true;
+            }
+        }
+        cur = end;
+        if (*cur == ',')
+            cur++;
+    }
+    if (!any)
+        return false;
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0)
+        return false;
+    threadsNumaBound = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void resetCurrentThreadAffinity()
+{
+#ifdef __linux__
+    if (!threadsNumaBound)
+        return;
+    //The main thread is never bound to a node, so its cpus are the process's
+    cpu_set_t cpuset;
+    if (sched_getaffinity(getpid(), sizeof(cpu_set_t), &cpuset) == 0)
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+#endif
+}
+
 //===========================================================================
 
 #ifdef LEAK_CHECK
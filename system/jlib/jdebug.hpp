@@ -348,6 +348,10 @@ extern jlib_decl void PrintMemoryReport(bool full=true);
 extern jlib_decl void printAllocationSummary();
 extern jlib_decl bool areTransparentHugePagesEnabled();
 extern jlib_decl memsize_t getHugePageSize();
+extern jlib_decl unsigned getNumNumaNodes();     // number of NUMA nodes that memory can be placed on (1 if not NUMA)
+extern jlib_decl unsigned getCurrentNumaNode();  // NUMA node of the cpu the calling thread is currently running on
+extern jlib_decl bool bindCurrentThreadToNumaNode(unsigned node); // restrict the calling thread (and threads it creates) to the cpus of a NUMA node
+extern jlib_decl void resetCurrentThreadAffinity(); // undo an inherited bindCurrentThreadToNumaNode, so the calling thread can run on any of the process's cpus
 
 #endif
 
@@ -3733,7 +3733,12 @@ StringBuffer &getSocketStatisticsString(JSocketStatistics &stats,StringBuffer &s
     str.append("blockrecvtime=").append(stats.blockrecvtime).append('\n');
     str.append("blocksendtime=").append(stats.blocksendtime).append('\n');
     str.append("longestblocksend=").append(stats.longestblocksend).append('\n');
-    str.append("longestblocksize=").append(stats.longestblocksize);
+    str.append("longestblocksize=").append(stats.longestblocksize).append('\n');
+    str.append("epollwaits=").append(stats.epollwaits).append('\n');
+    str.append("epollevents=").append(stats.epollevents).append('\n');
+    str.append("epollmaxevents=").append(stats.epollmaxevents).append('\n');
+    appendtime(str.append("epollnotifytime="),stats.epollnotifytime).append('\n');
+    appendtime(str.append("longestepollnotify="),stats.longestepollnotify);
     return str;
 }
 
@@ -4588,6 +4593,11 @@ class CSocketEpollThread: public CSocketBaseThread
     SelectItem *sidummy;
     SelectItemArrayP items;
     struct epoll_event *epevents;
+    unsigned reactor;           // index of this thread within its CSocketEpollHandler
+    // per thread counters, also accumulated into STATS
+    unsigned __int64 numevents = 0;
+    unsigned maxevents = 0;
+    unsigned __int64 notifytime = 0;
 
     void epoll_op(int efd, int op, SelectItem *si, unsigned int event_mask)
     {
@@ -4683,8 +4693,8 @@ class CSocketEpollThread: public CSocketBaseThread
 
 public:
     IMPLEMENT_IINTERFACE;
-    CSocketEpollThread(const char *trc)
-        : CSocketBaseThread("CSocketEpollThread")
+    CSocketEpollThread(const char *trc, unsigned _reactor)
+        : CSocketBaseThread("CSocketEpollThread"), reactor(_reactor)
     {
         dummysockopen = false;
         terminating = false;
@@ -4978,6 +4988,13 @@ public:
                     lastnumto = 0;
                     total += n;
                     totnum++;
+                    numevents += n;
+                    if ((unsigned)n > maxevents)
+                        maxevents = n;
+                    STATS.epollwaits++;
+                    STATS.epollevents += n;
+                    if ((unsigned)n > STATS.epollmaxevents)
+                        STATS.epollmaxevents = n;
                     SelectItemArray tonotify;
                     {
                         CriticalBlock block(sect);
@@ -5039,6 +5056,7 @@ public:
                     ForEachItemIn(j,tonotify)
                     {
                         const SelectItem &si = tonotify.item(j);
+                        unsigned startt = usTick();
                         try
                         {
                             si.nfy->notifySelected(si.sock,si.mode); // ignore return
@@ -5049,6 +5067,11 @@ public:
                             EXCLOG(e,"CSocketEpollThread notifySelected");
                             throw ;
                         }
+                        unsigned elapsed = usTick()-startt;
+                        notifytime += elapsed;
+                        STATS.epollnotifytime += elapsed;
+                        if (elapsed > STATS.longestepollnotify)
+                            STATS.longestepollnotify = elapsed;
                         // Release/dtors should not throw but leaving try/catch here until all paths checked
                         try
                         {
@@ -5069,7 +5092,7 @@ public:
                     {
                         lastnumto = numto;
                         if (selecttrace&&(numto>4))
-                            PROGLOG("%s: Epoll Idle(%d), %d,%d,%0.2f",selecttrace,numto,totnum,total,totnum?((double)total/(double)totnum):0.0);
+                            PROGLOG("%s[%u]: Epoll Idle(%d), %d,%d,%0.2f, events=%" I64F "u, maxevents=%u, notifytime=%" I64F "uus",selecttrace,reactor,numto,totnum,total,totnum?((double)total/(double)totnum):0.0,numevents,maxevents,notifytime);
                     }
 /*
                     if (numto&&(numto%100))
@@ -5104,53 +5127,80 @@ public:
     }
 };
 
+/* Spreads the sockets between a number of epoll threads, each socket always being handled by the same thread
+ * (chosen by hashing the socket), so that a busy process is not limited to dispatching on a single core.
+ * NB: notifySelected callbacks for different sockets can therefore be concurrent.
+ */
 class CSocketEpollHandler: implements ISocketSelectHandler, public CInterface
 {
-    CSocketEpollThread *epollthread;
-    CriticalSection sect;
+    CSocketEpollThread **epollthreads;
+    unsigned numthreads;
     StringAttr epolltrace;
+
+    inline CSocketEpollThread *queryThread(ISocket *sock)
+    {
+        if (1 == numthreads)
+            return epollthreads[0];
+        return epollthreads[hashc((const byte *)&sock, sizeof(sock), 0) % numthreads];
+    }
 public:
     IMPLEMENT_IINTERFACE;
-    CSocketEpollHandler(const char *trc)
-        : epolltrace(trc)
+    CSocketEpollHandler(const char *trc, unsigned _numthreads)
+        : numthreads(_numthreads ? _numthreads : 1), epolltrace(trc)
     {
-        epollthread = new CSocketEpollThread(epolltrace);
+        epollthreads = new CSocketEpollThread *[numthreads];
+        for (unsigned i=0; i<numthreads; i++)
+            epollthreads[i] = new CSocketEpollThread(epolltrace, i);
     }
 
     ~CSocketEpollHandler()
     {
-        delete epollthread;
+        for (unsigned i=0; i<numthreads; i++)
+            delete epollthreads[i];
+        delete [] epollthreads;
     }
 
     void start()
     {
-        CriticalBlock block(sect);
-        epollthread->start();
+        for (unsigned i=0; i<numthreads; i++)
+            epollthreads[i]->start();
     }
 
     void add(ISocket *sock,unsigned mode,ISocketSelectNotify *nfy)
     {
-        CriticalBlock block(sect); // JCS->MK - are these blocks necessary? epollthread->add() uses it's own CS.
-
         /* JCS->MK, the CSocketSelectHandler variety, checks result of thread->add and spins up another handler
          * Shouldn't epoll version do the same?
          */
-        if (!epollthread->add(sock,mode,nfy))
+        if (!queryThread(sock)->add(sock,mode,nfy))
             throw MakeStringException(-1, "CSocketEpollHandler: failed to add socket to epollthread handler: sock # = %d", sock->OShandle());
     }
 
     void remove(ISocket *sock)
     {
-        CriticalBlock block(sect); // JCS->MK - are these blocks necessary? epollthread->add() uses it's own CS.
-        epollthread->remove(sock);
+        if (sock)
+            queryThread(sock)->remove(sock);
+        else
+        {
+            // wait until no changes outstanding on any thread
+            for (unsigned i=0; i<numthreads; i++)
+                epollthreads[i]->remove(NULL);
+        }
     }
 
     void stop(bool wait)
     {
         IException *e=NULL;
-        epollthread->stop(wait);           // not quite as quick as could be if wait true
-        if (wait && !e && epollthread->termexcept)
-            e = epollthread->termexcept.getClear();
+        for (unsigned i=0; i<numthreads; i++)
+            epollthreads[i]->stop(false);   // signal them all before waiting for any
+        if (wait)
+        {
+            for (unsigned i=0; i<numthreads; i++)
+            {
+                epollthreads[i]->join();
+                if (!e && epollthreads[i]->termexcept)
+                    e = epollthreads[i]->termexcept.getClear();
+            }
+        }
 #if 0 // don't throw error as too late
         if (e)
             throw e;
@@ -5164,6 +5214,7 @@ public:
 #ifdef _HAS_EPOLL_SUPPORT
 enum EpollMethod { EPOLL_INIT = 0, EPOLL_DISABLED, EPOLL_ENABLED };
 static EpollMethod epoll_method = EPOLL_INIT;
+static unsigned epoll_threads = 1; // # of threads each epoll select handler dispatches on
 static CriticalSection epollsect;
 #endif
 
@@ -5179,11 +5230,12 @@ ISocketSelectHandler *createSocketSelectHandler(const char *trc)
                 epoll_method = EPOLL_ENABLED;
             else
                 epoll_method = EPOLL_DISABLED;
+            epoll_threads = queryEnvironmentConf().getPropInt("epoll_threads", 1);
         // DBGLOG("createSocketSelectHandler(): after reading conf file, epoll_method = %d",epoll_method);
         }
     }
     if (epoll_method == EPOLL_ENABLED)
-        return new CSocketEpollHandler(trc);
+        return new CSocketEpollHandler(trc, epoll_threads);
     else
         return new CSocketSelectHandler(trc);
 #else
@@ -5191,10 +5243,10 @@ ISocketSelectHandler *createSocketSelectHandler(const char *trc)
 #endif
 }
 
-ISocketSelectHandler *createSocketEpollHandler(const char *trc)
+ISocketSelectHandler *createSocketEpollHandler(const char *trc, unsigned numthreads)
 {
 #ifdef _HAS_EPOLL_SUPPORT
-    return new CSocketEpollHandler(trc);
+    return new CSocketEpollHandler(trc, numthreads);
 #else
     return new CSocketSelectHandler(trc);
 #endif
@@ -496,6 +496,11 @@ struct JSocketStatistics
     unsigned blocksendtime; 
     unsigned longestblocksend; 
     unsigned longestblocksize; 
+    unsigned epollwaits;        // epoll_wait calls that returned events, summed over all epoll threads
+    __int64  epollevents;       // socket events returned by those calls
+    unsigned epollmaxevents;    // most events returned by a single epoll_wait (i.e. deepest ready queue)
+    unsigned epollnotifytime;   // time spent in notifySelected callbacks
+    unsigned longestepollnotify;
 };
 
 extern jlib_decl void getSocketStatistics(JSocketStatistics &stats);
@@ -525,7 +530,7 @@ public:
 
 extern jlib_decl ISocketSelectHandler *createSocketSelectHandler(const char *trc=NULL);
 
-extern jlib_decl ISocketSelectHandler *createSocketEpollHandler(const char *trc=NULL);
+extern jlib_decl ISocketSelectHandler *createSocketEpollHandler(const char *trc=NULL, unsigned numthreads=1);
 
 
 class MemoryBuffer;
@@ -1047,3 +1047,169 @@ IRowStream *createRowStreamMerger(unsigned numstreams,IRowProvider &provider,ICo
 {
     return new CMergeRowStreams(numstreams,provider,icmp,partdedup);
 }
+
+//==================================================================================================
+// Parallel merge. The inputs are split into contiguous groups, each merged on its own thread into a bounded
+// queue of row blocks, and the group outputs are then merged by the caller. As ties are resolved in favour
+// of the lower input by both levels of merge, the output is the same as a single merge of all the inputs.
+
+#define PARMERGE_BLOCKROWS 1024     // rows handed between threads at a time
+#define PARMERGE_QUEUEDBLOCKS 4     // blocks each merge thread can get ahead of the consumer
+#define PARMERGE_MINGROUPSIZE 2     // not worth a thread to merge fewer inputs
+
+class CParallelMergeGroup : public CInterfaceOf<IRowStream>, implements IThreaded
+{
+    struct RowBlock
+    {
+        unsigned num = 0;
+        const void *rows[PARMERGE_BLOCKROWS];
+    };
+
+    Owned<IRowStream> merger;
+    Linked<IRowLinkCounter> linkcounter;
+    CThreaded threaded;
+    CriticalSection crit;
+    QueueOf<RowBlock, false> blocks;
+    Semaphore blockSem;     // signalled when a block is queued, or the thread has finished
+    Semaphore spaceSem;     // signalled when the consumer takes a block
+    Owned<IException> exception;
+    RowBlock *current = nullptr;
+    unsigned currentPos = 0;
+    std::atomic<bool> stopped{false};
+    bool eos = false;
+
+    void releaseBlock(RowBlock *block, unsigned from)
+    {
+        while (from < block->num)
+            linkcounter->releaseRow(block->rows[from++]);
+        delete block;
+    }
+public:
+    CParallelMergeGroup(IRowStream *_merger, IRowLinkCounter *_linkcounter)
+        : merger(_merger), linkcounter(_linkcounter), threaded("CParallelMergeGroup"), spaceSem(PARMERGE_QUEUEDBLOCKS)
+    {
+        threaded.init(this);
+    }
+    ~CParallelMergeGroup()
+    {
+        stop();
+    }
+// IThreaded
+    virtual void main() override
+    {
+        RowBlock *block = nullptr;
+        try
+        {
+            for (;;)
+            {
+                spaceSem.wait();
+                if (stopped)
+                    break;
+                block = new RowBlock;
+                while (block->num < PARMERGE_BLOCKROWS)
+                {
+                    const void *row = merger->nextRow();
+                    if (!row)
+                        break;
+                    block->rows[block->num++] = row;
+                }
+                bool last = block->num < PARMERGE_BLOCKROWS;
+                if (block->num)
+                {
+                    {
+                        CriticalBlock b(crit);
+                        blocks.enqueue(block);
+                    }
+                    blockSem.signal();
+                }
+                else
+                    delete block;
+                block = nullptr;
+                if (last)
+                    break;
+            }
+        }
+        catch (IException *e)
+        {
+            if (block)
+                releaseBlock(block, 0);
+            exception.setown(e);
+        }
+        merger->stop();
+        blockSem.signal();
+    }
+// IRowStream
+    virtual const void *nextRow() override
+    {
+        for (;;)
+        {
+            if (current)
+            {
+                if (currentPos < current->num)
+                    return current->rows[currentPos++];
+                delete current;
+                current = nullptr;
+            }
+            if (eos)
+                return nullptr;
+            blockSem.wait();
+            {
+                CriticalBlock b(crit);
+                current = blocks.dequeue();
+            }
+            if (!current)
+            {
+                // the thread only signals without queuing a block when it has finished
+                eos = true;
+                threaded.join();
+                if (exception)
+                    throw exception.getClear();
+                return nullptr;
+            }
+            currentPos = 0;
+            spaceSem.signal();
+        }
+    }
+    virtual void stop() override
+    {
+        if (stopped)
+            return;
+        stopped = true;
+        spaceSem.signal();
+        threaded.join();
+        if (current)
+        {
+            releaseBlock(current, currentPos);
+            current = nullptr;
+        }
+        for (;;)
+        {
+            RowBlock *block = blocks.dequeue();
+            if (!block)
+                break;
+            releaseBlock(block, 0);
+        }
+        eos = true;
+    }
+};
+
+IRowStream *createParallelRowStreamMerger(unsigned numstreams, IRowStream **instreams, ICompare *icmp, bool partdedup, IRowLinkCounter *linkcounter, unsigned numthreads)
+{
+    if (0 == numthreads)
+        numthreads = getAffinityCpus();
+    unsigned maxGroups = numstreams / PARMERGE_MINGROUPSIZE;
+    if (numthreads > maxGroups)
+        numthreads = maxGroups;
+    if (numthreads <= 1)
+        return createRowStreamMerger(numstreams, instreams, icmp, partdedup, linkcounter);
+    IArrayOf<IRowStream> groups;
+    unsigned start = 0;
+    for (unsigned g=0; g<numthreads; g++)
+    {
+        unsigned end = (unsigned)(((unsigned __int64)numstreams * (g+1)) / numthreads);
+        Owned<IRowStream> groupMerger = createRowStreamMerger(end-start, instreams+start, icmp, partdedup, linkcounter);
+        groups.append(*new CParallelMergeGroup(groupMerger.getClear(), linkcounter));
+        start = end;
+    }
+    return createRowStreamMerger(groups.ordinality(), groups.getArray(), icmp, partdedup, linkcounter);
+}
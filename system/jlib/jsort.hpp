@@ -92,6 +92,8 @@ extern jlib_decl bool heap_push_up(unsigned c, unsigned * heap, const void ** ro
 
 extern jlib_decl IRowStream *createRowStreamMerger(unsigned numstreams,IRowProvider &provider,ICompare *icmp, bool partdedup=false);
 extern jlib_decl IRowStream *createRowStreamMerger(unsigned numstreams,IRowStream **instreams,ICompare *icmp, bool partdedup, IRowLinkCounter *linkcounter);
+// As above, but merges contiguous groups of the inputs on up to numthreads threads (0 = one per cpu), producing identical output
+extern jlib_decl IRowStream *createParallelRowStreamMerger(unsigned numstreams,IRowStream **instreams,ICompare *icmp, bool partdedup, IRowLinkCounter *linkcounter, unsigned numthreads=0);
 
 class ISortedRowProvider
 {
@@ -202,6 +202,9 @@ enum StatisticKind
     StCycleGenerateCycles,
     StWhenStarted,                      // When a graph/query etc. starts
     StWhenFinished,                     // When a graph stopped
+    StTimeSpillStall,                   // Time a spilling thread was blocked waiting for asynchronous spill i/o
+    StCycleSpillStallCycles,
+    StSizeReplyCopyAvoided,             // Size of local slave replies passed to the server as rows rather than copied
 
     StMax,
 
@@ -795,6 +795,9 @@ static const StatisticMeta statsMetaData[StMax] = {
     { CYCLESTAT(Generate) },
     { WHENSTAT(Started) },
     { WHENSTAT(Finished) },
+    { TIMESTAT(SpillStall) },
+    { CYCLESTAT(SpillStall) },
+    { SIZESTAT(ReplyCopyAvoided) },
 };
 
 
@@ -24,6 +24,7 @@
 #include "jmisc.hpp"
 #include "jqueue.tpp"
 #include "jregexp.hpp"
+#include "jdebug.hpp"
 #include <assert.h>
 #ifdef _WIN32
 #include <process.h>
@@ -837,6 +838,8 @@ public:
 
     int run()
     {
+        // Pooled threads are reused for unrelated work, so must not keep a NUMA binding inherited from the thread that created them
+        resetCurrentThreadAffinity();
         do
         {
             sem.wait();
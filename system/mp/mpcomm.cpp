@@ -72,6 +72,9 @@
 #define CONFIRM_TIMEOUT_INTERVAL 5000 // 5 secs
 #define TRACESLOW_THRESHOLD      1000 // 1 sec
 
+#define MAXCOALESCEMSGSIZE      0x1000       // only messages up to this size (inc. header) are coalesced
+#define MAXCOALESCESIZE         0x10000      // coalesced messages are written as soon as this much is pending
+
 #define VERIFY_DELAY            (1*60*1000)  // 1 Minute
 #define VERIFY_TIMEOUT          (1*60*1000)  // 1 Minute
 
@@ -463,6 +466,7 @@ class BroadcastPacketHandler;
 class ForwardPacketHandler;
 class UserPacketHandler;
 class CMPNotifyClosedThread;
+class CMPCoalesceFlushThread;
 
 typedef SuperHashTableOf<CMPChannel,SocketEndpoint> CMPChannelHT;
 class CMPServer: private CMPChannelHT, implements IMPServer
@@ -472,12 +476,15 @@ class CMPServer: private CMPChannelHT, implements IMPServer
     CMPConnectThread            *connectthread;
     CBufferQueue                receiveq;
     CMPNotifyClosedThread       *notifyclosedthread;
+    CMPCoalesceFlushThread      *coalesceflushthread = nullptr;
     CriticalSection sect;
+    CriticalSection coalescesect;
 protected:
     unsigned short              port;
 public:
     bool checkclosed;
     bool tryReopenChannel = false;
+    unsigned coalesceWindow = 0;    // ms small messages can be held back to be written with others to the same channel, 0 = off
 
 // packet handlers
     PingPacketHandler           *pingpackethandler;         // TAG_SYS_PING
@@ -512,6 +519,7 @@ public:
         return receiveq.getReceiveQueueDetails(buf);
     }   
     void removeChannel(CMPChannel *c) { if (c) removeExact(c); }
+    void noteCoalesced(CMPChannel *c);
 protected:
     void onAdd(void *);
     void onRemove(void *e);
@@ -562,6 +570,12 @@ public:
                 tryReopenChannel = tf;
                 break;
             }
+            case mpsopt_coalescewindow:
+            {
+                coalesceWindow = (nullptr != value) ? atoi(value) : 0;
+                PROGLOG("Setting CoalesceWindow = %u ms", coalesceWindow);
+                break;
+            }
             default:
                 // ignore
                 break;
@@ -725,6 +739,9 @@ class CMPChannel: public CInterface
     unsigned __int64 attachaddrval;
     SocketEndpoint attachep;
     atomic_t attachchk;
+    MemoryBuffer coalescebuf;           // small messages (header+body) held back to be written in one go, protected by sendmutex
+    unsigned coalescecount = 0;
+    Owned<IException> coalesceerror;    // failure writing held back messages, reported by the next send, protected by sendmutex
 
 protected: friend class CMPServer;
     SocketEndpoint remoteep;
@@ -1049,8 +1066,12 @@ public:
             unsigned t2 = msTick();
 #endif
             unsigned n = 0;
-            const void *bufs[3];
-            size32_t sizes[3];
+            const void *bufs[4];
+            size32_t sizes[4];
+            if (coalescebuf.length()) { // any held back messages must precede this one
+                bufs[n] = coalescebuf.toByteArray();
+                sizes[n++] = coalescebuf.length();
+            }
             if (hdrsize) {
                 bufs[n] = hdr;
                 sizes[n++] = hdrsize;
@@ -1067,7 +1088,12 @@ public:
                 LOG(MCdebugInfo(100), unknownJob, "MP Warning: WritePacket unexpected NULL socket");
                 return false;
             }
-            dest->write_multiple(n,bufs,sizes);  
+            if (n)
+                dest->write_multiple(n,bufs,sizes);
+            if (coalescebuf.length()) {
+                coalescebuf.clear();
+                coalescecount = 0;
+            }
             lastxfer = msTick();
 #ifdef _FULLTRACE
             LOG(MCdebugInfo(100), unknownJob, "WritePacket(timewaiting=%d,timesending=%d)",t2-t1,lastxfer-t2);
@@ -1075,12 +1101,55 @@ public:
         }
         catch (IException *e) {
             FLLOG(MCoperatorWarning, unknownJob, e,"MP writepacket");
+            coalescebuf.clear();
+            coalescecount = 0;
             closeSocket(false, true);
             throw;
         }
         return true;
     }
 
+    bool coalesce(PacketHeader &hdr,MemoryBuffer &mb,CTimeMon &tm)
+    {
+        // must be called in sendmutex
+        coalescebuf.append(sizeof(hdr),&hdr).append(mb.length(),mb.toByteArray());
+        if (coalescebuf.length()>=MAXCOALESCESIZE)
+            return writepacket(NULL,0,tm);
+        if (1==++coalescecount)
+            parent->noteCoalesced(this);
+        return true;
+    }
+
+    void flushCoalesced()
+    {
+        synchronized block(sendmutex);
+        if (!coalescecount)
+            return;
+        // written as the async sends that were held back would have been, so a dead link cannot stall the flush thread
+        unsigned count = coalescecount;
+        Owned<IException> e;
+        try {
+            CTimeMon tm(MP_ASYNC_SEND);
+            if (writepacket(NULL,0,tm))
+                return;
+        }
+        catch (IException *_e) {
+            e.setown(_e); // already logged and the channel closed by writepacket
+        }
+        coalescebuf.clear();
+        coalescecount = 0;
+        // the senders have returned, so report the loss of their messages to the next one
+        if (!coalesceerror) {
+            StringBuffer ep, msg;
+            remoteep.getUrlStr(ep);
+            if (e)
+                e->errorMessage(msg);
+            else
+                msg.append("connect failed");
+            coalesceerror.setown(MakeStringException(e?e->errorCode():MPERR_connection_failed, "MP: %u held back message(s) to %s not sent: %s", count, ep.str(), msg.str()));
+        }
+    }
+
     bool writepacket(const void *hdr,size32_t hdrsize,const void *body,size32_t bodysize,CTimeMon &tm)
     {
         return writepacket(hdr,hdrsize,NULL,0,body,bodysize,tm);
@@ -1787,11 +1856,80 @@ bool CMPChannel::send(MemoryBuffer &mb, mptag_t tag, mptag_t replytag, CTimeMon
         }
     } postcond(sendmutex,sendwaiting,sendwaitingsig,ismulti?&multitag:NULL); 
 
+    if (coalesceerror)  // messages held back for an earlier send were lost
+        throw coalesceerror.getClear();
     if (ismulti)
         return parent->multipackethandler->send(this,hdr,mb,tm,sendmutex);
+    // Only sends that do not wait for the write to complete can be held back
+    if (parent->coalesceWindow&&(hdr.size<=MAXCOALESCEMSGSIZE)&&(tm.timeout==MP_ASYNC_SEND))
+        return coalesce(hdr,mb,tm);
     return parent->userpackethandler->send(this,hdr,mb,tm);
 }
 
+/* Writes out the small messages that channels have been holding back (see CMPChannel::coalesce),
+ * coalesceWindow ms after the first is queued, unless a write to the channel has already carried them.
+ */
+class CMPCoalesceFlushThread: public Thread
+{
+    CMPServer *parent;
+    CIArrayOf<CMPChannel> pending;
+    CriticalSection sect;
+    Semaphore sem;
+    bool stopping;
+public:
+    CMPCoalesceFlushThread(CMPServer *_parent)
+        : Thread("CMPCoalesceFlushThread")
+    {
+        parent = _parent;
+        stopping = false;
+    }
+    void add(CMPChannel *channel);
+    void flushPending();
+    int run()
+    {
+        for (;;) {
+            sem.wait();
+            if (stopping)
+                break;
+            unsigned window = parent->coalesceWindow;
+            if (window)
+                Sleep(window); // let others accumulate
+            flushPending();
+        }
+        flushPending();
+        return 0;
+    }
+    void stop()
+    {
+        stopping = true;
+        sem.signal();
+        while (!join(1000*60*3))
+            PROGLOG("CMPCoalesceFlushThread join failed");
+    }
+};
+
+
+void CMPCoalesceFlushThread::add(CMPChannel *channel)
+{
+    CriticalBlock block(sect);
+    pending.append(*LINK(channel));
+    if (1==pending.ordinality())
+        sem.signal();
+}
+
+void CMPCoalesceFlushThread::flushPending()
+{
+    CIArrayOf<CMPChannel> toflush;
+    {
+        CriticalBlock block(sect);
+        ForEachItemIn(i,pending)
+            toflush.append(*LINK(&pending.item(i)));
+        pending.kill();
+    }
+    ForEachItemIn(i,toflush)
+        toflush.item(i).flushCoalesced();
+}
+
 bool CMPChannel::sendPing(CTimeMon &tm)
 {
     unsigned remaining;
@@ -2184,6 +2322,9 @@ CMPServer::CMPServer(unsigned _port)
     userpackethandler = new UserPacketHandler(this);        // default
     notifyclosedthread = new CMPNotifyClosedThread(this);
     notifyclosedthread->start();
+    Owned<IPropertyTree> env = getHPCCEnvironment();
+    if (env)
+        coalesceWindow = env->getPropInt("EnvSettings/mpCoalesceWindow", 0);
     selecthandler->start();
     rettag = (int)TAG_REPLY_BASE; // NB negative
 
@@ -2199,6 +2340,10 @@ CMPServer::~CMPServer()
     if (buf.length())
         LOG(MCdebugInfo(100), unknownJob, "MP: Orphan check\n%s",buf.str());
 #endif
+    if (coalesceflushthread) {
+        coalesceflushthread->stop();
+        coalesceflushthread->Release();
+    }
     _releaseAll();
     selecthandler->Release();
     notifyclosedthread->stop();
@@ -2374,8 +2519,20 @@ void CMPServer::start()
     connectthread->startPort(getPort());
 }
 
+void CMPServer::noteCoalesced(CMPChannel *c)
+{
+    CriticalBlock block(coalescesect);
+    if (!coalesceflushthread) {
+        coalesceflushthread = new CMPCoalesceFlushThread(this);
+        coalesceflushthread->start();
+    }
+    coalesceflushthread->add(c);
+}
+
 void CMPServer::stop()
 {
+    if (coalesceflushthread)
+        coalesceflushthread->flushPending();
     selecthandler->stop(true); 
     connectthread->stop();
     CMPChannel *c = NULL;
@@ -2789,6 +2946,146 @@ public:
 #endif
     }
 
+    /*
+     * The collectives below work on ranks relative to the root (vrank 0 is the root).
+     * In the binomial tree the parent of vrank v is v with its lowest set bit cleared, and the
+     * children of v are v+mask for each power of 2 mask below v's lowest set bit, so the tree is
+     * ceiling(lgp) deep and each subtree covers a contiguous range of vranks.
+     */
+    inline rank_t fromVRank(unsigned vrank, rank_t root, unsigned numranks)
+    {
+        return (rank_t)((vrank+root)%numranks);
+    }
+
+    bool pipelinedBroadcast(CMessageBuffer &mbuf, rank_t root, mptag_t tag, size32_t chunkSize, unsigned timeout)
+    {
+        // Each chunk is passed down a binary tree (children 2v+1 and 2v+2) as soon as it arrives, so for large
+        // buffers the time is close to (size + depth*chunkSize)/bandwidth rather than depth*size/bandwidth.
+        // Every chunk is prefixed with the total size so receivers know when they are done.
+        unsigned numranks = group->ordinality();
+        unsigned vrank = (myrank+numranks-root)%numranks;
+        rank_t children[2];
+        unsigned numchildren = 0;
+        for (unsigned c=2*vrank+1; (c<=2*vrank+2)&&(c<numranks); c++)
+            children[numchildren++] = fromVRank(c, root, numranks);
+        CMessageBuffer chunk;
+        if (0 == vrank) {
+            size32_t total = mbuf.length();
+            const byte *data = (const byte *)mbuf.toByteArray();
+            size32_t ofs = 0;
+            do {
+                size32_t sz = total-ofs;
+                if (sz > chunkSize)
+                    sz = chunkSize;
+                chunk.clear().append(total).append(sz, data+ofs);
+                for (unsigned i=0; i<numchildren; i++) {
+                    if (!send(chunk, children[i], tag, timeout))
+                        return false;
+                }
+                ofs += sz;
+            } while (ofs < total);
+        }
+        else {
+            rank_t parent = fromVRank((vrank-1)/2, root, numranks);
+            mbuf.clear();
+            size32_t total;
+            do {
+                if (!recv(chunk, parent, tag, NULL, timeout))
+                    return false;
+                for (unsigned i=0; i<numchildren; i++) {
+                    if (!send(chunk, children[i], tag, timeout))
+                        return false;
+                }
+                chunk.read(total);
+                size32_t sz = chunk.remaining();
+                mbuf.append(sz, chunk.readDirect(sz));
+            } while (mbuf.length() < total);
+        }
+        return true;
+    }
+
+    bool broadcast(CMessageBuffer &mbuf, rank_t root, mptag_t tag, size32_t chunkSize, unsigned timeout)
+    {
+        unsigned numranks = group->ordinality();
+        assertex(root<numranks);
+        if (numranks<=1)
+            return true;
+        if (chunkSize)
+            return pipelinedBroadcast(mbuf, root, tag, chunkSize, timeout);
+        unsigned vrank = (myrank+numranks-root)%numranks;
+        unsigned mask = 0x1;
+        while (mask < numranks) {
+            if (vrank & mask) {
+                if (!recv(mbuf, fromVRank(vrank-mask, root, numranks), tag, NULL, timeout))
+                    return false;
+                break;
+            }
+            mask <<= 1;
+        }
+        // forward to children, largest subtree first
+        mask >>= 1;
+        while (mask) {
+            if (vrank+mask < numranks) {
+                if (!send(mbuf, fromVRank(vrank+mask, root, numranks), tag, timeout))
+                    return false;
+            }
+            mask >>= 1;
+        }
+        return true;
+    }
+
+    bool allgather(CMessageBuffer &mbuf, mptag_t tag, unsigned timeout)
+    {
+        // Gather up a binomial tree rooted at rank 0, then broadcast the result.
+        // Children are received in increasing order and each subtree is a contiguous
+        // range of ranks, so the gathered contributions arrive already in rank order.
+        unsigned numranks = group->ordinality();
+        CMessageBuffer gathered;
+        gathered.append((size32_t)mbuf.length()).append(mbuf.length(), mbuf.toByteArray());
+        unsigned mask = 0x1;
+        while (mask < numranks) {
+            if (myrank & mask) {
+                if (!send(gathered, myrank-mask, tag, timeout))
+                    return false;
+                break;
+            }
+            if (myrank+mask < numranks) {
+                CMessageBuffer child;
+                if (!recv(child, myrank+mask, tag, NULL, timeout))
+                    return false;
+                gathered.append(child.length(), child.toByteArray());
+            }
+            mask <<= 1;
+        }
+        if (0 == myrank)
+            mbuf.swapWith(gathered);
+        return broadcast(mbuf, 0, tag, 0, timeout);
+    }
+
+    bool reduce(CMessageBuffer &mbuf, rank_t root, mptag_t tag, IMPReducer &reducer, unsigned timeout)
+    {
+        unsigned numranks = group->ordinality();
+        assertex(root<numranks);
+        unsigned vrank = (myrank+numranks-root)%numranks;
+        unsigned mask = 0x1;
+        while (mask < numranks) {
+            if (vrank & mask) {
+                bool ok = send(mbuf, fromVRank(vrank-mask, root, numranks), tag, timeout);
+                mbuf.clear();
+                return ok;
+            }
+            if (vrank+mask < numranks) {
+                CMessageBuffer child;
+                if (!recv(child, fromVRank(vrank+mask, root, numranks), tag, NULL, timeout))
+                    return false;
+                reducer.reduce(mbuf, child);
+            }
+            mask <<= 1;
+        }
+        mbuf.reset();
+        return true;
+    }
+
     bool verifyConnection(rank_t rank,  unsigned timeout)
     {
         CriticalBlock block(verifysect);
@@ -31,6 +31,12 @@
 #define MP_ASYNC_SEND   ((unsigned)-2)
 
 
+interface IMPReducer
+{
+    virtual void reduce(CMessageBuffer &result, CMessageBuffer &other) = 0;
+                            // combine other into result, must be associative (and commutative if reducing to a root other than rank 0)
+};
+
 interface ICommunicator: extends IInterface
 {
     virtual bool send (CMessageBuffer &mbuf, rank_t dstrank, mptag_t tag, unsigned timeout=MP_WAIT_FOREVER) = 0;  
@@ -57,6 +63,15 @@ interface ICommunicator: extends IInterface
     virtual bool verifyAll(bool duplex=false, unsigned timeout=1000*60*30) = 0;
     virtual void disconnect(INode *node) = 0;
     virtual void barrier() = 0;
+
+    // collectives - all ranks in the group must call with the same root/tag, timeout applies to each step
+    virtual bool broadcast(CMessageBuffer &mbuf, rank_t root, mptag_t tag, size32_t chunkSize=0, unsigned timeout=MP_WAIT_FOREVER) = 0;
+                            // root's mbuf is copied to all other ranks over a binomial tree, or if chunkSize is non zero
+                            // pipelined in chunks of chunkSize down a binary tree (better for large buffers)
+    virtual bool allgather(CMessageBuffer &mbuf, mptag_t tag, unsigned timeout=MP_WAIT_FOREVER) = 0;
+                            // on exit mbuf contains every rank's contribution in rank order, each as size32_t length followed by data
+    virtual bool reduce(CMessageBuffer &mbuf, rank_t root, mptag_t tag, IMPReducer &reducer, unsigned timeout=MP_WAIT_FOREVER) = 0;
+                            // combines all ranks' mbuf into root's mbuf up a binomial tree, mbuf is cleared on other ranks
 };
 
 interface IInterCommunicator: extends IInterface
@@ -91,7 +106,7 @@ extern mp_decl ICommunicator *createCommunicator(IGroup *group,bool outer=false)
 extern mp_decl IInterCommunicator &queryWorldCommunicator();
 extern mp_decl bool hasMPServerStarted();
 
-enum MPServerOpts { mpsopt_null, mpsopt_channelreopen };
+enum MPServerOpts { mpsopt_null, mpsopt_channelreopen, mpsopt_coalescewindow };
 interface IMPServer : extends IInterface
 {
     virtual mptag_t createReplyTag() = 0;
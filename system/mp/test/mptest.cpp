@@ -18,6 +18,7 @@ using namespace std;
 //#define STREAMTEST
 //#define MPITEST
 //#define MPITEST2
+//#define COLLECTIVETEST
 //#define GPF
 
 #ifdef MULTITEST
@@ -648,6 +649,122 @@ void MPITest2(IGroup *group, ICommunicator *mpicomm)
     return;
 }
 
+class CSumReducer : implements IMPReducer
+{
+public:
+    virtual void reduce(CMessageBuffer &result, CMessageBuffer &other)
+    {
+        // element-wise sum of unsigned arrays
+        unsigned n = result.length()/sizeof(unsigned);
+        assertex(other.length()==n*sizeof(unsigned));
+        unsigned *r = (unsigned *)result.bufferBase();
+        const unsigned *o = (const unsigned *)other.toByteArray();
+        for (unsigned i=0; i<n; i++)
+            r[i] += o[i];
+    }
+};
+
+#define COLLECTIVE_NITER 10
+#define COLLECTIVE_CHUNKSIZE 0x10000
+
+void CollectiveTest(IGroup *group, ICommunicator *comm)
+{
+    // times (and checks) broadcast, allgather and reduce over a range of sizes
+    // naive broadcast (root sends to each rank in turn) is included for comparison
+    rank_t myrank = group->rank();
+    unsigned numranks = group->ordinality();
+    PrintLog("MPTEST: CollectiveTest: myrank=%u numranks=%u", myrank, numranks);
+
+    static const size32_t sizes[] = { 0x400, 0x10000, 0x100000, 0x1000000 };
+    CMessageBuffer mb;
+    for (unsigned s=0; s<_elements_in(sizes); s++) {
+        size32_t size = sizes[s];
+        unsigned n = size/sizeof(unsigned);
+        for (unsigned method=0; method<3; method++) {
+            comm->barrier();
+            CCycleTimer timer;
+            for (unsigned iter=0; iter<COLLECTIVE_NITER; iter++) {
+                rank_t root = iter%numranks;
+                mb.clear();
+                if (myrank==root) {
+                    unsigned *data = (unsigned *)mb.reserveTruncate(size);
+                    for (unsigned i=0; i<n; i++)
+                        data[i] = i+iter;
+                }
+                switch (method) {
+                case 0:
+                    if (myrank==root) {
+                        for (rank_t r=0; r<numranks; r++) {
+                            if (r!=root)
+                                comm->send(mb, r, MPTAG_TEST);
+                        }
+                    }
+                    else
+                        comm->recv(mb, root, MPTAG_TEST);
+                    break;
+                case 1:
+                    comm->broadcast(mb, root, MPTAG_TEST);
+                    break;
+                case 2:
+                    comm->broadcast(mb, root, MPTAG_TEST, COLLECTIVE_CHUNKSIZE);
+                    break;
+                }
+                assertex(mb.length()==size);
+                const unsigned *data = (const unsigned *)mb.toByteArray();
+                for (unsigned i=0; i<n; i+=n/16+1)
+                    assertex(data[i]==i+iter);
+            }
+            comm->barrier();
+            unsigned ms = timer.elapsedMs();
+            static const char *methods[] = { "naive broadcast", "tree broadcast", "pipelined broadcast" };
+            PrintLog("MPTEST: CollectiveTest: %s size=%u time=%ums (%.1f MB/s)", methods[method], size, ms, ms ? ((double)size*COLLECTIVE_NITER*1000)/(ms*0x100000) : 0.0);
+        }
+
+        // allgather of size/numranks from each rank
+        size32_t part = (size/numranks) & ~(sizeof(unsigned)-1);
+        comm->barrier();
+        CCycleTimer timer;
+        for (unsigned iter=0; iter<COLLECTIVE_NITER; iter++) {
+            mb.clear();
+            unsigned *data = (unsigned *)mb.reserveTruncate(part);
+            for (unsigned i=0; i<part/sizeof(unsigned); i++)
+                data[i] = myrank;
+            comm->allgather(mb, MPTAG_TEST);
+            for (rank_t r=0; r<numranks; r++) {
+                size32_t len;
+                mb.read(len);
+                assertex(len==part);
+                const unsigned *got = (const unsigned *)mb.readDirect(len);
+                assertex(!len || (got[0]==r));
+            }
+        }
+        comm->barrier();
+        unsigned ms = timer.elapsedMs();
+        PrintLog("MPTEST: CollectiveTest: allgather size=%u time=%ums", part*numranks, ms);
+
+        // element-wise sum of size bytes to rank 0
+        CSumReducer reducer;
+        comm->barrier();
+        timer.reset();
+        for (unsigned iter=0; iter<COLLECTIVE_NITER; iter++) {
+            mb.clear();
+            unsigned *data = (unsigned *)mb.reserveTruncate(size);
+            for (unsigned i=0; i<n; i++)
+                data[i] = myrank+1;
+            comm->reduce(mb, 0, MPTAG_TEST, reducer);
+            if (0==myrank) {
+                assertex(mb.length()==size);
+                const unsigned *got = (const unsigned *)mb.toByteArray();
+                for (unsigned i=0; i<n; i+=n/16+1)
+                    assertex(got[i]==numranks*(numranks+1)/2);
+            }
+        }
+        comm->barrier();
+        ms = timer.elapsedMs();
+        PrintLog("MPTEST: CollectiveTest: reduce size=%u time=%ums", size, ms);
+    }
+}
+
 void testIPnodeHash()
 {
     setNodeCaching(true);
@@ -757,7 +874,13 @@ int main(int argc, char* argv[])
         IGroup *group = createIGroup(MYMACHINES,MPPORT); 
 #endif
 
-#ifdef STREAMTEST
+#ifdef COLLECTIVETEST
+
+        ICommunicator * mpicomm = createCommunicator(group);
+        CollectiveTest(group,mpicomm);
+        mpicomm->Release();
+
+#elif defined(STREAMTEST)
 
         ICommunicator * mpicomm = createCommunicator(group);
         StreamTest(group,mpicomm);
@@ -31,6 +31,7 @@
 #include "dasds.hpp"
 #include "danqs.hpp"
 #include "dautils.hpp"
+#include "jptree.ipp"
 
 #include "unittests.hpp"
 
@@ -448,6 +449,9 @@ class CDaliTestsStress : public CppUnit::TestFixture
         CPPUNIT_TEST(testSDSRW);
         CPPUNIT_TEST(testSDSSubs);
         CPPUNIT_TEST(testSDSSubs2);
+        CPPUNIT_TEST(testSDSSubs3);
+        CPPUNIT_TEST(testSDSNotifyCoalesce);
+        CPPUNIT_TEST(testSDSIndex);
         CPPUNIT_TEST(testFiles);
         CPPUNIT_TEST(testGroups);
         CPPUNIT_TEST(testMultiCluster);
@@ -2363,6 +2367,288 @@ public:
         }
     }
 
+
+    void testSDSSubs3()
+    {
+        // Wildcard, qualified, descendant ('//'), exact and nested (sub) subscriptions are only notified of changes they match
+        class CSubscriber : public CSimpleInterfaceOf<ISDSSubscription>
+        {
+            StringAttr xpath;
+            CriticalSection &crit;
+            StringArray &result;
+            SubscriptionId id;
+        public:
+            CSubscriber(CriticalSection &_crit, StringArray &_result, const char *_xpath, bool sub) : crit(_crit), result(_result), xpath(_xpath)
+            {
+                id = querySDS().subscribe(xpath, *this, sub, false);
+            }
+            ~CSubscriber()
+            {
+                querySDS().unsubscribe(id);
+            }
+            virtual void notify(SubscriptionId id, const char *_xpath, SDSNotifyFlags flags, unsigned valueLen, const void *valueData)
+            {
+                PROGLOG("CSubscriber notified path=%s for subscriber=%s", _xpath, xpath.get());
+                CriticalBlock b(crit);
+                result.append(xpath);
+            }
+        };
+        Owned<IRemoteConnection> conn = querySDS().connect("/DAREGRESS/TestSub3", myProcessSession(), RTM_CREATE, INFINITE);
+        IPropertyTree *root = conn->queryRoot();
+        root->setPropTree("a", createPTreeFromXMLString("<a><leaf/><other/></a>"));
+        root->setPropTree("b", createPTreeFromXMLString("<b><leaf/><deep><leaf/></deep></b>"));
+        root->setPropTree("c", createPTreeFromXMLString("<c><leaf/></c>"));
+        conn->commit();
+
+        CriticalSection crit;
+        StringArray result;
+        Owned<ISDSSubscription> sub1 = new CSubscriber(crit, result, "/DAREGRESS/TestSub3/*/leaf", false);
+        Owned<ISDSSubscription> sub2 = new CSubscriber(crit, result, "/DAREGRESS/TestSub3/b", true);
+        Owned<ISDSSubscription> sub3 = new CSubscriber(crit, result, "/DAREGRESS/TestSub3/c/leaf", false);
+        Owned<ISDSSubscription> sub4 = new CSubscriber(crit, result, "/DAREGRESS/TestSub3/a/other", false);
+        Owned<ISDSSubscription> sub5 = new CSubscriber(crit, result, "/DAREGRESS/TestSub3/c[leaf]/leaf", false);
+        Owned<ISDSSubscription> sub6 = new CSubscriber(crit, result, "/DAREGRESS/TestSub3/a[deep]/leaf", false);
+        Owned<ISDSSubscription> sub7 = new CSubscriber(crit, result, "/DAREGRESS/TestSub3//deep/leaf", false);
+
+        MilliSleep(1000);
+
+        StringArray props, expectedResults;
+        props.appendList("a/leaf,b/leaf,b/deep/leaf,c/leaf,a/other", ",");
+        expectedResults.append("/DAREGRESS/TestSub3/*/leaf");
+        expectedResults.append("/DAREGRESS/TestSub3/*/leaf|/DAREGRESS/TestSub3/b");
+        expectedResults.append("/DAREGRESS/TestSub3//deep/leaf|/DAREGRESS/TestSub3/b");
+        expectedResults.append("/DAREGRESS/TestSub3/*/leaf|/DAREGRESS/TestSub3/c/leaf|/DAREGRESS/TestSub3/c[leaf]/leaf");
+        expectedResults.append("/DAREGRESS/TestSub3/a/other");
+        ForEachItemIn(p, props)
+        {
+            {
+                CriticalBlock b(crit);
+                result.kill();
+            }
+            root->setProp(props.item(p), "testv");
+            conn->commit();
+
+            MilliSleep(500); // time for notifications to come through
+
+            StringBuffer got;
+            {
+                CriticalBlock b(crit);
+                result.sortAscii();
+                ForEachItemIn(r, result)
+                {
+                    if (got.length())
+                        got.append("|");
+                    got.append(result.item(r));
+                }
+            }
+            VStringBuffer errMsg("testSDSSubs3 [ %s ]: expected %s, got %s", props.item(p), expectedResults.item(p), got.str());
+            CPPUNIT_ASSERT_MESSAGE(errMsg.str(), streq(expectedResults.item(p), got));
+        }
+        conn->close(true);
+    }
+
+    unsigned __int64 getNotificationStat(const char *name)
+    {
+        // e.g. "Notifications coalesced  : 123", see formatUsageStats
+        StringBuffer stats;
+        querySDS().getUsageStats(stats);
+        const char *line = strstr(stats, name);
+        VStringBuffer errMsg("SDS usage stats do not include '%s'", name);
+        CPPUNIT_ASSERT_MESSAGE(errMsg.str(), line && strchr(line, ':'));
+        return strtoull(strchr(line, ':')+1, NULL, 10);
+    }
+
+    void testSDSNotifyCoalesce()
+    {
+        class CSubscriber : public CSimpleInterfaceOf<ISDSSubscription>
+        {
+            SubscriptionId id;
+        public:
+            CriticalSection crit;
+            StringArray values;
+            UnsignedArray flags;
+
+            CSubscriber(const char *xpath)
+            {
+                id = querySDS().subscribe(xpath, *this, false, true);
+            }
+            ~CSubscriber()
+            {
+                querySDS().unsubscribe(id);
+            }
+            virtual void notify(SubscriptionId id, const char *xpath, SDSNotifyFlags _flags, unsigned valueLen, const void *valueData)
+            {
+                CriticalBlock b(crit);
+                values.append(StringBuffer().append(valueLen, (const char *)valueData));
+                flags.append(_flags);
+            }
+            bool waitFor(const char *value, unsigned timeout)
+            {
+                CTimeMon tm(timeout);
+                for (;;)
+                {
+                    {
+                        CriticalBlock b(crit);
+                        if (values.ordinality() && streq(value, values.tos()))
+                            return true;
+                    }
+                    if (tm.timedout())
+                        return false;
+                    MilliSleep(10);
+                }
+            }
+            void clear()
+            {
+                CriticalBlock b(crit);
+                values.kill();
+                flags.kill();
+            }
+        };
+        Owned<IRemoteConnection> conn = querySDS().connect("/DAREGRESS/TestSub4", myProcessSession(), RTM_CREATE, INFINITE);
+        IPropertyTree *root = conn->queryRoot();
+        root->setProp("x", "initial");
+        conn->commit();
+        Owned<CSubscriber> subscriber = new CSubscriber("/DAREGRESS/TestSub4/x");
+        MilliSleep(1000);
+
+        // Repeated changes to the same path are coalesced whilst pending, the latest value is always delivered,
+        // and every change is accounted for as delivered, coalesced or dropped (over the queue limit)
+        unsigned __int64 queued = getNotificationStat("Notifications queued");
+        unsigned __int64 coalesced = getNotificationStat("Notifications coalesced");
+        unsigned __int64 dropped = getNotificationStat("Notifications dropped");
+        const unsigned numChanges = 50;
+        for (unsigned i = 0; i < numChanges; i++)
+        {
+            VStringBuffer value("v%u", i);
+            root->setProp("x", value);
+            conn->commit();
+        }
+        ASSERT(subscriber->waitFor(VStringBuffer("v%u", numChanges-1), 10000));
+        MilliSleep(500);
+        queued = getNotificationStat("Notifications queued") - queued;
+        coalesced = getNotificationStat("Notifications coalesced") - coalesced;
+        dropped = getNotificationStat("Notifications dropped") - dropped;
+        unsigned received;
+        {
+            CriticalBlock b(subscriber->crit);
+            received = subscriber->values.ordinality();
+        }
+        PROGLOG("testSDSNotifyCoalesce: %u changes, %u notifications received, %" I64F "u queued, %" I64F "u coalesced, %" I64F "u dropped", numChanges, received, queued, coalesced, dropped);
+        ASSERT(received <= numChanges);
+        ASSERT(received == queued);
+        ASSERT(queued + coalesced + dropped == numChanges);
+
+        // A change is never coalesced past a later delete of the same path
+        subscriber->clear();
+        root->setProp("x", "before");
+        conn->commit();
+        root->removeProp("x");
+        conn->commit();
+        root->setProp("x", "after");
+        conn->commit();
+        ASSERT(subscriber->waitFor("after", 10000));
+        MilliSleep(500);
+        {
+            CriticalBlock b(subscriber->crit);
+            unsigned deleted = NotFound;
+            ForEachItemIn(n, subscriber->flags)
+            {
+                if (SDSNotify_Deleted == (subscriber->flags.item(n) & SDSNotify_Deleted))
+                    deleted = n;
+            }
+            ASSERT(deleted != NotFound);
+            ForEachItemIn(v, subscriber->values)
+            {
+                bool isAfter = streq("after", subscriber->values.item(v));
+                if (v != deleted)
+                    ASSERT(isAfter == (v > deleted));
+            }
+        }
+        subscriber.clear();
+        conn->close(true);
+    }
+    // Names of the indexed children of /WorkUnits matching state (from getIndexedElements, sorted on @submitID), or false if there is no index
+    bool getIndexedNames(StringBuffer &names, const char *state, unsigned from=0, unsigned limit=0, unsigned *total=NULL)
+    {
+        names.clear();
+        Owned<IPropertyTreeIterator> iter = querySDS().getIndexedElements("/WorkUnits", "@state", state, "@submitID", false, from, limit, "Action,Application", total);
+        if (!iter)
+            return false;
+        ForEach(*iter)
+        {
+            IPropertyTree &wu = iter->query();
+            if (names.length())
+                names.append(',');
+            names.append(wu.queryName());
+            ASSERT(streq("run", wu.queryProp("Action")));
+            ASSERT(streq(wu.queryName(), wu.queryProp("Application/daregress/name")));
+        }
+        return true;
+    }
+    void testSDSIndex()
+    {
+        // Needs the server to index /WorkUnits on @state and @submitID, as the default environment does (see the SDS Index configuration)
+        VStringBuffer stateA("daregressA%u", (unsigned)GetCurrentProcessId());
+        VStringBuffer stateB("daregressB%u", (unsigned)GetCurrentProcessId());
+        StringBuffer names;
+        ASSERT(getIndexedNames(names, stateA) && "dali has no SDS index on /WorkUnits @state,@submitID");
+        ASSERT(0 == names.length());
+        const char *wuNames[] = { "DAREGRESSIDX0", "DAREGRESSIDX1", "DAREGRESSIDX2" };
+        for (unsigned i = 0; i < 3; i++)
+        {
+            VStringBuffer path("/WorkUnits/%s", wuNames[i]);
+            Owned<IRemoteConnection> conn = querySDS().connect(path, myProcessSession(), RTM_CREATE|RTM_LOCK_WRITE, 10000);
+            IPropertyTree *root = conn->queryRoot();
+            root->setProp("@state", i < 2 ? stateA : stateB);
+            root->setProp("@submitID", VStringBuffer("user%u", 2-i));
+            root->setProp("Action", "run");
+            root->setProp("Application/daregress/name", wuNames[i]);
+        }
+
+        // New children are indexed on commit, sorted on @submitID, and paged
+        unsigned total = 0;
+        ASSERT(getIndexedNames(names, stateA, 0, 0, &total));
+        ASSERT(streq("DAREGRESSIDX1,DAREGRESSIDX0", names));
+        ASSERT(2 == total);
+        ASSERT(getIndexedNames(names, stateA, 1, 1, &total));
+        ASSERT(streq("DAREGRESSIDX0", names));
+        ASSERT(2 == total);
+
+        // Updates move the entry
+        {
+            Owned<IRemoteConnection> conn = querySDS().connect("/WorkUnits/DAREGRESSIDX2", myProcessSession(), RTM_LOCK_WRITE, 10000);
+            conn->queryRoot()->setProp("@state", stateA);
+        }
+        ASSERT(getIndexedNames(names, stateA, 0, 0, &total));
+        ASSERT(streq("DAREGRESSIDX2,DAREGRESSIDX1,DAREGRESSIDX0", names));
+        ASSERT(3 == total);
+        ASSERT(getIndexedNames(names, stateB, 0, 0, &total));
+        ASSERT(0 == total);
+
+        // Renames and deletes via the parent
+        {
+            Owned<IRemoteConnection> conn = querySDS().connect("/WorkUnits", myProcessSession(), RTM_LOCK_WRITE, 10000);
+            IPropertyTree *root = conn->queryRoot();
+            ASSERT(root->renameProp("DAREGRESSIDX1", "DAREGRESSIDX3"));
+            root->setProp("DAREGRESSIDX3/Application/daregress/name", "DAREGRESSIDX3");
+            ASSERT(root->removeProp("DAREGRESSIDX0"));
+        }
+        ASSERT(getIndexedNames(names, stateA, 0, 0, &total));
+        ASSERT(streq("DAREGRESSIDX2,DAREGRESSIDX3", names));
+        ASSERT(2 == total);
+
+        // Branches freed when their connection deletes them
+        {
+            Owned<IRemoteConnection> conn = querySDS().connect("/WorkUnits/DAREGRESSIDX2", myProcessSession(), RTM_LOCK_WRITE, 10000);
+            conn->close(true);
+        }
+        {
+            Owned<IRemoteConnection> conn = querySDS().connect("/WorkUnits/DAREGRESSIDX3", myProcessSession(), RTM_LOCK_WRITE|RTM_DELETE_ON_DISCONNECT, 10000);
+        }
+        ASSERT(getIndexedNames(names, stateA, 0, 0, &total));
+        ASSERT(0 == names.length());
+        ASSERT(0 == total);
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION( CDaliTestsStress );
@@ -2372,7 +2658,65 @@ class CDaliUtils : public CppUnit::TestFixture
 {
     CPPUNIT_TEST_SUITE(CDaliUtils);
       CPPUNIT_TEST(testDFSLfn);
+      CPPUNIT_TEST(testBinaryStore);
     CPPUNIT_TEST_SUITE_END();
+
+    StringBuffer &getStoreFileName(StringBuffer &name, const char *dir, const char *base, unsigned edition)
+    {
+        name.append(dir).append(base);
+        if (edition)
+            name.append(edition);
+        return name.append(".xml");
+    }
+    unsigned saveStoreDelta(IStoreHelper &storeHelper, const char *path, IPropertyTree *changeTree)
+    {
+        // as CCovenSDSManager::saveDelta
+        Owned<IPropertyTree> header = createPTree("Header");
+        header->setProp("@path", path);
+        header->addPropTree("Delta", createPTree())->addPropTree(changeTree->queryName(), changeTree);
+        StringBuffer delta;
+        toXML(header, delta);
+        bool first;
+        return storeHelper.writeDelta(delta, first);
+    }
+    IPropertyTree *createStateChange(const char *wuid, const char *state, bool isNew)
+    {
+        Owned<IPropertyTree> change = createPTreeFromXMLString("<T name=\"WorkUnits\"><T><AC/></T></T>");
+        IPropertyTree *wuChange = change->queryPropTree("T");
+        wuChange->setProp("@name", wuid);
+        if (isNew)
+            wuChange->setProp("@new", "1");
+        else
+            wuChange->setProp("@pos", "1");
+        wuChange->setProp("AC/@state", state);
+        return change.getClear();
+    }
+    IPropertyTree *loadStoreEdition(IStoreHelper &storeHelper, const char *dir, unsigned edition)
+    {
+        StringBuffer storeName, deltaName;
+        Owned<IPropertyTree> root = loadStoreFile(getStoreFileName(storeName, dir, "dalisds", edition));
+        ASSERT(root);
+        getStoreFileName(deltaName, dir, "daliinc", edition);
+        OwnedIFile iFile = createIFile(deltaName);
+        if (iFile->exists())
+            ASSERT(storeHelper.loadDelta(deltaName, iFile, root));
+        return root.getClear();
+    }
+    void checkStoreMatches(IPropertyTree *expected, IPropertyTree *actual)
+    {
+        StringBuffer expectedXml, actualXml;
+        toXML(expected, expectedXml);
+        toXML(actual, actualXml);
+        ASSERT(streq(expectedXml, actualXml));
+    }
+    void checkStoreFlags(IPropertyTree &tree)
+    {
+        // the dali subscribed/orphaned flags are runtime only, so are not persisted
+        ASSERT(0 == (((PTree &)tree).queryFlags() & (ipt_ext4|ipt_ext5)));
+        Owned<IPropertyTreeIterator> iter = tree.getElements("*");
+        ForEach(*iter)
+            checkStoreFlags(iter->query());
+    }
 public:
     void testDFSLfn()
     {
@@ -2447,6 +2791,99 @@ public:
             }
         }
     }
+    void testBinaryStore()
+    {
+        const char *dir = "daregress_binarystore" PATHSEPSTR;
+        recursiveCreateDirectory(dir);
+        Owned<IDirectoryIterator> oldFiles = createDirectoryIterator(dir, "*");
+        ForEach(*oldFiles)
+            oldFiles->query().remove();
+
+        Owned<IPropertyTree> root = createPTree("SDS");
+        IPropertyTree *files = root->addPropTree("Files", createPTree("Files", ipt_lowmem|ipt_ext4));
+        IPropertyTree *file = files->addPropTree("File", createPTree("File", ipt_fast|ipt_ext5));
+        file->setProp("@name", "daregress::binarystore");
+        file->setPropInt("@numparts", 3);
+        file->setProp("Description", "a <quoted> & escaped description");
+        byte bin[256];
+        for (unsigned b=0; b<sizeof(bin); b++)
+            bin[b] = (byte)b;
+        file->setPropBin("Bin", sizeof(bin), bin);
+        IPropertyTree *ext = file->addPropTree("Ext", createPTree("Ext", ipt_ext4));
+        ext->setPropInt64("@sds:ext", 42); // an external value is saved as a reference only
+        IPropertyTree *extBin = files->addPropTree("File", createPTree("File"));
+        extBin->setProp("@name", "daregress::binarystore2");
+        extBin->setPropBin(NULL, 5, "a\0b\0c");
+        root->addPropTree("WorkUnits", createPTree("WorkUnits"))->addPropTree("W1", createPTree("W1"))->setProp("@state", "completed");
+        root->addPropTree("Empty", createPTree("Empty"));
+
+        Owned<IStoreHelper> storeHelper = createStoreHelper(NULL, dir, NULL, SH_BinaryStore);
+        unsigned edition = 0;
+        storeHelper->saveStore(root, &edition);
+        ASSERT(edition == storeHelper->queryCurrentEdition());
+
+        // round trip of the full store
+        StringBuffer storeName(dir);
+        storeHelper->getCurrentStoreFilename(storeName);
+        Owned<IPropertyTree> loaded = loadStoreFile(storeName);
+        ASSERT(loaded);
+        checkStoreMatches(root, loaded);
+        checkStoreFlags(*loaded);
+        MemoryBuffer mb;
+        ASSERT(loaded->getPropBin("Files/File[1]/Bin", mb));
+        ASSERT(mb.length() == sizeof(bin) && 0 == memcmp(bin, mb.toByteArray(), sizeof(bin)));
+        IPropertyTree *loadedExtBin = loaded->queryPropTree("Files/File[2]");
+        ASSERT(loadedExtBin->isBinary());
+        ASSERT(loadedExtBin->getPropBin(NULL, mb.clear()));
+        ASSERT(5 == mb.length() && 0 == memcmp("a\0b\0c", mb.toByteArray(), 5));
+        ASSERT(42 == loaded->getPropInt64("Files/File[1]/Ext/@sds:ext"));
+        ASSERT(!loaded->queryProp("Files/File[1]/Ext"));
+
+        // A snapshot saves to the next edition. Deltas committed whilst it is written go to both editions' deltas,
+        // so whichever edition is loaded gives the same store.
+        root->setProp("WorkUnits/W1/@state", "archived"); // before the snapshot, in the old edition's delta only
+        ASSERT(edition == saveStoreDelta(*storeHelper, "/WorkUnits", createStateChange("W1", "archived", false)));
+        Owned<IStoreSnapshot> snapshot = createStoreSnapshot(*root);
+        ASSERT(snapshot->querySize());
+        unsigned snapshotEdition = storeHelper->beginSnapshotDeltas();
+        ASSERT(snapshotEdition == edition+1);
+        root->addPropTree("WorkUnits/W2", createPTree("W2"))->setProp("@state", "running"); // whilst the snapshot is written
+        ASSERT(edition == saveStoreDelta(*storeHelper, "/WorkUnits", createStateChange("W2", "running", true)));
+        unsigned newEdition = 0;
+        storeHelper->saveStoreSnapshot(*snapshot, &newEdition);
+        ASSERT(newEdition == snapshotEdition);
+        ASSERT(newEdition == storeHelper->queryCurrentEdition());
+        Owned<IPropertyTree> oldStore = loadStoreEdition(*storeHelper, dir, edition);
+        checkStoreMatches(root, oldStore);
+        root->setProp("WorkUnits/W2/@state", "completed"); // after the snapshot is committed, before the deltas are ended
+        ASSERT(newEdition == saveStoreDelta(*storeHelper, "/WorkUnits", createStateChange("W2", "completed", false)));
+        ASSERT(storeHelper->endSnapshotDeltas());
+
+        Owned<IPropertyTree> newStore = loadStoreEdition(*storeHelper, dir, newEdition);
+        checkStoreMatches(root, newStore);
+        checkStoreFlags(*newStore);
+
+        // A snapshot that is not committed loses its edition's delta, the deltas written meanwhile are in the current edition's
+        snapshotEdition = storeHelper->beginSnapshotDeltas();
+        ASSERT(snapshotEdition == newEdition+1);
+        root->setProp("WorkUnits/W1/@state", "deleted");
+        ASSERT(newEdition == saveStoreDelta(*storeHelper, "/WorkUnits", createStateChange("W1", "deleted", false)));
+        StringBuffer snapshotDeltaName;
+        OwnedIFile snapshotDelta = createIFile(getStoreFileName(snapshotDeltaName, dir, "daliinc", snapshotEdition));
+        ASSERT(snapshotDelta->exists());
+        ASSERT(!storeHelper->endSnapshotDeltas());
+        ASSERT(!snapshotDelta->exists());
+        ASSERT(newEdition == storeHelper->queryCurrentEdition());
+        newStore.setown(loadStoreEdition(*storeHelper, dir, newEdition));
+        checkStoreMatches(root, newStore);
+
+        storeHelper.clear();
+        Owned<IDirectoryIterator> storeFiles = createDirectoryIterator(dir, "*");
+        ForEach(*storeFiles)
+            storeFiles->query().remove();
+        OwnedIFile iFileDir = createIFile(dir);
+        iFileDir->remove();
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION( CDaliUtils );
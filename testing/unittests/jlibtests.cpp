@@ -22,6 +22,8 @@
 
 #ifdef _USE_CPPUNIT
 #include <memory>
+#include <vector>
+#include <deque>
 #include "jsem.hpp"
 #include "jfile.hpp"
 #include "jdebug.hpp"
@@ -29,6 +31,7 @@
 #include "sockfile.hpp"
 #include "jqueue.hpp"
 #include "jregexp.hpp"
+#include "jsort.hpp"
 
 #include "unittests.hpp"
 
@@ -724,6 +727,7 @@ class JlibReaderWriterTestTiming : public CppUnit::TestFixture
 {
     CPPUNIT_TEST_SUITE(JlibReaderWriterTestTiming);
     CPPUNIT_TEST(testCombinations);
+    CPPUNIT_TEST(testThreadPairs);
     CPPUNIT_TEST_SUITE_END();
 
     const static unsigned spinScaling = 1000;
@@ -1004,6 +1008,137 @@ public:
         testQueue(2, 2, 100);
     }
 
+    //A queue protected by a critical section, which blocks on semaphores when empty or full, for comparison with
+    //the lock free queue.
+    class LockedRowQueue : public CInterfaceOf<IRowQueue>
+    {
+    public:
+        LockedRowQueue(unsigned _maxItems) : maxItems(_maxItems)
+        {
+        }
+        virtual bool enqueue(const void * const item) override
+        {
+            CriticalBlock block(crit);
+            while (items.size() >= maxItems)
+            {
+                writerWaiting = true;
+                CriticalUnblock unblock(crit);
+                writerSem.wait();
+            }
+            items.push_back(item);
+            if (readerWaiting)
+            {
+                readerWaiting = false;
+                readerSem.signal();
+            }
+            return true;
+        }
+        virtual bool dequeue(const void * & result) override
+        {
+            CriticalBlock block(crit);
+            while (items.empty())
+            {
+                if (writerStopped)
+                    return false;
+                readerWaiting = true;
+                CriticalUnblock unblock(crit);
+                readerSem.wait();
+            }
+            result = items.front();
+            items.pop_front();
+            if (writerWaiting)
+            {
+                writerWaiting = false;
+                writerSem.signal();
+            }
+            return true;
+        }
+        virtual bool tryDequeue(const void * & result) override
+        {
+            CriticalBlock block(crit);
+            if (items.empty())
+                return false;
+            result = items.front();
+            items.pop_front();
+            return true;
+        }
+        virtual void noteReaderStopped() override {}
+        virtual void noteWriterStopped() override
+        {
+            CriticalBlock block(crit);
+            writerStopped = true;
+            if (readerWaiting)
+            {
+                readerWaiting = false;
+                readerSem.signal();
+            }
+        }
+        virtual void abort() override {}
+        virtual void reset() override {}
+
+    private:
+        CriticalSection crit;
+        Semaphore readerSem;
+        Semaphore writerSem;
+        std::deque<const void *> items;
+        unsigned maxItems;
+        bool readerWaiting = false;
+        bool writerWaiting = false;
+        bool writerStopped = false;
+    };
+
+    //Each pair of threads has its own queue, so this measures the hand off cost rather than contention on a queue
+    double timeThreadPairs(unsigned numPairs, unsigned queueElements, bool lockFree)
+    {
+        const size_t sizePerPair = bufferSize;
+        OwnedMalloc<byte> buffer(sizePerPair * numPairs, true);
+        Semaphore startSem;
+        Semaphore writerDoneSem;
+        Semaphore readerDoneSem;
+
+        IArrayOf<IRowQueue> queues;
+        IArrayOf<Thread> threads;
+        for (unsigned i = 0; i < numPairs; i++)
+        {
+            IRowQueue * queue = lockFree ? createRowQueue(1, 1, queueElements, 0) : new LockedRowQueue(queueElements);
+            queues.append(*queue);
+            Reader * reader = new Reader(*queue, readerDoneSem, 0);
+            Writer * writer = new Writer(*queue, sizePerPair, buffer + i * sizePerPair, startSem, writerDoneSem, 0);
+            threads.append(*reader);
+            threads.append(*writer);
+            reader->start();
+            writer->start();
+        }
+
+        cycle_t startTime = get_cycles_now();
+        startSem.signal(numPairs);
+        for (unsigned i = 0; i < numPairs; i++)
+        {
+            writerDoneSem.wait();
+            readerDoneSem.wait();
+        }
+        cycle_t stopTime = get_cycles_now();
+
+        ForEachItemIn(t, threads)
+            threads.item(t).join();
+        for (size_t pos = 0; pos < sizePerPair * numPairs; pos++)
+            ASSERT(buffer[pos] == 1);
+
+        double seconds = (double)cycle_to_nanosec(stopTime - startTime) / 1000000000;
+        return (double)sizePerPair / seconds;
+    }
+
+    void testThreadPairs()
+    {
+        const unsigned queueElements = 0x3f00;
+        for (unsigned numPairs = 1; numPairs <= 8; numPairs *= 2)
+        {
+            double lockedRate = timeThreadPairs(numPairs, queueElements, false);
+            double lockFreeRate = timeThreadPairs(numPairs, queueElements, true);
+            printf("%u thread pairs: locked queue %.0f rows/sec per pair, lock free queue %.0f rows/sec per pair\n", numPairs, lockedRate, lockFreeRate);
+        }
+    }
+
 protected:
     unsigned unitWorkTimeMs;
 };
@@ -1212,4 +1347,125 @@ CPPUNIT_TEST_SUITE_REGISTRATION(JlibMapping);
 CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(JlibMapping, "JlibMapping");
 
 
+class JlibMergeTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(JlibMergeTest);
+        CPPUNIT_TEST(testParallelMerge);
+        CPPUNIT_TEST(testParallelMergeStop);
+    CPPUNIT_TEST_SUITE_END();
+
+    struct TestRow
+    {
+        unsigned key;
+        unsigned seq;
+    };
+    class CTestRowStream : public CSimpleInterfaceOf<IRowStream>
+    {
+        const TestRow *rows;
+        unsigned num;
+        unsigned pos = 0;
+    public:
+        CTestRowStream(const TestRow *_rows, unsigned _num) : rows(_rows), num(_num) { }
+        virtual const void *nextRow() override { return (pos < num) ? &rows[pos++] : nullptr; }
+        virtual void stop() override { pos = num; }
+    };
+    class CNoLinkCounter : public CSimpleInterfaceOf<IRowLinkCounter>
+    {
+    public:
+        virtual void linkRow(const void *row) override { }
+        virtual void releaseRow(const void *row) override { }
+    };
+    class CKeyCompare : public ICompare
+    {
+    public:
+        virtual int docompare(const void *left, const void *right) const override
+        {
+            unsigned l = ((const TestRow *)left)->key;
+            unsigned r = ((const TestRow *)right)->key;
+            return (l < r) ? -1 : (l > r) ? 1 : 0;
+        }
+    } compare;
+
+    // numStreams runs of sorted rows, with many duplicate keys within and between runs
+    void createRuns(unsigned numStreams, unsigned rowsPerStream, std::vector<TestRow> &rows)
+    {
+        rows.resize(numStreams * rowsPerStream);
+        for (unsigned s=0; s<numStreams; s++)
+        {
+            unsigned key = 0;
+            for (unsigned r=0; r<rowsPerStream; r++)
+            {
+                key += getRandom() % 4;
+                rows[s*rowsPerStream+r] = { key, s*rowsPerStream+r };
+            }
+        }
+    }
+    IRowStream *createMerger(std::vector<TestRow> &rows, unsigned numStreams, unsigned rowsPerStream, unsigned numThreads)
+    {
+        IArrayOf<IRowStream> streams;
+        for (unsigned s=0; s<numStreams; s++)
+            streams.append(*new CTestRowStream(&rows[s*rowsPerStream], rowsPerStream));
+        Owned<IRowLinkCounter> linkCounter = new CNoLinkCounter;
+        if (numThreads)
+            return createParallelRowStreamMerger(numStreams, streams.getArray(), &compare, false, linkCounter, numThreads);
+        return createRowStreamMerger(numStreams, streams.getArray(), &compare, false, linkCounter);
+    }
+public:
+    void testParallelMerge()
+    {
+        const unsigned numStreams = 37;
+        const unsigned rowsPerStream = 20000;
+        std::vector<TestRow> rows;
+        createRuns(numStreams, rowsPerStream, rows);
+        Owned<IRowStream> serial = createMerger(rows, numStreams, rowsPerStream, 0);
+        std::vector<const void *> expected;
+        for (;;)
+        {
+            const void *row = serial->nextRow();
+            if (!row)
+                break;
+            expected.push_back(row);
+        }
+        CPPUNIT_ASSERT_EQUAL((size_t)numStreams*rowsPerStream, expected.size());
+        unsigned threadCounts[] = { 2, 3, 8, 64 };
+        for (unsigned t=0; t<_elements_in(threadCounts); t++)
+        {
+            Owned<IRowStream> parallel = createMerger(rows, numStreams, rowsPerStream, threadCounts[t]);
+            size_t n = 0;
+            for (;;)
+            {
+                const void *row = parallel->nextRow();
+                if (!row)
+                    break;
+                CPPUNIT_ASSERT(n < expected.size());
+                CPPUNIT_ASSERT(row == expected[n]); // same order, including stability of duplicates
+                n++;
+            }
+            CPPUNIT_ASSERT_EQUAL(expected.size(), n);
+        }
+    }
+    void testParallelMergeStop()
+    {
+        const unsigned numStreams = 16;
+        const unsigned rowsPerStream = 50000;
+        std::vector<TestRow> rows;
+        createRuns(numStreams, rowsPerStream, rows);
+        for (unsigned read=0; read<3; read++)
+        {
+            Owned<IRowStream> parallel = createMerger(rows, numStreams, rowsPerStream, 4);
+            unsigned lastKey = 0;
+            for (unsigned r=0; r<read*1000; r++)
+            {
+                const TestRow *row = (const TestRow *)parallel->nextRow();
+                CPPUNIT_ASSERT(row && (row->key >= lastKey));
+                lastKey = row->key;
+            }
+            parallel->stop();
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(JlibMergeTest);
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(JlibMergeTest, "JlibMergeTest");
+
 #endif // _USE_CPPUNIT
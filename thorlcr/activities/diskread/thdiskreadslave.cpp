@@ -35,6 +35,7 @@
 #include "thsortu.hpp"
 #include "thexception.hpp"
 #include "thactivityutil.ipp"
+#include "sockfile.hpp"
 
 #include "../hashdistrib/thhashdistribslave.ipp"
 #include "thdiskreadslave.ipp"
@@ -53,8 +54,10 @@ protected:
     bool isFixedDiskWidth;
     size32_t diskRowMinSz;
     const RtlRecord *recInfo = nullptr;
+    const RtlTypeInfo *diskTypeInfo = nullptr;
     unsigned numOffsets = 0;
     unsigned numSegFieldsUsed = 0;
+    bool filterRemotely = false; // remote parts are read via dafilesrv, which only returns the rows matching the segment monitors
 
     inline bool segMonitorsMatch(const void *buffer)
     {
@@ -84,6 +87,7 @@ public:
         diskRowMinSz = diskRowMeta->getMinRecordSize();
         helper->createSegmentMonitors(this);
         recInfo = &diskRowMeta->queryRecordAccessor(true);
+        diskTypeInfo = diskRowMeta->queryTypeInfo();
         numOffsets = recInfo->getNumVarFields() + 1;  // MORE - note max field used in segmonitors
         grouped = false;
     }
@@ -139,6 +143,7 @@ void mergeStats(CRuntimeStatisticCollection & stats, IExtRowStream * in)
 class CDiskRecordPartHandler : public CDiskPartHandlerBase
 {
     Owned<IExtRowStream> in;
+    Owned<IRemoteFilteredFileReader> filteredIn;
 protected:
     offset_t localRowOffset;
     CDiskReadSlaveActivityRecord &activity;
@@ -164,8 +169,21 @@ public:
             ++activity.diskProgress;
         return ret;
     }
+    inline bool isFilteredRemotely() const { return nullptr != filteredIn; }
     inline const void *prefetchRow()
     {
+        if (filteredIn)
+        {
+            size32_t sz;
+            const void *ret = filteredIn->nextRow(sz);
+            if (ret)
+            {
+                if (needsFileOffset)
+                    localRowOffset = filteredIn->queryRowOffset();
+                ++activity.diskProgress;
+            }
+            return ret;
+        }
         if (needsFileOffset)
             localRowOffset = in->getOffset();       // shame this needed as a bit inefficient
         const void *ret = in->prefetchRow();
@@ -175,7 +193,8 @@ public:
     }
     inline void prefetchDone()
     {
-        in->prefetchDone();
+        if (!filteredIn)
+            in->prefetchDone();
     }
     virtual void gatherStats(CRuntimeStatisticCollection & merged)
     {
@@ -235,6 +254,18 @@ void CDiskRecordPartHandler::open()
 {
     CDiskPartHandlerBase::open();
     in.clear();
+    filteredIn.clear();
+    if (activity.filterRemotely && !compressed && !activity.grouped)
+    {
+        // NULL if the part is local, or its dafilesrv predates filtered reads, in which case it is read in full below
+        filteredIn.setown(createRemoteFilteredFileReader(iFile, activity.diskTypeInfo, nullptr, &activity));
+        if (filteredIn)
+        {
+            checkFileCrc = false; // the part is not read in full
+            ActPrintLog(&activity, "%s[part=%d]: filtering remotely %s", kindStr, which, filename.get());
+            return;
+        }
+    }
     unsigned rwFlags = DEFAULT_RWFLAGS;
     if (checkFileCrc) // NB: if compressed, this will be turned off by base class
         rwFlags |= rw_crc;
@@ -334,7 +365,7 @@ public:
                                     break;
                             }
                             size32_t sz;
-                            if (activity.segMonitorsMatch(row)) 
+                            if (isFilteredRemotely() || activity.segMonitorsMatch(row))
                                 sz = activity.helper->transform(outBuilder.ensureRow(), row);
                             else
                                 sz = 0;
@@ -430,6 +461,7 @@ public:
         unsorted = 0 != (TDRunsorted & helper->getFlags());
         grouped = 0 != (TDXgrouped & helper->getFlags());
         needTransform = segMonitors.length() || helper->needTransform();
+        filterRemotely = segMonitors.length() && diskTypeInfo && getOptBool(THOROPT_REMOTE_FILTER, true);
         appendOutputLinked(this);
     }
     ~CDiskReadSlaveActivity()
@@ -172,6 +172,8 @@ public:
         buildUserMetadata(metadata);                
         buildLayoutMetadata(metadata);
         unsigned nodeSize = metadata ? metadata->getPropInt("_nodeSize", NODESIZE) : NODESIZE;
+        if (metadata && metadata->getPropBool("_frontCodedLeaves"))
+            flags |= HTREE_FRONTCODED_LEAF;
         builder.setown(createKeyBuilder(out, flags, maxDiskRecordSize, nodeSize, helper->getKeyedSize(), isTopLevel ? 0 : totalCount));
     }
 
@@ -37,6 +37,7 @@ enum join_t { JT_Undefined, JT_Inner, JT_LeftOuter, JT_RightOuter, JT_LeftOnly,
 
 #define MAX_SEND_SIZE 0x100000 // 1MB
 #define MAX_QUEUE_BLOCKS 5
+#define LKJOIN_PROBESTRAND_BLOCKSIZE 512 // rows per strand block, if strandBlockSize is not set
 
 enum broadcast_code { bcast_none, bcast_send, bcast_sendStopping, bcast_stop };
 enum broadcast_flags { bcastflag_null=0, bcastflag_spilt=0x100 };
@@ -807,8 +808,6 @@ class CInMemJoinBase : public CSlaveActivity, public CAllOrLookupHelper<HELPER>,
 
     Owned<IException> leftexception;
 
-    bool eos, eog, someSinceEog;
-
 protected:
     typedef CAllOrLookupHelper<HELPER> HELPERBASE;
 
@@ -915,8 +914,104 @@ protected:
     rowidx_t rhsTableLen;
     Owned<HTHELPER> table; // NB: only channel 0 uses table, unless failing over to local lookup join
     Linked<HTHELPER> tableProxy; // Channels >1 will reference channel 0 table unless failed over
-    HtEntry currentHashEntry; // Used for lookup,many only
-    OwnedConstThorRow leftRow;
+    /* State of a stream of LHS rows probing the table.
+     * The activity's own output uses 'probe', each probing strand (see CProbeStrand) has its own.
+     */
+    class CProbeState
+    {
+    public:
+        IRowStream *left = nullptr;
+        OwnedConstThorRow leftRow;
+        const void *rhsNext = nullptr;
+        HtEntry currentHashEntry; // Used for lookup,many only
+        unsigned joined = 0;
+        unsigned joinCounter = 0;
+        bool leftMatch = false;
+        bool eos = false, eog = false, someSinceEog = false;
+        unsigned leftRowHash = 0; // Only valid if probeBatchSize, hash of leftRow calculated when prefetched
+        OwnedMalloc<const void *> probeRows;
+        OwnedMalloc<unsigned> probeHashes;
+        unsigned probeNext = 0, probeEnd = 0;
+
+        void reset()
+        {
+            joined = 0;
+            joinCounter = 0;
+            leftMatch = false;
+            rhsNext = nullptr;
+            eos = eog = someSinceEog = false;
+            currentHashEntry.index = 0;
+            currentHashEntry.count = 0;
+        }
+    } probe;
+    /* If probeBatchSize, LHS rows are read in batches and each is hashed and its table slot prefetched,
+     * before the first of the batch is probed, so that the cache misses on the table overlap.
+     * A batch never reads beyond a NULL (end of group or stream).
+     */
+    unsigned probeBatchSize = 0;
+
+    /* A strand probing the table with its share of the LHS rows.
+     * Its rows are pulled on the thread of the junction recombining the strands.
+     */
+    class CProbeStrand : public CSimpleInterfaceOf<IEngineRowStream>
+    {
+        CInMemJoinBase &owner;
+        IEngineRowStream *input;
+        CProbeState state;
+    public:
+        CProbeStrand(CInMemJoinBase &_owner, IEngineRowStream *_input) : owner(_owner), input(_input)
+        {
+            state.left = input;
+        }
+        void reset()
+        {
+            owner.clearProbeBatch(state);
+            state.leftRow.clear();
+            state.reset();
+        }
+    // IRowStream
+        virtual const void *nextRow() override
+        {
+            return owner.lookupNextRow(state);
+        }
+        virtual void stop() override
+        {
+            owner.clearProbeBatch(state);
+            input->stop();
+        }
+    // IEngineRowStream
+        virtual void resetEOF() override
+        {
+            throwUnexpected();
+        }
+    };
+    /* Feeds the LHS stream (which may be replaced when the RHS is gathered) to the strand splitter.
+     * NB: the activity stops its LHS input itself
+     */
+    class CProbeInput : public CSimpleInterfaceOf<IEngineRowStream>
+    {
+        CInMemJoinBase &owner;
+    public:
+        CProbeInput(CInMemJoinBase &_owner) : owner(_owner) { }
+    // IRowStream
+        virtual const void *nextRow() override
+        {
+            return owner.left->nextRow();
+        }
+        virtual void stop() override { }
+    // IEngineRowStream
+        virtual void resetEOF() override
+        {
+            throwUnexpected();
+        }
+    } probeInput;
+    unsigned probeStrands = 0; // if >1, LHS is split between this many strands, probing the table in parallel
+    unsigned probeStrandBlockSize = 0;
+    bool probeStrandsOrdered = true;
+    bool probeStrandsStarted = false;
+    Owned<IStrandBranch> probeBranch;
+    IArrayOf<CProbeStrand> probeStrandStreams;
+    IEngineRowStream *probeOutput = nullptr;
 
     IThorDataLink *leftITDL, *rightITDL;
     Owned<IRowStream> left;
@@ -935,7 +1030,6 @@ protected:
     bool local;
     unsigned flags;
     bool exclude;
-    const void *rhsNext;
     CThorExpandingRowArray rhs;
     Owned<IOutputMetaData> outputMeta;
     IOutputMetaData *rightOutputMeta;
@@ -944,11 +1038,9 @@ protected:
     bool rhsConstant = false;
 
     unsigned keepLimit;
-    unsigned joined;
-    unsigned joinCounter;
     OwnedConstThorRow defaultLeft;
 
-    bool leftMatch, grouped;
+    bool grouped;
     bool fuzzyMatch, returnMany;
     rank_t myNodeNum, mySlaveNum;
     unsigned numNodes, numSlaves;
@@ -1147,37 +1239,74 @@ protected:
         ActPrintLog("Sending final RHS broadcast packet");
         broadcaster->send(sendItem); // signals stop to others
     }
-    inline void resetRhsNext()
+    inline void resetRhsNext(CProbeState &state)
+    {
+        state.joined = 0;
+        state.leftMatch = false;
+    }
+    void fillProbeBatch(CProbeState &state)
     {
-        joined = 0;
-        leftMatch = false;
+        if (!state.probeRows)
+        {
+            state.probeRows.allocateN(probeBatchSize);
+            state.probeHashes.allocateN(probeBatchSize, true);
+        }
+        state.probeNext = state.probeEnd = 0;
+        while (state.probeEnd < probeBatchSize)
+        {
+            const void *row = state.left->nextRow();
+            state.probeRows[state.probeEnd] = row;
+            if (!row)
+            {
+                ++state.probeEnd;
+                break; // NB: do not read beyond end of group/stream
+            }
+            if (rhsTableLen)
+                state.probeHashes[state.probeEnd] = tableProxy->prefetchRHSMatch(row);
+            ++state.probeEnd;
+        }
     }
-    inline const void *denormalizeNextRow()
+    void clearProbeBatch(CProbeState &state)
+    {
+        while (state.probeNext < state.probeEnd)
+            ReleaseThorRow(state.probeRows[state.probeNext++]);
+        state.probeNext = state.probeEnd = 0;
+    }
+    inline const void *nextLeftRow(CProbeState &state)
+    {
+        if (!probeBatchSize)
+            return state.left->nextRow();
+        if (state.probeNext == state.probeEnd)
+            fillProbeBatch(state);
+        state.leftRowHash = state.probeHashes[state.probeNext];
+        return state.probeRows[state.probeNext++];
+    }
+    inline const void *denormalizeNextRow(CProbeState &state)
     {
         ConstPointerArray filteredRhs;
-        while (rhsNext)
+        while (state.rhsNext)
         {
             if (abortSoon)
                 return NULL;
-            if (!fuzzyMatch || (HELPERBASE::match(leftRow, rhsNext)))
+            if (!fuzzyMatch || (HELPERBASE::match(state.leftRow, state.rhsNext)))
             {
-                leftMatch = true;
+                state.leftMatch = true;
                 if (exclude)
                 {
-                    rhsNext = NULL;
+                    state.rhsNext = NULL;
                     break;
                 }
-                ++joined;
-                filteredRhs.append(rhsNext);
+                ++state.joined;
+                filteredRhs.append(state.rhsNext);
             }
-            if (!returnMany || joined == keepLimit)
+            if (!returnMany || state.joined == keepLimit)
             {
-                rhsNext = NULL;
+                state.rhsNext = NULL;
                 break;
             }
-            rhsNext = tableProxy->getNextRHS(currentHashEntry); // NB: currentHashEntry only used for Lookup,Many case
+            state.rhsNext = tableProxy->getNextRHS(state.currentHashEntry); // NB: currentHashEntry only used for Lookup,Many case
         }
-        if (filteredRhs.ordinality() || (!leftMatch && 0!=(flags & JFleftouter)))
+        if (filteredRhs.ordinality() || (!state.leftMatch && 0!=(flags & JFleftouter)))
         {
             unsigned rcCount = 0;
             OwnedConstThorRow ret;
@@ -1186,13 +1315,13 @@ protected:
             const void *rightRow = numRows ? filteredRhs.item(0) : defaultRight.get();
             if (isGroupOp())
             {
-                size32_t sz = HELPERBASE::joinTransform(rowBuilder, leftRow, rightRow, numRows, filteredRhs.getArray(), JTFmatchedleft|(numRows ? JTFmatchedright : 0));
+                size32_t sz = HELPERBASE::joinTransform(rowBuilder, state.leftRow, rightRow, numRows, filteredRhs.getArray(), JTFmatchedleft|(numRows ? JTFmatchedright : 0));
                 if (sz)
                     ret.setown(rowBuilder.finalizeRowClear(sz));
             }
             else
             {
-                ret.set(leftRow);
+                ret.set(state.leftRow);
                 if (filteredRhs.ordinality())
                 {
                     size32_t rowSize = 0;
@@ -1218,96 +1347,130 @@ protected:
         else
             return NULL;
     }
-    const void *lookupNextRow()
+    const void *lookupNextRow(CProbeState &state)
     {
-        if (!abortSoon && !eos)
+        if (!abortSoon && !state.eos)
         {
             for (;;)
             {
-                if (NULL == rhsNext)
+                if (NULL == state.rhsNext)
                 {
-                    leftRow.setown(left->nextRow());
-                    joinCounter = 0;
-                    if (leftRow)
+                    state.leftRow.setown(nextLeftRow(state));
+                    state.joinCounter = 0;
+                    if (state.leftRow)
                     {
-                        eog = false;
+                        state.eog = false;
                         if (rhsTableLen)
                         {
-                            resetRhsNext();
+                            resetRhsNext(state);
                             const void *failRow = NULL;
                             // NB: currentHashEntry used for Lookup,Many or All cases
-                            rhsNext = tableProxy->getFirstRHSMatch(leftRow, failRow, currentHashEntry); // also checks abortLimit/atMost
+                            if (probeBatchSize)
+                                state.rhsNext = tableProxy->getFirstRHSMatch(state.leftRow, state.leftRowHash, failRow, state.currentHashEntry); // also checks abortLimit/atMost
+                            else
+                                state.rhsNext = tableProxy->getFirstRHSMatch(state.leftRow, failRow, state.currentHashEntry); // also checks abortLimit/atMost
                             if (failRow)
                                 return failRow;
                         }
                     }
                     else
                     {
-                        if (eog)
-                            eos = true;
+                        if (state.eog)
+                            state.eos = true;
                         else
                         {
-                            eog = true;
-                            if (!someSinceEog)
+                            state.eog = true;
+                            if (!state.someSinceEog)
                                 continue; // skip empty 'group'
-                            someSinceEog = false;
+                            state.someSinceEog = false;
                         }
                         break;
                     }
                 }
                 OwnedConstThorRow ret;
                 if (isDenormalize())
-                    ret.setown(denormalizeNextRow());
+                    ret.setown(denormalizeNextRow(state));
                 else
                 {
                     RtlDynamicRowBuilder rowBuilder(allocator);
-                    while (rhsNext)
+                    while (state.rhsNext)
                     {
-                        if (!fuzzyMatch || HELPERBASE::match(leftRow, rhsNext))
+                        if (!fuzzyMatch || HELPERBASE::match(state.leftRow, state.rhsNext))
                         {
-                            leftMatch = true;
+                            state.leftMatch = true;
                             if (!exclude)
                             {
-                                size32_t sz = HELPERBASE::joinTransform(rowBuilder, leftRow, rhsNext, ++joinCounter, JTFmatchedleft|JTFmatchedright);
+                                size32_t sz = HELPERBASE::joinTransform(rowBuilder, state.leftRow, state.rhsNext, ++state.joinCounter, JTFmatchedleft|JTFmatchedright);
                                 if (sz)
                                 {
                                     OwnedConstThorRow row = rowBuilder.finalizeRowClear(sz);
-                                    someSinceEog = true;
-                                    if (++joined == keepLimit)
-                                        rhsNext = NULL;
+                                    state.someSinceEog = true;
+                                    if (++state.joined == keepLimit)
+                                        state.rhsNext = NULL;
                                     else if (!returnMany)
-                                        rhsNext = NULL;
+                                        state.rhsNext = NULL;
                                     else
-                                        rhsNext = tableProxy->getNextRHS(currentHashEntry); // NB: currentHashEntry only used for Lookup,Many case
+                                        state.rhsNext = tableProxy->getNextRHS(state.currentHashEntry); // NB: currentHashEntry only used for Lookup,Many case
                                     return row.getClear();
                                 }
                             }
                         }
-                        rhsNext = tableProxy->getNextRHS(currentHashEntry); // NB: currentHashEntry used for Lookup,Many or All cases
+                        state.rhsNext = tableProxy->getNextRHS(state.currentHashEntry); // NB: currentHashEntry used for Lookup,Many or All cases
                     }
-                    if (!leftMatch && NULL == rhsNext && 0!=(flags & JFleftouter))
+                    if (!state.leftMatch && NULL == state.rhsNext && 0!=(flags & JFleftouter))
                     {
-                        size32_t sz = HELPERBASE::joinTransform(rowBuilder, leftRow, defaultRight, 0, JTFmatchedleft);
+                        size32_t sz = HELPERBASE::joinTransform(rowBuilder, state.leftRow, defaultRight, 0, JTFmatchedleft);
                         if (sz)
                             ret.setown(rowBuilder.finalizeRowClear(sz));
                     }
                 }
                 if (ret)
                 {
-                    someSinceEog = true;
+                    state.someSinceEog = true;
                     return ret.getClear();
                 }
             }
         }
         return NULL;
     }
+    void startProbeStrands()
+    {
+        if (!probeBranch)
+        {
+            probeBranch.setown(createStrandBranch(*queryRowManager(), probeStrands, probeStrandBlockSize, probeStrandsOrdered, false, false, nullptr));
+            IStrandJunction *splitter = probeBranch->queryInputJunction();
+            IStrandJunction *recombiner = probeBranch->queryOutputJunction();
+            splitter->setInput(0, &probeInput);
+            for (unsigned s=0; s<probeStrands; s++)
+            {
+                CProbeStrand *strand = new CProbeStrand(*this, splitter->queryOutput(s));
+                probeStrandStreams.append(*strand);
+                recombiner->setInput(s, strand);
+            }
+            probeOutput = recombiner->queryOutput(0);
+        }
+        ActPrintLog("Probing table with %u %s strands", probeStrands, probeStrandsOrdered ? "ordered" : "unordered");
+        probeBranch->queryInputJunction()->start();
+        probeBranch->queryOutputJunction()->start();
+        probeStrandsStarted = true;
+    }
+    const void *lookupNextRow()
+    {
+        if (probeStrands > 1)
+        {
+            if (!probeStrandsStarted)
+                startProbeStrands();
+            return probeOutput->nextRow();
+        }
+        probe.left = left;
+        return lookupNextRow(probe);
+    }
 public:
     IMPLEMENT_IINTERFACE_USING(CSlaveActivity);
 
-    CInMemJoinBase(CGraphElementBase *_container) : CSlaveActivity(_container), HELPERBASE((HELPER *)queryHelper()), rhs(*this)
+    CInMemJoinBase(CGraphElementBase *_container) : CSlaveActivity(_container), HELPERBASE((HELPER *)queryHelper()), rhs(*this), probeInput(*this)
     {
         gotRHS = false;
-        rhsNext = NULL;
         myNodeNum = queryJob().queryMyNodeRank()-1; // 0 based
         mySlaveNum = queryJobChannel().queryMyRank()-1; // 0 based
         numNodes = queryJob().queryNodes();
@@ -1318,13 +1481,8 @@ public:
         rhsTableLen = 0;
         leftITDL = rightITDL = NULL;
 
-        joined = 0;
-        joinCounter = 0;
-        leftMatch = false;
         returnMany = false;
 
-        eos = eog = someSinceEog = false;
-
         flags = helper->getJoinFlags();
         grouped = helper->queryOutputMeta()->isGrouped();
         fuzzyMatch = 0 != (JFmatchrequired & flags);
@@ -1352,6 +1510,14 @@ public:
         if (!isGlobal())
             setRequireInitData(false);
         rhsConstant = getOptBool("lookupRhsConstant", false); // for testing purposes only
+        CThorStrandOptions strandOptions(container);
+        probeStrands = getOptUInt(THOROPT_LKJOIN_PROBESTRANDS, strandOptions.numStrands);
+        probeStrandBlockSize = strandOptions.blockSize;
+        if (0 == probeStrandBlockSize)
+            probeStrandBlockSize = LKJOIN_PROBESTRAND_BLOCKSIZE;
+        probeStrandsOrdered = !getOptBool(THOROPT_UNSORTED_OUTPUT);
+        if (grouped) // groups cannot be split between strands
+            probeStrands = 0;
         appendOutputLinked(this);
     }
     ~CInMemJoinBase()
@@ -1459,14 +1625,16 @@ public:
             gotRHS = false;
             rhsTableLen = 0;
         }
+        if (probeBranch)
+        {
+            resetJunction(probeBranch->queryInputJunction());
+            resetJunction(probeBranch->queryOutputJunction());
+            ForEachItemIn(s, probeStrandStreams)
+                probeStrandStreams.item(s).reset();
+        }
     }
     virtual void start() override
     {
-        joined = 0;
-        joinCounter = 0;
-        leftMatch = false;
-        rhsNext = NULL;
-
         left.set(inputStream); // can be replaced by loader stream
         if (isGlobal())
         {
@@ -1484,9 +1652,8 @@ public:
             }
         }
 
-        eos = eog = someSinceEog = false;
-        currentHashEntry.index = 0;
-        currentHashEntry.count = 0;
+        probe.reset();
+        clearProbeBatch(probe);
 
         if (hasStarted() && isRhsConstant()) // if this is the 2nd+ iteration and the RHS is constant, don't both restarting right, it will not be used.
         {
@@ -1517,6 +1684,11 @@ public:
     virtual void abort()
     {
         CSlaveActivity::abort();
+        if (probeBranch)
+        {
+            probeBranch->queryInputJunction()->abort();
+            probeBranch->queryOutputJunction()->abort();
+        }
         if (isGlobal())
         {
             cancelReceiveMsg(queryJob().queryNodeComm(), RANK_ALL, mpTag);
@@ -1538,6 +1710,12 @@ public:
             stopInput(1, "(R)");
         if (broadcaster)
             broadcaster->reset();
+        if (probeStrandsStarted)
+        {
+            probeOutput->stop(); // stops the strands and the splitter reading the LHS
+            probeStrandsStarted = false;
+        }
+        clearProbeBatch(probe);
         stopInput(0, "(L)");
         left.clear();
         dataLinkStop();
@@ -1673,11 +1851,10 @@ protected:
     using PARENT::table;
     using PARENT::flags;
     using PARENT::outputMeta;
-    using PARENT::leftMatch;
     using PARENT::gotRHS;
     using PARENT::isLocal;
     using PARENT::isGlobal;
-    using PARENT::leftRow;
+    using PARENT::probe;
     using PARENT::allocator;
     using PARENT::defaultRight;
     using PARENT::grouped;
@@ -1693,6 +1870,7 @@ protected:
     using PARENT::doBroadcastStop;
     using PARENT::getGlobalRHSTotal;
     using PARENT::getOptBool;
+    using PARENT::getOptUInt;
     using PARENT::getOpt;
     using PARENT::broadcaster;
     using PARENT::inputs;
@@ -1717,12 +1895,16 @@ protected:
     using PARENT::queryInput;
     using PARENT::rhsRowLock;
     using PARENT::hasStarted;
+    using PARENT::probeBatchSize;
+    using PARENT::probeStrands;
 
     IHash *leftHash, *rightHash;
     ICompare *compareRight, *compareLeftRight;
 
     unsigned abortLimit, atMost;
     bool dedup, stable;
+    bool partitionBuild;
+    unsigned buildThreads;
 
     mptag_t lhsDistributeTag, rhsDistributeTag, broadcast2MpTag, broadcast3MpTag;
 
@@ -2578,6 +2760,9 @@ public:
         }
         return dedup;
     }
+    inline bool isDedup() const { return dedup; }
+    inline bool isPartitionedBuild() const { return partitionBuild; }
+    inline unsigned queryBuildThreads() const { return buildThreads; }
     CLookupJoinActivityBase(CGraphElementBase *_container) : PARENT(_container)
     {
         rhsCollated = rhsCompacted = false;
@@ -2599,6 +2784,11 @@ public:
             atMost = (unsigned)-1;
         if (abortLimit < atMost)
             atMost = abortLimit;
+        partitionBuild = getOptBool(THOROPT_LKJOIN_PARTITIONBUILD);
+        probeBatchSize = getOptUInt(THOROPT_LKJOIN_PROBEBATCH);
+        buildThreads = getOptUInt(THOROPT_LKJOIN_BUILDTHREADS, 1);
+        if ((unsigned)-1 != atMost) // limit handling (see exceedsLimit) is tied to the activity's own probe
+            probeStrands = 0;
 
         switch (container.getKind())
         {
@@ -2637,7 +2827,7 @@ public:
                             helper->onMatchAbortLimitExceeded();
                         CommonXmlWriter xmlwrite(0);
                         if (outputMeta && outputMeta->hasXML())
-                            outputMeta->toXML((const byte *) leftRow.get(), xmlwrite);
+                            outputMeta->toXML((const byte *) left, xmlwrite);
                         throw MakeActivityException(this, 0, "More than %d match candidates in join for row %s", abortLimit, xmlwrite.str());
                     }
                     catch (IException *_e)
@@ -2647,12 +2837,12 @@ public:
                         e.setown(_e);
                     }
                     RtlDynamicRowBuilder ret(allocator);
-                    size32_t transformedSize = helper->onFailTransform(ret, leftRow, defaultRight, e.get(), JTFmatchedleft);
+                    size32_t transformedSize = helper->onFailTransform(ret, left, defaultRight, e.get(), JTFmatchedleft);
                     if (transformedSize)
                         failRow = ret.finalizeRowClear(transformedSize);
                 }
                 else
-                    leftMatch = true; // there was a lhs match, even though rhs group exceeded limit. Therefore this lhs will not be considered left only/left outer
+                    probe.leftMatch = true; // there was a lhs match, even though rhs group exceeded limit. Therefore this lhs will not be considered left only/left outer
                 return true;
             }
             else if (count>atMost)
@@ -2913,6 +3103,14 @@ public:
     }
 };
 
+// Claims an empty (zero) table slot, only needed when the table is being built by more than one thread
+template <typename T>
+static inline bool claimSlot(T &slot, T value)
+{
+    T expected = 0;
+    return reinterpret_cast<std::atomic<T> &>(slot).compare_exchange_strong(expected, value);
+}
+
 class CHTBase : public CTableCommon
 {
 protected:
@@ -2920,14 +3118,73 @@ protected:
     IHash *leftHash, *rightHash;
     ICompare *compareLeftRight;
 
+    static const rowidx_t minRowsPerBuildChunk = 0x10000;
+
+    /* Calls addGroup(pos, count) for each group of matching rows delimited by marker.
+     * With >1 thread, the rows are split into chunks which are processed in parallel, each chunk
+     * handling the groups that start within it, in which case addGroup must be thread safe.
+     */
+    template <class ADDGROUP>
+    static void forEachGroup(CMarker &marker, rowidx_t numRows, unsigned numThreads, ADDGROUP &addGroup)
+    {
+        unsigned numChunks = 1;
+        rowidx_t chunkSize = numRows;
+        if (numThreads > 1)
+        {
+            numChunks = numThreads * 4; // finer than # threads, to even out skewed groups
+            chunkSize = (numRows+numChunks-1) / numChunks;
+            if (chunkSize < minRowsPerBuildChunk)
+                chunkSize = minRowsPerBuildChunk;
+            numChunks = (numRows+chunkSize-1) / chunkSize;
+        }
+        if (numChunks <= 1)
+        {
+            rowidx_t pos=0;
+            for (;;)
+            {
+                rowidx_t nextPos = marker.findNextBoundary(pos);
+                if (0 == nextPos)
+                    break;
+                addGroup(pos, nextPos-pos);
+                pos = nextPos;
+            }
+            return;
+        }
+        class CGroupChunks : public CAsyncFor
+        {
+            CMarker &marker;
+            ADDGROUP &addGroup;
+            rowidx_t numRows, chunkSize;
+        public:
+            CGroupChunks(CMarker &_marker, ADDGROUP &_addGroup, rowidx_t _numRows, rowidx_t _chunkSize)
+                : marker(_marker), addGroup(_addGroup), numRows(_numRows), chunkSize(_chunkSize)
+            {
+            }
+            virtual void Do(unsigned c)
+            {
+                rowidx_t start = c * chunkSize;
+                rowidx_t end = (numRows-start > chunkSize) ? start+chunkSize : numRows;
+                // skip the tail of a group that started in the previous chunk
+                rowidx_t pos = (0 == start) ? 0 : marker.findNextBoundary(start-1);
+                while (pos < end)
+                {
+                    rowidx_t nextPos = marker.findNextBoundary(pos);
+                    addGroup(pos, nextPos-pos);
+                    pos = nextPos;
+                }
+            }
+        } chunks(marker, addGroup, numRows, chunkSize);
+        chunks.For(numChunks, numThreads);
+    }
+
 public:
     CHTBase()
     {
         reset();
     }
-    void setup(CSlaveActivity *activity, roxiemem::IRowManager *rowManager, rowidx_t size, IHash *_leftHash, IHash *_rightHash, ICompare *_compareLeftRight)
+    void setup(CSlaveActivity *activity, roxiemem::IRowManager *rowManager, rowidx_t size, IHash *_leftHash, IHash *_rightHash, ICompare *_compareLeftRight, size32_t entrySize=sizeof(const void *))
     {
-        unsigned __int64 _sz = sizeof(const void *) * ((unsigned __int64)size);
+        unsigned __int64 _sz = entrySize * ((unsigned __int64)size);
         memsize_t sz = (memsize_t)_sz;
         if (sz != _sz) // treat as OOM exception for handling purposes.
             throw MakeStringException(ROXIEMM_MEMORY_LIMIT_EXCEEDED, "Unsigned overflow, trying to allocate hash table of size: %" I64F "d ", _sz);
@@ -2953,9 +3210,9 @@ class CLookupHT : public CHTBase
     CLookupJoinActivityBase<CLookupHT> *activity;
     const void **ht;
 
-    const void *findFirst(const void *left)
+    const void *findFirst(const void *left, unsigned hash)
     {
-        unsigned h = leftHash->hash(left)%tableSize;
+        unsigned h = hash%tableSize;
         for (;;)
         {
             const void *right = ht[h];
@@ -2994,16 +3251,22 @@ public:
         CHTBase::reset();
         ht = NULL;
     }
-    inline void addEntry(const void *row, unsigned hash)
+    inline void addEntry(const void *row, unsigned hash, bool threaded=false)
     {
+        LinkThorRow(row);
         for (;;)
         {
             const void *&htRow = ht[hash];
             if (!htRow)
             {
-                LinkThorRow(row);
-                htRow = row;
-                break;
+                if (!threaded)
+                {
+                    htRow = row;
+                    break;
+                }
+                if (claimSlot(htRow, row))
+                    break;
+                continue; // lost the slot to another thread, move on from it
             }
             hash++;
             if (hash>=tableSize)
@@ -3014,25 +3277,33 @@ public:
     {
         return NULL; // no next in LOOKUP without MANY
     }
-    inline const void *getFirstRHSMatch(const void *leftRow, const void *&failRow, HtEntry &currentHashEntry __attribute__((unused)))
+    inline unsigned prefetchRHSMatch(const void *leftRow)
+    {
+        unsigned hash = leftHash->hash(leftRow);
+        __builtin_prefetch(ht+(hash%tableSize));
+        return hash;
+    }
+    inline const void *getFirstRHSMatch(const void *leftRow, unsigned hash, const void *&failRow, HtEntry &currentHashEntry __attribute__((unused)))
     {
         failRow = NULL;
-        return findFirst(leftRow);
+        return findFirst(leftRow, hash);
+    }
+    inline const void *getFirstRHSMatch(const void *leftRow, const void *&failRow, HtEntry &currentHashEntry)
+    {
+        return getFirstRHSMatch(leftRow, leftHash->hash(leftRow), failRow, currentHashEntry);
     }
     virtual void addRows(CThorExpandingRowArray &_rows, CMarker &marker)
     {
         const void **rows = _rows.getRowArray();
-        rowidx_t pos=0;
-        for (;;)
+        unsigned numThreads = activity->queryBuildThreads();
+        bool threaded = numThreads > 1;
+        auto addGroup = [&](rowidx_t pos, rowidx_t count)
         {
-            rowidx_t nextPos = marker.findNextBoundary(pos);
-            if (0 == nextPos)
-                break;
             const void *row = rows[pos];
             unsigned h = rightHash->hash(row)%tableSize;
-            addEntry(row, h);
-            pos = nextPos;
-        }
+            addEntry(row, h, threaded);
+        };
+        forEachGroup(marker, _rows.ordinality(), numThreads, addGroup);
         // Rows now in hash table, rhs arrays no longer needed
         _rows.kill();
         marker.reset();
@@ -3052,9 +3323,9 @@ class CLookupManyHT : public CHTBase
             return NULL;
         return e;
     }
-    const void *findFirst(const void *left, HtEntry &currentHashEntry)
+    const void *findFirst(const void *left, unsigned hash, HtEntry &currentHashEntry)
     {
-        unsigned h = leftHash->hash(left)%tableSize;
+        unsigned h = hash%tableSize;
         for (;;)
         {
             HtEntry *e = lookup(h);
@@ -3083,16 +3354,26 @@ public:
         CHTBase::setup(activity, rowManager, size, leftHash, rightHash, compareLeftRight);
         ht = (HtEntry *)htMemory.get();
     }
-    inline void addEntry(const void *row, unsigned hash, rowidx_t index, rowidx_t count)
+    inline void addEntry(const void *row, unsigned hash, rowidx_t index, rowidx_t count, bool threaded=false)
     {
         for (;;)
         {
             HtEntry &e = ht[hash];
             if (!e.count)
             {
-                e.index = index;
-                e.count = count;
-                break;
+                if (!threaded)
+                {
+                    e.index = index;
+                    e.count = count;
+                    break;
+                }
+                // count is never 0 for a used entry, so claim on it, index is not read until the build is complete
+                if (claimSlot(e.count, count))
+                {
+                    e.index = index;
+                    break;
+                }
+                continue;
             }
             hash++;
             if (hash>=tableSize)
@@ -3112,9 +3393,15 @@ public:
         --currentHashEntry.count;
         return rows[++currentHashEntry.index];
     }
-    inline const void *getFirstRHSMatch(const void *leftRow, const void *&failRow, HtEntry &currentHashEntry)
+    inline unsigned prefetchRHSMatch(const void *leftRow)
     {
-        const void *right = findFirst(leftRow, currentHashEntry);
+        unsigned hash = leftHash->hash(leftRow);
+        __builtin_prefetch(ht+(hash%tableSize));
+        return hash;
+    }
+    inline const void *getFirstRHSMatch(const void *leftRow, unsigned hash, const void *&failRow, HtEntry &currentHashEntry)
+    {
+        const void *right = findFirst(leftRow, hash, currentHashEntry);
         if (right)
         {
             if (activity->exceedsLimit(currentHashEntry.count, leftRow, right, failRow))
@@ -3122,17 +3409,17 @@ public:
         }
         return right;
     }
+    inline const void *getFirstRHSMatch(const void *leftRow, const void *&failRow, HtEntry &currentHashEntry)
+    {
+        return getFirstRHSMatch(leftRow, leftHash->hash(leftRow), failRow, currentHashEntry);
+    }
     virtual void addRows(CThorExpandingRowArray &_rows, CMarker &marker)
     {
         rows = _rows.getRowArray();
-        rowidx_t pos=0;
-        rowidx_t pos2;
-        for (;;)
+        unsigned numThreads = activity->queryBuildThreads();
+        bool threaded = numThreads > 1;
+        auto addGroup = [&](rowidx_t pos, rowidx_t count)
         {
-            pos2 = marker.findNextBoundary(pos);
-            if (0 == pos2)
-                break;
-            rowidx_t count = pos2-pos;
             /* JCS->GH - Could you/do you spot LOOKUP MANY, followed by DEDUP(key) ?
              * It feels like we should only dedup if code gen spots, rather than have LOOKUP without MANY option
              * i.e. feels like LOOKUP without MANY should be deprecated..
@@ -3140,8 +3427,249 @@ public:
             const void *row = rows[pos];
             unsigned h = rightHash->hash(row)%tableSize;
             // NB: 'pos' and 'count' won't be used if dedup variety
-            addEntry(row, h, pos, count);
-            pos = pos2;
+            addEntry(row, h, pos, count, threaded);
+        };
+        forEachGroup(marker, _rows.ordinality(), numThreads, addGroup);
+    }
+};
+
+/* Lookup table that keeps a packed array of 32-bit hash tags alongside a separate array of
+ * (row index, count) entries into the rhs row array.
+ * Probing walks the tags only, so a collision chain is resolved within a cache line or two,
+ * the entry and rhs row are only touched (and compareLeftRight only called) when a tag matches.
+ * Handles both the LOOKUP (dedup) and MANY LOOKUP varieties.
+ * If partitionBuild, the group hashes are first radix partitioned by table region,
+ * so that the inserts for each region are confined to a range of the table that fits in L2.
+ */
+class CLookupTagHT : public CHTBase
+{
+    CLookupJoinActivityBase<CLookupTagHT> *activity;
+    roxiemem::IRowManager *rowManager;
+    unsigned *tags;
+    HtEntry *entries;
+    const void **rows;
+    bool dedup;
+
+    struct BuildEntry { unsigned hash; rowidx_t index, count; };
+    static const memsize_t partitionCacheSize = 0x40000; // 256KB, conservative L2 size
+
+    static inline unsigned makeTag(unsigned hash)
+    {
+        return hash | 1; // NB: 0 marks an empty slot
+    }
+    const void *findFirst(const void *left, unsigned hash, HtEntry &currentHashEntry)
+    {
+        unsigned tag = makeTag(hash);
+        unsigned h = hash%tableSize;
+        for (;;)
+        {
+            unsigned t = tags[h];
+            if (!t)
+                break;
+            if (t == tag)
+            {
+                const HtEntry &e = entries[h];
+                const void *right = rows[e.index];
+                if (0 == compareLeftRight->docompare(left, right))
+                {
+                    currentHashEntry = e;
+                    return right;
+                }
+            }
+            h++;
+            if (h>=tableSize)
+                h = 0;
+        }
+        return NULL;
+    }
+    inline void addEntry(unsigned hash, rowidx_t index, rowidx_t count, bool threaded=false)
+    {
+        unsigned h = hash%tableSize;
+        for (;;)
+        {
+            if (!tags[h])
+            {
+                if (!threaded)
+                    tags[h] = makeTag(hash);
+                else if (!claimSlot(tags[h], makeTag(hash)))
+                    continue; // lost the slot to another thread, move on from it
+                entries[h].index = index;
+                entries[h].count = count;
+                break;
+            }
+            h++;
+            if (h>=tableSize)
+                h = 0;
+        }
+    }
+    void addPartitioned(BuildEntry *groups, rowidx_t numGroups, unsigned numThreads)
+    {
+        // # of table slots whose tags and entries fit in L2, rounded down to a power of 2
+        rowidx_t partitionSlots = partitionCacheSize / (sizeof(unsigned)+sizeof(HtEntry));
+        while (partitionSlots & (partitionSlots-1))
+            partitionSlots &= (partitionSlots-1);
+        unsigned numPartitions = (tableSize+partitionSlots-1) / partitionSlots;
+        if (numPartitions <= 1)
+        {
+            addUnpartitioned(groups, numGroups);
+            return;
+        }
+        OwnedMalloc<rowidx_t> partitionStart;
+        partitionStart.allocateN(numPartitions+1, true);
+        for (rowidx_t g=0; g<numGroups; g++)
+            ++partitionStart[(groups[g].hash%tableSize)/partitionSlots + 1];
+        for (unsigned p=0; p<numPartitions; p++)
+            partitionStart[p+1] += partitionStart[p];
+        OwnedConstThorRow sortedMem = rowManager->allocate(sizeof(BuildEntry)*(memsize_t)numGroups, activity->queryContainer().queryId(), SPILL_PRIORITY_LOW);
+        BuildEntry *sorted = (BuildEntry *)sortedMem.get();
+        for (rowidx_t g=0; g<numGroups; g++)
+        {
+            const BuildEntry &group = groups[g];
+            sorted[partitionStart[(group.hash%tableSize)/partitionSlots]++] = group;
+        }
+        if (numThreads <= 1)
+        {
+            for (rowidx_t g=0; g<numGroups; g++)
+                addEntry(sorted[g].hash, sorted[g].index, sorted[g].count);
+            return;
+        }
+        // partitionStart[p] is now the end of partition p, insert each partition on its own thread
+        class CAddPartitions : public CAsyncFor
+        {
+            CLookupTagHT &owner;
+            const BuildEntry *sorted;
+            const rowidx_t *partitionEnd;
+        public:
+            CAddPartitions(CLookupTagHT &_owner, const BuildEntry *_sorted, const rowidx_t *_partitionEnd)
+                : owner(_owner), sorted(_sorted), partitionEnd(_partitionEnd)
+            {
+            }
+            virtual void Do(unsigned p)
+            {
+                rowidx_t end = partitionEnd[p];
+                // NB: collision chains can run into the next partition, so inserts still need to claim slots
+                for (rowidx_t g=(0 == p) ? 0 : partitionEnd[p-1]; g<end; g++)
+                    owner.addEntry(sorted[g].hash, sorted[g].index, sorted[g].count, true);
+            }
+        } addPartitions(*this, sorted, partitionStart);
+        addPartitions.For(numPartitions, numThreads);
+    }
+    void addUnpartitioned(BuildEntry *groups, rowidx_t numGroups)
+    {
+        for (rowidx_t g=0; g<numGroups; g++)
+            addEntry(groups[g].hash, groups[g].index, groups[g].count);
+    }
+public:
+    CLookupTagHT()
+    {
+        reset();
+    }
+    void setup(CLookupJoinActivityBase<CLookupTagHT> *_activity, roxiemem::IRowManager *_rowManager, rowidx_t size, IHash *leftHash, IHash *rightHash, ICompare *compareLeftRight)
+    {
+        activity = _activity;
+        rowManager = _rowManager;
+        dedup = activity->isDedup();
+        CHTBase::setup(activity, rowManager, size, leftHash, rightHash, compareLeftRight, sizeof(unsigned)+sizeof(HtEntry));
+        tags = (unsigned *)htMemory.get();
+        entries = (HtEntry *)(tags+size);
+    }
+    void reset()
+    {
+        CHTBase::reset();
+        activity = NULL;
+        rowManager = NULL;
+        tags = NULL;
+        entries = NULL;
+        rows = NULL;
+        dedup = false;
+    }
+    inline const void *getNextRHS(HtEntry &currentHashEntry)
+    {
+        if (1 == currentHashEntry.count)
+            return NULL;
+        --currentHashEntry.count;
+        return rows[++currentHashEntry.index];
+    }
+    inline unsigned prefetchRHSMatch(const void *leftRow)
+    {
+        unsigned hash = leftHash->hash(leftRow);
+        __builtin_prefetch(tags+(hash%tableSize));
+        return hash;
+    }
+    inline const void *getFirstRHSMatch(const void *leftRow, unsigned hash, const void *&failRow, HtEntry &currentHashEntry)
+    {
+        failRow = NULL;
+        const void *right = findFirst(leftRow, hash, currentHashEntry);
+        if (right && !dedup)
+        {
+            if (activity->exceedsLimit(currentHashEntry.count, leftRow, right, failRow))
+                return NULL;
+        }
+        return right;
+    }
+    inline const void *getFirstRHSMatch(const void *leftRow, const void *&failRow, HtEntry &currentHashEntry)
+    {
+        return getFirstRHSMatch(leftRow, leftHash->hash(leftRow), failRow, currentHashEntry);
+    }
+    virtual void addRows(CThorExpandingRowArray &_rows, CMarker &marker)
+    {
+        rows = _rows.getRowArray();
+        OwnedConstThorRow groupsMem;
+        BuildEntry *groups = NULL;
+        if (activity->isPartitionedBuild())
+        {
+            try
+            {
+                // NB: # groups is bounded by tableSize
+                groupsMem.setown(rowManager->allocate(sizeof(BuildEntry)*(memsize_t)tableSize, activity->queryContainer().queryId(), SPILL_PRIORITY_LOW));
+                groups = (BuildEntry *)groupsMem.get();
+            }
+            catch (IException *e)
+            {
+                if (!isOOMException(e))
+                    throw;
+                EXCLOG(e, "CLookupTagHT: insufficient memory to partition build, building unpartitioned");
+                e->Release();
+            }
+        }
+        unsigned numThreads = activity->queryBuildThreads();
+        bool threaded = numThreads > 1;
+        std::atomic<rowidx_t> numGroups(0);
+        auto addGroup = [&](rowidx_t pos, rowidx_t count)
+        {
+            unsigned h = rightHash->hash(rows[pos]);
+            if (dedup)
+            {
+                // only the 1st of each group is needed, release the rest asap
+                for (rowidx_t r=pos+1; r<pos+count; r++)
+                    _rows.setRow(r, NULL);
+                count = 1;
+            }
+            if (groups)
+            {
+                BuildEntry &group = groups[numGroups++];
+                group.hash = h;
+                group.index = pos;
+                group.count = count;
+            }
+            else
+                addEntry(h, pos, count, threaded);
+        };
+        forEachGroup(marker, _rows.ordinality(), numThreads, addGroup);
+        if (groups)
+        {
+            try
+            {
+                addPartitioned(groups, numGroups, numThreads);
+            }
+            catch (IException *e)
+            {
+                if (!isOOMException(e))
+                    throw;
+                EXCLOG(e, "CLookupTagHT: insufficient memory to partition build, building unpartitioned");
+                e->Release();
+                addUnpartitioned(groups, numGroups);
+            }
         }
     }
 };
@@ -3165,6 +3693,17 @@ public:
     }
 };
 
+class CLookupTagJoinSlaveActivity : public CLookupJoinActivityBase<CLookupTagHT>
+{
+public:
+    CLookupTagJoinSlaveActivity(CGraphElementBase *_container) : CLookupJoinActivityBase<CLookupTagHT>(_container)
+    {
+        dedup = needDedup(helper);
+        if (!dedup)
+            returnMany = 0 != (JFmanylookup & flags);
+    }
+};
+
 class CAllTable : public CTableCommon
 {
     const void **rows;
@@ -3190,6 +3729,14 @@ public:
         failRow = NULL;
         return rows[0]; // guaranteed to be at least one row
     }
+    inline unsigned prefetchRHSMatch(const void *leftRow __attribute__((unused)))
+    {
+        return 0; // every left row visits every rhs row, nothing to prefetch
+    }
+    inline const void *getFirstRHSMatch(const void *leftRow, unsigned hash __attribute__((unused)), const void *&failRow, HtEntry &currentEntry)
+    {
+        return getFirstRHSMatch(leftRow, failRow, currentEntry);
+    }
     void addRows(CThorExpandingRowArray &_rows)
     {
         tableSize = _rows.ordinality();
@@ -3320,6 +3867,8 @@ public:
 CActivityBase *createLookupJoinSlave(CGraphElementBase *container) 
 { 
     IHThorHashJoinArg *helper = (IHThorHashJoinArg *)container->queryHelper();
+    if (container->getOptBool(THOROPT_LKJOIN_TAGTABLE))
+        return new CLookupTagJoinSlaveActivity(container);
     if (CLookupManyJoinSlaveActivity::needDedup(helper))
         return new CLookupJoinSlaveActivity(container);
     else
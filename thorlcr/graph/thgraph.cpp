@@ -2292,6 +2292,7 @@ class CGraphExecutor : implements IGraphExecutor, public CInterface
             class CGraphExecutorThread : implements IPooledThread, public CInterface
             {
                 Owned<CGraphExecutorGraphInfo> graphInfo;
+                bool numaBound = false;
             public:
                 IMPLEMENT_IINTERFACE;
                 CGraphExecutorThread()
@@ -2303,6 +2304,11 @@ class CGraphExecutor : implements IGraphExecutor, public CInterface
                 }
                 void main()
                 {
+                    if (!numaBound)
+                    {
+                        graphInfo->executor.bindThreadToNumaNode();
+                        numaBound = true;
+                    }
                     for (;;)
                     {
                         Linked<CGraphBase> graph = graphInfo->subGraph;
@@ -2340,6 +2346,21 @@ class CGraphExecutor : implements IGraphExecutor, public CInterface
         }
     } *factory;
 
+    //With multiple channels each channel's rows are allocated from its own NUMA node, so run the channel's
+    //subgraphs, and the activity threads they create, on the same node.  Pooled threads (e.g. strands) may be
+    //shared between channels, so they reset the affinity they inherit (see resetCurrentThreadAffinity).
+    void bindThreadToNumaNode()
+    {
+        if (job.queryJobChannels() > 1)
+        {
+            unsigned node = jobChannel.queryRowManager()->getNumaNode();
+            if (node != (unsigned)-1)
+            {
+                if (bindCurrentThreadToNumaNode(node))
+                    PROGLOG("CGraphExecutor: channel %u bound to NUMA node %u", jobChannel.queryChannel(), node);
+            }
+        }
+    }
     CGraphExecutorGraphInfo *findRunning(graph_id gid)
     {
         ForEachItemIn(r, running)
@@ -2627,6 +2648,7 @@ void CJobBase::init()
 
     crcChecking = 0 != getWorkUnitValueInt("THOR_ROWCRC", globals->getPropBool("@THOR_ROWCRC", false));
     usePackedAllocator = 0 != getWorkUnitValueInt("THOR_PACKEDALLOCATOR", globals->getPropBool("@THOR_PACKEDALLOCATOR", true));
+    rowCacheThreads = (unsigned)getWorkUnitValueInt("rowCacheThreads", globals->getPropInt("@rowCacheThreads", 0)); // NB: 0 disables the per-thread row caches
     memorySpillAtPercentage = (unsigned)getWorkUnitValueInt("memorySpillAt", globals->getPropInt("@memorySpillAt", 80));
     sharedMemoryLimitPercentage = (unsigned)getWorkUnitValueInt("globalMemoryLimitPC", globals->getPropInt("@sharedMemoryLimit", 90));
     sharedMemoryMB = globalMemoryMB*sharedMemoryLimitPercentage/100;
@@ -2693,7 +2715,12 @@ void CJobBase::startJob()
     setNodeCacheMem(keyNodeCacheMB * 0x100000);
     setLeafCacheMem(keyLeafCacheMB * 0x100000);
     setBlobCacheMem(keyBlobCacheMB * 0x100000);
-    PROGLOG("Key node caching setting: node=%u MB, leaf=%u MB, blob=%u MB", keyNodeCacheMB, keyLeafCacheMB, keyBlobCacheMB);
+    StringBuffer policyText;
+    NodeCachePolicy keyLeafCachePolicy = getNodeCachePolicy(getWorkUnitValue("keyLeafCachePolicy", policyText).str());
+    NodeCachePolicy keyBlobCachePolicy = getNodeCachePolicy(getWorkUnitValue("keyBlobCachePolicy", policyText.clear()).str());
+    setLeafCachePolicy(keyLeafCachePolicy);
+    setBlobCachePolicy(keyBlobCachePolicy);
+    PROGLOG("Key node caching setting: node=%u MB, leaf=%u MB, blob=%u MB, leaf policy=%s, blob policy=%s", keyNodeCacheMB, keyLeafCacheMB, keyBlobCacheMB, getNodeCachePolicyName(keyLeafCachePolicy), getNodeCachePolicyName(keyBlobCachePolicy));
 
     unsigned keyFileCacheLimit = (unsigned)getWorkUnitValueInt("keyFileCacheLimit", 0);
     if (!keyFileCacheLimit)
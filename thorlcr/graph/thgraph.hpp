@@ -810,6 +810,7 @@ protected:
     OwnedMalloc<unsigned> jobSlaveChannelNum;
     bool crcChecking;
     bool usePackedAllocator;
+    unsigned rowCacheThreads;
     rank_t myNodeRank;
     Owned<IPropertyTree> graphXGMML;
     unsigned memorySpillAtPercentage, sharedMemoryLimitPercentage;
@@ -2742,6 +2742,7 @@ static bool suppressStatisticIfZero(StatisticKind kind)
     case StNumSpills:
     case StSizeSpillFile:
     case StTimeSpillElapsed:
+    case StTimeSpillStall:
     case StNumDiskRetries:
         return true;
     }
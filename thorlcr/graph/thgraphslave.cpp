@@ -1526,6 +1526,8 @@ CJobSlave::CJobSlave(ISlaveWatchdog *_watchdog, IPropertyTree *_workUnitInfo, co
     }
     tmpHandler.setown(createTempHandler(true));
     sharedAllocator.setown(::createThorAllocator(globalMemoryMB, sharedMemoryMB, numChannels, memorySpillAtPercentage, *logctx, crcChecking, usePackedAllocator));
+    if (rowCacheThreads)
+        sharedAllocator->queryRowManager()->setThreadRowCaches(rowCacheThreads);
 }
 
 void CJobSlave::addChannel(IMPServer *mpServer)
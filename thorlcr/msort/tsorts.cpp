@@ -1167,7 +1167,8 @@ public:
         else
         {
             Owned<IRowLinkCounter> linkcounter = new CThorRowLinkCounter;
-            merger.setown(createRowStreamMerger(readers.ordinality(), readers.getArray(), rowCompare, false, linkcounter));
+            unsigned mergeThreads = activity->getOptUInt(THOROPT_SORT_MERGETHREADS, 1);
+            merger.setown(createParallelRowStreamMerger(readers.ordinality(), readers.getArray(), rowCompare, false, linkcounter, mergeThreads));
         }
         ActPrintLog(activity, "Global Merger Created: %d streams", readers.ordinality());
         startmergesem.signal();
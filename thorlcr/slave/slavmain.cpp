@@ -801,6 +801,7 @@ void slaveMain(bool &jobListenerStopped)
     {
         // should prob. error here
     }
+    roxiemem::setHeapNumaNodes(globals->getPropInt("@heapNumaNodes", 1));
     roxiemem::setTotalMemoryLimit(gmemAllowHugePages, gmemAllowTransparentHugePages, gmemRetainMemory, ((memsize_t)gmemSize) * 0x100000, 0, thorAllocSizes, NULL);
 
     CJobListener jobListener(jobListenerStopped);
@@ -40,6 +40,7 @@
 #include "thexception.hpp"
 #include "thmem.hpp"
 #include "thbuf.hpp"
+#include "thorstrand.hpp"
 
 #include "mpbase.hpp"
 #include "mplog.hpp"
@@ -143,7 +144,9 @@ static bool RegisterSelf(SocketEndpoint &masterEp)
             blockSize = defaultStrandBlockSize;
             globals->setPropInt("Debug/@strandBlockSize", defaultStrandBlockSize);
         }
-        PROGLOG("Strand defaults: numStrands=%u, blockSize=%u", numStrands, blockSize);
+        unsigned strandThreadLimit = globals->getPropInt("Debug/@strandThreadLimit", 0);
+        setStrandThreadLimit(strandThreadLimit);
+        PROGLOG("Strand defaults: numStrands=%u, blockSize=%u, threadLimit=%u", numStrands, blockSize, strandThreadLimit);
 
         const char *_masterBuildTag = globals->queryProp("@masterBuildTag");
         const char *masterBuildTag = _masterBuildTag?_masterBuildTag:"no build tag";
@@ -424,6 +427,7 @@ int main( int argc, char *argv[]  )
             SetTempDir(tempDirStr.str(), "thtmp", true);
 
             useMemoryMappedRead(globals->getPropBool("@useMemoryMappedRead"));
+            setRemoteFileReadAhead(globals->getPropInt("@remoteReadAheadWindow"), globals->getPropInt("@remoteReadAheadBlockSize", DEFAULT_READAHEAD_BLOCKSIZE), globals->getPropBool("@remoteReadAheadCompress"));
 
             LOG(MCdebugProgress, thorJob, "ThorSlave Version LCR - %d.%d started",THOR_VERSION_MAJOR,THOR_VERSION_MINOR);
             StringBuffer url;
@@ -29,6 +29,7 @@
 #include "jfile.hpp"
 #include "jset.hpp"
 #include "jqueue.tpp"
+#include "jqueue.hpp"
 
 #include "thmem.hpp"
 #include "thalloc.hpp"
@@ -427,49 +428,73 @@ public:
 };
 
 
+#define SMART_BUFFER_MAX_QUEUED_ROWS 0x3f00 // fits the single reader/writer layout of createRowQueue
+
+/* The rows are passed through a lock free queue (see createRowQueue), which only blocks (after spinning) if it is empty
+ * or full.  The total memory footprint of queued rows is also limited, but that is only checked by the writer, and the
+ * reader only signals the writer if it is known to be waiting.
+ */
 class CSmartRowInMemoryBuffer: public CSimpleInterface, implements ISmartRowBuffer, implements IRowWriter
 {
     // NB must *not* call LinkThorRow or ReleaseThorRow (or Owned*ThorRow) if deallocator set
     CActivityBase *activity;
     IThorRowInterfaces *rowIf;
-    ThorRowQueue *in;
-    size32_t insz;
-    SpinLock lock; // MORE: This lock is held for quite long periods.  I suspect it could be significantly optimized.
-    bool waitingin;
+    Owned<IRowQueue> queue;
+    std::atomic<size32_t> insz;
+    std::atomic<unsigned> numQueued;
+    std::atomic<bool> waitingin;
     Semaphore waitinsem;
-    bool waitingout;
-    Semaphore waitoutsem;
     size32_t blocksize;
+    std::atomic<bool> stopped;
     bool eoi;
 #ifdef _DEBUG
     bool putrecheck;
     bool getrecheck;
 #endif
 
+    template <class CONDITION>
+    void waitWriter(CONDITION condition, const char *msg)
+    {
+        // NB: waitingin must be set before the condition is rechecked, and the reader clears it after updating the counts
+        while (!condition() && !stopped)
+        {
+            waitingin = true;
+            if (condition() || stopped)
+                break;
+            if (!waitinsem.wait(1000*60) && msg)
+                ActPrintLogEx(&activity->queryContainer(), thorlog_null, MCwarning, "%s", msg);
+        }
+        waitingin = false;
+    }
+    inline void releaseWriter()
+    {
+        // NB: read first, to avoid writing to the shared flag for every row
+        if (waitingin && waitingin.exchange(false))
+            waitinsem.signal();
+    }
+
 public:
     IMPLEMENT_IINTERFACE_USING(CSimpleInterface);
 
     CSmartRowInMemoryBuffer(CActivityBase *_activity, IThorRowInterfaces *_rowIf, size32_t bufsize)
-        : activity(_activity), rowIf(_rowIf)
+        : activity(_activity), rowIf(_rowIf), insz(0), numQueued(0), waitingin(false), stopped(false)
     {
 #ifdef _DEBUG
         putrecheck = false;
         getrecheck = false;
 #endif
-        in = new ThorRowQueue;
-        waitingin = false;
-        waitingout = false;
+        queue.setown(createRowQueue(1, 1, SMART_BUFFER_MAX_QUEUED_ROWS, 0));
         blocksize = ((bufsize/2+0xfffff)/0x100000)*0x100000;
-        insz = 0;
         eoi = false;
     }
 
     ~CSmartRowInMemoryBuffer()
     {
-        // clear in contents 
-        while (in->ordinality()) 
-            ReleaseThorRow(in->dequeue());
-        delete in;
+        // clear queue contents, reset() allows the queue to be read again if it has been stopped or aborted
+        queue->reset();
+        const void *row;
+        while (queue->tryDequeue(row))
+            ReleaseThorRow(row);
     }
 
     void putRow(const void *row)
@@ -484,31 +509,16 @@ public:
             ActPrintLog(activity, "***putRow(%x) %d  {%x}",(unsigned)row,sz,*(const unsigned *)row);
 #endif
         }
+        if (!stopped && !eoi)
         {
-            SpinBlock block(lock);
-            if (!eoi) {
-                assertex(in);  // reentry check
-                while ((sz+insz>blocksize)&&insz) {
-                    waitingin = true;
-                    {
-                        SpinUnblock unblock(lock);
-                        waitinsem.wait();
-                    }
-                    if (eoi)
-                        break;
-                }
-            }
-            if (!eoi) {
-                in->enqueue(row);
+            if (sz+insz > blocksize)
+                waitWriter([&]() { return (sz+insz <= blocksize) || (0 == numQueued); }, nullptr);
+            if (!stopped)
+            {
                 insz += sz;
-#ifdef _TRACE_SMART_PUTGET
-                ActPrintLog(activity, "***putRow2(%x) insize = %d ",insz);
-#endif
-                if (waitingout) {
-                    waitoutsem.signal();
-                    waitingout = false;
-                }
-                return;
+                ++numQueued;
+                if (queue->enqueue(row))
+                    return;
             }
         }
         // cancelled
@@ -518,38 +528,18 @@ public:
     const void *nextRow()
     {
         REENTRANCY_CHECK(getrecheck)
-        const void * ret;
-        SpinBlock block(lock);
-        assertex(!waitingout);  // reentrancy checks
-        for (;;) {
-            if (in->ordinality()) {
-                ret = in->dequeue();
-                if (ret) {
-                    size32_t sz = thorRowMemoryFootprint(rowIf->queryRowSerializer(), ret);
+        const void *ret;
+        if (stopped || !queue->dequeue(ret))
+            return NULL;
+        if (ret) {
+            size32_t sz = thorRowMemoryFootprint(rowIf->queryRowSerializer(), ret);
 #ifdef _TRACE_SMART_PUTGET
-                    ActPrintLog(activity, "***dequeueRow(%x) %d insize=%d {%x}",(unsigned)ret,sz,insz,*(const unsigned *)ret);
+            ActPrintLog(activity, "***dequeueRow(%x) %d insize=%d {%x}",(unsigned)ret,sz,(size32_t)insz,*(const unsigned *)ret);
 #endif
-                    if (insz<sz) {
-                        ActPrintLog(activity, "CSmartRowInMemoryBuffer::nextRow(%x) %d insize=%d {%x} ord = %d",(unsigned)(memsize_t)ret,sz,insz,*(const unsigned *)ret,in->ordinality());
-                        assertex(insz>=sz);
-                    }
-                    insz -= sz;
-                }
-                break;
-            }
-            else if (eoi) {
-                ret = NULL;
-                break;
-            }
-            assertex(!waitingout);  // reentrancy check
-            waitingout = true;
-            SpinUnblock unblock(lock);
-            waitoutsem.wait();
-        }
-        if (waitingin) {
-            waitinsem.signal();
-            waitingin = false;
+            insz -= sz;
         }
+        --numQueued;
+        releaseWriter();
         return ret;
     }
 
@@ -558,49 +548,21 @@ public:
 #ifdef _FULL_TRACE
         ActPrintLog(activity, "CSmartRowInMemoryBuffer stop %x",(unsigned)(memsize_t)this);
 #endif
-        SpinBlock block(lock);
-#ifdef _DEBUG
-        if (waitingout) {
-            ActPrintLogEx(&activity->queryContainer(), thorlog_null, MCwarning, "CSmartRowInMemoryBuffer::stop while nextRow waiting");
-            PrintStackReport();
-        }
-#endif
-
-        eoi = true;
-        while (in->ordinality()) 
-            ReleaseThorRow(in->dequeue());
-        in->clear();
-        if (waitingin) {
-            waitinsem.signal();
-            waitingin = false;
-        }
+        if (stopped.exchange(true))
+            return;
+        const void *row;
+        while (queue->tryDequeue(row))
+            ReleaseThorRow(row);
+        queue->noteReaderStopped(); // NB: any row enqueued by a racing writer is released when the buffer is destroyed
+        releaseWriter();
     }
 
-
-//  offset_t getPosition()
-//  {
-//      SpinBlock block(lock);
-//      return pos;
-//  }
-
     void flush()
     {
         // I think flush should wait til all rows read
-        SpinBlock block(lock);
         eoi = true;
-        for (;;) {
-            assertex(in);  // reentry check
-            if (waitingout) {
-                waitoutsem.signal();
-                waitingout = false;
-            }
-            if (!in->ordinality()) 
-                break;
-            waitingin = true;
-            SpinUnblock unblock(lock);
-            while (!waitinsem.wait(1000*60))
-                ActPrintLogEx(&activity->queryContainer(), thorlog_null, MCwarning, "CSmartRowInMemoryBuffer::flush stalled");
-        }
+        queue->noteWriterStopped();
+        waitWriter([&]() { return 0 == numQueued; }, "CSmartRowInMemoryBuffer::flush stalled");
     }
 
     IRowWriter *queryWriter()
@@ -1652,171 +1614,152 @@ ISharedSmartBuffer *createSharedSmartMemBuffer(CActivityBase *activity, unsigned
 }
 
 
+#define SHARED_WRITE_MAX_WRITERS 127 // max # of writers that can be blocked on the queue concurrently
+#define SHARED_WRITE_MAX_BLOCKS 254
+
+/* Writers commit blocks of writeGranularity rows to a lock free queue (see createRowQueue), which the reader consumes
+ * a block at a time.  The queue holds at most limit rows worth of blocks.  A NULL block marks the end of the writers.
+ */
 class CRowMultiWriterReader : public CSimpleInterface, implements IRowMultiWriterReader
 {
-    rowidx_t readGranularity, writeGranularity, rowPos, limit, rowsToRead;
-    CThorSpillableRowArray rows;
-    const void **readRows;
+    typedef CThorExpandingRowArray RowBlock;
+
     CActivityBase &activity;
     IThorRowInterfaces *rowIf;
-    bool readerBlocked, eos, eow;
-    Semaphore emptySem, fullSem;
-    unsigned numWriters, writersComplete, writersBlocked;
+    rowidx_t writeGranularity, rowPos;
+    Owned<IRowQueue> queue;
+    RowBlock *readBlock;
+    std::atomic<bool> eos;
+    CriticalSection writersCrit;
+    unsigned numWriters, writersComplete;
 
     class CAWriter : public CSimpleInterface, implements IRowWriter
     {
         CRowMultiWriterReader &owner;
-        CThorExpandingRowArray rows;
+        RowBlock *rows;
     public:
         IMPLEMENT_IINTERFACE_USING(CSimpleInterface);
 
-        CAWriter(CRowMultiWriterReader &_owner) : owner(_owner), rows(_owner.activity, _owner.rowIf)
+        CAWriter(CRowMultiWriterReader &_owner) : owner(_owner), rows(nullptr)
         {
         }
         ~CAWriter()
         {
             flush();
+            delete rows;
             owner.writerStopped();
         }
     // IRowWriter impl.
         virtual void putRow(const void *row)
         {
-            if (rows.ordinality() >= owner.writeGranularity)
+            if (!rows)
+                rows = owner.createBlock();
+            else if (rows->ordinality() >= owner.writeGranularity)
+            {
                 owner.addRows(rows);
-            rows.append(row);
+                rows = owner.createBlock();
+            }
+            rows->append(row);
         }
         virtual void flush()
         {
-            if (rows.ordinality())
+            if (rows && rows->ordinality())
+            {
                 owner.addRows(rows);
+                rows = nullptr;
+            }
         }
     };
 
-    void addRows(CThorExpandingRowArray &inRows)
+    RowBlock *createBlock()
     {
-        for (;;)
-        {
-            {
-                CThorArrayLockBlock block(rows);
-                if (eos)
-                {
-                    inRows.kill();
-                    return;
-                }
-                if (rows.numCommitted() < limit)
-                {
-                    // NB: allowed to go over limit, by as much as inRows.ordinality()-1
-                    rows.appendRows(inRows, true);
-                    if (rows.numCommitted() >= readGranularity)
-                        checkReleaseReader();
-                    return;
-                }
-                writersBlocked++;
-            }
-            fullSem.wait();
-        }
+        return new RowBlock(activity, rowIf, ers_forbidden, stableSort_none, true, writeGranularity);
     }
-    inline void checkReleaseReader()
+    void addRows(RowBlock *block)
     {
-        if (readerBlocked)
-        {
-            emptySem.signal();
-            readerBlocked = false;
-        }
+        // NB: takes ownership of block
+        if (eos || !queue->enqueue(block))
+            delete block;
     }
-    inline void checkReleaseWriters()
+    void clearQueue()
     {
-        if (writersBlocked)
-        {
-            fullSem.signal(writersBlocked);
-            writersBlocked = 0;
-        }
+        queue->reset();
+        const void *next;
+        while (queue->tryDequeue(next))
+            delete (RowBlock *)next;
     }
 public:
     IMPLEMENT_IINTERFACE_USING(CSimpleInterface);
 
-    CRowMultiWriterReader(CActivityBase &_activity, IThorRowInterfaces *_rowIf, unsigned _limit, unsigned _readGranularity, unsigned _writerGranularity)
-        : activity(_activity), rowIf(_rowIf), rows(_activity, _rowIf), limit(_limit), readGranularity(_readGranularity), writeGranularity(_writerGranularity)
-    {
-        if (readGranularity > limit)
-            readGranularity = limit; // readGranularity must be <= limit;
-        numWriters = 0;
-        readRows = static_cast<const void * *>(activity.queryRowManager()->allocate(readGranularity * sizeof(void*), activity.queryContainer().queryId()));
-        eos = eow = readerBlocked = false;
-        rowPos = rowsToRead = 0;
-        writersComplete = writersBlocked = 0;
-        rows.setup(rowIf, ers_forbidden, stableSort_none, true); // turning on throwOnOom;
+    CRowMultiWriterReader(CActivityBase &_activity, IThorRowInterfaces *_rowIf, unsigned limit, unsigned _readGranularity, unsigned _writerGranularity)
+        : activity(_activity), rowIf(_rowIf), writeGranularity(_writerGranularity), eos(false)
+    {
+        // NB: readGranularity is no longer used, the reader consumes a block at a time without contending with the writers
+        if (0 == writeGranularity)
+            writeGranularity = 1;
+        unsigned maxBlocks = limit / writeGranularity;
+        if (maxBlocks < 2)
+            maxBlocks = 2;
+        else if (maxBlocks > SHARED_WRITE_MAX_BLOCKS)
+            maxBlocks = SHARED_WRITE_MAX_BLOCKS;
+        queue.setown(createRowQueue(1, SHARED_WRITE_MAX_WRITERS, maxBlocks, 0));
+        numWriters = writersComplete = 0;
+        readBlock = nullptr;
+        rowPos = 0;
     }
     ~CRowMultiWriterReader()
     {
-        roxiemem::ReleaseRoxieRowRange(readRows, rowPos, rowsToRead);
-        ReleaseThorRow(readRows);
+        delete readBlock;
+        clearQueue();
     }
     void writerStopped()
     {
-        CThorArrayLockBlock block(rows);
-        writersComplete++;
-        if (writersComplete == numWriters)
         {
-            rows.flush();
-            eow = true;
-            checkReleaseReader();
+            CriticalBlock block(writersCrit);
+            writersComplete++;
+            if (writersComplete != numWriters)
+                return;
         }
+        if (!eos)
+            queue->enqueue(nullptr); // end of writers
     }
 // ISharedWriteBuffer impl.
     virtual IRowWriter *getWriter()
     {
-        CThorArrayLockBlock block(rows);
+        CriticalBlock block(writersCrit);
         ++numWriters;
+        assertex(numWriters <= SHARED_WRITE_MAX_WRITERS);
         return new CAWriter(*this);
     }
     virtual void abort()
     {
-        CThorArrayLockBlock block(rows);
         eos = true;
-        checkReleaseWriters();
-        checkReleaseReader();
+        queue->abort();
     }
 // IRowStream impl.
     virtual const void *nextRow()
     {
         if (eos)
             return NULL;
-        if (rowPos == rowsToRead)
+        while (!readBlock || (rowPos == readBlock->ordinality()))
         {
-            for (;;)
+            delete readBlock;
+            readBlock = nullptr;
+            const void *next;
+            if (!queue->dequeue(next) || !next)
             {
-                {
-                    CThorArrayLockBlock block(rows);
-                    if (rows.numCommitted() >= readGranularity || eow)
-                    {
-                        rowsToRead = (eow && rows.numCommitted() < readGranularity) ? rows.numCommitted() : readGranularity;
-                        if (0 == rowsToRead)
-                        {
-                            eos = true;
-                            return NULL;
-                        }
-                        rows.readBlock(readRows, rowsToRead);
-                        rowPos = 0;
-                        checkReleaseWriters();
-                        break; // fall through to return a row
-                    }
-                    readerBlocked = true;
-                }
-                emptySem.wait();
-                if (eos)
-                    return NULL;
+                eos = true;
+                return NULL;
             }
+            readBlock = (RowBlock *)next;
+            rowPos = 0;
         }
-        const void *row = readRows[rowPos];
-        readRows[rowPos] = NULL;
-        ++rowPos;
-        return row;
+        return readBlock->getClear(rowPos++);
     }
     virtual void stop()
     {
         eos = true;
-        checkReleaseWriters();
+        queue->abort(); // release any blocked writers, queued rows are released when destroyed
     }
 };
 
@@ -62,6 +62,7 @@ static Owned<ILargeMemLimitNotify> MTthresholdnotify;
 static bool MTlocked = false;
 
 #define DEFAULT_SORT_COMPBLKSZ 0x10000 // 64K
+#define ASYNC_SPILL_READ_MAXFILES 32 // max # of spill files read back with read ahead threads
 
 void checkMultiThorMemoryThreshold(bool inc)
 {
@@ -1349,6 +1350,8 @@ rowidx_t CThorSpillableRowArray::save(IFile &iFile, unsigned _spillCompInfo, boo
         rwFlags |= _spillCompInfo;
     }
     rwFlags |= mapESRToRWFlags(emptyRowSemantics);
+    if (asyncSpill)
+        rwFlags |= rw_async;
 
     // NB: This is always called within a CThorArrayLockBlock, as such no writebacks are added or updating
     rowidx_t nextCBI = RCIDXMAX; // indicates none
@@ -1362,6 +1365,7 @@ rowidx_t CThorSpillableRowArray::save(IFile &iFile, unsigned _spillCompInfo, boo
         nextCB = &cbCopy.popGet();
         nextCBI = nextCB->queryRecordNumber();
     }
+    CCycleTimer saveTimer;
     Owned<IExtRowWriter> writer = createRowWriter(&iFile, rowIf, rwFlags, nullptr, compBlkSz);
     rowidx_t i=0;
     rowidx_t rowsWritten=0;
@@ -1410,8 +1414,12 @@ rowidx_t CThorSpillableRowArray::save(IFile &iFile, unsigned _spillCompInfo, boo
     }
     firstRow += n;
     offset_t bytesWritten = writer->getPosition();
+    cycle_t stallCycles = writer->getStatistic(StCycleSpillStallCycles);
+    spillStallCycles += stallCycles;
     writer.clear();
-    ActPrintLog(&activity, "%s: CThorSpillableRowArray::save done, rows written = %" RIPF "u, bytes = %" I64F "u", tracingPrefix, rowsWritten, (__int64)bytesWritten);
+    unsigned elapsedMs = saveTimer.elapsedMs();
+    double mbPerSec = elapsedMs ? ((double)bytesWritten / 0x100000) / ((double)elapsedMs / 1000) : 0.0;
+    ActPrintLog(&activity, "%s: CThorSpillableRowArray::save done, rows written = %" RIPF "u, bytes = %" I64F "u, time = %ums (%.1f MB/s), stalled = %ums", tracingPrefix, rowsWritten, (__int64)bytesWritten, elapsedMs, mbPerSec, (unsigned)cycle_to_millisec(stallCycles));
     return n;
 }
 
@@ -1569,6 +1577,48 @@ IRowStream *CThorSpillableRowArray::createRowStream(unsigned spillPriority, unsi
 
 
 
+// Time spent waiting for read ahead threads by a collector's spill read back streams, which may outlive the collector
+class CSpillReadStallCounter : public CSimpleInterface
+{
+public:
+    RelaxedAtomic<cycle_t> cycles{0};
+};
+
+// Adds the stream's read ahead stall time to the collector's when it is stopped (or released unfinished)
+class CSpillReadStreamOwner : public CStreamFileOwner
+{
+    Linked<CSpillReadStallCounter> stallCounter;
+
+    void collectStall()
+    {
+        if (stallCounter)
+        {
+            // before stopping, which may close the file and discard its statistics
+            stallCounter->cycles += CStreamFileOwner::getStatistic(StCycleSpillStallCycles);
+            stallCounter.clear();
+        }
+    }
+public:
+    CSpillReadStreamOwner(CFileOwner *_fileOwner, IExtRowStream *_stream, CSpillReadStallCounter *_stallCounter)
+        : CStreamFileOwner(_fileOwner, _stream), stallCounter(_stallCounter)
+    {
+    }
+    ~CSpillReadStreamOwner()
+    {
+        collectStall();
+    }
+    virtual void stop() override
+    {
+        collectStall();
+        CStreamFileOwner::stop(nullptr);
+    }
+    virtual void stop(CRC32 *crcout=NULL) override
+    {
+        collectStall();
+        CStreamFileOwner::stop(crcout);
+    }
+};
+
 class CThorRowCollectorBase : public CSpillable
 {
 protected:
@@ -1588,6 +1638,8 @@ protected:
     Owned<CSharedSpillableRowSet> spillableRowSet;
     unsigned options;
     unsigned spillCompInfo = 0;
+    bool asyncSpill = false;
+    Owned<CSpillReadStallCounter> spillReadStall;
     __uint64 spillCycles;
     __uint64 sortCycles;
 
@@ -1710,12 +1762,18 @@ protected:
             rwFlags |= spillCompInfo;
         }
         rwFlags |= mapESRToRWFlags(emptyRowSemantics);
+        // Each read ahead stream has its own thread and buffers, so only use them if merging a modest number of files
+        if (asyncSpill && (spillFiles.ordinality() <= ASYNC_SPILL_READ_MAXFILES))
+            rwFlags |= rw_async;
         IArrayOf<IRowStream> instrms;
         ForEachItemIn(f, spillFiles)
         {
             CFileOwner *fileOwner = spillFiles.item(f);
             Owned<IExtRowStream> strm = createRowStream(&fileOwner->queryIFile(), rowIf, rwFlags);
-            instrms.append(* new CStreamFileOwner(fileOwner, strm));
+            if (TestRwFlag(rwFlags, rw_async))
+                instrms.append(* new CSpillReadStreamOwner(fileOwner, strm, spillReadStall));
+            else
+                instrms.append(* new CStreamFileOwner(fileOwner, strm));
         }
 
         {
@@ -1770,7 +1828,8 @@ protected:
         else if (iCompare)
         {
             Owned<IRowLinkCounter> linkcounter = new CThorRowLinkCounter;
-            return createRowStreamMerger(instrms.ordinality(), instrms.getArray(), iCompare, false, linkcounter);
+            unsigned mergeThreads = activity.getOptUInt(THOROPT_SORT_MERGETHREADS, 1);
+            return createParallelRowStreamMerger(instrms.ordinality(), instrms.getArray(), iCompare, false, linkcounter, mergeThreads);
         }
         else
             return createConcatRowStream(instrms.ordinality(),instrms.getArray());
@@ -1805,6 +1864,9 @@ public:
             activity.getOpt(THOROPT_COMPRESS_SPILL_TYPE, compType);
             setCompFlag(compType, spillCompInfo);
         }
+        asyncSpill = activity.getOptBool(THOROPT_SPILL_ASYNC, true);
+        spillableRows.setAsyncSpill(asyncSpill);
+        spillReadStall.setown(new CSpillReadStallCounter);
         spillCycles = 0;
         sortCycles = 0;
         if (iCompare)
@@ -1927,6 +1989,10 @@ public:
             return overflowCount;
         case StSizeSpillFile:
             return sizeSpill;
+        case StCycleSpillStallCycles:
+            return spillableRows.querySpillStallCycles() + spillReadStall->cycles;
+        case StTimeSpillStall:
+            return cycle_to_nanosec(spillableRows.querySpillStallCycles() + spillReadStall->cycles);
         }
         return 0;
     }
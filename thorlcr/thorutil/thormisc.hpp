@@ -64,6 +64,11 @@
 #define THOROPT_JOINHELPER_THREADS    "joinHelperThreads"       // Number of threads to use in threaded variety of join helper
 #define THOROPT_LKJOIN_LOCALFAILOVER  "lkjoin_localfailover"    // Force SMART to failover to distributed local lookup join (for testing only)   (default = false)
 #define THOROPT_LKJOIN_HASHJOINFAILOVER "lkjoin_hashjoinfailover" // Force SMART to failover to hash join (for testing only)                     (default = false)
+#define THOROPT_LKJOIN_TAGTABLE       "lkjoin_tagtable"         // Use the tagged (packed hash fingerprint) lookup join table                    (default = false)
+#define THOROPT_LKJOIN_PARTITIONBUILD "lkjoin_partitionbuild"   // Radix partition the tagged lookup join table build, to fit each pass in L2    (default = false)
+#define THOROPT_LKJOIN_PROBEBATCH     "lkjoin_probebatch"       // # of LHS rows hashed and prefetched ahead of probing the lookup join table    (default = 0 [off])
+#define THOROPT_LKJOIN_PROBESTRANDS   "lkjoin_probestrands"     // # of strands probing the lookup/all join table in parallel, if LHS ungrouped  (default = PARALLEL or forceNumStrands)
+#define THOROPT_LKJOIN_BUILDTHREADS   "lkjoin_buildthreads"     // # of threads used to build the lookup join hash table                         (default = 1)
 #define THOROPT_MAX_KERNLOG           "max_kern_level"          // Max kernel logging level, to push to workunit, -1 to disable                  (default = 3)
 #define THOROPT_COMP_FORCELZW         "forceLZW"                // Forces file compression to use LZW                                            (default = false)
 #define THOROPT_COMP_FORCEFLZ         "forceFLZ"                // Forces file compression to use FLZ                                            (default = false)
@@ -74,8 +79,11 @@
 #define THOROPT_WRITE_CRC             "crcWriteEnabled"         // Calculate CRC's for disk outputs and store in file meta data                  (default = true)
 #define THOROPT_READCOMPRESSED_CRC    "crcReadCompressedEnabled"  // Enabled CRC validation on compressed disk reads if file CRC are available   (default = false)
 #define THOROPT_WRITECOMPRESSED_CRC   "crcWriteCompressedEnabled" // Calculate CRC's for compressed disk outputs and store in file meta data     (default = false)
+#define THOROPT_REMOTE_FILTER         "remoteFilter"            // Filter disk reads of remote parts within dafilesrv                            (default = true)
 #define THOROPT_CHILD_GRAPH_INIT_TIMEOUT "childGraphInitTimeout"  // Time to wait for child graphs to respond to initialization                  (default = 5*60 seconds)
 #define THOROPT_SORT_COMPBLKSZ        "sortCompBlkSz"           // Block size used by compressed spill in a spilling sort                        (default = 0, uses row writer default)
+#define THOROPT_SORT_MERGETHREADS     "sortMergeThreads"        // # of threads used to merge sorted runs in sorts and spilling collectors       (default = 1, 0 = one per cpu)
+#define THOROPT_SPILL_ASYNC           "asyncSpill"              // Compress and write spills (and read them back) on background threads          (default = true)
 
 #define INITIAL_SELFJOIN_MATCH_WARNING_LEVEL 20000  // max of row matches before selfjoin emits warning
 
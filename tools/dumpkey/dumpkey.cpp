@@ -43,6 +43,7 @@ void usage()
         "  node=[n]            - dump node n (0 = just header)\n"
         "  fpos=[n]            - dump node at offset fpos\n"
         "  recs=[n]            - dump n rows\n"
+        "  seeks=[n]           - time n seeks to keys sampled from the index, with and without search prefixes\n"
         "  -H                  - hex display\n"
         "  -R                  - raw output\n"
                     );
@@ -52,6 +53,43 @@ void usage()
     _exit(2);
 }
 
+void timeSeeks(IKeyIndex *index, size32_t keySize, unsigned numSeeks)
+{
+    // Sample every nth key so that the seeks are spread over the whole index
+    Owned<IKeyCursor> cursor = index->getCursor(NULL);
+    MemoryBuffer allKeys;
+    char *buffer = (char *) alloca(keySize);
+    unsigned numKeys = 0;
+    for (bool ok = cursor->first(buffer); ok; ok = cursor->next(buffer))
+    {
+        allKeys.append(keySize, buffer);
+        numKeys++;
+    }
+    if (!numKeys || !numSeeks)
+        return;
+    MemoryBuffer probes;
+    Owned<IRandomNumberGenerator> random = createRandomNumberGenerator();
+    random->seed(numKeys);
+    for (unsigned i = 0; i < numSeeks; i++)
+        probes.append(keySize, allKeys.toByteArray() + (size_t)(random->next() % numKeys) * keySize);
+
+    bool oldSearchPrefixes = useNodeSearchPrefixes;
+    for (unsigned pass = 0; pass < 2; pass++)
+    {
+        useNodeSearchPrefixes = (pass != 0);
+        clearNodeCache();   // prefixes are built when a node is loaded
+        cursor.setown(index->getCursor(NULL));
+        for (unsigned i = 0; i < numSeeks; i++)
+            cursor->gtEqual(probes.toByteArray() + (size_t)i * keySize, buffer);    // warm the cache
+        cycle_t start = get_cycles_now();
+        for (unsigned i = 0; i < numSeeks; i++)
+            cursor->gtEqual(probes.toByteArray() + (size_t)i * keySize, buffer);
+        unsigned __int64 elapsedNs = cycle_to_nanosec(get_cycles_now() - start);
+        printf("%s: %u seeks in %" I64F "u us (%" I64F "u ns/seek)\n", useNodeSearchPrefixes ? "Prefix search" : "Binary search", numSeeks, elapsedNs / 1000, elapsedNs / numSeeks);
+    }
+    useNodeSearchPrefixes = oldSearchPrefixes;
+}
+
 void doOption(const char *opt)
 {
     switch (toupper(opt[1]))
@@ -118,7 +156,11 @@ int main(int argc, const char **argv)
         }
         char *buffer = (char*)alloca(key_size);
 
-        if (globals->hasProp("node"))
+        if (globals->hasProp("seeks"))
+        {
+            timeSeeks(index, key_size, globals->getPropInt("seeks"));
+        }
+        else if (globals->hasProp("node"))
         {
             if (stricmp(globals->queryProp("node"), "all")==0)
             {